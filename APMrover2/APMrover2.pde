@@ -138,7 +138,7 @@ AP_Param param_loader(var_info);
 ////////////////////////////////////////////////////////////////////////////////
 // the rate we run the main loop at
 ////////////////////////////////////////////////////////////////////////////////
-static const AP_InertialSensor::Sample_rate ins_sample_rate = AP_InertialSensor::RATE_50HZ;
+static const AP_InertialSensor::Sample_rate ins_sample_rate = (AP_InertialSensor::Sample_rate)MAIN_LOOP_RATE;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Parameters
@@ -412,6 +412,22 @@ static AP_Frsky_Telem frsky_telemetry(ahrs, battery);
 // The instantaneous desired lateral acceleration in m/s/s
 static float lateral_acceleration;
 
+// speed targets set by calc_throttle() at 50Hz and followed by
+// update_throttle() every loop
+static struct {
+    // are the targets current for an auto-throttle mode?
+    bool active;
+    // target ground speed after the turn reduction in m/s
+    float target_speed;
+    // feed-forward throttle in percent, including the nudge
+    int16_t throttle_target;
+    // turn reduction factor, applied to the throttle as well
+    float reduction;
+    // is update_throttle() using reverse throttle to brake? This
+    // doesn't change in_reverse, as the rover is still moving forward
+    bool braking;
+} speed_control;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Waypoint distances
 ////////////////////////////////////////////////////////////////////////////////
@@ -469,6 +485,8 @@ static uint32_t 	fast_loopTimer_us;
 static uint32_t		delta_us_fast_loop;
 // Counter of main loop executions.  Used for performance monitoring and failsafe processing
 static uint16_t			mainLoop_count;
+// Counts main loops towards the next 20ms scheduler tick
+static uint8_t          loops_this_tick;
 
 // set if we are driving backwards
 static bool in_reverse;
@@ -480,38 +498,47 @@ static bool in_reverse;
 /*
   scheduler table - all regular tasks should be listed here, along
   with how often they should be called (in 20ms units) and the maximum
-  time they are expected to take (in microseconds)
+  time they are expected to take (in microseconds). The AHRS, the
+  steering and speed controllers and the servo output are not in the
+  table, they run every loop in fast_loop()
+
+  The times are for the APM2, where a tick is one 20ms loop. A task
+  only runs if its time fits in what is left of one loop, so at higher
+  loop rates they are scaled down to the same share of the shorter
+  loop. The 32 bit boards that run faster loops take far less than
+  that
  */
+#define TASK_MICROS(us) ((us) / MAIN_LOOPS_PER_TICK)
+
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
-	{ read_radio,             1,   1000 },
-    { ahrs_update,            1,   6400 },
-    { read_sonars,            1,   2000 },
-    { update_current_mode,    1,   1500 },
-    { set_servos,             1,   1500 },
-    { update_GPS_50Hz,        1,   2500 },
-    { update_GPS_10Hz,        5,   2500 },
-    { update_alt,             5,   3400 },
-    { navigate,               5,   1600 },
-    { update_compass,         5,   2000 },
-    { update_commands,        5,   1000 },
-    { update_logging1,        5,   1000 },
-    { update_logging2,        5,   1000 },
-    { gcs_retry_deferred,     1,   1000 },
-    { gcs_update,             1,   1700 },
-    { gcs_data_stream_send,   1,   3000 },
-    { read_control_switch,   15,   1000 },
-    { read_trim_switch,       5,   1000 },
-    { read_battery,           5,   1000 },
-    { read_receiver_rssi,     5,   1000 },
-    { update_events,          1,   1000 },
-    { check_usb_mux,         15,   1000 },
-    { mount_update,           1,    600 },
-    { gcs_failsafe_check,     5,    600 },
-    { compass_accumulate,     1,    900 },
-    { update_notify,          1,    300 },
-    { one_second_loop,       50,   3000 },
+    { read_radio,              1, TASK_MICROS(1000) },
+    { read_sonars,             1, TASK_MICROS(2000) },
+    { update_current_mode,     1, TASK_MICROS(1500) },
+    { update_logging_50Hz,     1, TASK_MICROS(1000) },
+    { update_GPS_50Hz,         1, TASK_MICROS(2500) },
+    { update_GPS_10Hz,         5, TASK_MICROS(2500) },
+    { update_alt,              5, TASK_MICROS(3400) },
+    { navigate,                5, TASK_MICROS(1600) },
+    { update_compass,          5, TASK_MICROS(2000) },
+    { update_commands,         5, TASK_MICROS(1000) },
+    { update_logging1,         5, TASK_MICROS(1000) },
+    { update_logging2,         5, TASK_MICROS(1000) },
+    { gcs_retry_deferred,      1, TASK_MICROS(1000) },
+    { gcs_update,              1, TASK_MICROS(1700) },
+    { gcs_data_stream_send,    1, TASK_MICROS(3000) },
+    { read_control_switch,    15, TASK_MICROS(1000) },
+    { read_trim_switch,        5, TASK_MICROS(1000) },
+    { read_battery,            5, TASK_MICROS(1000) },
+    { read_receiver_rssi,      5, TASK_MICROS(1000) },
+    { update_events,           1, TASK_MICROS(1000) },
+    { check_usb_mux,          15, TASK_MICROS(1000) },
+    { mount_update,            1, TASK_MICROS(600)  },
+    { gcs_failsafe_check,      5, TASK_MICROS(600)  },
+    { compass_accumulate,      1, TASK_MICROS(900)  },
+    { update_notify,           1, TASK_MICROS(300)  },
+    { one_second_loop,        50, TASK_MICROS(3000) },
 #if FRSKY_TELEM_ENABLED == ENABLED
-    { frsky_telemetry_send,  10,    100 }
+    { frsky_telemetry_send,   10, TASK_MICROS(100)  }
 #endif
 };
 
@@ -560,10 +587,43 @@ void loop()
 
     mainLoop_count++;
 
-    // tell the scheduler one tick has passed
-    scheduler.tick();
+    // run the AHRS and the low level controllers on every IMU sample
+    fast_loop();
 
-    scheduler.run(19500U);
+    // tell the scheduler one tick has passed every 20ms
+    if (++loops_this_tick >= MAIN_LOOPS_PER_TICK) {
+        loops_this_tick = 0;
+        scheduler.tick();
+    }
+
+    // run the scheduler tasks in the time left before the next
+    // sample. Tasks only run once per tick, so at the higher loop
+    // rates they spread out over the loops of the tick
+    uint32_t time_available = (timer + MAIN_LOOP_MICROS) - hal.scheduler->micros();
+    if (time_available > MAIN_LOOP_MICROS) {
+        time_available = 0;
+    }
+    scheduler.run(time_available);
+}
+
+/*
+  the part of the main loop that runs at the IMU rate. Navigation
+  sets the lateral acceleration and speed targets at 50Hz, which are
+  followed here at the full loop rate
+ */
+static void fast_loop()
+{
+    ahrs_update();
+
+    update_steering();
+
+    update_throttle();
+
+    set_servos();
+
+#if CAMERA == ENABLED
+    camera.update_fast();
+#endif
 }
 
 // update AHRS system
@@ -588,8 +648,22 @@ static void ahrs_update()
     Vector3f velocity;
     if (ahrs.get_velocity_NED(velocity)) {
         ground_speed = pythagorous2(velocity.x, velocity.y);
+    } else if (gps.status() >= AP_GPS::GPS_OK_FIX_3D &&
+               hal.scheduler->millis() - gps.last_fix_time_ms() < 500) {
+        // without the EKF carry the GPS speed on between fixes with
+        // the forward acceleration, less the part due to gravity when
+        // on a slope. Each new fix resets the speed in update_GPS_10Hz()
+        float forward_accel = ins.get_accel().x - GRAVITY_MSS * sinf(ahrs.pitch);
+        float forward_speed = (in_reverse ? -ground_speed : ground_speed) + forward_accel * G_Dt;
+        ground_speed = fabsf(forward_speed);
     }
+}
 
+/*
+  logging that was done by ahrs_update() when it ran at 50Hz
+ */
+static void update_logging_50Hz(void)
+{
     if (should_log(MASK_LOG_ATTITUDE_FAST))
         Log_Write_Attitude();
 
@@ -606,6 +680,9 @@ static void mount_update(void)
 	camera_mount.update();
 #endif
 #if CAMERA == ENABLED
+    if (camera.update_trigger(ahrs)) {
+        log_picture();
+    }
     camera.trigger_pic_cleanup();
 #endif
 }
@@ -791,12 +868,6 @@ static void update_GPS_10Hz(void)
         } else {
             ground_speed   = gps.ground_speed();
         }
-
-#if CAMERA == ENABLED
-        if (camera.update_location(current_loc) == true) {
-            do_take_picture();
-        }
-#endif        
 	}
 }
 
@@ -179,6 +179,7 @@ struct PACKED log_Performance {
     int16_t  gyro_drift_z;
     uint8_t  i2c_lockup_count;
     uint16_t ins_error_count;
+    uint16_t max_lateness;
 };
 
 // Write a performance monitoring packet. Total length : 19 bytes
@@ -194,7 +195,8 @@ static void Log_Write_Performance()
         gyro_drift_y    : (int16_t)(ahrs.get_gyro_drift().y * 1000),
         gyro_drift_z    : (int16_t)(ahrs.get_gyro_drift().z * 1000),
         i2c_lockup_count: hal.i2c->lockup_count(),
-        ins_error_count  : ins.error_count()
+        ins_error_count  : ins.error_count(),
+        max_lateness     : scheduler.max_lateness()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
 }
@@ -377,7 +379,7 @@ static void Log_Write_Baro(void)
 static const struct LogStructure log_structure[] PROGMEM = {
     LOG_COMMON_STRUCTURES,
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
-      "PM",  "IIHIhhhBH", "TimeMS,LTime,MLC,gDt,GDx,GDy,GDz,I2CErr,INSErr" },
+      "PM",  "IIHIhhhBHH", "TimeMS,LTime,MLC,gDt,GDx,GDy,GDz,I2CErr,INSErr,MaxLate" },
     { LOG_STARTUP_MSG, sizeof(log_Startup),         
       "STRT", "IBH",        "TimeMS,SType,CTot" },
     { LOG_CTUN_MSG, sizeof(log_Control_Tuning),     
@@ -80,11 +80,13 @@ static bool use_pivot_steering(void)
 
 
 /*
-  calculate the throtte for auto-throttle modes
+  calculate the speed targets for auto-throttle modes. The throttle
+  itself is worked out by update_throttle() at the main loop rate
  */
 static void calc_throttle(float target_speed)
 {  
     if (!auto_check_trigger()) {
+        speed_control.active = false;
         channel_throttle->servo_out = g.throttle_min.get();
         return;
     }
@@ -116,15 +118,31 @@ static void calc_throttle(float target_speed)
     }
     
     // reduce the target speed by the reduction factor
-    target_speed *= reduction;
+    speed_control.target_speed = target_speed * reduction;
+    speed_control.throttle_target = throttle_target;
+    speed_control.reduction = reduction;
+    speed_control.active = true;
+}
 
-    groundspeed_error = fabsf(target_speed) - ground_speed; 
+/*
+  run the speed controller towards the targets from calc_throttle(),
+  called every loop
+ */
+static void update_throttle(void)
+{
+    if (!speed_control.active) {
+        return;
+    }
+    bool was_braking = speed_control.braking;
+    speed_control.braking = false;
+
+    groundspeed_error = fabsf(speed_control.target_speed) - ground_speed; 
     
-    throttle = throttle_target + (g.pidSpeedThrottle.get_pid(groundspeed_error * 100) / 100);
+    throttle = speed_control.throttle_target + (g.pidSpeedThrottle.get_pid(groundspeed_error * 100) / 100);
 
     // also reduce the throttle by the reduction factor. This gives a
     // much faster response in turns
-    throttle *= reduction;
+    throttle *= speed_control.reduction;
 
     if (in_reverse) {
         channel_throttle->servo_out = constrain_int16(-throttle, -g.throttle_max, -g.throttle_min);
@@ -144,9 +162,13 @@ static void calc_throttle(float target_speed)
         int16_t braking_throttle = g.throttle_max * (g.braking_percent * 0.01f) * brake_gain;
         channel_throttle->servo_out = constrain_int16(-braking_throttle, -g.throttle_max, -g.throttle_min);
 
-        // temporarily set us in reverse to allow the PWM setting to
-        // go negative
-        set_reverse(true);
+        // allow the PWM setting to go negative for this loop. The
+        // speed integrator is reset when braking starts, as it was
+        // built up driving forward
+        speed_control.braking = true;
+        if (!was_braking) {
+            g.pidSpeedThrottle.reset_I();
+        }
     }
     
     if (use_pivot_steering()) {
@@ -190,7 +212,7 @@ static void calc_lateral_acceleration()
 }
 
 /*
-  calculate steering angle given lateral_acceleration
+  finish the lateral acceleration demand for the steering controller
  */
 static void calc_nav_steer()
 {
@@ -199,8 +221,24 @@ static void calc_nav_steer()
 
     // constrain to max G force
     lateral_acceleration = constrain_float(lateral_acceleration, -g.turn_max_g*GRAVITY_MSS, g.turn_max_g*GRAVITY_MSS);
+}
 
-    channel_steer->servo_out = steerController.get_steering_out_lat_accel(lateral_acceleration);
+/*
+  run the steering controller towards the lateral acceleration from
+  calc_nav_steer(), called every loop
+ */
+static void update_steering(void)
+{
+    switch (control_mode) {
+    case AUTO:
+    case RTL:
+    case GUIDED:
+    case STEERING:
+        channel_steer->servo_out = steerController.get_steering_out_lat_accel(lateral_acceleration);
+        break;
+    default:
+        break;
+    }
 }
 
 /*****************************************
@@ -223,7 +261,7 @@ static void set_servos(void)
         }
 	} else {       
         channel_steer->calc_pwm();
-        if (in_reverse) {
+        if (in_reverse || speed_control.braking) {
             channel_throttle->servo_out = constrain_int16(channel_throttle->servo_out, 
                                                           -g.throttle_max,
                                                           -g.throttle_min);
@@ -331,6 +331,6 @@ static void log_picture()
 {
     gcs_send_message(MSG_CAMERA_FEEDBACK);
     if (should_log(MASK_LOG_CAMERA)) {
-        DataFlash.Log_Write_Camera(ahrs, gps, current_loc);
+        camera.log_picture(DataFlash, gps, ahrs, current_loc);
     }
 }
@@ -92,6 +92,21 @@
 # define MAV_SYSTEM_ID		1
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+// MAIN_LOOP_RATE
+//
+// the AHRS and the steering and speed controllers run at this rate,
+// the scheduler tasks including navigation still run in 20ms ticks
+#ifndef MAIN_LOOP_RATE
+# if HAL_CPU_CLASS >= HAL_CPU_CLASS_150
+#  define MAIN_LOOP_RATE    200
+# else
+#  define MAIN_LOOP_RATE    50
+# endif
+#endif
+#define MAIN_LOOP_MICROS    (1000000UL / MAIN_LOOP_RATE)
+#define MAIN_LOOPS_PER_TICK (MAIN_LOOP_RATE / 50)
+
 
 //////////////////////////////////////////////////////////////////////////////
 // FrSky telemetry support
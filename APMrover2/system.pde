@@ -279,6 +279,9 @@ static void set_mode(enum mode mode)
     throttle = 500;
     set_reverse(false);
     g.pidSpeedThrottle.reset_I();
+    speed_control.active = false;
+    speed_control.braking = false;
+    lateral_acceleration = 0;
 
     if (control_mode != AUTO) {
         auto_triggered = false;
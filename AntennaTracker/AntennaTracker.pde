@@ -177,10 +177,20 @@ static struct {
     Location location_estimate; // lat, long in degrees * 10^7; alt in meters * 100
     uint32_t last_update_us;    // last position update in micxroseconds
     uint32_t last_update_ms;    // last position update in milliseconds
-    float heading;          // last known direction vehicle is moving
-    float ground_speed;     // vehicle's last known ground speed in m/s
+    Location origin;            // reference point of the tracking filter north and east axes
+    Vector3f vel_estimate;      // predicted north, east and up velocity in m/s
+    float alt_diff_estimate;    // predicted height of the vehicle above the tracker in meters
 } vehicle;
 
+// tracking filter, a constant acceleration Kalman filter for each of
+// the north, east and up axes of the vehicle position. See tracking_filter.pde
+static struct {
+    bool initialised;
+    uint32_t time_us;       // time the state is for, the receive time of the last measurement less the link latency
+    float x[3];             // position (m), velocity (m/s) and acceleration (m/s/s)
+    float P[3][3];          // covariance of x
+} vehicle_kf[3];
+
 ////////////////////////////////////////////////////////////////////////////////
 // Navigation controller state
 ////////////////////////////////////////////////////////////////////////////////
@@ -190,6 +200,8 @@ static struct {
     float pitch;                    // pitch to vehicle in degrees (positive means vehicle is above tracker, negative means below)
     float altitude_difference;      // altitude difference between tracker and vehicle in meters.  positive value means vehicle is above tracker
     float altitude_offset;          // offset in meters which is added to tracker altitude to align altitude measurements with vehicle's barometer
+    float bearing_rate;             // predicted rate of change of bearing to the vehicle in degrees/second
+    float pitch_rate;               // predicted rate of change of pitch to the vehicle in degrees/second
     bool manual_control_yaw         : 1;// true if tracker yaw is under manual control
     bool manual_control_pitch       : 1;// true if tracker pitch is manually controlled
     bool need_altitude_calibration  : 1;// true if tracker altitude has not been determined (true after startup)
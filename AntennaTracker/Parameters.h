@@ -92,6 +92,9 @@ public:
         k_param_pitch_range,
         k_param_distance_min,
         k_param_sysid_target,       // 138
+        k_param_track_latency,
+        k_param_track_jerk,
+        k_param_track_ff,
 
         //
         // 150: Telemetry control
@@ -142,6 +145,9 @@ public:
     AP_Int16 yaw_range;             // yaw axis total range of motion in degrees
     AP_Int16 pitch_range;           // pitch axis total range of motion in degrees
     AP_Int16 distance_min;          // target's must be at least this distance from tracker to be tracked
+    AP_Float track_latency;         // telemetry link latency in seconds
+    AP_Float track_jerk;            // tracking filter process noise in m/s/s/s
+    AP_Float track_ff;              // gain of the bearing and pitch rate feed-forward to the servos
 
     // Waypoints
     //
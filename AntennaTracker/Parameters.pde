@@ -194,6 +194,32 @@ const AP_Param::Info var_info[] PROGMEM = {
     // @User: Standard
     GSCALAR(distance_min,           "DISTANCE_MIN", DISTANCE_MIN_DEFAULT),
 
+    // @Param: TRACK_LATENCY
+    // @DisplayName: Telemetry latency
+    // @Description: Average delay between the vehicle sending a position or pressure message and the tracker receiving it. The tracking filter predicts the vehicle position forward by this time
+    // @Units: seconds
+    // @Increment: 0.01
+    // @Range: 0 2
+    // @User: Advanced
+    GSCALAR(track_latency,          "TRACK_LATENCY", TRACK_LATENCY_DEFAULT),
+
+    // @Param: TRACK_JERK
+    // @DisplayName: Tracking filter jerk noise
+    // @Description: How quickly the tracking filter expects the vehicle acceleration to change. Increase for agile vehicles so the filter follows their manoeuvres more quickly, decrease for a smoother estimate of slow vehicles
+    // @Units: m/s/s/s
+    // @Increment: 0.5
+    // @Range: 0.5 50
+    // @User: Advanced
+    GSCALAR(track_jerk,             "TRACK_JERK", TRACK_JERK_DEFAULT),
+
+    // @Param: TRACK_FF
+    // @DisplayName: Tracking rate feed-forward
+    // @Description: Fraction of the predicted bearing and pitch rate of the vehicle that is added directly to the position servo outputs, so the servos lead a fast vehicle instead of waiting for an angle error to build up. Needs the servo ranges to be set up so the servo angle matches the servo output. 0 disables
+    // @Range: 0 1
+    // @Increment: 0.05
+    // @User: Advanced
+    GSCALAR(track_ff,               "TRACK_FF", 1.0f),
+
     // barometer ground calibration. The GND_ prefix is chosen for
     // compatibility with previous releases of ArduPlane
     // @Group: GND_
@@ -56,6 +56,24 @@
 #ifndef DISTANCE_MIN_DEFAULT
  # define DISTANCE_MIN_DEFAULT              5.0f    // do not track targets within 5 meters
 #endif
+#ifndef TRACK_LATENCY_DEFAULT
+ # define TRACK_LATENCY_DEFAULT             0.1f    // typical telemetry radio latency in seconds
+#endif
+#ifndef TRACK_JERK_DEFAULT
+ # define TRACK_JERK_DEFAULT                5.0f    // tracking filter process noise in m/s/s/s
+#endif
+#ifndef TRACK_POS_NOISE
+ # define TRACK_POS_NOISE                   3.0f    // vehicle horizontal position measurement noise in meters
+#endif
+#ifndef TRACK_VEL_NOISE
+ # define TRACK_VEL_NOISE                   0.5f    // vehicle velocity measurement noise in m/s
+#endif
+#ifndef TRACK_ALT_NOISE
+ # define TRACK_ALT_NOISE                   1.0f    // altitude difference measurement noise in meters
+#endif
+#ifndef TRACK_ACCEL_HORIZON_SEC
+ # define TRACK_ACCEL_HORIZON_SEC           1.0f    // predict with the vehicle acceleration for at most this long after a measurement
+#endif
 
 //////////////////////////////////////////////////////////////////////////////
 // Developer Items
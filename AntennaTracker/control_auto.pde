@@ -20,7 +20,7 @@ static void update_auto(void)
 
     // only move servos if target is at least distance_min away
     if ((g.distance_min <= 0) || (nav_status.distance >= g.distance_min)) {
-        update_pitch_servo(pitch);
-        update_yaw_servo(yaw);
+        update_pitch_servo(pitch, nav_status.pitch_rate);
+        update_yaw_servo(yaw, nav_status.bearing_rate);
     }
 }
@@ -22,9 +22,10 @@ static void init_servos()
 
 /**
    update the pitch (elevation) servo. The aim is to drive the boards ahrs pitch to the
-   requested pitch, so the board (and therefore the antenna) will be pointing at the target
+   requested pitch, so the board (and therefore the antenna) will be pointing at the target.
+   pitch_rate is the expected rate of change of the requested pitch in degrees/second
  */
-static void update_pitch_servo(float pitch)
+static void update_pitch_servo(float pitch, float pitch_rate)
 {
     switch ((enum ServoType)g.servo_type.get()) {
     case SERVO_TYPE_ONOFF:
@@ -33,7 +34,7 @@ static void update_pitch_servo(float pitch)
 
     case SERVO_TYPE_POSITION:
     default:
-        update_pitch_position_servo(pitch);
+        update_pitch_position_servo(pitch, pitch_rate);
         break;
     }
 
@@ -46,7 +47,7 @@ static void update_pitch_servo(float pitch)
    update the pitch (elevation) servo. The aim is to drive the boards ahrs pitch to the
    requested pitch, so the board (and therefore the antenna) will be pointing at the target
  */
-static void update_pitch_position_servo(float pitch)
+static void update_pitch_position_servo(float pitch, float pitch_rate)
 {
     // degrees(ahrs.pitch) is -90 to 90, where 0 is horizontal
     // pitch argument is -90 to 90, where 0 is horizontal
@@ -71,8 +72,10 @@ static void update_pitch_position_servo(float pitch)
     // PITCH2SRV_D      0.000000
     // PITCH2SRV_IMAX   4000.000000
 
-    // calculate new servo position
+    // calculate new servo position, leading a moving target by the
+    // distance it will move in this 50Hz step
     int32_t new_servo_out = channel_pitch.servo_out + g.pidPitch2Srv.get_pid(angle_err);
+    new_servo_out += g.track_ff * pitch_rate * 100 * 0.02f;
 
     // initialise limit flags
     servo_limit.pitch_lower = false;
@@ -134,9 +137,10 @@ static void update_pitch_onoff_servo(float pitch)
 }
 
 /**
-   update the yaw (azimuth) servo.
+   update the yaw (azimuth) servo. yaw_rate is the expected rate of
+   change of the requested yaw in degrees/second
  */
-static void update_yaw_servo(float yaw)
+static void update_yaw_servo(float yaw, float yaw_rate)
 {
     switch ((enum ServoType)g.servo_type.get()) {
     case SERVO_TYPE_ONOFF:
@@ -145,7 +149,7 @@ static void update_yaw_servo(float yaw)
 
     case SERVO_TYPE_POSITION:
     default:
-        update_yaw_position_servo(yaw);
+        update_yaw_position_servo(yaw, yaw_rate);
         break;
     }
 
@@ -159,7 +163,7 @@ static void update_yaw_servo(float yaw)
    yaw to the requested yaw, so the board (and therefore the antenna)
    will be pointing at the target
  */
-static void update_yaw_position_servo(float yaw)
+static void update_yaw_position_servo(float yaw, float yaw_rate)
 {
     int32_t ahrs_yaw_cd = wrap_180_cd(ahrs.yaw_sensor);
     int32_t yaw_cd   = wrap_180_cd(yaw*100);
@@ -249,6 +253,8 @@ static void update_yaw_position_servo(float yaw)
         g.pidYaw2Srv.reset_I();
     } else {
         float servo_change = g.pidYaw2Srv.get_pid(angle_err);
+        // lead a moving target by the distance it will move in this 50Hz step
+        servo_change -= g.track_ff * yaw_rate * 100 * 0.02f;
         servo_change = constrain_float(servo_change, -18000, 18000);
         new_servo_out = constrain_float(channel_yaw.servo_out - servo_change, -18000, 18000);
     }
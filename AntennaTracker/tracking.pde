@@ -7,13 +7,22 @@
 static void update_vehicle_pos_estimate()
 {
     // calculate time since last actual position update
-    float dt = (hal.scheduler->micros() - vehicle.last_update_us) * 1.0e-6f;
+    uint32_t now = hal.scheduler->micros();
+    float dt = (now - vehicle.last_update_us) * 1.0e-6f;
 
     // if less than 5 seconds since last position update estimate the position
-    if (dt < TRACKING_TIMEOUT_SEC) {
-        // project the vehicle position to take account of lost radio packets
-        vehicle.location_estimate = vehicle.location;
-        location_update(vehicle.location_estimate, vehicle.heading, vehicle.ground_speed * dt);
+    if (dt < TRACKING_TIMEOUT_SEC && vehicle_kf[0].initialised) {
+        // predict the vehicle position from the tracking filter to take
+        // account of the link latency and lost radio packets
+        float pos[3], vel[3];
+        for (uint8_t axis=0; axis<3; axis++) {
+            vehicle_kf_output(axis, now, pos[axis], vel[axis]);
+        }
+        vehicle.location_estimate = vehicle.origin;
+        vehicle.location_estimate.alt = vehicle.location.alt;
+        location_offset(vehicle.location_estimate, pos[0], pos[1]);
+        vehicle.vel_estimate = Vector3f(vel[0], vel[1], vehicle_kf[2].initialised ? vel[2] : 0);
+        vehicle.alt_diff_estimate = vehicle_kf[2].initialised ? pos[2] : nav_status.altitude_difference;
         // set valid_location flag
         vehicle.location_valid = true;
     } else {
@@ -41,6 +50,9 @@ static void update_tracker_position()
  */
 static void update_bearing_and_distance()
 {
+    nav_status.bearing_rate = 0;
+    nav_status.pitch_rate = 0;
+
     // exit immediately if we do not have a valid vehicle position
     if (!vehicle.location_valid) {
         return;
@@ -58,7 +70,29 @@ static void update_bearing_and_distance()
     // calculate pitch to vehicle
     // To-Do: remove need for check of control_mode
     if (control_mode != SCAN && !nav_status.manual_control_pitch) {
-        nav_status.pitch    = degrees(atan2f(nav_status.altitude_difference, nav_status.distance));
+        nav_status.pitch    = degrees(atan2f(vehicle.alt_diff_estimate, nav_status.distance));
+    }
+
+    // rates of change of bearing and pitch from the velocity of the
+    // vehicle relative to the tracker, for the servo feed-forward
+    Vector2f ofs = location_diff(current_loc, vehicle.location_estimate);
+    Vector3f vel = vehicle.vel_estimate;
+    if (gps.status() >= AP_GPS::GPS_OK_FIX_3D) {
+        vel.x -= gps.velocity().x;
+        vel.y -= gps.velocity().y;
+    }
+    float dist_sq = ofs.x*ofs.x + ofs.y*ofs.y;
+    if (dist_sq < 1.0f) {
+        return;
+    }
+    float dist = sqrtf(dist_sq);
+    float dist_rate = (ofs.x*vel.x + ofs.y*vel.y) / dist;
+    float alt = vehicle.alt_diff_estimate;
+    if (control_mode != SCAN && !nav_status.manual_control_yaw) {
+        nav_status.bearing_rate = degrees((ofs.x*vel.y - ofs.y*vel.x) / dist_sq);
+    }
+    if (control_mode != SCAN && !nav_status.manual_control_pitch) {
+        nav_status.pitch_rate = degrees((dist*vel.z - alt*dist_rate) / (dist_sq + alt*alt));
     }
 }
 
@@ -115,10 +149,9 @@ static void tracking_update_position(const mavlink_global_position_int_t &msg)
     vehicle.location.lat = msg.lat;
     vehicle.location.lng = msg.lon;
     vehicle.location.alt = msg.alt/10;
-    vehicle.heading      = msg.hdg * 0.01f;
-    vehicle.ground_speed = pythagorous2(msg.vx, msg.vy) * 0.01f;
     vehicle.last_update_us = hal.scheduler->micros();    
     vehicle.last_update_ms = hal.scheduler->millis();
+    vehicle_kf_update_position(msg);
 }
 
 
@@ -142,6 +175,12 @@ static void tracking_update_pressure(const mavlink_scaled_pressure_t &msg)
         nav_status.altitude_offset = -nav_status.altitude_difference;
         nav_status.altitude_difference = 0;
         nav_status.need_altitude_calibration = false;
+        // restart the up axis of the tracking filter from zero
+        vehicle_kf[2].initialised = false;
+    }
+
+    if (!isnan(alt_diff)) {
+        vehicle_kf_update_altitude(nav_status.altitude_difference);
     }
 }
 
@@ -0,0 +1,183 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/*
+ * tracking_filter.pde - Kalman filter for the vehicle position
+ *
+ * Each axis (0=north, 1=east, 2=up) is an independent constant
+ * acceleration filter driven by white noise jerk of TRACK_JERK. The
+ * state is kept at the time the last measurement was sent by the
+ * vehicle, which is taken to be its receive time less TRACK_LATENCY,
+ * and vehicle_kf_output() predicts it forward to the current time.
+ */
+
+/*
+  start an axis from a position and velocity, with the acceleration
+  unknown
+ */
+static void vehicle_kf_reset(uint8_t axis, float pos, float vel, float pos_var, float vel_var, uint32_t time_us)
+{
+    vehicle_kf[axis].x[0] = pos;
+    vehicle_kf[axis].x[1] = vel;
+    vehicle_kf[axis].x[2] = 0;
+    memset(vehicle_kf[axis].P, 0, sizeof(vehicle_kf[axis].P));
+    vehicle_kf[axis].P[0][0] = pos_var;
+    vehicle_kf[axis].P[1][1] = vel_var;
+    vehicle_kf[axis].P[2][2] = sq(5.0f);     // acceleration unknown
+    vehicle_kf[axis].time_us = time_us;
+    vehicle_kf[axis].initialised = true;
+}
+
+/*
+  move an axis forward to time_us. Measurements that arrive out of
+  order are fused at the current filter time
+ */
+static void vehicle_kf_predict(uint8_t axis, uint32_t time_us)
+{
+    int32_t dt_us = (int32_t)(time_us - vehicle_kf[axis].time_us);
+    if (dt_us <= 0) {
+        return;
+    }
+    float dt = dt_us * 1.0e-6f;
+    float dt2 = dt*dt;
+    float *x = vehicle_kf[axis].x;
+    float (*P)[3] = vehicle_kf[axis].P;
+
+    x[0] += x[1]*dt + 0.5f*x[2]*dt2;
+    x[1] += x[2]*dt;
+
+    // P = F*P*F' with F = [1 dt dt^2/2; 0 1 dt; 0 0 1]
+    float FP[3][3];
+    for (uint8_t j=0; j<3; j++) {
+        FP[0][j] = P[0][j] + dt*P[1][j] + 0.5f*dt2*P[2][j];
+        FP[1][j] = P[1][j] + dt*P[2][j];
+        FP[2][j] = P[2][j];
+    }
+    for (uint8_t i=0; i<3; i++) {
+        P[i][0] = FP[i][0] + dt*FP[i][1] + 0.5f*dt2*FP[i][2];
+        P[i][1] = FP[i][1] + dt*FP[i][2];
+        P[i][2] = FP[i][2];
+    }
+
+    // process noise for white noise jerk
+    float q = sq(g.track_jerk);
+    float dt3 = dt2*dt;
+    P[0][0] += q*dt3*dt2/20;
+    P[0][1] += q*dt2*dt2/8;
+    P[0][2] += q*dt3/6;
+    P[1][0] += q*dt2*dt2/8;
+    P[1][1] += q*dt3/3;
+    P[1][2] += q*dt2/2;
+    P[2][0] += q*dt3/6;
+    P[2][1] += q*dt2/2;
+    P[2][2] += q*dt;
+
+    vehicle_kf[axis].time_us = time_us;
+}
+
+/*
+  fuse a measurement z with variance var of state 0 (position) or 1
+  (velocity) of an axis
+ */
+static void vehicle_kf_fuse(uint8_t axis, uint8_t state, float z, float var)
+{
+    float *x = vehicle_kf[axis].x;
+    float (*P)[3] = vehicle_kf[axis].P;
+
+    float S = P[state][state] + var;
+    if (S <= 0) {
+        return;
+    }
+    float K[3];
+    for (uint8_t i=0; i<3; i++) {
+        K[i] = P[i][state] / S;
+    }
+    float innovation = z - x[state];
+    float Prow[3] = { P[state][0], P[state][1], P[state][2] };
+    for (uint8_t i=0; i<3; i++) {
+        x[i] += K[i] * innovation;
+        for (uint8_t j=0; j<3; j++) {
+            P[i][j] -= K[i] * Prow[j];
+        }
+    }
+}
+
+/*
+  predict the position and velocity of an axis at time_us without
+  changing the filter. The acceleration is only used for the first
+  TRACK_ACCEL_HORIZON_SEC, after that the velocity is held, so a run
+  of lost packets doesn't throw the prediction off
+ */
+static void vehicle_kf_output(uint8_t axis, uint32_t time_us, float &pos, float &vel)
+{
+    const float *x = vehicle_kf[axis].x;
+    float dt = (int32_t)(time_us - vehicle_kf[axis].time_us) * 1.0e-6f;
+    if (dt < 0) {
+        dt = 0;
+    }
+    float dt_acc = min(dt, TRACK_ACCEL_HORIZON_SEC);
+    pos = x[0] + x[1]*dt + x[2]*dt_acc*(dt - 0.5f*dt_acc);
+    vel = x[1] + x[2]*dt_acc;
+}
+
+/*
+  time a message received now was sent by the vehicle
+ */
+static uint32_t vehicle_kf_measurement_time(void)
+{
+    return hal.scheduler->micros() - (uint32_t)(constrain_float(g.track_latency, 0, 2) * 1.0e6f);
+}
+
+/*
+  fuse a GLOBAL_POSITION_INT from the vehicle into the north and east
+  axes, and its climb rate into the up axis
+ */
+static void vehicle_kf_update_position(const mavlink_global_position_int_t &msg)
+{
+    uint32_t time_us = vehicle_kf_measurement_time();
+    Location loc = {};
+    loc.lat = msg.lat;
+    loc.lng = msg.lon;
+    Vector3f vel(msg.vx * 0.01f, msg.vy * 0.01f, -msg.vz * 0.01f);
+
+    // restart after losing the vehicle, and keep the origin near the
+    // vehicle so the positions stay small
+    bool lost = !vehicle_kf[0].initialised ||
+        (int32_t)(time_us - vehicle_kf[0].time_us) > (int32_t)(TRACKING_TIMEOUT_SEC * 1.0e6f);
+    if (lost || get_distance(vehicle.origin, loc) > 10000) {
+        vehicle.origin = loc;
+        for (uint8_t axis=0; axis<2; axis++) {
+            vehicle_kf_reset(axis, 0, vel[axis], sq(TRACK_POS_NOISE), sq(TRACK_VEL_NOISE), time_us);
+        }
+    } else {
+        Vector2f ofs = location_diff(vehicle.origin, loc);
+        float pos[2] = { ofs.x, ofs.y };
+        for (uint8_t axis=0; axis<2; axis++) {
+            vehicle_kf_predict(axis, time_us);
+            vehicle_kf_fuse(axis, 0, pos[axis], sq(TRACK_POS_NOISE));
+            vehicle_kf_fuse(axis, 1, vel[axis], sq(TRACK_VEL_NOISE));
+        }
+    }
+
+    // the up axis is measured by the pressure difference, and only
+    // uses the climb rate once that has started it
+    if (vehicle_kf[2].initialised) {
+        vehicle_kf_predict(2, time_us);
+        vehicle_kf_fuse(2, 1, vel.z, sq(TRACK_VEL_NOISE));
+    }
+}
+
+/*
+  fuse the height of the vehicle above the tracker from its pressure
+  into the up axis
+ */
+static void vehicle_kf_update_altitude(float alt_diff)
+{
+    uint32_t time_us = vehicle_kf_measurement_time();
+    if (!vehicle_kf[2].initialised ||
+        (int32_t)(time_us - vehicle_kf[2].time_us) > (int32_t)(TRACKING_TIMEOUT_SEC * 1.0e6f)) {
+        vehicle_kf_reset(2, alt_diff, 0, sq(TRACK_ALT_NOISE), sq(TRACK_VEL_NOISE), time_us);
+        return;
+    }
+    vehicle_kf_predict(2, time_us);
+    vehicle_kf_fuse(2, 0, alt_diff, sq(TRACK_ALT_NOISE));
+}
@@ -162,8 +162,12 @@
 #include <AP_Parachute.h>		// Parachute release library
 #endif
 #include <AP_LandingGear.h>     // Landing Gear library
+#if SYSTEMID_ENABLED == ENABLED
+#include <AC_SystemID.h>        // System identification library
+#endif
 #include <AP_Terrain.h>
 #include <AP_AccelCal.h>
+#include <AP_VehicleState.h>   // vehicle state snapshot
 
 // AP_HAL to Arduino compatibility layer
 #include "compat.h"
@@ -311,6 +315,11 @@ static AP_SerialManager serial_manager;
 static const uint8_t num_gcs = MAVLINK_COMM_NUM_BUFFERS;
 static GCS_MAVLINK gcs[MAVLINK_COMM_NUM_BUFFERS];
 
+#if TELEM_THREAD == ENABLED
+// vehicle state published once per main loop, see vehicle_state.pde
+static AP_VehicleState vehicle_state;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // User variables
 ////////////////////////////////////////////////////////////////////////////////
@@ -740,6 +749,13 @@ static AP_Parachute parachute(relay);
 ////////////////////////////////////////////////////////////////////////////////
 static AP_LandingGear landinggear;
 
+////////////////////////////////////////////////////////////////////////////////
+// System identification
+////////////////////////////////////////////////////////////////////////////////
+#if SYSTEMID_ENABLED == ENABLED
+static AC_SystemID systemid;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // terrain handling
 #if AP_TERRAIN_AVAILABLE
@@ -774,6 +790,17 @@ AP_Param param_loader(var_info);
   4000 = 0.1hz
   
  */
+/*
+  TELEM_TASK runs a task on the telemetry worker. Only tasks that build
+  everything they send from the vehicle_state snapshot may use it,
+  which is only the heartbeat so far
+ */
+#if TELEM_THREAD == ENABLED
+ # define TELEM_TASK (AP_Scheduler::TASK_THREAD_SAFE | AP_Scheduler::TASK_WORKER_ONLY)
+#else
+ # define TELEM_TASK 0
+#endif
+
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { rc_loop,               4,     10 },
     { throttle_loop,         8,     45 },
@@ -788,6 +815,7 @@ static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { auto_trim,            40,     14 },
     { update_altitude,      40,    100 },
     { run_nav_updates,       8,     80 },
+    { auto_wp_lookahead_update, 40, 60 },
     { update_thr_average,    4,     10 },
     { three_hz_loop,       133,      9 },
     { compass_accumulate,    4,     42 },
@@ -801,15 +829,18 @@ static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { one_hz_loop,         400,     42 },
     { ekf_check,            40,      2 },
     { landinggear_update,   40,      1 },
+#if SYSTEMID_ENABLED == ENABLED
+    { systemid_update,       4,    100 },
+#endif
     { lost_vehicle_check,   40,      2 },
     { gcs_check_input,       1,    550 },
-    { gcs_send_heartbeat,  400,    150 },
+    { gcs_send_heartbeat,  400,    150, TELEM_TASK },
     { gcs_send_deferred,     8,    720 },
     { gcs_data_stream_send,  8,    950 },
 #if COPTER_LEDS == ENABLED
     { update_copter_leds,   40,      5 },
 #endif
-    { update_mount,          8,     45 },
+    { update_mount,          8,     75 },
     { gmb_att_update,        1,     50 },
     { ten_hz_logging_loop,  40,     30 },
     { fifty_hz_logging_loop, 8,     22 },
@@ -853,6 +884,10 @@ void setup()
 
     // initialise the main loop scheduler
     scheduler.init(&scheduler_tasks[0], sizeof(scheduler_tasks)/sizeof(scheduler_tasks[0]));
+#if TELEM_THREAD == ENABLED
+    // the heartbeat needs a worker thread to run on
+    scheduler.set_default_workers(1);
+#endif
 
     // setup initial performance counters
     perf_info_reset();
@@ -936,6 +971,11 @@ static void fast_loop()
 
     // run low level rate controllers that only require IMU data
     attitude_control.rate_controller_run();
+
+#if SYSTEMID_ENABLED == ENABLED
+    // add the system identification chirp to the rate controller's output
+    systemid_output();
+#endif
     
 #if FRAME_CONFIG == HELI_FRAME
     update_heli_control_dynamics();
@@ -963,9 +1003,18 @@ static void fast_loop()
 
     camera_mount.update_fast();
 
+#if CAMERA == ENABLED
+    camera.update_fast();
+#endif
+
     if (should_log(MASK_LOG_RCOUT_FAST)) {
         DataFlash.Log_Write_RCOUT();
     }
+
+#if TELEM_THREAD == ENABLED
+    // publish state for the telemetry worker
+    vehicle_state_publish();
+#endif
 }
 
 // rc_loops - reads user input from transmitter/receiver
@@ -1012,6 +1061,9 @@ static void update_mount()
 #endif
 
 #if CAMERA == ENABLED
+    if (camera.update_trigger(ahrs)) {
+        log_picture();
+    }
     camera.trigger_pic_cleanup();
 #endif
 }
@@ -1208,16 +1260,6 @@ static void update_GPS(void)
     if (gps_updated) {
         // set system time if necessary
         set_system_time_from_GPS();
-
-        // checks to initialise home and take location based pictures
-        if (gps.status() >= AP_GPS::GPS_OK_FIX_3D) {
-
-#if CAMERA == ENABLED
-            if (camera.update_location(current_loc) == true) {
-                do_take_picture();
-            }
-#endif
-        }
     }
 }
 
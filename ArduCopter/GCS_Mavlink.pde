@@ -18,7 +18,17 @@ static bool	gcs_out_of_time;
 
 static void gcs_send_heartbeat(void)
 {
+#if TELEM_THREAD == ENABLED
+    // this runs on the telemetry worker, so don't go through the
+    // deferred queue, which can hold messages built from live state
+    for (uint8_t i=0; i<num_gcs; i++) {
+        if (gcs[i].initialised) {
+            gcs[i].send_message_now(MSG_HEARTBEAT);
+        }
+    }
+#else
     gcs_send_message(MSG_HEARTBEAT);
+#endif
 }
 
 static void gcs_send_deferred(void)
@@ -38,12 +48,28 @@ static void gcs_send_deferred(void)
 
 static NOINLINE void send_heartbeat(mavlink_channel_t chan)
 {
+#if TELEM_THREAD == ENABLED
+    // the heartbeat runs on the telemetry worker, so it reads the
+    // state fast_loop published rather than the live variables
+    VehicleState s;
+    vehicle_state_get(s);
+    bool landed = s.landed;
+    uint8_t mode = s.mode;
+    bool failsafe_active = s.failsafe != 0;
+    bool armed = s.armed;
+#else
+    bool landed = ap.land_complete;
+    uint8_t mode = control_mode;
+    bool failsafe_active = failsafe.radio || failsafe.battery || failsafe.gcs || failsafe.ekf;
+    bool armed = motors.armed();
+#endif
+
     uint8_t base_mode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
-    uint8_t system_status = ap.land_complete ? MAV_STATE_STANDBY : MAV_STATE_ACTIVE;
-    uint32_t custom_mode = control_mode;
+    uint8_t system_status = landed ? MAV_STATE_STANDBY : MAV_STATE_ACTIVE;
+    uint32_t custom_mode = mode;
 
     // set system as critical if any failsafe have triggered
-    if (failsafe.radio || failsafe.battery || failsafe.gcs || failsafe.ekf)  {
+    if (failsafe_active)  {
         system_status = MAV_STATE_CRITICAL;
     }
 
@@ -56,7 +82,7 @@ static NOINLINE void send_heartbeat(mavlink_channel_t chan)
     // the APM flight mode and has a well defined meaning in the
     // ArduPlane documentation
     base_mode = MAV_MODE_FLAG_STABILIZE_ENABLED;
-    switch (control_mode) {
+    switch (mode) {
     case AUTO:
     case RTL:
     case LOITER:
@@ -80,7 +106,7 @@ static NOINLINE void send_heartbeat(mavlink_channel_t chan)
 #endif
 
     // we are armed if we are not initialising
-    if (motors.armed()) {
+    if (armed) {
         base_mode |= MAV_MODE_FLAG_SAFETY_ARMED;
     }
 
@@ -2023,6 +2049,8 @@ static void gcs_send_text_P(gcs_severity severity, const prog_char_t *str)
  */
 static void gcs_send_text_fmt(const prog_char_t *fmt, ...)
 {
+    // pending_status is also used by the telemetry thread
+    GCS_MAVLINK::send_lock();
     va_list arg_list;
     gcs[0].pending_status.severity = (uint8_t)SEVERITY_LOW;
     va_start(arg_list, fmt);
@@ -2036,4 +2064,5 @@ static void gcs_send_text_fmt(const prog_char_t *fmt, ...)
             gcs[i].send_message(MSG_STATUSTEXT);
         }
     }
+    GCS_MAVLINK::send_unlock();
 }
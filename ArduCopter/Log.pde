@@ -211,6 +211,89 @@ static void Log_Write_AutoTuneDetails(float angle_cd, float rate_cds)
 }
 #endif
 
+#if SYSTEMID_ENABLED == ENABLED
+struct PACKED log_SystemID {
+    LOG_PACKET_HEADER;
+    uint32_t time_ms;
+    uint16_t index;         // sample number in the sweep
+    float    chirp;         // chirp added to the rate controller's output
+    float    input;         // total input to the motors on the axis
+    float    output;        // rotation rate in centi-degrees / second
+};
+
+// Write a System ID sample packet
+static void Log_Write_SystemID(uint16_t index, float chirp, float input, float output)
+{
+    struct log_SystemID pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_SYSTEMID_MSG),
+        time_ms     : hal.scheduler->millis(),
+        index       : index,
+        chirp       : chirp,
+        input       : input,
+        output      : output
+    };
+    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+}
+
+struct PACKED log_SystemIDBand {
+    LOG_PACKET_HEADER;
+    uint32_t time_ms;
+    uint8_t  axis;
+    uint8_t  band;
+    float    freq_hz;       // centre frequency of the band
+    float    gain;          // rotation rate per unit input
+    float    phase;         // phase in degrees
+    float    coherence;     // 0 to 1
+};
+
+// Write a System ID frequency response packet
+static void Log_Write_SystemIDBand(uint8_t axis, uint8_t band, float freq_hz, float gain, float phase, float coherence)
+{
+    struct log_SystemIDBand pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_SYSTEMID_BAND_MSG),
+        time_ms     : hal.scheduler->millis(),
+        axis        : axis,
+        band        : band,
+        freq_hz     : freq_hz,
+        gain        : gain,
+        phase       : phase,
+        coherence   : coherence
+    };
+    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+}
+
+struct PACKED log_SystemIDResult {
+    LOG_PACKET_HEADER;
+    uint32_t time_ms;
+    uint8_t  axis;
+    float    gain;          // fitted model gain
+    float    tau;           // fitted model lag in seconds
+    float    delay;         // fitted model delay in seconds
+    float    fit_error;     // RMS error of the fit in dB
+    float    gain_rp;       // designed gain
+    float    gain_rd;       // designed gain
+    float    gain_sp;       // designed gain
+};
+
+// Write a System ID result packet
+static void Log_Write_SystemIDResult(uint8_t axis, float gain, float tau, float delay, float fit_error, float gain_rp, float gain_rd, float gain_sp)
+{
+    struct log_SystemIDResult pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_SYSTEMID_RESULT_MSG),
+        time_ms     : hal.scheduler->millis(),
+        axis        : axis,
+        gain        : gain,
+        tau         : tau,
+        delay       : delay,
+        fit_error   : fit_error,
+        gain_rp     : gain_rp,
+        gain_rd     : gain_rd,
+        gain_sp     : gain_sp
+    };
+    DataFlash.WriteBlock(&pkt, sizeof(pkt));
+}
+#endif
+
 // Write a Current data packet
 static void Log_Write_Current()
 {
@@ -337,6 +420,7 @@ struct PACKED log_Performance {
     int16_t  pm_test;
     uint8_t i2c_lockup_count;
     uint16_t ins_error_count;
+    uint16_t max_lateness;
 };
 
 // Write a performance monitoring packet
@@ -349,7 +433,8 @@ static void Log_Write_Performance()
         max_time         : perf_info_get_max_time(),
         pm_test          : pmTest1,
         i2c_lockup_count : hal.i2c->lockup_count(),
-        ins_error_count  : ins.error_count()
+        ins_error_count  : ins.error_count(),
+        max_lateness     : scheduler.max_lateness()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
 }
@@ -728,6 +813,14 @@ static void Log_Write_Land_Detector()
       "ATUN", "IBBffffff",       "TimeMS,Axis,TuneStep,RateTarg,RateMin,RateMax,RP,RD,SP" },
     { LOG_AUTOTUNEDETAILS_MSG, sizeof(log_AutoTuneDetails),
       "ATDE", "Iff",          "TimeMS,Angle,Rate" },
+#endif
+#if SYSTEMID_ENABLED == ENABLED
+    { LOG_SYSTEMID_MSG, sizeof(log_SystemID),
+      "SIDD", "IHfff",        "TimeMS,Idx,Chirp,In,Out" },
+    { LOG_SYSTEMID_BAND_MSG, sizeof(log_SystemIDBand),
+      "SIDB", "IBBffff",      "TimeMS,Axis,Band,Freq,Gain,Phase,Coh" },
+    { LOG_SYSTEMID_RESULT_MSG, sizeof(log_SystemIDResult),
+      "SIDR", "IBfffffff",    "TimeMS,Axis,K,Tau,Delay,FitErr,RP,RD,SP" },
 #endif
     { LOG_PARAMTUNE_MSG, sizeof(log_ParameterTuning),
       "PTUN", "IBfHHH",          "TimeMS,Param,TunVal,CtrlIn,TunLo,TunHi" },  
@@ -738,7 +831,7 @@ static void Log_Write_Land_Detector()
     { LOG_CONTROL_TUNING_MSG, sizeof(log_Control_Tuning),
       "CTUN", "Ihhhffecchh", "TimeMS,ThrIn,AngBst,ThrOut,DAlt,Alt,BarAlt,DSAlt,SAlt,DCRt,CRt" },
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
-      "PM",  "HHIhBH",    "NLon,NLoop,MaxT,PMT,I2CErr,INSErr" },
+      "PM",  "HHIhBHH",   "NLon,NLoop,MaxT,PMT,I2CErr,INSErr,MaxLate" },
     { LOG_RATE_MSG, sizeof(log_Rate),
       "RATE", "Iffffffffffff",  "TimeMS,RDes,R,ROut,PDes,P,POut,YDes,Y,YOut,ADes,A,AOut" },
     { LOG_MOTBATT_MSG, sizeof(log_MotBatt),
@@ -808,6 +901,11 @@ static void Log_Write_Startup() {}
 static void Log_Write_AutoTune(uint8_t axis, uint8_t tune_step, float rate_target, float rate_min, float rate_max, float new_gain_rp, float new_gain_rd, float new_gain_sp) {}
 static void Log_Write_AutoTuneDetails(float angle_cd, float rate_cds) {}
 #endif
+#if SYSTEMID_ENABLED == ENABLED
+static void Log_Write_SystemID(uint16_t index, float chirp, float input, float output) {}
+static void Log_Write_SystemIDBand(uint8_t axis, uint8_t band, float freq_hz, float gain, float phase, float coherence) {}
+static void Log_Write_SystemIDResult(uint8_t axis, float gain, float tau, float delay, float fit_error, float gain_rp, float gain_rd, float gain_sp) {}
+#endif
 static void Log_Write_Current() {}
 static void Log_Write_Attitude() {}
 static void Log_Write_Rate() {}
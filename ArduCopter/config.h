@@ -312,6 +312,15 @@
  # define AUTOTUNE_ENABLED  ENABLED
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+//  System identification - passes the gains it finds to AutoTune to be tested and saved
+#ifndef SYSTEMID_ENABLED
+ # define SYSTEMID_ENABLED  AUTOTUNE_ENABLED
+#endif
+#if SYSTEMID_ENABLED == ENABLED && AUTOTUNE_ENABLED != ENABLED
+ # error SYSTEMID_ENABLED requires AUTOTUNE_ENABLED
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 //  Crop Sprayer
 #ifndef SPRAYER
@@ -750,6 +759,23 @@
   #  define FRSKY_TELEM_ENABLED          ENABLED
 #endif
 
+// send the heartbeat from a scheduler worker thread, so a slow link
+// can't hold it up. Linux only. This moves only the heartbeat: the
+// other GCS streams, GCS input and all logging still run in the main
+// loop, as they read live state the snapshot doesn't carry. The
+// MAVLink library has to lock its sends, so this is turned on by
+// building with EXTRAFLAGS=-DMAVLINK_SEND_LOCK=1
+#ifndef TELEM_THREAD
+ # if MAVLINK_SEND_LOCK
+  #  define TELEM_THREAD          ENABLED
+ # else
+  #  define TELEM_THREAD          DISABLED
+ # endif
+#endif
+#if TELEM_THREAD == ENABLED && !MAVLINK_SEND_LOCK
+  # error TELEM_THREAD needs the MAVLink send lock, build with EXTRAFLAGS=-DMAVLINK_SEND_LOCK=1
+#endif
+
 /*
   build a firmware version string.
   GIT_VERSION comes from Makefile builds
@@ -193,6 +193,40 @@ static void auto_wp_run()
     }
 }
 
+// auto_wp_lookahead_update - passes the upcoming mission waypoints to the waypoint controller's look-ahead planner
+//      called at 10hz.  the waypoint controller moves the plan on itself as each waypoint is reached so this only
+//      needs to add the waypoints that have come into range
+static void auto_wp_lookahead_update()
+{
+    uint8_t lookahead = wp_nav.get_lookahead();
+    if (lookahead == 0 || control_mode != AUTO || auto_mode != Auto_WP || mission.state() != AP_Mission::MISSION_RUNNING) {
+        wp_nav.lookahead_reset();
+        return;
+    }
+
+    // start again if the plan does not begin with the current command (i.e. after a jump or the mission being changed)
+    const AP_Mission::Mission_Command& nav_cmd = mission.get_current_nav_cmd();
+    if (wp_nav.lookahead_num() > 0 && wp_nav.lookahead_id(0) != nav_cmd.index) {
+        wp_nav.lookahead_reset();
+    }
+    if (wp_nav.lookahead_num() == 0) {
+        wp_nav.lookahead_push(nav_cmd.index, wp_nav.get_wp_destination(), loiter_time_max != 0);
+    }
+
+    // add waypoints until the plan is full or reaches one the vehicle will stop at
+    AP_Mission::Mission_Command cmd;
+    while (wp_nav.lookahead_num() < lookahead && !wp_nav.lookahead_ends_in_stop()) {
+        uint8_t last = wp_nav.lookahead_num()-1;
+        if (!mission.get_next_nav_cmd(wp_nav.lookahead_id(last)+1, cmd)) {
+            break;
+        }
+        bool stop = (cmd.id != MAV_CMD_NAV_WAYPOINT || cmd.p1 != 0);
+        wp_nav.lookahead_push(cmd.index, pv_location_to_vector_with_default(cmd.content.location, wp_nav.lookahead_pos(last)), stop);
+    }
+
+    wp_nav.lookahead_update();
+}
+
 // auto_spline_start - initialises waypoint controller to implement flying to a particular destination using the spline controller
 //  seg_end_type can be SEGMENT_END_STOP, SEGMENT_END_STRAIGHT or SEGMENT_END_SPLINE.  If Straight or Spline the next_destination should be provided
 static void auto_spline_start(const Vector3f& destination, bool stopped_at_start, AC_WPNav::spline_segment_end_type seg_end_type, const Vector3f& next_destination)
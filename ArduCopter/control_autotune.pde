@@ -1022,6 +1022,49 @@ static void autotune_save_tuning_gains()
     }
 }
 
+#if SYSTEMID_ENABLED == ENABLED
+// autotune_set_identified_gains - take the gains worked out by system identification for one axis as tuned gains
+//  the pilot can then test them by switching to AutoTune and save them by landing and disarming as if AutoTune had found them
+//  returns false without taking them while AutoTune is flying or part way through a tune
+static bool autotune_set_identified_gains(uint8_t axis, float rate_p, float rate_d, float stab_p)
+{
+    if (control_mode == AUTOTUNE || autotune_state.mode == AUTOTUNE_MODE_TUNING) {
+        return false;
+    }
+
+    if (autotune_state.mode != AUTOTUNE_MODE_SUCCESS) {
+        // back up the gains as originals and only keep tuned gains for axes that have been identified
+        autotune_backup_gains_and_initialise();
+        tune_roll_rp = 0;
+        tune_pitch_rp = 0;
+        tune_yaw_rp = 0;
+        tune_roll_accel = attitude_control.get_accel_roll_max();
+        tune_pitch_accel = attitude_control.get_accel_pitch_max();
+        tune_yaw_accel = attitude_control.get_accel_yaw_max();
+        autotune_state.mode = AUTOTUNE_MODE_SUCCESS;
+    }
+
+    switch (axis) {
+        case AUTOTUNE_AXIS_ROLL:
+            tune_roll_rp = rate_p;
+            tune_roll_rd = rate_d;
+            tune_roll_sp = stab_p;
+            break;
+        case AUTOTUNE_AXIS_PITCH:
+            tune_pitch_rp = rate_p;
+            tune_pitch_rd = rate_d;
+            tune_pitch_sp = stab_p;
+            break;
+        case AUTOTUNE_AXIS_YAW:
+            tune_yaw_rp = rate_p;
+            tune_yaw_sp = stab_p;
+            break;
+    }
+    autotune_update_gcs(AUTOTUNE_MESSAGE_SUCCESS);
+    return true;
+}
+#endif
+
 // autotune_update_gcs - send message to ground station
 void autotune_update_gcs(uint8_t message_id)
 {
@@ -0,0 +1,249 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#if SYSTEMID_ENABLED == ENABLED
+
+/*
+ * control_systemid.pde - init and run calls for the system identification flight mode
+ *
+ * Instructions:
+ *      1) Set SID_AXIS to the axis to identify (it must also be enabled in AUTOTUNE_AXES)
+ *      2) Take off in stabilize or althold mode and put the vehicle into a level hover with plenty of room around it
+ *      3) Switch to SystemID mode and keep the sticks centred.  The vehicle holds altitude while a chirp sweeping
+ *         from SID_F_START_HZ to SID_F_STOP_HZ is added to the axis' motor output for about ten seconds
+ *      4) Moving the sticks or leaning more than 30 degrees stops the sweep
+ *      5) Once the sweep is complete the response is analysed and the gains designed from it are passed to AutoTune.
+ *         They are held while AutoTune is flying or part way through a tune, and passed on once it isn't.
+ *         Switch to AutoTune to fly on them, then land and disarm in AutoTune to save them as when AutoTune succeeds
+ *      6) The samples, frequency response and fitted model are logged as SIDD, SIDB and SIDR messages
+ *
+ * The vehicle is modelled as rate/input = K * exp(-s*delay) / (s * (tau*s + 1)).  The rate P and D gains give the phase
+ * margin below at the highest crossover frequency the D term's phase lead allows, and the stabilize P gain puts the
+ * angle loop's crossover a fixed ratio below that.
+ */
+
+#define SYSTEMID_ANGLE_MAX_CD           3000    // lean angle in centi-degrees that stops the sweep
+#define SYSTEMID_ANALYSIS_TIME_US         75    // time the analysis is allowed each time systemid_update runs
+#define SYSTEMID_RP_PHASE_MARGIN        50.0f   // roll and pitch rate loop phase margin in degrees
+#define SYSTEMID_RP_MAX_LEAD            45.0f   // phase lead in degrees the roll and pitch rate D term may add
+#define SYSTEMID_Y_PHASE_MARGIN         60.0f   // yaw rate loop phase margin in degrees, yaw has no D term
+#define SYSTEMID_MAX_CROSSOVER_HZ       10.0f   // highest rate loop crossover frequency designed for
+#define SYSTEMID_SP_RATIO                6.0f   // ratio of the rate loop crossover frequency to the angle loop's
+
+// designed gains waiting to be passed to AutoTune
+static struct {
+    bool pending;
+    uint8_t axis;
+    float rate_p, rate_d, stab_p;
+} systemid_gains;
+
+// systemid_init - initialise the system identification flight mode
+static bool systemid_init(bool ignore_checks)
+{
+    // only allow from Stabilize or AltHold flight modes
+    if (control_mode != STABILIZE && control_mode != ALT_HOLD) {
+        return false;
+    }
+
+    // ensure throttle is above zero
+    if (g.rc_3.control_in <= 0) {
+        return false;
+    }
+
+    // ensure we are flying
+    if (!motors.armed() || !ap.auto_armed || ap.land_complete) {
+        return false;
+    }
+
+    // the gains are passed to AutoTune, which only tests and saves the axes it is enabled for
+    uint8_t axis = systemid.axis();
+    if (axis < AC_SystemID::AXIS_ROLL || axis > AC_SystemID::AXIS_YAW ||
+        (g.autotune_axis_bitmask & (1 << (axis - AC_SystemID::AXIS_ROLL))) == 0) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Axis not in AUTOTUNE_AXES"));
+        return false;
+    }
+
+    if (!systemid.start(MAIN_LOOP_RATE)) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Failed to start"));
+        return false;
+    }
+
+    // initialize vertical speeds and leash lengths
+    pos_control.set_speed_z(-g.pilot_velocity_z_max, g.pilot_velocity_z_max);
+    pos_control.set_accel_z(g.pilot_accel_z);
+
+    // initialise altitude target to stopping point
+    pos_control.set_target_to_stopping_point_z();
+
+    gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Started"));
+    return true;
+}
+
+// systemid_stop - stops the sweep, should be called when the flight mode is exited
+//  a completed sweep carries on being analysed
+static void systemid_stop()
+{
+    if (systemid.recording()) {
+        systemid.stop();
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Stopped"));
+    }
+}
+
+// systemid_run - runs the system identification flight mode
+// should be called at 100hz or more
+static void systemid_run()
+{
+    float target_roll, target_pitch;
+    float target_yaw_rate;
+    int16_t target_climb_rate;
+
+    // initialize vertical speeds and leash lengths
+    pos_control.set_speed_z(-g.pilot_velocity_z_max, g.pilot_velocity_z_max);
+    pos_control.set_accel_z(g.pilot_accel_z);
+
+    // if not auto armed or landed set throttle to zero and exit immediately
+    // this should not actually be possible because of the systemid_init() checks
+    if (!ap.auto_armed || ap.land_complete) {
+        systemid_stop();
+        attitude_control.set_throttle_out_unstabilized(0,true,g.throttle_filt);
+        pos_control.relax_alt_hold_controllers(get_throttle_pre_takeoff(g.rc_3.control_in)-throttle_average);
+        return;
+    }
+
+    // apply SIMPLE mode transform to pilot inputs
+    update_simple_mode();
+
+    // get pilot desired lean angles
+    get_pilot_desired_lean_angles(g.rc_1.control_in, g.rc_2.control_in, target_roll, target_pitch);
+
+    // get pilot's desired yaw rate
+    target_yaw_rate = get_pilot_desired_yaw_rate(g.rc_4.control_in);
+
+    // get pilot desired climb rate
+    target_climb_rate = get_pilot_desired_climb_rate(g.rc_3.control_in);
+
+    // stop the sweep if the pilot takes over or it upsets the vehicle
+    if (systemid.recording() &&
+        (target_roll != 0 || target_pitch != 0 || target_yaw_rate != 0.0f || target_climb_rate != 0 ||
+         labs(ahrs.roll_sensor) > SYSTEMID_ANGLE_MAX_CD || labs(ahrs.pitch_sensor) > SYSTEMID_ANGLE_MAX_CD)) {
+        systemid_stop();
+    }
+
+    // call attitude controller
+    attitude_control.angle_ef_roll_pitch_rate_ef_yaw_smooth(target_roll, target_pitch, target_yaw_rate, get_smoothing_gain());
+
+    // call position controller
+    pos_control.set_alt_target_from_climb_rate(target_climb_rate, G_Dt);
+    pos_control.update_z_controller();
+}
+
+// systemid_output - add the chirp to the rate controller's output and record the response
+// called from the fast loop after the rate controllers have run
+static void systemid_output()
+{
+    if (control_mode != SYSTEMID || !systemid.recording()) {
+        return;
+    }
+
+    float chirp = systemid.chirp();
+    const Vector3f &gyro = ahrs.get_gyro();
+    int16_t input;
+    float output;
+    switch (systemid.axis()) {
+        case AC_SystemID::AXIS_ROLL:
+            input = constrain_float(motors.get_roll() + chirp, -AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX);
+            motors.set_roll(input);
+            output = gyro.x * AC_ATTITUDE_CONTROL_DEGX100;
+            break;
+        case AC_SystemID::AXIS_PITCH:
+            input = constrain_float(motors.get_pitch() + chirp, -AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX);
+            motors.set_pitch(input);
+            output = gyro.y * AC_ATTITUDE_CONTROL_DEGX100;
+            break;
+        case AC_SystemID::AXIS_YAW:
+            input = constrain_float(motors.get_yaw() + chirp, -AC_ATTITUDE_RATE_YAW_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_YAW_CONTROLLER_OUT_MAX);
+            motors.set_yaw(input);
+            output = gyro.z * AC_ATTITUDE_CONTROL_DEGX100;
+            break;
+        default:
+            return;
+    }
+
+    // log every sample so the sweep can be analysed again offline
+    if (should_log(MASK_LOG_ATTITUDE_FAST)) {
+        Log_Write_SystemID(systemid.sample_index(), chirp, input, output);
+    }
+    systemid.add_sample(input, output);
+}
+
+// systemid_update - analyse a completed sweep a slice at a time
+// called by the scheduler at 100hz
+static void systemid_update()
+{
+    if (systemid_gains.pending) {
+        systemid_pass_gains();
+    }
+
+    if (!systemid.analysing()) {
+        return;
+    }
+
+    systemid.update(SYSTEMID_ANALYSIS_TIME_US);
+
+    if (systemid.failed()) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Failed"));
+        systemid.stop();
+    } else if (systemid.complete()) {
+        systemid_set_gains();
+        systemid.stop();
+    }
+}
+
+// systemid_set_gains - design gains from the identified model and pass them to AutoTune
+static void systemid_set_gains()
+{
+    uint8_t axis = systemid.axis();
+    for (uint8_t i=0; i<systemid.num_bands(); i++) {
+        const AC_SystemID::band &b = systemid.get_band(i);
+        Log_Write_SystemIDBand(axis, i, b.freq_hz, b.gain, b.phase, b.coherence);
+    }
+
+    float rate_p, rate_d, crossover_hz;
+    bool success;
+    if (axis == AC_SystemID::AXIS_YAW) {
+        success = systemid.design_rate_gains(SYSTEMID_Y_PHASE_MARGIN, 0.0f, SYSTEMID_MAX_CROSSOVER_HZ, rate_p, rate_d, crossover_hz);
+        rate_d = 0.0f;
+    } else {
+        success = systemid.design_rate_gains(SYSTEMID_RP_PHASE_MARGIN, SYSTEMID_RP_MAX_LEAD, SYSTEMID_MAX_CROSSOVER_HZ, rate_p, rate_d, crossover_hz);
+        rate_d = constrain_float(rate_d, AUTOTUNE_RD_MIN, AUTOTUNE_RD_MAX);
+    }
+    if (!success) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Failed"));
+        return;
+    }
+    rate_p = constrain_float(rate_p, AUTOTUNE_RP_MIN, AUTOTUNE_RP_MAX);
+    float stab_p = constrain_float(2.0f * M_PI_F * crossover_hz / SYSTEMID_SP_RATIO, AUTOTUNE_SP_MIN, AUTOTUNE_SP_MAX);
+
+    Log_Write_SystemIDResult(axis, systemid.model_gain(), systemid.model_tau(), systemid.model_delay(),
+                             systemid.model_fit_error(), rate_p, rate_d, stab_p);
+    gcs_send_text_fmt(PSTR("SystemID: RP %.3f RD %.4f SP %.2f"), rate_p, rate_d, stab_p);
+
+    systemid_gains.axis = axis - AC_SystemID::AXIS_ROLL;
+    systemid_gains.rate_p = rate_p;
+    systemid_gains.rate_d = rate_d;
+    systemid_gains.stab_p = stab_p;
+    systemid_gains.pending = true;
+    systemid_pass_gains();
+    if (systemid_gains.pending) {
+        gcs_send_text_P(SEVERITY_HIGH,PSTR("SystemID: Gains held until AutoTune is idle"));
+    }
+}
+
+// systemid_pass_gains - pass the designed gains to AutoTune unless it is flying or part way through a tune
+static void systemid_pass_gains()
+{
+    if (autotune_set_identified_gains(systemid_gains.axis, systemid_gains.rate_p, systemid_gains.rate_d, systemid_gains.stab_p)) {
+        systemid_gains.pending = false;
+    }
+}
+
+#endif  // SYSTEMID_ENABLED == ENABLED
@@ -110,7 +110,8 @@ enum aux_sw_func {
 #define AUTOTUNE    15                  // autotune the vehicle's roll and pitch gains
 #define POSHOLD     16                  // position hold with manual override
 #define STOP        17                  // Full-Stop using inertial/GPS system, no pilot input
-#define NUM_MODES   18
+#define SYSTEMID    18                  // identify the response of one axis to a frequency sweep
+#define NUM_MODES   19
 
 #define DEPRECATED_MODES_MASK ((1UL<<8)|(1UL<<10)|(1UL<<12))
 
@@ -248,6 +249,9 @@ enum FlipState {
 #define LOG_MOTBATT_MSG                 0x1E
 #define LOG_PARAMTUNE_MSG               0x1F
 #define LOG_LANDDETECT_MSG              0x20
+#define LOG_SYSTEMID_MSG                0x21
+#define LOG_SYSTEMID_BAND_MSG           0x22
+#define LOG_SYSTEMID_RESULT_MSG         0x23
 
 #define MASK_LOG_ATTITUDE_FAST          (1<<0)
 #define MASK_LOG_ATTITUDE_MED           (1<<1)
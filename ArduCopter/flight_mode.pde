@@ -94,6 +94,12 @@ static bool set_mode(uint8_t mode)
             success = stop_init(ignore_checks);
             break;
 
+#if SYSTEMID_ENABLED == ENABLED
+        case SYSTEMID:
+            success = systemid_init(ignore_checks);
+            break;
+#endif
+
         default:
             success = false;
             break;
@@ -206,6 +212,12 @@ static void update_flight_mode()
         case STOP:
             stop_run();
             break;
+
+#if SYSTEMID_ENABLED == ENABLED
+        case SYSTEMID:
+            systemid_run();
+            break;
+#endif
     }
 }
 
@@ -218,6 +230,12 @@ static void exit_mode(uint8_t old_control_mode, uint8_t new_control_mode)
     }
 #endif
 
+#if SYSTEMID_ENABLED == ENABLED
+    if (old_control_mode == SYSTEMID) {
+        systemid_stop();
+    }
+#endif
+
     // stop mission when we leave auto mode
     if (old_control_mode == AUTO) {
         if (mission.state() == AP_Mission::MISSION_RUNNING) {
@@ -376,6 +394,9 @@ print_flight_mode(AP_HAL::BetterStream *port, uint8_t mode)
     case POSHOLD:
         port->print_P(PSTR("POSHOLD"));
         break;
+    case SYSTEMID:
+        port->print_P(PSTR("SYSTEMID"));
+        break;
     default:
         port->printf_P(PSTR("Mode(%u)"), (unsigned)mode);
         break;
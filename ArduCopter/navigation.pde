@@ -64,8 +64,8 @@ static void calc_home_distance_and_bearing()
 
     // calculate home distance and bearing
     if (position_ok()) {
-        home_distance = pythagorous2(curr.x, curr.y);
         Vector3f home = pv_location_to_vector(ahrs.get_home());
+        home_distance = pv_get_horizontal_distance_cm(curr, home);
         home_bearing = pv_get_bearing_cd(curr,home);
 
         // update super simple bearing (if required) because it relies on home_bearing
@@ -3,15 +3,22 @@
 // position_vector.pde related utility functions
 
 // position vectors are Vector3f
-//    .x = latitude from home in cm
-//    .y = longitude from home in cm
-//    .z = altitude above home in cm
+//    .x = north of the EKF origin in cm
+//    .y = east of the EKF origin in cm
+//    .z = altitude above the EKF origin in cm
 
 // pv_location_to_vector - convert lat/lon coordinates to a position vector
+//  uses the AHRS local frame, which is the one the EKF positions are in
 Vector3f pv_location_to_vector(const Location& loc)
 {
-    const struct Location &origin = inertial_nav.get_origin();
     float alt_above_origin = pv_alt_above_origin(loc.alt);  // convert alt-relative-to-home to alt-relative-to-origin
+    LocalFrame frame;
+    if (ahrs.get_local_frame(frame)) {
+        Vector2f ne = frame.to_NE(loc);
+        return Vector3f(ne.x * 100.0f, ne.y * 100.0f, alt_above_origin);
+    }
+    // no origin yet
+    const struct Location &origin = inertial_nav.get_origin();
     return Vector3f((loc.lat-origin.lat) * LATLON_TO_CM, (loc.lng-origin.lng) * LATLON_TO_CM * scaleLongDown, alt_above_origin);
 }
 
@@ -0,0 +1,79 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/*
+  vehicle state snapshot, published at the end of each fast_loop for
+  the telemetry worker. Without TELEM_THREAD messages are built from
+  the live variables in the main loop and no snapshot is kept
+ */
+
+#if TELEM_THREAD == ENABLED
+
+// bits of VehicleState::failsafe
+#define VEHICLE_STATE_FAILSAFE_RADIO    (1<<0)
+#define VEHICLE_STATE_FAILSAFE_BATTERY  (1<<1)
+#define VEHICLE_STATE_FAILSAFE_GCS      (1<<2)
+#define VEHICLE_STATE_FAILSAFE_EKF      (1<<3)
+
+// fill in a VehicleState from the live vehicle state
+static void vehicle_state_fill(VehicleState &s)
+{
+    s.time_us = fast_loopTimer;
+    s.roll = ahrs.roll;
+    s.pitch = ahrs.pitch;
+    s.yaw = ahrs.yaw;
+    s.gyro = ins.get_gyro();
+
+    s.location = current_loc;
+    s.home_alt_cm = ahrs.get_home().alt;
+    const Vector3f &pos = inertial_nav.get_position();
+    const Vector3f &vel = inertial_nav.get_velocity();
+    s.position_ned(pos.x*0.01f, pos.y*0.01f, -pos.z*0.01f);
+    s.velocity_ned(vel.x*0.01f, vel.y*0.01f, -vel.z*0.01f);
+
+    const Vector3f &targets = attitude_control.angle_ef_targets();
+    s.target_attitude(radians(targets.x*0.01f), radians(targets.y*0.01f), radians(targets.z*0.01f));
+    s.wp_bearing = wp_bearing * 0.01f;
+    s.wp_distance = wp_distance * 0.01f;
+    s.alt_error = pos_control.get_alt_error() * 0.01f;
+    s.throttle = g.rc_3.servo_out * 0.001f;
+
+    hal.rcout->read(s.servo_out, AP_VEHICLESTATE_NUM_OUTPUTS);
+
+    s.mode = control_mode;
+    s.failsafe = 0;
+    if (failsafe.radio) {
+        s.failsafe |= VEHICLE_STATE_FAILSAFE_RADIO;
+    }
+    if (failsafe.battery) {
+        s.failsafe |= VEHICLE_STATE_FAILSAFE_BATTERY;
+    }
+    if (failsafe.gcs) {
+        s.failsafe |= VEHICLE_STATE_FAILSAFE_GCS;
+    }
+    if (failsafe.ekf) {
+        s.failsafe |= VEHICLE_STATE_FAILSAFE_EKF;
+    }
+    s.gps_fix = gps.status();
+    s.armed = motors.armed();
+    s.landed = ap.land_complete;
+    s.ahrs_healthy = ahrs.healthy();
+}
+
+// publish the vehicle state. Called at the end of fast_loop
+static void vehicle_state_publish()
+{
+    VehicleState s;
+    vehicle_state_fill(s);
+    vehicle_state.publish(s);
+}
+
+// get the latest vehicle state
+static void vehicle_state_get(VehicleState &s)
+{
+    if (!vehicle_state.read(s)) {
+        // nothing published yet, we are still initialising in the
+        // main thread
+        vehicle_state_fill(s);
+    }
+}
+#endif // TELEM_THREAD
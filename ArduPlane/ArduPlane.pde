@@ -920,6 +920,11 @@ static void update_mount(void)
 #endif
 
 #if CAMERA == ENABLED
+    if (camera.update_trigger(ahrs)) {
+        log_picture();
+    }
+    // this already runs at the main loop rate
+    camera.update_fast();
     camera.trigger_pic_cleanup();
 #endif
 }
@@ -1172,12 +1177,6 @@ static void update_GPS_10Hz(void)
         // see if we've breached the geo-fence
         geofence_check(false);
 
-#if CAMERA == ENABLED
-        if (camera.update_location(current_loc) == true) {
-            do_take_picture();
-        }
-#endif        
-
         if (!hal.util->get_soft_armed()) {
             update_home();
         }
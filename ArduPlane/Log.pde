@@ -202,9 +202,10 @@ struct PACKED log_Performance {
     int16_t  gyro_drift_z;
     uint8_t  i2c_lockup_count;
     uint16_t ins_error_count;
+    uint16_t max_lateness;
 };
 
-// Write a performance monitoring packet. Total length : 19 bytes
+// Write a performance monitoring packet. Total length : 21 bytes
 static void Log_Write_Performance()
 {
     struct log_Performance pkt = {
@@ -216,7 +217,8 @@ static void Log_Write_Performance()
         gyro_drift_y    : (int16_t)(ahrs.get_gyro_drift().y * 1000),
         gyro_drift_z    : (int16_t)(ahrs.get_gyro_drift().z * 1000),
         i2c_lockup_count: hal.i2c->lockup_count(),
-        ins_error_count  : ins.error_count()
+        ins_error_count  : ins.error_count(),
+        max_lateness     : scheduler.max_lateness()
     };
     DataFlash.WriteBlock(&pkt, sizeof(pkt));
 }
@@ -460,7 +462,7 @@ static void Log_Write_Airspeed(void)
 static const struct LogStructure log_structure[] PROGMEM = {
     LOG_COMMON_STRUCTURES,
     { LOG_PERFORMANCE_MSG, sizeof(log_Performance), 
-      "PM",  "IHIhhhBH", "LTime,MLC,gDt,GDx,GDy,GDz,I2CErr,INSErr" },
+      "PM",  "IHIhhhBHH", "LTime,MLC,gDt,GDx,GDy,GDz,I2CErr,INSErr,MaxLate" },
     { LOG_STARTUP_MSG, sizeof(log_Startup),         
       "STRT", "BH",         "SType,CTot" },
     { LOG_CTUN_MSG, sizeof(log_Control_Tuning),     
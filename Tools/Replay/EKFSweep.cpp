@@ -0,0 +1,240 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+
+#include "EKFSweep.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+EKFSweep::EKFSweep(const AP_AHRS *_ahrs, AP_Baro &_baro, const RangeFinder &_rng, const AP_GPS &_gps) :
+    ahrs(_ahrs),
+    baro(_baro),
+    rng(_rng),
+    gps(_gps),
+    sets(NULL),
+    _num_sets(0),
+    _running(false),
+    pool(&EKFSweep::update_set_job, this)
+{
+}
+
+/*
+  parse one line of NAME=VALUE pairs. Names may be given with or
+  without the EKF_ prefix
+ */
+bool EKFSweep::parse_set(char *line, struct param_set &set, uint16_t line_num)
+{
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(line, " \t\r\n", &saveptr);
+         tok != NULL;
+         tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        if (eq == NULL) {
+            ::printf("Line %u: expected NAME=VALUE, got %s\n", (unsigned)line_num, tok);
+            return false;
+        }
+        *eq++ = 0;
+        const char *name = tok;
+        if (strncmp(name, "EKF_", 4) == 0) {
+            name += 4;
+        }
+        bool found = false;
+        uint8_t type;
+        for (uint8_t i=0;
+             (type=pgm_read_byte(&NavEKF::var_info[i].type)) != AP_PARAM_NONE;
+             i++) {
+            if (type <= AP_PARAM_FLOAT && strcmp(name, NavEKF::var_info[i].name) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            ::printf("Line %u: unknown EKF parameter %s\n", (unsigned)line_num, tok);
+            return false;
+        }
+        if (set.num_params >= EKFSWEEP_MAX_PARAMS) {
+            ::printf("Line %u: too many parameters\n", (unsigned)line_num);
+            return false;
+        }
+        strncpy(set.params[set.num_params].name, name, AP_MAX_NAME_SIZE);
+        set.params[set.num_params].value = atof(eq);
+        set.num_params++;
+    }
+    return true;
+}
+
+bool EKFSweep::load_sets(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        ::printf("Failed to open %s - %s\n", filename, strerror(errno));
+        return false;
+    }
+    if (sets == NULL) {
+        sets = (struct param_set *)calloc(EKFSWEEP_MAX_SETS, sizeof(sets[0]));
+        if (sets == NULL) {
+            fclose(f);
+            return false;
+        }
+    }
+    char line[512];
+    uint16_t line_num = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) {
+            continue;
+        }
+        if (_num_sets >= EKFSWEEP_MAX_SETS) {
+            ::printf("%s: more than %u parameter sets\n", filename, EKFSWEEP_MAX_SETS);
+            ok = false;
+            break;
+        }
+        ok = parse_set(p, sets[_num_sets], line_num);
+        _num_sets++;
+    }
+    fclose(f);
+    if (ok && _num_sets == 0) {
+        ::printf("%s: no parameter sets\n", filename);
+        ok = false;
+    }
+    return ok;
+}
+
+bool EKFSweep::start(const NavEKF &ref, uint8_t _num_threads)
+{
+    for (uint8_t i=0; i<_num_sets; i++) {
+        struct param_set &set = sets[i];
+        set.ekf = new NavEKF(ahrs, baro, rng);
+        if (set.ekf == NULL) {
+            ::printf("Out of memory for parameter set %u\n", (unsigned)i);
+            return false;
+        }
+        set.ekf->copyParameters(ref);
+        for (uint8_t p=0; p<set.num_params; p++) {
+            AP_Param::set_object_value(set.ekf, NavEKF::var_info,
+                                       set.params[p].name, set.params[p].value);
+        }
+        set.ekf->InitialiseFilterDynamic();
+    }
+
+    uint8_t threads_used = pool.start(_num_threads, _num_sets);
+    _running = true;
+    ::printf("EKF sweep: %u parameter sets on %u threads\n",
+             (unsigned)_num_sets, (unsigned)threads_used);
+    return true;
+}
+
+void EKFSweep::update_set_job(void *obj, uint16_t i)
+{
+    EKFSweep *sweep = (EKFSweep *)obj;
+    sweep->update_set(sweep->sets[i]);
+}
+
+void EKFSweep::update(void)
+{
+    if (!_running) {
+        return;
+    }
+    pool.run();
+}
+
+void EKFSweep::update_set(struct param_set &set)
+{
+    NavEKF &ekf = *set.ekf;
+    ekf.UpdateFilter();
+
+    set.steps++;
+    if (!ekf.healthy()) {
+        set.unhealthy_steps++;
+    }
+
+    Vector3f vel_innov, pos_innov, mag_innov;
+    float tas_innov;
+    ekf.getInnovations(vel_innov, pos_innov, mag_innov, tas_innov);
+    if (vel_innov != set.last_vel_innov) {
+        set.vel_innov.add(vel_innov.length());
+        set.last_vel_innov = vel_innov;
+    }
+    if (pos_innov.x != set.last_pos_innov.x || pos_innov.y != set.last_pos_innov.y) {
+        set.pos_innov.add(pythagorous2(pos_innov.x, pos_innov.y));
+    }
+    if (pos_innov.z != set.last_pos_innov.z) {
+        set.hgt_innov.add(pos_innov.z);
+    }
+    set.last_pos_innov = pos_innov;
+    if (mag_innov != set.last_mag_innov) {
+        set.mag_innov.add(mag_innov.length());
+        set.last_mag_innov = mag_innov;
+    }
+
+    float vel_var, pos_var, hgt_var, tas_var;
+    Vector3f mag_var;
+    Vector2f offset;
+    ekf.getVariances(vel_var, pos_var, hgt_var, mag_var, tas_var, offset);
+    set.vel_ratio.add(vel_var);
+    set.pos_ratio.add(pos_var);
+    set.hgt_ratio.add(hgt_var);
+    set.mag_ratio.add(mag_var.length());
+
+    if (gps.status() >= AP_GPS::GPS_OK_FIX_3D && gps.last_fix_time_ms() != set.last_gps_ms) {
+        set.last_gps_ms = gps.last_fix_time_ms();
+        struct Location origin;
+        Vector3f pos;
+        if (ekf.getOriginLLH(origin) && ekf.getPosNED(pos)) {
+            Vector2f gps_pos = location_diff(origin, gps.location());
+            set.pos_error.add(pythagorous2(pos.x - gps_pos.x, pos.y - gps_pos.y));
+        }
+    }
+}
+
+/*
+  write one row per set. Innovations are RMS over each fusion, test
+  ratios are RMS over every step, and PosErr is the horizontal distance
+  of the filter position from each GPS fix, not corrected for the GPS
+  delay
+ */
+bool EKFSweep::write_report(const char *filename) const
+{
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        ::printf("Failed to create %s - %s\n", filename, strerror(errno));
+        return false;
+    }
+    fprintf(f, "Set VelInnov PosInnov HgtInnov MagInnov VelRatio PosRatio HgtRatio MagRatio PosErr PosErrMax Unhealthy Params\n");
+    ::printf("%3s %8s %8s %8s %8s %8s %8s %8s %8s %8s %9s %9s  %s\n",
+             "Set", "VelInnov", "PosInnov", "HgtInnov", "MagInnov",
+             "VelRatio", "PosRatio", "HgtRatio", "MagRatio",
+             "PosErr", "PosErrMax", "Unhealthy", "Params");
+    for (uint8_t i=0; i<_num_sets; i++) {
+        const struct param_set &set = sets[i];
+        char params[EKFSWEEP_MAX_PARAMS*(AP_MAX_NAME_SIZE+20)] = "";
+        for (uint8_t p=0; p<set.num_params; p++) {
+            size_t len = strlen(params);
+            snprintf(&params[len], sizeof(params)-len, "%sEKF_%s=%g",
+                     p==0?"":",", set.params[p].name, (double)set.params[p].value);
+        }
+        if (set.num_params == 0) {
+            strcpy(params, "-");
+        }
+        float unhealthy = set.steps > 0 ? 100.0f * set.unhealthy_steps / set.steps : 0;
+        fprintf(f, "%u %f %f %f %f %f %f %f %f %f %f %f %s\n",
+                (unsigned)i,
+                set.vel_innov.rms(), set.pos_innov.rms(), set.hgt_innov.rms(), set.mag_innov.rms(),
+                set.vel_ratio.rms(), set.pos_ratio.rms(), set.hgt_ratio.rms(), set.mag_ratio.rms(),
+                set.pos_error.rms(), set.pos_error.max, unhealthy, params);
+        ::printf("%3u %8.3f %8.3f %8.3f %8.4f %8.3f %8.3f %8.3f %8.3f %8.2f %9.2f %8.1f%%  %s\n",
+                 (unsigned)i,
+                 set.vel_innov.rms(), set.pos_innov.rms(), set.hgt_innov.rms(), set.mag_innov.rms(),
+                 set.vel_ratio.rms(), set.pos_ratio.rms(), set.hgt_ratio.rms(), set.mag_ratio.rms(),
+                 set.pos_error.rms(), set.pos_error.max, unhealthy, params);
+    }
+    fclose(f);
+    return true;
+}
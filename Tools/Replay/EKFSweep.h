@@ -0,0 +1,96 @@
+#include <AP_AHRS.h>
+#include <AP_NavEKF.h>
+#include <AP_GPS.h>
+#include <AP_Baro.h>
+#include <AP_RangeFinder.h>
+
+#include "LogBatch.h"
+
+/*
+  NavEKF parameter sweep
+
+  Runs one extra NavEKF for each of a list of parameter sets alongside
+  the replayed filter, all fed from the same pass over the log, and
+  reports innovation and position error statistics for each set. The
+  sets are read from a file with one set per line of NAME=VALUE pairs,
+  for example
+
+    EKF_GYRO_PNOISE=0.015 EKF_ACC_PNOISE=0.25
+    EKF_GYRO_PNOISE=0.03  EKF_POS_GATE=3
+
+  Parameters not in a set keep the values of the replayed filter. The
+  filters of each IMU step are shared out between worker threads, and
+  update() waits for all of them, so the sensor data they read can't
+  change underneath them.
+ */
+class EKFSweep
+{
+public:
+    EKFSweep(const AP_AHRS *_ahrs, AP_Baro &_baro, const RangeFinder &_rng, const AP_GPS &_gps);
+
+    // read the parameter sets. Returns false if the file can't be
+    // read or names an unknown parameter
+    bool load_sets(const char *filename);
+
+    // create and initialise a filter for each set, starting from the
+    // parameters of ref, using up to num_threads threads
+    bool start(const NavEKF &ref, uint8_t num_threads);
+
+    // update every filter with the latest sensor data
+    void update(void);
+
+    // write the statistics of each set to filename and stdout
+    bool write_report(const char *filename) const;
+
+    uint8_t num_sets(void) const { return _num_sets; }
+    bool running(void) const { return _running; }
+
+private:
+    const AP_AHRS *ahrs;
+    AP_Baro &baro;
+    const RangeFinder &rng;
+    const AP_GPS &gps;
+
+#define EKFSWEEP_MAX_SETS 64
+#define EKFSWEEP_MAX_PARAMS 16
+    struct param_set {
+        NavEKF *ekf;
+        uint8_t num_params;
+        struct {
+            char name[AP_MAX_NAME_SIZE+1];  // without the EKF_ prefix
+            float value;
+        } params[EKFSWEEP_MAX_PARAMS];
+
+        // innovations are recorded each time they change, which is
+        // once per fusion of the measurement
+        Vector3f last_vel_innov;
+        Vector3f last_pos_innov;
+        Vector3f last_mag_innov;
+        struct log_stats vel_innov;
+        struct log_stats pos_innov;
+        struct log_stats hgt_innov;
+        struct log_stats mag_innov;
+
+        // innovation test ratios, every step
+        struct log_stats vel_ratio;
+        struct log_stats pos_ratio;
+        struct log_stats hgt_ratio;
+        struct log_stats mag_ratio;
+
+        // horizontal distance from each new GPS fix
+        uint32_t last_gps_ms;
+        struct log_stats pos_error;
+
+        uint32_t steps;
+        uint32_t unhealthy_steps;
+    } *sets;
+    uint8_t _num_sets;
+    bool _running;
+
+    bool parse_set(char *line, struct param_set &set, uint16_t line_num);
+    void update_set(struct param_set &set);
+
+    // threads the sets of each update() are shared out between
+    LogBatchPool pool;
+    static void update_set_job(void *obj, uint16_t i);
+};
@@ -0,0 +1,158 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+
+#include "LogBatch.h"
+#include "MsgHandler.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+struct log_batch_job {
+    char * const *logfiles;
+    bool (*process)(void *obj, const char *logfile);
+    void *obj;
+    volatile uint16_t failed;
+};
+
+static void log_batch_process(void *arg, uint16_t i)
+{
+    struct log_batch_job *job = (struct log_batch_job *)arg;
+    if (!job->process(job->obj, job->logfiles[i])) {
+        __sync_fetch_and_add(&job->failed, 1);
+    }
+}
+
+bool log_batch(char * const *logfiles, uint16_t num_logs, uint8_t num_threads,
+               bool (*process)(void *obj, const char *logfile), void *obj)
+{
+    struct log_batch_job job;
+    job.logfiles = logfiles;
+    job.process = process;
+    job.obj = obj;
+    job.failed = 0;
+
+    LogBatchPool pool(log_batch_process, &job);
+    pool.start(num_threads, num_logs);
+    pool.run();
+    pool.stop();
+
+    if (job.failed != 0) {
+        ::printf("%u of %u logs failed\n", (unsigned)job.failed, (unsigned)num_logs);
+        return false;
+    }
+    return true;
+}
+
+LogBatchPool::LogBatchPool(void (*_job)(void *obj, uint16_t i), void *_obj) :
+    job(_job),
+    obj(_obj),
+    num_jobs(0),
+    num_threads(0),
+    generation(0),
+    busy(0),
+    stopping(false),
+    next_job(0)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+uint8_t LogBatchPool::start(uint8_t _num_threads, uint16_t _num_jobs)
+{
+    num_jobs = _num_jobs;
+    if (_num_threads > num_jobs) {
+        _num_threads = num_jobs;
+    }
+    if (_num_threads > LOG_BATCH_MAX_THREADS) {
+        _num_threads = LOG_BATCH_MAX_THREADS;
+    }
+    // the calling thread runs jobs too
+    for (uint8_t i=0; i+1<_num_threads; i++) {
+        if (pthread_create(&threads[num_threads], NULL, &LogBatchPool::thread_main, this) != 0) {
+            break;
+        }
+        num_threads++;
+    }
+    return num_threads+1;
+}
+
+void LogBatchPool::run_jobs(void)
+{
+    while (true) {
+        uint16_t i = __sync_fetch_and_add(&next_job, 1);
+        if (i >= num_jobs) {
+            break;
+        }
+        job(obj, i);
+    }
+}
+
+void *LogBatchPool::thread_main(void *arg)
+{
+    LogBatchPool *pool = (LogBatchPool *)arg;
+    uint32_t done_generation = 0;
+    while (true) {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->generation == done_generation && !pool->stopping) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        done_generation = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        pool->run_jobs();
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->busy--;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+void LogBatchPool::run(void)
+{
+    pthread_mutex_lock(&mutex);
+    next_job = 0;
+    busy = num_threads;
+    generation++;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    run_jobs();
+
+    pthread_mutex_lock(&mutex);
+    while (busy != 0) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void LogBatchPool::stop(void)
+{
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    for (uint8_t i=0; i<num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    num_threads = 0;
+    stopping = false;
+}
+
+char *log_output_path(const char *outdir, const char *logfile, const char *suffix)
+{
+    const char *base = strrchr(logfile, '/');
+    base = base ? base+1 : logfile;
+    const char *ext = strrchr(base, '.');
+    int base_len = ext ? (int)(ext - base) : (int)strlen(base);
+    char *path;
+    if (asprintf(&path, "%s/%.*s%s", outdir, base_len, base, suffix) == -1) {
+        fatal("asprintf failed");
+    }
+    return path;
+}
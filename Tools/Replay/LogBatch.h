@@ -0,0 +1,82 @@
+#ifndef AP_LOGBATCH_H
+#define AP_LOGBATCH_H
+
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+/*
+  process a list of logs, sharing them out between up to num_threads
+  threads. process is called once for each log and returns false if
+  the log failed. Returns false if any log failed
+ */
+bool log_batch(char * const *logfiles, uint16_t num_logs, uint8_t num_threads,
+               bool (*process)(void *obj, const char *logfile), void *obj);
+
+/*
+  return the path of an output for a log: outdir followed by the name
+  of the log without its extension, followed by suffix. The caller
+  frees the returned string
+ */
+char *log_output_path(const char *outdir, const char *logfile, const char *suffix);
+
+/*
+  a pool of threads that run a numbered list of jobs. Each run() shares
+  jobs 0 to num_jobs-1 out between the threads, including the caller,
+  and returns when they have all been done. The threads wait between
+  runs, so a pool can run the jobs of every step of a replay
+ */
+#define LOG_BATCH_MAX_THREADS 64
+class LogBatchPool
+{
+public:
+    LogBatchPool(void (*_job)(void *obj, uint16_t i), void *_obj);
+    ~LogBatchPool() { stop(); }
+
+    // start the threads for num_jobs jobs. The caller is one of the
+    // num_threads. Returns the number of threads used
+    uint8_t start(uint8_t num_threads, uint16_t _num_jobs);
+
+    // run every job once
+    void run(void);
+
+    // stop the threads
+    void stop(void);
+
+private:
+    void (*job)(void *obj, uint16_t i);
+    void *obj;
+    uint16_t num_jobs;
+
+    // each run() bumps the generation, and every thread takes jobs
+    // from next_job until there are none left
+    uint8_t num_threads;
+    pthread_t threads[LOG_BATCH_MAX_THREADS];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t generation;
+    uint8_t busy;
+    bool stopping;
+    volatile uint16_t next_job;
+    void run_jobs(void);
+    static void *thread_main(void *arg);
+};
+
+/*
+  RMS and maximum of a series of values. Zero it before use
+ */
+struct log_stats {
+    uint32_t n;
+    double sum_sq;
+    float max;
+    void add(float x) {
+        n++;
+        sum_sq += (double)x*x;
+        if (fabsf(x) > max) {
+            max = fabsf(x);
+        }
+    }
+    float rms(void) const { return n > 0 ? sqrt(sum_sq / n) : 0; }
+};
+
+#endif // AP_LOGBATCH_H
@@ -0,0 +1,1334 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <DataFlash.h>
+
+#include "LogCheck.h"
+#include "LogStream.h"
+#include "LogBatch.h"
+#include "MsgHandler_Check.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// the fields each check message uses, in the order they are kept in
+// check_format.fields
+static const struct {
+    const char *name;
+    const char *labels[LOGCHECK_MAX_FIELDS];
+} check_messages[] = {
+    { "", { NULL } },
+    { "PARM", { "Name", "Value" } },
+    { "MSG",  { "Message" } },
+    { "MODE", { "Mode" } },
+    { "GPS",  { "TimeMS", "NSats", "HDop" } },
+    { "IMU",  { "AccX", "AccY", "AccZ" } },
+    { "MAG",  { "MagX", "MagY", "MagZ", "OfsX", "OfsY", "OfsZ" } },
+    { "ERR",  { "Subsys", "ECode" } },
+    { "EV",   { "Id" } },
+    { "CTUN", { "ThrOut", "BarAlt" } },
+    { "CURR", { "Vcc" } },
+    { "PM",   { "NLon", "NLoop" } },
+    { "RCOU", { "Ch1", "Ch2", "Ch3", "Ch4", "Ch5", "Ch6", "Ch7", "Ch8" } },
+    { "ATT",  { "Pitch" } },
+};
+
+// copter flight mode the vibration check looks at
+#define LOGCHECK_COPTER_LOITER 5
+
+LogCheck::LogCheck(DataFlash_Class &_dataflash) :
+    dataflash(_dataflash),
+    have_vehicle(false),
+    have_gps(false),
+    first_gps_ms(0),
+    last_gps_ms(0),
+    max_gps_ms(0),
+    num_params(0),
+    have_ctun(false),
+    armed(false),
+    final_baro_alt(0),
+    max_throttle_out(0),
+    have_mag(false),
+    max_mag_offsets_length(-1),
+    have_mag_field(false),
+    min_mag_field(0),
+    max_mag_field(0),
+    mag_zeros(false),
+    gps_glitches(0),
+    min_sats(0),
+    max_hdop(0),
+    errors(0),
+    have_rcou(false),
+    motor_params_missing(false),
+    motor_min_throttle(0),
+    motor_channels(0),
+    motor_rows(0),
+    motor_row_avg_sum(0),
+    have_pm(false),
+    slow_loop_lines(0),
+    max_percent_slow(0),
+    max_percent_slow_line(0),
+    have_curr(false),
+    vcc_min(0),
+    vcc_max(0),
+    have_imu(false),
+    in_loiter(false),
+    num_pending_chunks(0),
+    have_best_chunk(false),
+    num_pitch(0),
+    pitch_space(0),
+    pitch(NULL),
+    pitch_line(NULL)
+{
+    memset(formats, 0, sizeof(formats));
+    memset(vehicle_type, 0, sizeof(vehicle_type));
+    memset(firmware_version, 0, sizeof(firmware_version));
+    memset(firmware_hash, 0, sizeof(firmware_hash));
+    memset(copter_type, 0, sizeof(copter_type));
+    memset(max_mag_offsets, 0, sizeof(max_mag_offsets));
+    memset(motor_missing_param, 0, sizeof(motor_missing_param));
+    memset(motor_sum, 0, sizeof(motor_sum));
+    memset(results, 0, sizeof(results));
+}
+
+LogCheck::~LogCheck()
+{
+    free(pitch);
+    free(pitch_line);
+}
+
+/*
+  find where the fields the checks use are in a message type
+ */
+void LogCheck::add_format(const struct log_Format &f)
+{
+    char name[5];
+    memset(name, 0, sizeof(name));
+    strncpy(name, f.name, 4);
+
+    // LogAnalyzer takes the copter frame from the MOT labels
+    if (streq(name, "MOT")) {
+        char labels[sizeof(f.labels)+1];
+        memset(labels, 0, sizeof(labels));
+        memcpy(labels, f.labels, sizeof(f.labels));
+        uint8_t num_labels = 1;
+        for (const char *p=labels; *p; p++) {
+            if (*p == ',') {
+                num_labels++;
+            }
+        }
+        if (strstr(labels, "GGain") != NULL) {
+            strcpy(copter_type, "tradheli");
+        } else if (num_labels == 4) {
+            strcpy(copter_type, "quad");
+        } else if (num_labels == 6) {
+            strcpy(copter_type, "hex");
+        } else if (num_labels == 8) {
+            strcpy(copter_type, "octo");
+        }
+        return;
+    }
+
+    enum check_msg msg = CHECK_MSG_NONE;
+    for (uint8_t i=1; i<(sizeof(check_messages)/sizeof(check_messages[0])); i++) {
+        if (streq(name, check_messages[i].name)) {
+            msg = (enum check_msg)i;
+            break;
+        }
+    }
+    if (msg == CHECK_MSG_NONE || formats[f.type].msg != CHECK_MSG_NONE) {
+        return;
+    }
+
+    struct log_Format fmt = f;
+    uint64_t last_timestamp_usec = 0;
+    MsgHandler_Check handler(fmt, dataflash, last_timestamp_usec);
+
+    struct check_format &cf = formats[f.type];
+    cf.msg = msg;
+    cf.length = f.length;
+    for (uint8_t i=0; i<LOGCHECK_MAX_FIELDS; i++) {
+        const char *label = check_messages[msg].labels[i];
+        if (label == NULL) {
+            break;
+        }
+        cf.fields[i].offset = handler.find_offset(label, cf.fields[i].type);
+        if (cf.fields[i].offset == 0 && msg == CHECK_MSG_RCOU) {
+            // newer logs name the outputs Chan1 to Chan8
+            char chan[6];
+            snprintf(chan, sizeof(chan), "Chan%u", (unsigned)(i+1));
+            cf.fields[i].offset = handler.find_offset(chan, cf.fields[i].type);
+        }
+    }
+}
+
+bool LogCheck::field_present(enum check_msg msg, uint8_t i) const
+{
+    for (uint16_t t=0; t<256; t++) {
+        if (formats[t].msg == msg && formats[t].fields[i].offset != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  value of a numeric field, scaled the way LogAnalyzer scales it
+ */
+double LogCheck::field_float(const uint8_t *msg, const struct check_field &field)
+{
+    const uint8_t *p = &msg[field.offset];
+    switch (field.type) {
+    case 'b': {
+        int8_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    case 'B':
+    case 'M': {
+        uint8_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    case 'h':
+    case 'c': {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        return field.type == 'c' ? v/100.0 : v;
+    }
+    case 'H':
+    case 'C': {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return field.type == 'C' ? v/100.0 : v;
+    }
+    case 'i':
+    case 'e':
+    case 'L': {
+        int32_t v;
+        memcpy(&v, p, sizeof(v));
+        return field.type == 'e' ? v/100.0 : v;
+    }
+    case 'I':
+    case 'E': {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return field.type == 'E' ? v/100.0 : v;
+    }
+    case 'f': {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    }
+    return 0;
+}
+
+int32_t LogCheck::field_int(const uint8_t *msg, const struct check_field &field)
+{
+    return (int32_t)field_float(msg, field);
+}
+
+bool LogCheck::find_param(const char *name, float &value) const
+{
+    for (uint16_t i=0; i<num_params; i++) {
+        if (streq(params[i].name, name)) {
+            value = params[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LogCheck::set_param(const char *name, float value)
+{
+    for (uint16_t i=0; i<num_params; i++) {
+        if (streq(params[i].name, name)) {
+            params[i].value = value;
+            return;
+        }
+    }
+    if (num_params < LOGCHECK_MAX_PARAMS) {
+        strncpy(params[num_params].name, name, sizeof(params[num_params].name)-1);
+        params[num_params].name[sizeof(params[num_params].name)-1] = 0;
+        params[num_params].value = value;
+        num_params++;
+    }
+}
+
+/*
+  update the checks with one message
+ */
+void LogCheck::process(const uint8_t *msg, uint32_t line)
+{
+    const struct check_format &fmt = formats[msg[2]];
+    const struct check_field *f = fmt.fields;
+
+    switch (fmt.msg) {
+    case CHECK_MSG_NONE:
+        break;
+
+    case CHECK_MSG_PARM: {
+        if (f[0].offset == 0 || f[1].offset == 0) {
+            break;
+        }
+        char name[17];
+        memset(name, 0, sizeof(name));
+        memcpy(name, &msg[f[0].offset], 16);
+        set_param(name, field_float(msg, f[1]));
+        break;
+    }
+
+    case CHECK_MSG_MSG: {
+        if (have_vehicle || f[0].offset == 0) {
+            break;
+        }
+        // the first message is "vehicle version (hash)"
+        char text[65];
+        memset(text, 0, sizeof(text));
+        memcpy(text, &msg[f[0].offset], 64);
+        char *saveptr = NULL;
+        const char *tokens[4];
+        uint8_t num_tokens = 0;
+        for (char *t = strtok_r(text, " ", &saveptr);
+             t != NULL && num_tokens < (sizeof(tokens)/sizeof(tokens[0]));
+             t = strtok_r(NULL, " ", &saveptr)) {
+            tokens[num_tokens++] = t;
+        }
+        if (num_tokens > 0) {
+            strncpy(vehicle_type, tokens[0], sizeof(vehicle_type)-1);
+        }
+        if (num_tokens > 1) {
+            strncpy(firmware_version, tokens[1], sizeof(firmware_version)-1);
+        }
+        if (num_tokens == 3 && strlen(tokens[2]) >= 2) {
+            // strip the brackets around the hash
+            strncpy(firmware_hash, tokens[2]+1, sizeof(firmware_hash)-1);
+            firmware_hash[min(strlen(tokens[2])-2, sizeof(firmware_hash)-1)] = 0;
+        }
+        have_vehicle = true;
+        break;
+    }
+
+    case CHECK_MSG_MODE: {
+        if (f[0].offset == 0 || !is_copter()) {
+            break;
+        }
+        if (in_loiter) {
+            end_loiter_chunk(line-1);
+        }
+        if (field_int(msg, f[0]) == LOGCHECK_COPTER_LOITER) {
+            in_loiter = true;
+            memset(&loiter, 0, sizeof(loiter));
+            loiter.start_line = line;
+        }
+        break;
+    }
+
+    case CHECK_MSG_GPS: {
+        if (f[0].offset == 0) {
+            break;
+        }
+        uint32_t time_ms = field_int(msg, f[0]);
+        uint8_t nsats = f[1].offset ? field_int(msg, f[1]) : 0;
+        double hdop = f[2].offset ? field_float(msg, f[2]) : 0;
+        if (!have_gps) {
+            first_gps_ms = time_ms;
+            max_gps_ms = time_ms;
+            min_sats = nsats;
+            max_hdop = hdop;
+            have_gps = true;
+        }
+        last_gps_ms = time_ms;
+        if (time_ms > max_gps_ms) {
+            max_gps_ms = time_ms;
+        }
+        if (nsats < min_sats) {
+            min_sats = nsats;
+        }
+        if (hdop > max_hdop) {
+            max_hdop = hdop;
+        }
+        if (in_loiter && !loiter.have_start_gps) {
+            loiter.have_start_gps = true;
+            loiter.start_gps_ms = time_ms;
+        }
+        for (uint8_t i=0; i<num_pending_chunks; i++) {
+            finish_loiter_chunk(pending_chunks[i], time_ms);
+        }
+        num_pending_chunks = 0;
+        break;
+    }
+
+    case CHECK_MSG_IMU:
+        have_imu = true;
+        if (in_loiter) {
+            for (uint8_t i=0; i<3; i++) {
+                if (f[i].offset != 0) {
+                    loiter.acc[i].add(field_float(msg, f[i]));
+                }
+            }
+        }
+        break;
+
+    case CHECK_MSG_MAG: {
+        have_mag = true;
+        if (f[3].offset != 0 && f[4].offset != 0 && f[5].offset != 0) {
+            Vector3f ofs(field_float(msg, f[3]), field_float(msg, f[4]), field_float(msg, f[5]));
+            if (ofs.length() >= max_mag_offsets_length) {
+                max_mag_offsets_length = ofs.length();
+                max_mag_offsets[0] = ofs.x;
+                max_mag_offsets[1] = ofs.y;
+                max_mag_offsets[2] = ofs.z;
+            }
+        }
+        if (f[0].offset != 0 && f[1].offset != 0 && f[2].offset != 0) {
+            Vector3f mag(field_float(msg, f[0]), field_float(msg, f[1]), field_float(msg, f[2]));
+            if (mag.is_zero()) {
+                mag_zeros = true;
+            } else {
+                float mag_field = mag.length();
+                if (!have_mag_field || mag_field < min_mag_field) {
+                    min_mag_field = mag_field;
+                }
+                if (!have_mag_field || mag_field > max_mag_field) {
+                    max_mag_field = mag_field;
+                }
+                have_mag_field = true;
+            }
+        }
+        break;
+    }
+
+    case CHECK_MSG_ERR: {
+        if (f[0].offset == 0 || f[1].offset == 0) {
+            break;
+        }
+        uint8_t subsys = field_int(msg, f[0]);
+        uint8_t ecode = field_int(msg, f[1]);
+        // bit per error name, in the order of event_names
+        static const struct {
+            uint8_t subsys;
+            uint8_t ecode_mask;    // bit per ECode, 0 for any
+        } events[] = {
+            {  2, 1<<1 },          // PPM
+            {  3, (1<<1)|(1<<2) }, // COMPASS
+            {  5, 1<<1 },          // FS_THR
+            {  6, 1<<1 },          // FS_BATT
+            {  7, 1<<1 },          // GPS
+            {  8, 1<<1 },          // GCS
+            {  9, (1<<1)|(1<<2) }, // FENCE
+            { 10, 0 },             // FLT_MODE
+            { 11, 1<<2 },          // GPS_GLITCH
+            { 12, 1<<1 },          // CRASH
+        };
+        for (uint8_t i=0; i<(sizeof(events)/sizeof(events[0])); i++) {
+            if (events[i].subsys == subsys &&
+                (events[i].ecode_mask == 0 || (ecode < 8 && (events[i].ecode_mask & (1U<<ecode))))) {
+                errors |= 1U<<i;
+                break;
+            }
+        }
+        if (subsys == 11 && ecode == 2) {
+            gps_glitches++;
+        }
+        break;
+    }
+
+    case CHECK_MSG_EV:
+        if (f[0].offset != 0) {
+            uint8_t id = field_int(msg, f[0]);
+            if (id == 10) {
+                armed = true;
+            } else if (id == 11) {
+                armed = false;
+            }
+        }
+        break;
+
+    case CHECK_MSG_CTUN: {
+        if (f[0].offset != 0) {
+            int32_t thr = field_int(msg, f[0]);
+            if (!have_ctun || thr > max_throttle_out) {
+                max_throttle_out = thr;
+            }
+        }
+        if (f[1].offset != 0) {
+            final_baro_alt = field_float(msg, f[1]);
+        }
+        have_ctun = true;
+        break;
+    }
+
+    case CHECK_MSG_CURR:
+        if (f[0].offset != 0) {
+            int32_t vcc = field_int(msg, f[0]);
+            if (!have_curr || vcc < vcc_min) {
+                vcc_min = vcc;
+            }
+            if (!have_curr || vcc > vcc_max) {
+                vcc_max = vcc;
+            }
+        }
+        have_curr = true;
+        break;
+
+    case CHECK_MSG_PM:
+        have_pm = true;
+        if (f[0].offset != 0 && f[1].offset != 0) {
+            float nloop = field_float(msg, f[1]);
+            if (nloop <= 0) {
+                break;
+            }
+            float percent_slow = 100 * field_float(msg, f[0]) / nloop;
+            if (percent_slow > 6.0f) {
+                slow_loop_lines++;
+                if (percent_slow > max_percent_slow) {
+                    max_percent_slow = percent_slow;
+                    max_percent_slow_line = line;
+                }
+            }
+        }
+        break;
+
+    case CHECK_MSG_RCOU:
+        have_rcou = true;
+        update_motors(msg, fmt);
+        break;
+
+    case CHECK_MSG_ATT:
+        if (f[0].offset == 0) {
+            break;
+        }
+        if (num_pitch == pitch_space) {
+            pitch_space = pitch_space ? pitch_space*2 : 4096;
+            pitch = (float *)realloc(pitch, pitch_space*sizeof(pitch[0]));
+            pitch_line = (uint32_t *)realloc(pitch_line, pitch_space*sizeof(pitch_line[0]));
+            if (pitch == NULL || pitch_line == NULL) {
+                fatal("out of memory for ATT data");
+            }
+        }
+        pitch[num_pitch] = field_float(msg, f[0]);
+        pitch_line[num_pitch] = line;
+        num_pitch++;
+        break;
+    }
+}
+
+/*
+  add an RCOU message to the motor averages. Only messages with every
+  output in range and an average output above minimum throttle count
+ */
+void LogCheck::update_motors(const uint8_t *msg, const struct check_format &fmt)
+{
+    if (motor_params_missing) {
+        return;
+    }
+    if (motor_channels == 0) {
+        while (motor_channels < LOGCHECK_MAX_FIELDS && fmt.fields[motor_channels].offset != 0) {
+            motor_channels++;
+        }
+        float rc3_min, rc3_max, thr_min;
+        const char *missing = NULL;
+        if (!find_param("RC3_MIN", rc3_min)) {
+            missing = "RC3_MIN";
+        } else if (!find_param("THR_MIN", thr_min)) {
+            missing = "THR_MIN";
+        } else if (!find_param("RC3_MAX", rc3_max)) {
+            missing = "RC3_MAX";
+        }
+        if (missing != NULL) {
+            strcpy(motor_missing_param, missing);
+            motor_params_missing = true;
+            return;
+        }
+        // as LogAnalyzer calculates it
+        motor_min_throttle = rc3_min + thr_min / (rc3_max - rc3_min) / 1000.0f;
+    }
+    if (motor_channels < 2) {
+        return;
+    }
+
+    int32_t values[LOGCHECK_MAX_FIELDS];
+    int32_t sum = 0;
+    for (uint8_t i=0; i<motor_channels; i++) {
+        if (fmt.fields[i].offset == 0) {
+            return;
+        }
+        values[i] = field_int(msg, fmt.fields[i]);
+        if (values[i] <= 0 || values[i] >= 3000) {
+            return;
+        }
+        sum += values[i];
+    }
+    int32_t avg = sum / motor_channels;
+    if (avg <= motor_min_throttle) {
+        return;
+    }
+    for (uint8_t i=0; i<motor_channels; i++) {
+        motor_sum[i] += values[i];
+    }
+    motor_row_avg_sum += avg;
+    motor_rows++;
+}
+
+/*
+  a LOITER section ends at end_line. Its length in time comes from the
+  first GPS message after its end, so it waits for one
+ */
+void LogCheck::end_loiter_chunk(uint32_t end_line)
+{
+    in_loiter = false;
+    loiter.end_line = end_line;
+    if (num_pending_chunks < LOGCHECK_MAX_PENDING_CHUNKS) {
+        pending_chunks[num_pending_chunks++] = loiter;
+    }
+}
+
+void LogCheck::finish_loiter_chunk(const struct loiter_chunk &chunk, uint32_t end_gps_ms)
+{
+    // a section with no GPS message in it starts at the GPS message
+    // after it, as LogAnalyzer finds its start time from the next GPS
+    // message
+    uint32_t start_gps_ms = chunk.have_start_gps ? chunk.start_gps_ms : end_gps_ms;
+    if ((int32_t)(end_gps_ms - start_gps_ms + 1) <= 10000) {
+        return;
+    }
+    if (!have_best_chunk ||
+        chunk.end_line - chunk.start_line > best_chunk.end_line - best_chunk.start_line) {
+        best_chunk = chunk;
+        have_best_chunk = true;
+    }
+}
+
+void LogCheck::check_brownout(struct check_result &r)
+{
+    r.name = "Brownout";
+    if (!have_ctun) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No CTUN log data");
+        return;
+    }
+    // the highest altitude that is still on the ground
+    if (field_present(CHECK_MSG_CTUN, 1) && armed && final_baro_alt > 3.0f) {
+        r.status = CHECK_FAIL;
+        snprintf(r.message, sizeof(r.message),
+                 "Truncated Log? Ends while armed at altitude %.2fm", final_baro_alt);
+    }
+}
+
+void LogCheck::check_compass(struct check_result &r)
+{
+    r.name = "Compass";
+    const float warn_offset = 300;
+    const float fail_offset = 500;
+    size_t len;
+
+    static const char *ofs_names[3] = { "COMPASS_OFS_X", "COMPASS_OFS_Y", "COMPASS_OFS_Z" };
+    float ofs[3];
+    for (uint8_t i=0; i<3; i++) {
+        if (!find_param(ofs_names[i], ofs[i])) {
+            r.status = CHECK_FAIL;
+            snprintf(r.message, sizeof(r.message), "'%s' not found", ofs_names[i]);
+            return;
+        }
+    }
+    float ofs_length = Vector3f(ofs[0], ofs[1], ofs[2]).length();
+    if (ofs_length > fail_offset) {
+        r.status = CHECK_FAIL;
+        snprintf(r.message, sizeof(r.message),
+                 "FAIL: Large compass offset params (X:%.2f, Y:%.2f, Z:%.2f)\n",
+                 ofs[0], ofs[1], ofs[2]);
+    } else if (ofs_length > warn_offset) {
+        r.status = CHECK_WARN;
+        snprintf(r.message, sizeof(r.message),
+                 "WARN: Large compass offset params (X:%.2f, Y:%.2f, Z:%.2f)\n",
+                 ofs[0], ofs[1], ofs[2]);
+    }
+
+    if (!have_mag) {
+        len = strlen(r.message);
+        snprintf(&r.message[len], sizeof(r.message)-len,
+                 "No MAG data, unable to test mag_field interference\n");
+        return;
+    }
+
+    if (max_mag_offsets_length > fail_offset) {
+        r.status = CHECK_FAIL;
+        len = strlen(r.message);
+        snprintf(&r.message[len], sizeof(r.message)-len,
+                 "FAIL: Large compass offset in MAG data (X:%.2f, Y:%.2f, Z:%.2f)\n",
+                 max_mag_offsets[0], max_mag_offsets[1], max_mag_offsets[2]);
+    } else if (max_mag_offsets_length > warn_offset) {
+        if (r.status != CHECK_FAIL) {
+            r.status = CHECK_WARN;
+        }
+        len = strlen(r.message);
+        snprintf(&r.message[len], sizeof(r.message)-len,
+                 "WARN: Large compass offset in MAG data (X:%.2f, Y:%.2f, Z:%.2f)\n",
+                 max_mag_offsets[0], max_mag_offsets[1], max_mag_offsets[2]);
+    }
+
+    // change in mag field length, and length outside of the
+    // recommended range
+    if (have_mag_field) {
+        float percent_diff = (max_mag_field - min_mag_field) / min_mag_field;
+        len = strlen(r.message);
+        if (percent_diff > 0.35f) {
+            r.status = CHECK_FAIL;
+            snprintf(&r.message[len], sizeof(r.message)-len,
+                     "Large change in mag_field (%.2f%%)\n", percent_diff*100);
+        } else if (percent_diff > 0.25f) {
+            if (r.status != CHECK_FAIL) {
+                r.status = CHECK_WARN;
+            }
+            snprintf(&r.message[len], sizeof(r.message)-len,
+                     "Moderate change in mag_field (%.2f%%)\n", percent_diff*100);
+        } else {
+            snprintf(&r.message[len], sizeof(r.message)-len,
+                     "mag_field interference within limits (%.2f%%)\n", percent_diff*100);
+        }
+        if (min_mag_field < 120) {
+            len = strlen(r.message);
+            snprintf(&r.message[len], sizeof(r.message)-len,
+                     "Min mag field length (%.2f) < recommended (%.2f)\n", min_mag_field, 120.0);
+        }
+        if (max_mag_field > 550) {
+            len = strlen(r.message);
+            snprintf(&r.message[len], sizeof(r.message)-len,
+                     "Max mag field length (%.2f) > recommended (%.2f)\n", max_mag_field, 550.0);
+        }
+    }
+    if (mag_zeros) {
+        if (r.status != CHECK_FAIL) {
+            r.status = CHECK_WARN;
+        }
+        len = strlen(r.message);
+        snprintf(&r.message[len], sizeof(r.message)-len,
+                 "All zeros found in MAG X/Y/Z log data\n");
+    }
+}
+
+/*
+  look for a block of 20 ATT Pitch values repeated later in the log,
+  from 10 sample points spread through the log
+ */
+void LogCheck::check_dupe(struct check_result &r)
+{
+    r.name = "Dupe Log Data";
+    if (num_pitch == 0) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No ATT log data");
+        return;
+    }
+    const uint32_t sample_len = 20;
+    uint32_t end_index = num_pitch - 1;
+    uint32_t step = end_index / 11;
+    if (step == 0) {
+        return;
+    }
+    for (uint32_t start=step; start+step<end_index; start+=step) {
+        uint32_t len = sample_len;
+        if (start + len > num_pitch) {
+            len = num_pitch - start;
+        }
+        // ignore samples that are all the same value
+        uint32_t num_same = 0;
+        for (uint32_t j=0; j<len; j++) {
+            if (pitch[start+j] == pitch[start]) {
+                num_same++;
+            }
+        }
+        if (num_same == sample_len) {
+            continue;
+        }
+        for (uint32_t i=start+1; i<num_pitch; i++) {
+            uint32_t j = 0;
+            while (j < sample_len && j < len && i+j < num_pitch && pitch[i+j] == pitch[start+j]) {
+                j++;
+            }
+            if (j == sample_len) {
+                r.status = CHECK_FAIL;
+                snprintf(r.message, sizeof(r.message),
+                         "Duplicate data chunks found in log (%u and %u)",
+                         (unsigned)pitch_line[start], (unsigned)pitch_line[i]);
+                return;
+            }
+        }
+    }
+}
+
+void LogCheck::check_empty(struct check_result &r)
+{
+    r.name = "Empty";
+    // copter throttle is 0 to 1000, plane and rover 0 to 100
+    int32_t threshold = is_copter() ? 200 : 20;
+    if (have_ctun && field_present(CHECK_MSG_CTUN, 0) && max_throttle_out < threshold) {
+        r.status = CHECK_FAIL;
+        strcpy(r.message, "Empty log? Throttle never above 20%");
+    }
+}
+
+void LogCheck::check_events(struct check_result &r)
+{
+    r.name = "Event/Failsafe";
+    static const char *event_names[] = {
+        "PPM", "COMPASS", "FS_THR", "FS_BATT", "GPS", "GCS",
+        "FENCE", "FLT_MODE", "GPS_GLITCH", "CRASH"
+    };
+    const uint16_t fence = 1U<<6;
+    if (errors == 0) {
+        return;
+    }
+    if (errors == fence) {
+        r.status = CHECK_WARN;
+    } else {
+        r.status = CHECK_FAIL;
+        if ((errors & (errors-1)) == 0) {
+            strcpy(r.message, "ERR found: ");
+        } else {
+            strcpy(r.message, "ERRs found: ");
+        }
+    }
+    for (uint8_t i=0; i<(sizeof(event_names)/sizeof(event_names[0])); i++) {
+        if (errors & (1U<<i)) {
+            size_t len = strlen(r.message);
+            snprintf(&r.message[len], sizeof(r.message)-len, "%s ", event_names[i]);
+        }
+    }
+}
+
+// python str() of a float
+static void format_str(char *buf, size_t buflen, double v)
+{
+    snprintf(buf, buflen, "%.12g", v);
+    if (strpbrk(buf, ".en") == NULL) {
+        strncat(buf, ".0", buflen-strlen(buf)-1);
+    }
+}
+
+// python repr() of a float: the shortest string that reads back as
+// the same value
+static void format_repr(char *buf, size_t buflen, double v)
+{
+    if (isnan(v)) {
+        snprintf(buf, buflen, "nan");
+        return;
+    }
+    if (isinf(v)) {
+        snprintf(buf, buflen, v > 0 ? "inf" : "-inf");
+        return;
+    }
+    for (uint8_t digits=1; digits<=17; digits++) {
+        snprintf(buf, buflen, "%.*e", digits-1, v);
+        if (strtod(buf, NULL) != v) {
+            continue;
+        }
+        int exponent = atoi(strchr(buf, 'e')+1);
+        if (exponent >= -4 && exponent < 16) {
+            int decimals = digits - 1 - exponent;
+            snprintf(buf, buflen, "%.*f", decimals > 0 ? decimals : 0, v);
+            if (strchr(buf, '.') == NULL) {
+                strncat(buf, ".0", buflen-strlen(buf)-1);
+            }
+        }
+        return;
+    }
+}
+
+void LogCheck::check_gps(struct check_result &r)
+{
+    r.name = "GPS";
+    if (!have_gps) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No GPS log data");
+        return;
+    }
+    if (gps_glitches != 0) {
+        r.status = CHECK_FAIL;
+        snprintf(r.message, sizeof(r.message), "GPS glitch errors found (%u)\n", (unsigned)gps_glitches);
+    }
+    char hdop[32];
+    format_str(hdop, sizeof(hdop), max_hdop);
+    char sats_msg[80];
+    snprintf(sats_msg, sizeof(sats_msg), "Min satellites: %u, Max HDop: %s", (unsigned)min_sats, hdop);
+    if (gps_glitches != 0) {
+        strncat(r.message, sats_msg, sizeof(r.message)-strlen(r.message)-1);
+    } else if (min_sats < 5 || max_hdop > 10) {
+        r.status = CHECK_FAIL;
+        strcpy(r.message, sats_msg);
+    } else if (min_sats < 6 || max_hdop > 3) {
+        r.status = CHECK_WARN;
+        strcpy(r.message, sats_msg);
+    }
+}
+
+void LogCheck::check_motor_balance(struct check_result &r)
+{
+    r.name = "Motor Balance";
+    if (!is_copter()) {
+        r.status = CHECK_NA;
+        return;
+    }
+    r.status = CHECK_UNKNOWN;
+    if (motor_params_missing) {
+        snprintf(r.message, sizeof(r.message), "'%s' not found", motor_missing_param);
+        return;
+    }
+    if (!have_rcou || motor_channels < 2 || motor_rows == 0) {
+        return;
+    }
+
+    int32_t avg_all = motor_row_avg_sum / motor_rows;
+    int32_t avg_ch[LOGCHECK_MAX_FIELDS];
+    int32_t min_avg = 0, max_avg = 0;
+    char averages[128] = "[";
+    for (uint8_t i=0; i<motor_channels; i++) {
+        avg_ch[i] = motor_sum[i] / motor_rows;
+        if (i == 0 || avg_ch[i] < min_avg) {
+            min_avg = avg_ch[i];
+        }
+        if (i == 0 || avg_ch[i] > max_avg) {
+            max_avg = avg_ch[i];
+        }
+        size_t len = strlen(averages);
+        snprintf(&averages[len], sizeof(averages)-len, "%s%d", i==0?"":", ", (int)avg_ch[i]);
+    }
+    strncat(averages, "]", sizeof(averages)-strlen(averages)-1);
+
+    int32_t diff = max_avg - min_avg;
+    snprintf(r.message, sizeof(r.message),
+             "Motor channel averages = %s\nAverage motor output = %d\nDifference between min and max motor averages = %d",
+             averages, (int)avg_all, (int)diff);
+    if (diff > 150) {
+        r.status = CHECK_FAIL;
+    } else if (diff > 75) {
+        r.status = CHECK_WARN;
+    } else {
+        r.status = CHECK_GOOD;
+    }
+}
+
+void LogCheck::check_params(struct check_result &r)
+{
+    r.name = "Parameters";
+    size_t len;
+    for (uint16_t i=0; i<num_params; i++) {
+        if (isnan(params[i].value)) {
+            r.status = CHECK_FAIL;
+            len = strlen(r.message);
+            snprintf(&r.message[len], sizeof(r.message)-len, "%s is NaN\n", params[i].name);
+        }
+    }
+
+    if (is_copter()) {
+        // the checks of TestParams.py, including its wording
+        static const struct {
+            const char *name;
+            char op;
+            int16_t limit;
+        } limits[] = {
+            { "MAG_ENABLE", '=',   1 },
+            { "THR_MIN",    '<', 200 },
+            { "THR_MID",    '<', 701 },
+            { "THR_MID",    '>', 299 },
+        };
+        for (uint8_t i=0; i<(sizeof(limits)/sizeof(limits[0])); i++) {
+            float value;
+            if (!find_param(limits[i].name, value)) {
+                r.status = CHECK_FAIL;
+                snprintf(r.message, sizeof(r.message), "'%s' not found", limits[i].name);
+                return;
+            }
+            bool ok;
+            const char *expecting;
+            switch (limits[i].op) {
+            case '=':
+                ok = value == limits[i].limit;
+                expecting = "";
+                break;
+            case '<':
+                ok = value < limits[i].limit;
+                expecting = "less than ";
+                break;
+            default:
+                ok = value > limits[i].limit;
+                expecting = "less than ";
+                break;
+            }
+            if (!ok) {
+                char value_str[32];
+                format_repr(value_str, sizeof(value_str), value);
+                r.status = CHECK_FAIL;
+                len = strlen(r.message);
+                snprintf(&r.message[len], sizeof(r.message)-len, "%s set to %s, expecting %s%d\n",
+                         limits[i].name, value_str, expecting, (int)limits[i].limit);
+            }
+        }
+    }
+
+    if (r.status == CHECK_FAIL) {
+        const char *prefix = "Bad parameters found:\n";
+        len = strlen(prefix);
+        memmove(&r.message[len], r.message, sizeof(r.message)-len-1);
+        memcpy(r.message, prefix, len);
+        r.message[sizeof(r.message)-1] = 0;
+    }
+}
+
+void LogCheck::check_pm(struct check_result &r)
+{
+    r.name = "PM";
+    if (!is_copter()) {
+        r.status = CHECK_NA;
+        return;
+    }
+    if (!have_pm) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No PM log data");
+        return;
+    }
+    if (max_percent_slow > 10 || slow_loop_lines > 6) {
+        r.status = CHECK_FAIL;
+    } else if (max_percent_slow > 6) {
+        r.status = CHECK_WARN;
+    } else {
+        return;
+    }
+    snprintf(r.message, sizeof(r.message), "%u slow loop lines found, max %.2f%% on line %u",
+             (unsigned)slow_loop_lines, max_percent_slow, (unsigned)max_percent_slow_line);
+}
+
+void LogCheck::check_vcc(struct check_result &r)
+{
+    r.name = "VCC";
+    if (!have_curr) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No CURR log data");
+        return;
+    }
+    char a[32], b[32];
+    if (vcc_max - vcc_min > 300) {
+        r.status = CHECK_WARN;
+        format_str(a, sizeof(a), (vcc_max - vcc_min)/1000.0);
+        format_str(b, sizeof(b), 0.3);
+        snprintf(r.message, sizeof(r.message), "VCC min/max diff %sv, should be <%sv", a, b);
+    } else if (vcc_min < 4600) {
+        r.status = CHECK_FAIL;
+        format_repr(a, sizeof(a), 4.6);
+        format_repr(b, sizeof(b), vcc_min/1000.0);
+        snprintf(r.message, sizeof(r.message), "VCC below minimum of %sv (%sv)", a, b);
+    }
+}
+
+void LogCheck::check_vibration(struct check_result &r)
+{
+    r.name = "Vibration";
+    if (!is_copter()) {
+        r.status = CHECK_NA;
+        return;
+    }
+    if (!have_imu) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No IMU log data");
+        return;
+    }
+    if (!have_best_chunk) {
+        r.status = CHECK_UNKNOWN;
+        strcpy(r.message, "No stable LOITER log data found");
+        return;
+    }
+
+    // twice the standard deviation, so if 95% of samples are within
+    // the aim range we're good
+    float x = 2 * best_chunk.acc[0].std_dev();
+    float y = 2 * best_chunk.acc[1].std_dev();
+    float z = 2 * best_chunk.acc[2].std_dev();
+    const char *msg;
+    if (x > 3.0f || y > 3.0f || z > 5.0f) {
+        r.status = CHECK_FAIL;
+        msg = "Vibration too high";
+    } else if (x > 1.5f || y > 1.5f || z > 2.0f) {
+        r.status = CHECK_WARN;
+        msg = "Vibration slightly high";
+    } else {
+        msg = "Good vibration values";
+    }
+    snprintf(r.message, sizeof(r.message), "%s (X:%.2fg, Y:%.2fg, Z:%.2fg)", msg, x, y, z);
+}
+
+/*
+  run the checks, in the order LogAnalyzer runs them
+ */
+void LogCheck::run_checks(void)
+{
+    check_brownout(results[0]);
+    check_compass(results[1]);
+    check_dupe(results[2]);
+    check_empty(results[3]);
+    check_events(results[4]);
+    check_gps(results[5]);
+    check_motor_balance(results[6]);
+    check_params(results[7]);
+    check_pm(results[8]);
+    check_vcc(results[9]);
+    check_vibration(results[10]);
+}
+
+static const char *status_names[] = { "GOOD", "FAIL", "WARN", "UNKNOWN", "NA" };
+
+// write a string with XML special characters escaped
+static void xml_escape(FILE *f, const char *s)
+{
+    for (; *s; s++) {
+        switch (*s) {
+        case '&': fputs("&amp;", f); break;
+        case '<': fputs("&lt;", f); break;
+        case '>': fputs("&gt;", f); break;
+        default:  fputc(*s, f); break;
+        }
+    }
+}
+
+// write a quoted JSON string
+static void json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        switch (*s) {
+        case '"':  fputs("\\\"", f); break;
+        case '\\': fputs("\\\\", f); break;
+        case '\n': fputs("\\n", f); break;
+        case '\t': fputs("\\t", f); break;
+        default:
+            if ((uint8_t)*s < 0x20) {
+                fprintf(f, "\\u%04x", (unsigned)(uint8_t)*s);
+            } else {
+                fputc(*s, f);
+            }
+            break;
+        }
+    }
+    fputc('"', f);
+}
+
+// python str() of a timedelta in whole seconds
+static void format_duration(char *buf, size_t buflen, uint32_t secs)
+{
+    uint32_t days = secs / 86400;
+    secs %= 86400;
+    if (days > 0) {
+        snprintf(buf, buflen, "%u day%s, %u:%02u:%02u", (unsigned)days, days==1?"":"s",
+                 (unsigned)(secs/3600), (unsigned)((secs/60)%60), (unsigned)(secs%60));
+    } else {
+        snprintf(buf, buflen, "%u:%02u:%02u",
+                 (unsigned)(secs/3600), (unsigned)((secs/60)%60), (unsigned)(secs%60));
+    }
+}
+
+void LogCheck::write_xml(FILE *f, const char *logfile, uint64_t num_bytes, uint32_t num_lines)
+{
+    char buf[64];
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(f, "<loganalysis>\n");
+    fprintf(f, "<header>\n");
+    fprintf(f, "  <logfile>");
+    xml_escape(f, logfile);
+    fprintf(f, "</logfile>\n");
+    format_repr(buf, sizeof(buf), num_bytes / 1024.0);
+    fprintf(f, "  <sizekb>%s</sizekb>\n", buf);
+    fprintf(f, "  <sizelines>%u</sizelines>\n", (unsigned)num_lines);
+    format_duration(buf, sizeof(buf), have_gps ? (last_gps_ms - first_gps_ms) / 1000 : 0);
+    fprintf(f, "  <duration>%s</duration>\n", buf);
+    fprintf(f, "  <vehicletype>");
+    xml_escape(f, vehicle_type);
+    fprintf(f, "</vehicletype>\n");
+    if (is_copter() && copter_type[0] != 0) {
+        fprintf(f, "  <coptertype>%s</coptertype>\n", copter_type);
+    }
+    fprintf(f, "  <firmwareversion>");
+    xml_escape(f, firmware_version);
+    fprintf(f, "</firmwareversion>\n");
+    fprintf(f, "  <firmwarehash>");
+    xml_escape(f, firmware_hash);
+    fprintf(f, "</firmwarehash>\n");
+    fprintf(f, "  <hardwaretype></hardwaretype>\n");
+    fprintf(f, "  <freemem>0</freemem>\n");
+    fprintf(f, "  <skippedlines>0</skippedlines>\n");
+    fprintf(f, "</header>\n");
+
+    fprintf(f, "<params>\n");
+    for (uint16_t i=0; i<num_params; i++) {
+        format_repr(buf, sizeof(buf), params[i].value);
+        fprintf(f, "  <param name=\"%s\" value=\"%s\" />\n", params[i].name, buf);
+    }
+    fprintf(f, "</params>\n");
+
+    fprintf(f, "<results>\n");
+    for (uint8_t i=0; i<LOGCHECK_NUM_CHECKS; i++) {
+        const struct check_result &r = results[i];
+        fprintf(f, "  <result>\n");
+        fprintf(f, "    <name>");
+        xml_escape(f, r.name);
+        fprintf(f, "</name>\n");
+        fprintf(f, "    <status>%s</status>\n", status_names[r.status]);
+        if (r.status != CHECK_NA) {
+            fprintf(f, "    <message>");
+            xml_escape(f, r.message);
+            fprintf(f, "</message>\n");
+        }
+        if (r.status == CHECK_FAIL || r.status == CHECK_WARN) {
+            fprintf(f, "    <data>(test data will be embeded here at some point)</data>\n");
+        }
+        fprintf(f, "  </result>\n");
+    }
+    fprintf(f, "</results>\n");
+    fprintf(f, "</loganalysis>\n");
+}
+
+void LogCheck::write_json(FILE *f, const char *logfile, uint64_t num_bytes, uint32_t num_lines)
+{
+    char buf[64];
+    fprintf(f, "{\n  \"header\": {\n    \"logfile\": ");
+    json_string(f, logfile);
+    format_repr(buf, sizeof(buf), num_bytes / 1024.0);
+    fprintf(f, ",\n    \"sizekb\": %s,\n    \"sizelines\": %u,\n    \"duration\": ", buf, (unsigned)num_lines);
+    format_duration(buf, sizeof(buf), have_gps ? (last_gps_ms - first_gps_ms) / 1000 : 0);
+    json_string(f, buf);
+    fprintf(f, ",\n    \"vehicletype\": ");
+    json_string(f, vehicle_type);
+    if (is_copter() && copter_type[0] != 0) {
+        fprintf(f, ",\n    \"coptertype\": ");
+        json_string(f, copter_type);
+    }
+    fprintf(f, ",\n    \"firmwareversion\": ");
+    json_string(f, firmware_version);
+    fprintf(f, ",\n    \"firmwarehash\": ");
+    json_string(f, firmware_hash);
+    fprintf(f, ",\n    \"hardwaretype\": \"\",\n    \"freemem\": 0,\n    \"skippedlines\": 0\n  },\n");
+
+    fprintf(f, "  \"params\": {");
+    for (uint16_t i=0; i<num_params; i++) {
+        fprintf(f, "%s\n    ", i==0?"":",");
+        json_string(f, params[i].name);
+        if (isnan(params[i].value) || isinf(params[i].value)) {
+            // not representable as a JSON number
+            fprintf(f, ": null");
+        } else {
+            format_repr(buf, sizeof(buf), params[i].value);
+            fprintf(f, ": %s", buf);
+        }
+    }
+    fprintf(f, "\n  },\n");
+
+    fprintf(f, "  \"results\": [");
+    for (uint8_t i=0; i<LOGCHECK_NUM_CHECKS; i++) {
+        const struct check_result &r = results[i];
+        fprintf(f, "%s\n    { \"name\": ", i==0?"":",");
+        json_string(f, r.name);
+        fprintf(f, ", \"status\": \"%s\"", status_names[r.status]);
+        if (r.status != CHECK_NA) {
+            fprintf(f, ", \"message\": ");
+            json_string(f, r.message);
+        }
+        fprintf(f, " }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+bool LogCheck::check_log(const char *logfile, const char *report_path, bool json)
+{
+    LogStream stream;
+    if (!stream.open(logfile)) {
+        return false;
+    }
+
+    uint8_t msg[256];
+    uint8_t length;
+    while (stream.next(msg, length)) {
+        if (msg[2] == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            memcpy(&f, msg, sizeof(f));
+            add_format(f);
+            continue;
+        }
+        if (formats[msg[2]].msg != CHECK_MSG_NONE && formats[msg[2]].length == length) {
+            process(msg, stream.num_messages);
+        }
+    }
+    stream.close();
+
+    // sections still waiting for a GPS time end at the last one
+    if (in_loiter) {
+        end_loiter_chunk(stream.num_messages);
+    }
+    for (uint8_t i=0; i<num_pending_chunks; i++) {
+        finish_loiter_chunk(pending_chunks[i], max_gps_ms);
+    }
+    num_pending_chunks = 0;
+
+    run_checks();
+
+    FILE *f = stdout;
+    if (!streq(report_path, "-")) {
+        f = fopen(report_path, "w");
+        if (f == NULL) {
+            perror(report_path);
+            return false;
+        }
+    }
+    if (json) {
+        write_json(f, logfile, stream.num_bytes, stream.num_messages);
+    } else {
+        write_xml(f, logfile, stream.num_bytes, stream.num_messages);
+    }
+    if (f != stdout && fclose(f) != 0) {
+        perror(report_path);
+        return false;
+    }
+
+    uint8_t num_fail = 0, num_warn = 0;
+    for (uint8_t i=0; i<LOGCHECK_NUM_CHECKS; i++) {
+        if (results[i].status == CHECK_FAIL) {
+            num_fail++;
+        } else if (results[i].status == CHECK_WARN) {
+            num_warn++;
+        }
+    }
+    if (f != stdout) {
+        ::printf("%s: %u FAIL, %u WARN, report in %s\n", logfile,
+                 (unsigned)num_fail, (unsigned)num_warn, report_path);
+    }
+    return true;
+}
+
+struct check_batch {
+    DataFlash_Class *dataflash;
+    const char *outdir;
+    bool json;
+};
+
+static bool check_one(void *obj, const char *logfile)
+{
+    const struct check_batch *batch = (const struct check_batch *)obj;
+    char *report_path = log_output_path(batch->outdir, logfile, batch->json ? ".json" : ".xml");
+    // too big for the stack of a worker thread
+    LogCheck *check = new LogCheck(*batch->dataflash);
+    bool ret = check->check_log(logfile, report_path, batch->json);
+    delete check;
+    free(report_path);
+    return ret;
+}
+
+bool LogCheck::check_logs(DataFlash_Class &dataflash,
+                          char * const *logfiles, uint16_t num_logs,
+                          const char *outdir, uint8_t num_threads, bool json)
+{
+    if (mkdir(outdir, 0755) != 0 && errno != EEXIST) {
+        perror(outdir);
+        return false;
+    }
+    struct check_batch batch = { &dataflash, outdir, json };
+    return log_batch(logfiles, num_logs, num_threads, check_one, &batch);
+}
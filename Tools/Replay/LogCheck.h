@@ -0,0 +1,214 @@
+#include <DataFlash.h>
+
+#include <stdio.h>
+
+/*
+  post-flight log checks
+
+  Runs the checks of Tools/LogAnalyzer over a DataFlash log in a single
+  pass, with each check keeping running totals as the messages stream
+  past instead of building lists of the whole log, and writes the same
+  XML report as LogAnalyzer.py -x (or the same content as JSON).
+
+  One LogCheck checks one log. check_logs() checks a list of logs on
+  several threads, with a LogCheck for each log.
+ */
+class LogCheck
+{
+public:
+    LogCheck(DataFlash_Class &_dataflash);
+    ~LogCheck();
+
+    // check a log and write the report to report_path, or stdout if
+    // it is "-". Returns false if the log or report could not be opened
+    bool check_log(const char *logfile, const char *report_path, bool json);
+
+    // check logs, writing a report per log into outdir named after the
+    // log, using up to num_threads threads
+    static bool check_logs(DataFlash_Class &dataflash,
+                           char * const *logfiles, uint16_t num_logs,
+                           const char *outdir, uint8_t num_threads, bool json);
+
+    // status of each check, as in LogAnalyzer
+    enum check_status {
+        CHECK_GOOD = 0,
+        CHECK_FAIL,
+        CHECK_WARN,
+        CHECK_UNKNOWN,
+        CHECK_NA
+    };
+
+private:
+    DataFlash_Class &dataflash;
+
+    // messages the checks use
+    enum check_msg {
+        CHECK_MSG_NONE = 0,
+        CHECK_MSG_PARM,
+        CHECK_MSG_MSG,
+        CHECK_MSG_MODE,
+        CHECK_MSG_GPS,
+        CHECK_MSG_IMU,
+        CHECK_MSG_MAG,
+        CHECK_MSG_ERR,
+        CHECK_MSG_EV,
+        CHECK_MSG_CTUN,
+        CHECK_MSG_CURR,
+        CHECK_MSG_PM,
+        CHECK_MSG_RCOU,
+        CHECK_MSG_ATT
+    };
+
+#define LOGCHECK_MAX_FIELDS 8
+    // where a field is in a message. An offset of zero means the field
+    // is not in the message
+    struct check_field {
+        uint8_t offset;
+        char type;
+    };
+    struct check_format {
+        enum check_msg msg;
+        uint8_t length;
+        struct check_field fields[LOGCHECK_MAX_FIELDS];
+    } formats[256];
+
+    void add_format(const struct log_Format &f);
+    void process(const uint8_t *msg, uint32_t line);
+
+    static double field_float(const uint8_t *msg, const struct check_field &field);
+    static int32_t field_int(const uint8_t *msg, const struct check_field &field);
+    bool field_present(enum check_msg msg, uint8_t i) const;
+
+    // header
+    bool have_vehicle;
+    char vehicle_type[32];
+    char firmware_version[32];
+    char firmware_hash[32];
+    char copter_type[16];
+    bool have_gps;
+    uint32_t first_gps_ms;
+    uint32_t last_gps_ms;
+    uint32_t max_gps_ms;
+
+    // parameters, in the order they are logged
+#define LOGCHECK_MAX_PARAMS 1500
+    struct param {
+        char name[17];
+        float value;
+    } params[LOGCHECK_MAX_PARAMS];
+    uint16_t num_params;
+    bool find_param(const char *name, float &value) const;
+    void set_param(const char *name, float value);
+
+    bool is_copter(void) const { return strcmp(vehicle_type, "ArduCopter") == 0; }
+
+    // Brownout and Empty
+    bool have_ctun;
+    bool armed;
+    float final_baro_alt;
+    int32_t max_throttle_out;
+
+    // Compass
+    bool have_mag;
+    float max_mag_offsets[3];
+    float max_mag_offsets_length;
+    bool have_mag_field;
+    float min_mag_field;
+    float max_mag_field;
+    bool mag_zeros;
+
+    // GPS
+    uint16_t gps_glitches;
+    uint8_t min_sats;
+    double max_hdop;
+
+    // Event/Failsafe
+    uint16_t errors;
+
+    // Motor Balance
+    bool have_rcou;
+    bool motor_params_missing;
+    char motor_missing_param[17];
+    float motor_min_throttle;
+    uint8_t motor_channels;
+    uint32_t motor_rows;
+    int64_t motor_sum[8];
+    int64_t motor_row_avg_sum;
+    void update_motors(const uint8_t *msg, const struct check_format &fmt);
+
+    // PM
+    bool have_pm;
+    uint16_t slow_loop_lines;
+    float max_percent_slow;
+    uint32_t max_percent_slow_line;
+
+    // VCC
+    bool have_curr;
+    int32_t vcc_min;
+    int32_t vcc_max;
+
+    // Vibration: accelerometer statistics over the longest LOITER
+    // section of the log that lasts more than 10 seconds
+    bool have_imu;
+    struct running_stats {
+        uint32_t n;
+        double mean;
+        double m2;
+        void reset(void) { n = 0; mean = 0; m2 = 0; }
+        void add(double x) {
+            n++;
+            double delta = x - mean;
+            mean += delta / n;
+            m2 += delta * (x - mean);
+        }
+        double std_dev(void) const { return n > 0 ? sqrt(m2 / n) : 0; }
+    };
+    struct loiter_chunk {
+        uint32_t start_line;
+        uint32_t end_line;
+        bool have_start_gps;
+        uint32_t start_gps_ms;
+        struct running_stats acc[3];
+    };
+    bool in_loiter;
+    struct loiter_chunk loiter;
+#define LOGCHECK_MAX_PENDING_CHUNKS 4
+    // chunks that have ended but are waiting for a GPS time for their end
+    struct loiter_chunk pending_chunks[LOGCHECK_MAX_PENDING_CHUNKS];
+    uint8_t num_pending_chunks;
+    bool have_best_chunk;
+    struct loiter_chunk best_chunk;
+    void end_loiter_chunk(uint32_t end_line);
+    void finish_loiter_chunk(const struct loiter_chunk &chunk, uint32_t end_gps_ms);
+
+    // Dupe Log Data needs sample points spread over the whole log, so
+    // it keeps the one column it checks
+    uint32_t num_pitch;
+    uint32_t pitch_space;
+    float *pitch;
+    uint32_t *pitch_line;
+
+    // results
+    struct check_result {
+        const char *name;
+        enum check_status status;
+        char message[512];
+    };
+#define LOGCHECK_NUM_CHECKS 11
+    struct check_result results[LOGCHECK_NUM_CHECKS];
+    void run_checks(void);
+    void check_brownout(struct check_result &r);
+    void check_compass(struct check_result &r);
+    void check_dupe(struct check_result &r);
+    void check_empty(struct check_result &r);
+    void check_events(struct check_result &r);
+    void check_gps(struct check_result &r);
+    void check_motor_balance(struct check_result &r);
+    void check_params(struct check_result &r);
+    void check_pm(struct check_result &r);
+    void check_vcc(struct check_result &r);
+    void check_vibration(struct check_result &r);
+
+    void write_xml(FILE *f, const char *logfile, uint64_t num_bytes, uint32_t num_lines);
+    void write_json(FILE *f, const char *logfile, uint64_t num_bytes, uint32_t num_lines);
+};
@@ -0,0 +1,121 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <DataFlash.h>
+
+#include "LogExport.h"
+#include "LogStream.h"
+#include "LogBatch.h"
+#include "MsgHandler_Export.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define LOGEXPORT_MAX_FORMATS 256
+
+bool LogExport::export_log(const char *logfile, const char *logdir)
+{
+    LogStream stream;
+    if (!stream.open(logfile)) {
+        return false;
+    }
+
+    if (mkdir(logdir, 0755) != 0 && errno != EEXIST) {
+        perror(logdir);
+        return false;
+    }
+
+    // a handler keeps the first definition of its message type, and a
+    // message is only exported if its length matches the handler's
+    MsgHandler_Export *handlers[LOGEXPORT_MAX_FORMATS];
+    memset(handlers, 0, sizeof(handlers));
+
+    uint64_t last_timestamp_usec = 0;
+    bool ok = true;
+    uint8_t msg[256];
+    uint8_t length;
+
+    while (stream.next(msg, length)) {
+        if (msg[2] == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            memcpy(&f, msg, sizeof(f));
+            if (handlers[f.type] == NULL && f.type != LOG_FORMAT_MSG && f.length > 3) {
+                handlers[f.type] = new MsgHandler_Export(f, dataflash, last_timestamp_usec, logdir);
+                uint16_t fields_length = 3;
+                for (uint8_t i=0; i<handlers[f.type]->num_fields(); i++) {
+                    fields_length += handlers[f.type]->field_length(i);
+                }
+                if (fields_length != f.length) {
+                    // a field type we don't know the size of
+                    ::printf("%s: skipping type %u as its fields (%s) do not match its length\n",
+                             logfile, (unsigned)f.type, f.format);
+                    delete handlers[f.type];
+                    handlers[f.type] = NULL;
+                }
+            }
+            continue;
+        }
+
+        MsgHandler_Export *p = handlers[msg[2]];
+        if (p != NULL && p->length() == length) {
+            p->process_message(msg);
+        }
+    }
+    stream.close();
+
+    // write out the columns, listing each one in the index
+    char *index_path;
+    if (asprintf(&index_path, "%s/columns.txt", logdir) == -1) {
+        fatal("asprintf failed");
+    }
+    FILE *index = fopen(index_path, "w");
+    if (index == NULL) {
+        perror(index_path);
+        ok = false;
+    } else {
+        fprintf(index, "# column type size count\n");
+    }
+    for (uint16_t i=0; i<LOGEXPORT_MAX_FORMATS; i++) {
+        if (handlers[i] != NULL) {
+            if (index != NULL && !handlers[i]->finish(index)) {
+                ok = false;
+            }
+            delete handlers[i];
+        }
+    }
+    if (index != NULL && fclose(index) != 0) {
+        perror(index_path);
+        ok = false;
+    }
+    free(index_path);
+
+    if (stream.corrupt) {
+        // the columns hold the messages before the corruption, but
+        // the rest of the log is missing
+        ok = false;
+    }
+    ::printf("%s: %u messages exported to %s%s\n", logfile, (unsigned)stream.num_messages, logdir,
+             ok ? "" : ", FAILED");
+    return ok;
+}
+
+bool LogExport::export_one(void *obj, const char *logfile)
+{
+    LogExport *e = (LogExport *)obj;
+    char *logdir = log_output_path(e->outdir, logfile, "");
+    bool ret = e->export_log(logfile, logdir);
+    free(logdir);
+    return ret;
+}
+
+bool LogExport::export_logs(char * const *logfiles, uint16_t num_logs,
+                            const char *_outdir, uint8_t num_threads)
+{
+    if (mkdir(_outdir, 0755) != 0 && errno != EEXIST) {
+        perror(_outdir);
+        return false;
+    }
+    outdir = _outdir;
+    return log_batch(logfiles, num_logs, num_threads, export_one, this);
+}
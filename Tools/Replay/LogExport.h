@@ -0,0 +1,32 @@
+#include <DataFlash.h>
+
+/*
+  convert DataFlash logs into columns: one file per message field
+  holding the values of that field as a contiguous array of its type,
+  plus one file per message type of timestamps in microseconds. The
+  columns can then be memory mapped for analysis instead of parsing
+  the log again.
+
+  Each log is converted in a single pass and several logs are
+  converted at once on separate threads.
+ */
+class LogExport
+{
+public:
+    LogExport(DataFlash_Class &_dataflash) : dataflash(_dataflash), outdir(NULL) {}
+
+    // convert a log into columns in logdir. Returns false on failure
+    bool export_log(const char *logfile, const char *logdir);
+
+    // convert logs into a directory per log under outdir, named
+    // after the log, using up to num_threads threads. Returns false
+    // if any log failed
+    bool export_logs(char * const *logfiles, uint16_t num_logs,
+                     const char *_outdir, uint8_t num_threads);
+
+private:
+    DataFlash_Class &dataflash;
+    const char *outdir;
+
+    static bool export_one(void *obj, const char *logfile);
+};
@@ -0,0 +1,69 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <DataFlash.h>
+
+#include "LogStream.h"
+
+#define LOGSTREAM_READ_BUFFER (1024*1024)
+
+bool LogStream::open(const char *_logfile)
+{
+    close();
+    logf = fopen(_logfile, "rb");
+    if (logf == NULL) {
+        perror(_logfile);
+        return false;
+    }
+    // most of the time is spent reading, so read in large blocks
+    setvbuf(logf, NULL, _IOFBF, LOGSTREAM_READ_BUFFER);
+    logfile = _logfile;
+    memset(lengths, 0, sizeof(lengths));
+    num_messages = 0;
+    num_bytes = 0;
+    corrupt = false;
+    return true;
+}
+
+void LogStream::close(void)
+{
+    if (logf != NULL) {
+        fclose(logf);
+        logf = NULL;
+    }
+}
+
+bool LogStream::next(uint8_t *msg, uint8_t &length)
+{
+    if (logf == NULL || fread(msg, 1, 3, logf) != 3) {
+        return false;
+    }
+    if (msg[0] != HEAD_BYTE1 || msg[1] != HEAD_BYTE2) {
+        ::printf("%s: bad log header after %u messages\n", logfile, (unsigned)num_messages);
+        corrupt = true;
+        return false;
+    }
+
+    if (msg[2] == LOG_FORMAT_MSG) {
+        length = sizeof(struct log_Format);
+    } else {
+        length = lengths[msg[2]];
+        if (length == 0) {
+            ::printf("%s: no format defined for type %u\n", logfile, (unsigned)msg[2]);
+            corrupt = true;
+            return false;
+        }
+    }
+    if (fread(&msg[3], 1, length-3, logf) != (size_t)(length-3)) {
+        return false;
+    }
+    if (msg[2] == LOG_FORMAT_MSG) {
+        const struct log_Format *f = (const struct log_Format *)msg;
+        if (f->length >= 3) {
+            lengths[f->type] = f->length;
+        }
+    }
+
+    num_messages++;
+    num_bytes += length;
+    return true;
+}
@@ -0,0 +1,35 @@
+#include <DataFlash.h>
+
+#include <stdio.h>
+
+/*
+  read the messages of a DataFlash log one at a time, in large blocks,
+  keeping track of the message lengths given by the FMT messages
+ */
+class LogStream
+{
+public:
+    LogStream() : num_messages(0), num_bytes(0), corrupt(false), logf(NULL), logfile(NULL) {}
+    ~LogStream() { close(); }
+
+    bool open(const char *_logfile);
+    void close(void);
+
+    // read the next message into msg, which must have room for 256
+    // bytes, setting length to its length. FMT messages are returned
+    // too, after their message length has been recorded. Returns false
+    // at the end of the log or at the first corrupt message
+    bool next(uint8_t *msg, uint8_t &length);
+
+    // messages and bytes read so far
+    uint32_t num_messages;
+    uint64_t num_bytes;
+
+    // set when next() stopped at a bad header or a message with no FMT
+    bool corrupt;
+
+private:
+    FILE *logf;
+    const char *logfile;
+    uint8_t lengths[256];
+};
@@ -83,9 +83,11 @@ void MsgHandler::parse_format_fields()
     char * arg = labels;
     uint8_t label_offset = 0;
     char *next_label;
+    char *saveptr;
     uint8_t msg_offset = 3; // 3 bytes for the header
 
-    while ((next_label = strtok(arg, ",")) != NULL) {
+    // strtok_r as log export creates handlers on several threads at once
+    while ((next_label = strtok_r(arg, ",", &saveptr)) != NULL) {
 	if (label_offset > strlen(f.format)) {
 	    free(labels);
 	    printf("too few field times for labels %s (format=%s) (labels=%s)\n",
@@ -186,10 +188,8 @@ void MsgHandler::string_for_labels(char *buffer, uint bufferlen)
 
 MsgHandler::~MsgHandler()
 {
-    for (uint8_t k=0; k<LOGREADER_MAX_FIELDS; k++) {
-        if (field_info[k].label != NULL) {
-            free(field_info[k].label);
-        }
+    for (uint8_t k=0; k<next_field; k++) {
+        free(field_info[k].label);
     }
 }
 
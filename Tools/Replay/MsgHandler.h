@@ -9,6 +9,8 @@
 
 #define streq(x, y) (!strcmp(x, y))
 
+void fatal(const char *msg);
+
 class MsgHandler {
 public:
     // constructor - create a parser for a MavLink message format
@@ -48,6 +50,13 @@ public:
 
     bool set_parameter(const char *name, float value);
 
+    // the fields of the format, in the order they appear in a message
+    uint8_t num_fields(void) const { return next_field; }
+    const char *field_label(uint8_t i) const { return field_info[i].label; }
+    char field_type(uint8_t i) const { return field_info[i].type; }
+    uint8_t field_offset(uint8_t i) const { return field_info[i].offset; }
+    uint8_t field_length(uint8_t i) const { return field_info[i].length; }
+
 private:
 
     void add_field(const char *_label, uint8_t _type, uint8_t _offset,
@@ -77,7 +86,7 @@ private:
 
 protected:
     struct log_Format f; // the format we are a parser for
-    ~MsgHandler();
+    virtual ~MsgHandler();
     void wait_timestamp(uint32_t timestamp);
 
     uint64_t &last_timestamp_usec;
@@ -0,0 +1,27 @@
+#include <MsgHandler.h>
+
+/*
+  handler used by the log checks to find where the fields they use
+  are in a message. The checks read the messages themselves
+ */
+class MsgHandler_Check : public MsgHandler
+{
+public:
+    MsgHandler_Check(log_Format &_f, DataFlash_Class &_dataflash,
+                     uint64_t &_last_timestamp_usec)
+        : MsgHandler(_f, _dataflash, _last_timestamp_usec) { };
+    ~MsgHandler_Check() {}
+
+    virtual void process_message(uint8_t *) {}
+
+    // offset of a field in the message, zero if there is no such field
+    uint8_t find_offset(const char *label, char &type) const {
+        for (uint8_t i=0; i<num_fields(); i++) {
+            if (streq(field_label(i), label)) {
+                type = field_type(i);
+                return field_offset(i);
+            }
+        }
+        return 0;
+    }
+};
@@ -0,0 +1,129 @@
+#include "MsgHandler_Export.h"
+
+MsgHandler_Export::MsgHandler_Export(log_Format &_f, DataFlash_Class &_dataflash,
+                                     uint64_t &_last_timestamp_usec, const char *_outdir) :
+    MsgHandler(_f, _dataflash, _last_timestamp_usec),
+    num_columns(0),
+    time_column(-1),
+    failed(false)
+{
+    // the first column is the timestamp, taken from the "T" field
+    // where there is one (GPS messages carry the GPS time in TimeMS),
+    // otherwise from TimeMS, otherwise from the last message that had
+    // a time
+    add_column(_outdir, "TimeUS", 'Q', sizeof(uint64_t), 0);
+    for (uint8_t i=0; i<num_fields(); i++) {
+        add_column(_outdir, field_label(i), field_type(i), field_length(i), field_offset(i));
+    }
+    for (uint8_t i=1; i<num_columns; i++) {
+        const char *label = field_label(i-1);
+        if (streq(label, "T")) {
+            time_column = i;
+            break;
+        }
+        if (streq(label, "TimeMS") && time_column == -1) {
+            time_column = i;
+        }
+    }
+    if (time_column != -1 && columns[time_column].type != 'I') {
+        time_column = -1;
+    }
+}
+
+MsgHandler_Export::~MsgHandler_Export()
+{
+    for (uint8_t i=0; i<num_columns; i++) {
+        free(columns[i].path);
+        free(columns[i].buf);
+    }
+}
+
+void MsgHandler_Export::add_column(const char *outdir, const char *label, char type, uint8_t size, uint8_t offset)
+{
+    struct column &c = columns[num_columns++];
+    char name[5];
+    memset(name, '\0', sizeof(name));
+    memcpy(name, f.name, 4);
+    if (asprintf(&c.path, "%s/%s.%s", outdir, name, label) == -1) {
+        fatal("asprintf failed");
+    }
+    c.type = type;
+    c.size = size;
+    c.offset = offset;
+    c.created = false;
+    c.used = 0;
+    c.count = 0;
+    // allocated by append(), as many message types are defined in a
+    // log but never logged
+    c.buf = NULL;
+}
+
+void MsgHandler_Export::process_message(uint8_t *msg)
+{
+    if (time_column != -1) {
+        uint32_t time_ms;
+        memcpy(&time_ms, &msg[columns[time_column].offset], sizeof(time_ms));
+        last_timestamp_usec = time_ms * 1000ULL;
+    }
+    append(columns[0], (const uint8_t *)&last_timestamp_usec);
+    for (uint8_t i=1; i<num_columns; i++) {
+        append(columns[i], &msg[columns[i].offset]);
+    }
+}
+
+void MsgHandler_Export::append(struct column &c, const uint8_t *value)
+{
+    if (c.buf == NULL) {
+        c.buf = (uint8_t *)malloc(EXPORT_COLUMN_BUFFER);
+        if (c.buf == NULL) {
+            fatal("out of memory");
+        }
+    }
+    if (c.used + c.size > EXPORT_COLUMN_BUFFER && !flush(c)) {
+        return;
+    }
+    memcpy(&c.buf[c.used], value, c.size);
+    c.used += c.size;
+    c.count++;
+}
+
+/*
+  append the buffered values to the column's file. The file is only
+  held open while writing so that a log with hundreds of columns does
+  not need hundreds of file descriptors
+ */
+bool MsgHandler_Export::flush(struct column &c)
+{
+    if (failed) {
+        c.used = 0;
+        return false;
+    }
+    FILE *fp = fopen(c.path, c.created ? "ab" : "wb");
+    if (fp == NULL) {
+        perror(c.path);
+        failed = true;
+        return false;
+    }
+    c.created = true;
+    if (fwrite(c.buf, 1, c.used, fp) != c.used) {
+        perror(c.path);
+        failed = true;
+    }
+    if (fclose(fp) != 0) {
+        failed = true;
+    }
+    c.used = 0;
+    return !failed;
+}
+
+bool MsgHandler_Export::finish(FILE *index)
+{
+    for (uint8_t i=0; i<num_columns; i++) {
+        struct column &c = columns[i];
+        flush(c);
+        const char *name = strrchr(c.path, '/');
+        fprintf(index, "%s %c %u %llu\n",
+                name?name+1:c.path, c.type, (unsigned)c.size, (unsigned long long)c.count);
+    }
+    return !failed;
+}
@@ -0,0 +1,47 @@
+#include <MsgHandler.h>
+
+/*
+  handler used by log export for every message type. Each field is
+  appended to its own column file as an array of the type given in the
+  format, along with a column of timestamps in microseconds
+ */
+class MsgHandler_Export : public MsgHandler
+{
+public:
+    MsgHandler_Export(log_Format &_f, DataFlash_Class &_dataflash,
+                      uint64_t &_last_timestamp_usec, const char *_outdir);
+    ~MsgHandler_Export();
+
+    virtual void process_message(uint8_t *msg);
+
+    // length of the messages this handler was created for
+    uint8_t length(void) const { return f.length; }
+
+    // write out any buffered values and add an index line for each
+    // column. Returns false if a column could not be written
+    bool finish(FILE *index);
+
+private:
+#define EXPORT_COLUMN_BUFFER 65536
+    struct column {
+        char *path;
+        char type;
+        uint8_t size;
+        uint8_t offset;
+        bool created;
+        uint32_t used;
+        uint64_t count;
+        uint8_t *buf;
+    };
+    struct column columns[LOGREADER_MAX_FIELDS+1];
+    uint8_t num_columns;
+
+    // field giving the message time in milliseconds, -1 if there is none
+    int8_t time_column;
+
+    bool failed;
+
+    void add_column(const char *outdir, const char *label, char type, uint8_t size, uint8_t offset);
+    void append(struct column &c, const uint8_t *value);
+    bool flush(struct column &c);
+};
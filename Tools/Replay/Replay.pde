@@ -51,10 +51,13 @@
 #include <AP_SerialManager.h>
 #include <RC_Channel.h>
 #include <AP_RangeFinder.h>
+#include <AP_SpdHgtControl.h>
+#include <AP_TECS.h>
 #include <stdio.h>
 #include <getopt.h>
 #include <errno.h>
 #include <fenv.h>
+#include <sys/stat.h>
 #include <VehicleType.h>
 
 #ifndef INT16_MIN
@@ -63,6 +66,10 @@
 #endif
 
 #include "LogReader.h"
+#include "LogExport.h"
+#include "LogCheck.h"
+#include "EKFSweep.h"
+#include "TECSTune.h"
 
 const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
 
@@ -87,12 +94,15 @@ static const NavEKF &NavEKF = ahrs.get_NavEKF();
 
 static LogReader LogReader(ahrs, ins, barometer, compass, gps, airspeed, dataflash);
 
+static EKFSweep ekf_sweep(&ahrs, barometer, rng, gps);
+
 static FILE *plotf;
 static FILE *plotf2;
 static FILE *ekf1f;
 static FILE *ekf2f;
 static FILE *ekf3f;
 static FILE *ekf4f;
+static FILE *ekfprecf;
 
 static bool done_parameters;
 static bool done_baro_init;
@@ -103,6 +113,29 @@ static bool ahrs_healthy;
 static bool have_imu2;
 static uint32_t last_imu_usec;
 
+// EKF checkpoints, see -K and -R
+#define CHECKPOINT_FILE "EKFcheckpoint.dat"
+#define CHECKPOINT_MAGIC 0x45434b50
+#define CHECKPOINT_LOG_MAGIC 0x45434b4c
+// start of the file, identifying the log the checkpoints were taken from
+struct checkpoint_log {
+    uint32_t magic;
+    char name[64];          // name of the log, without its directory
+    uint64_t size;          // bytes in the log
+};
+// start of each checkpoint
+struct checkpoint_header {
+    uint32_t magic;
+    uint32_t size;          // bytes of EKF state following the header
+    uint64_t time_usec;     // log time of the IMU sample the checkpoint was taken after
+};
+static FILE *checkpointf;
+static uint64_t checkpoint_interval_usec;
+static uint64_t next_checkpoint_usec;
+static uint64_t resume_usec;        // non-zero while skipping forward to a checkpoint
+static uint8_t *resume_state;
+static uint32_t resume_state_size;
+
 static uint8_t num_user_parameters;
 static struct {
     char name[17];
@@ -124,6 +157,17 @@ static void usage(void)
     ::printf(" -aMASK     set accel mask (1=accel1 only, 2=accel2 only, 3=both)\n");
     ::printf(" -gMASK     set gyro mask (1=gyro1 only, 2=gyro2 only, 3=both)\n");
     ::printf(" -A time    arm at time milliseconds)\n");
+    ::printf(" -E DIR     export the logs given into columns under DIR and exit\n");
+    ::printf(" -C DIR     check the logs given, write a report for each under DIR and exit\n");
+    ::printf(" -J         write the check reports as JSON instead of XML\n");
+    ::printf(" -j N       number of logs to export or check at once, or threads for -S and -T\n");
+    ::printf(" -K SECS    write an EKF checkpoint to %s every SECS seconds of log time\n", CHECKPOINT_FILE);
+    ::printf(" -R SECS    resume from the last checkpoint in %s at or before SECS seconds\n", CHECKPOINT_FILE);
+    ::printf(" -S FILE    also run an EKF for each line of NAME=VALUE parameters in FILE and\n");
+    ::printf("            write their innovation and position error statistics to EKFsweep.dat\n");
+    ::printf(" -T FILE    fly every combination of the NAME=V1,V2,... TECS parameter values in FILE\n");
+    ::printf("            against a model fitted to the logs given, write their height and speed\n");
+    ::printf("            errors to TECStune.dat and exit\n");
 }
 
 void setup()
@@ -134,10 +178,17 @@ void setup()
     uint8_t argc;
     char * const *argv;
     int opt;
+    const char *export_dir = NULL;
+    const char *check_dir = NULL;
+    bool check_json = false;
+    uint8_t export_threads = 1;
+    float resume_time = -1;
+    const char *sweep_file = NULL;
+    const char *tecs_file = NULL;
 
     hal.util->commandline_arguments(argc, argv);
 
-	while ((opt = getopt(argc, argv, "r:p:ha:g:A:")) != -1) {
+	while ((opt = getopt(argc, argv, "r:p:ha:g:A:E:C:Jj:K:R:S:T:")) != -1) {
 		switch (opt) {
         case 'h':
             usage();
@@ -159,6 +210,38 @@ void setup()
             arm_time_ms = strtoul(optarg, NULL, 0);
             break;
 
+        case 'E':
+            export_dir = optarg;
+            break;
+
+        case 'C':
+            check_dir = optarg;
+            break;
+
+        case 'J':
+            check_json = true;
+            break;
+
+        case 'j':
+            export_threads = strtol(optarg, NULL, 0);
+            break;
+
+        case 'K':
+            checkpoint_interval_usec = atof(optarg) * 1.0e6f;
+            break;
+
+        case 'R':
+            resume_time = atof(optarg);
+            break;
+
+        case 'S':
+            sweep_file = optarg;
+            break;
+
+        case 'T':
+            tecs_file = optarg;
+            break;
+
         case 'p':
             char *eq = strchr(optarg, '=');
             if (eq == NULL) {
@@ -180,6 +263,35 @@ void setup()
 	argv += optind;
 	argc -= optind;
 
+    if (export_dir != NULL) {
+        if (argc == 0) {
+            ::printf("No logs to export\n");
+            exit(1);
+        }
+        LogExport exporter(dataflash);
+        exit(exporter.export_logs(argv, argc, export_dir, export_threads) ? 0 : 1);
+    }
+
+    if (check_dir != NULL) {
+        if (argc == 0) {
+            ::printf("No logs to check\n");
+            exit(1);
+        }
+        exit(LogCheck::check_logs(dataflash, argv, argc, check_dir, export_threads, check_json) ? 0 : 1);
+    }
+
+    if (tecs_file != NULL) {
+        if (argc == 0) {
+            ::printf("No logs to tune TECS from\n");
+            exit(1);
+        }
+        TECSTune tune(dataflash, barometer, gps);
+        if (!tune.load_search(tecs_file)) {
+            exit(1);
+        }
+        exit(tune.run(argv, argc, export_threads, "TECStune.dat") ? 0 : 1);
+    }
+
     if (argc > 0) {
         filename = argv[0];
     }
@@ -189,6 +301,26 @@ void setup()
         hal.console->printf("Using an update rate of %u Hz\n", update_rate);
     }
 
+    if (resume_time >= 0) {
+        if (checkpoint_interval_usec != 0) {
+            ::printf("Can't write checkpoints while resuming from one\n");
+            exit(1);
+        }
+        if (!load_checkpoint(filename, resume_time)) {
+            exit(1);
+        }
+    }
+
+    if (sweep_file != NULL) {
+        if (resume_time >= 0) {
+            ::printf("Can't run an EKF sweep while resuming from a checkpoint\n");
+            exit(1);
+        }
+        if (!ekf_sweep.load_sets(sweep_file)) {
+            exit(1);
+        }
+    }
+
     load_parameters();
 
     if (!LogReader.open_log(filename)) {
@@ -245,6 +377,7 @@ void setup()
     ekf2f = fopen("EKF2.dat", "w");
     ekf3f = fopen("EKF3.dat", "w");
     ekf4f = fopen("EKF4.dat", "w");
+    ekfprecf = fopen("EKFprec.dat", "w");
 
     fprintf(plotf, "time SIM.Roll SIM.Pitch SIM.Yaw BAR.Alt FLIGHT.Roll FLIGHT.Pitch FLIGHT.Yaw FLIGHT.dN FLIGHT.dE FLIGHT.Alt AHR2.Roll AHR2.Pitch AHR2.Yaw DCM.Roll DCM.Pitch DCM.Yaw EKF.Roll EKF.Pitch EKF.Yaw INAV.dN INAV.dE INAV.Alt EKF.dN EKF.dE EKF.Alt\n");
     fprintf(plotf2, "time E1 E2 E3 VN VE VD PN PE PD GX GY GZ WN WE MN ME MD MX MY MZ E1ref E2ref E3ref\n");
@@ -252,6 +385,9 @@ void setup()
     fprintf(ekf2f, "timestamp TimeMS AX AY AZ VWN VWE MN ME MD MX MY MZ\n");
     fprintf(ekf3f, "timestamp TimeMS IVN IVE IVD IPN IPE IPD IMX IMY IMZ IVT\n");
     fprintf(ekf4f, "timestamp TimeMS SV SP SH SMX SMY SMZ SVT OFN EFE FS DS\n");
+    fprintf(ekfprecf, "time Roll Pitch Yaw VN VE VD PN PE PD GX GY GZ WN WE MN ME MD MX MY MZ SV SP SH\n");
+
+    ::printf("NavEKF using %s precision\n", NAVEKF_DOUBLE_PRECISION ? "double" : "single");
 
     ahrs.set_ekf_use(true);
 
@@ -281,6 +417,144 @@ void setup()
         ::printf("Failed to start NavEKF\n");
         exit(1);
     }
+
+    if (resume_usec != 0 && resume_usec <= last_imu_usec) {
+        ::printf("Checkpoint is from before NavEKF started, replaying from the start\n");
+        resume_usec = 0;
+    }
+
+    if (checkpoint_interval_usec != 0) {
+        checkpointf = fopen(CHECKPOINT_FILE, "wb");
+        struct checkpoint_log log_id;
+        if (checkpointf == NULL ||
+            !checkpoint_log_id(filename, log_id) ||
+            fwrite(&log_id, sizeof(log_id), 1, checkpointf) != 1) {
+            perror(CHECKPOINT_FILE);
+            exit(1);
+        }
+        next_checkpoint_usec = last_imu_usec + checkpoint_interval_usec;
+    }
+
+    // the sweep filters start with the parameters the replayed filter
+    // has now, with their own overrides on top
+    if (ekf_sweep.num_sets() != 0 && !ekf_sweep.start(NavEKF, export_threads)) {
+        exit(1);
+    }
+}
+
+/*
+  identify a log by its name and size, so checkpoints are only resumed
+  on the log they were taken from
+ */
+static bool checkpoint_log_id(const char *logfile, struct checkpoint_log &id)
+{
+    struct stat st;
+    if (stat(logfile, &st) != 0) {
+        return false;
+    }
+    memset(&id, 0, sizeof(id));
+    id.magic = CHECKPOINT_LOG_MAGIC;
+    const char *name = strrchr(logfile, '/');
+    strncpy(id.name, name?name+1:logfile, sizeof(id.name)-1);
+    id.size = st.st_size;
+    return true;
+}
+
+/*
+  find the last checkpoint at or before time seconds, to resume from
+  when the replay reaches its IMU sample
+ */
+static bool load_checkpoint(const char *logfile, float time)
+{
+    FILE *f = fopen(CHECKPOINT_FILE, "rb");
+    if (f == NULL) {
+        perror(CHECKPOINT_FILE);
+        return false;
+    }
+
+    struct checkpoint_log log_id, file_log_id;
+    if (!checkpoint_log_id(logfile, log_id)) {
+        perror(logfile);
+        fclose(f);
+        return false;
+    }
+    if (fread(&file_log_id, sizeof(file_log_id), 1, f) != 1 ||
+        file_log_id.magic != CHECKPOINT_LOG_MAGIC) {
+        ::printf("Corrupt checkpoint file %s\n", CHECKPOINT_FILE);
+        fclose(f);
+        return false;
+    }
+    file_log_id.name[sizeof(file_log_id.name)-1] = 0;
+    if (strcmp(file_log_id.name, log_id.name) != 0 || file_log_id.size != log_id.size) {
+        ::printf("Checkpoints in %s are from %s (%llu bytes), not this log\n",
+                 CHECKPOINT_FILE, file_log_id.name, (unsigned long long)file_log_id.size);
+        fclose(f);
+        return false;
+    }
+
+    // each checkpoint is read into a buffer of its own and only
+    // replaces the last one found once it has been read completely
+    uint64_t time_usec = time * 1.0e6;
+    struct checkpoint_header hdr;
+    while (fread(&hdr, sizeof(hdr), 1, f) == 1) {
+        if (hdr.magic != CHECKPOINT_MAGIC) {
+            ::printf("Corrupt checkpoint file %s\n", CHECKPOINT_FILE);
+            break;
+        }
+        if (hdr.time_usec > time_usec) {
+            break;
+        }
+        uint8_t *state = (uint8_t *)malloc(hdr.size);
+        if (state == NULL || fread(state, hdr.size, 1, f) != 1) {
+            ::printf("Failed to read checkpoint at %.1f seconds\n", hdr.time_usec*1.0e-6f);
+            free(state);
+            break;
+        }
+        free(resume_state);
+        resume_state = state;
+        resume_usec = hdr.time_usec;
+        resume_state_size = hdr.size;
+    }
+    fclose(f);
+    if (resume_usec == 0) {
+        ::printf("No checkpoint at or before %.1f seconds in %s\n", time, CHECKPOINT_FILE);
+        return false;
+    }
+    ::printf("Skipping to checkpoint at %.1f seconds\n", resume_usec*1.0e-6f);
+    return true;
+}
+
+static void write_checkpoint(void)
+{
+    struct checkpoint_header hdr;
+    hdr.magic = CHECKPOINT_MAGIC;
+    hdr.size = ahrs.get_ekf_checkpoint_size();
+    hdr.time_usec = last_imu_usec;
+    uint8_t *state = (uint8_t *)malloc(hdr.size);
+    if (state == NULL) {
+        ::printf("Out of memory for checkpoint\n");
+        exit(1);
+    }
+    ahrs.save_ekf_checkpoint(state);
+    if (fwrite(&hdr, sizeof(hdr), 1, checkpointf) != 1 ||
+        fwrite(state, hdr.size, 1, checkpointf) != 1 ||
+        fflush(checkpointf) != 0) {
+        perror(CHECKPOINT_FILE);
+        exit(1);
+    }
+    free(state);
+}
+
+static void resume_from_checkpoint(void)
+{
+    if (!ahrs.restore_ekf_checkpoint(resume_state, resume_state_size)) {
+        ::printf("Checkpoint does not match this NavEKF build or lane setup\n");
+        exit(1);
+    }
+    ::printf("Resumed from checkpoint at %.1f seconds\n", resume_usec*1.0e-6f);
+    free(resume_state);
+    resume_state = NULL;
+    resume_usec = 0;
 }
 
 
@@ -343,8 +617,17 @@ static void read_sensors(uint8_t type)
             update_count = 1;
         }
         last_imu_usec = LogReader.last_timestamp_us();
+        if (resume_usec != 0 && ahrs.have_inertial_nav()) {
+            // skipping forward to the checkpoint, which was taken after
+            // the update for this IMU sample
+            if (last_imu_usec >= resume_usec) {
+                resume_from_checkpoint();
+            }
+            return;
+        }
         for (uint8_t i=0; i<update_count; i++) {
             ahrs.update();
+            ekf_sweep.update();
             if (ahrs.get_home().lat != 0) {
                 inertial_nav.update(ins.get_delta_time());
             }
@@ -358,6 +641,10 @@ static void read_sensors(uint8_t type)
                 printf("AHRS health: %u\n", (unsigned)ahrs_healthy);
             }
         }
+        if (checkpointf != NULL && last_imu_usec >= next_checkpoint_usec) {
+            write_checkpoint();
+            next_checkpoint_usec += checkpoint_interval_usec;
+        }
     }
 }
 
@@ -376,9 +663,24 @@ void loop()
         if (!LogReader.update(type)) {
             ::printf("End of log at %.1f seconds\n", hal.scheduler->millis()*0.001f);
             fclose(plotf);
+            fclose(ekfprecf);
+            if (checkpointf != NULL) {
+                fclose(checkpointf);
+            }
+            if (ekf_sweep.running()) {
+                ekf_sweep.write_report("EKFsweep.dat");
+            }
+            if (resume_usec != 0) {
+                ::printf("Log ended before the checkpoint was reached\n");
+                exit(1);
+            }
             exit(0);
         }
         read_sensors(type);
+        if (resume_usec != 0) {
+            // no output until the checkpoint has been restored
+            continue;
+        }
 
         if ((type == LOG_ATTITUDE_MSG) ||
             (type == LOG_PLANE_ATTITUDE_MSG && LogReader.vehicle == VehicleType::VEHICLE_PLANE) ||
@@ -481,6 +783,33 @@ void loop()
                     LogReader.get_attitude().y,
                     LogReader.get_attitude().z);
 
+            // full precision states for comparing single and double precision builds
+            fprintf(ekfprecf, "%.3f %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g %.8g\n",
+                    hal.scheduler->millis() * 0.001f,
+                    ekf_euler.x,
+                    ekf_euler.y,
+                    ekf_euler.z,
+                    velNED.x,
+                    velNED.y,
+                    velNED.z,
+                    posNED.x,
+                    posNED.y,
+                    posNED.z,
+                    gyroBias.x,
+                    gyroBias.y,
+                    gyroBias.z,
+                    windVel.x,
+                    windVel.y,
+                    magNED.x,
+                    magNED.y,
+                    magNED.z,
+                    magXYZ.x,
+                    magXYZ.y,
+                    magXYZ.z,
+                    velVar,
+                    posVar,
+                    hgtVar);
+
             // define messages for EKF1 data packet
             int16_t     roll  = (int16_t)(100*degrees(ekf_euler.x)); // roll angle (centi-deg)
             int16_t     pitch = (int16_t)(100*degrees(ekf_euler.y)); // pitch angle (centi-deg)
@@ -0,0 +1,816 @@
+#include <AP_HAL.h>
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+
+#include "TECSTune.h"
+#include "LogStream.h"
+#include "MsgHandler_Check.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+extern const AP_HAL::HAL& hal;
+
+// TECS runs at 50Hz between the 10Hz pitch and throttle updates
+#define TECSTUNE_STEP_USEC 20000
+
+// a gap in the TECS messages longer than this starts a new segment,
+// which AP_TECS sees as a restart
+#define TECSTUNE_SEGMENT_GAP_USEC 1000000
+
+void TECSTuneAHRS::set_state(float _roll, float _pitch, float hgt, float climb_rate,
+                             float hgt_accel, float airspeed, float airspeed_rate)
+{
+    roll = _roll;
+    pitch = _pitch;
+    _dcm.from_euler(roll, pitch, 0);
+    _position.z = -hgt;
+    _velocity.z = -climb_rate;
+    _accel_ef.z = -(hgt_accel + GRAVITY_MSS);
+    _airspeed_est = airspeed;
+
+    // AP_TECS takes the rate of change of airspeed from the
+    // accelerometers less the part due to gravity
+    _ins.set_accel(_ins.get_primary_accel(),
+                   Vector3f(airspeed_rate - _dcm.c.x * GRAVITY_MSS, 0, 0));
+}
+
+TECSTune::TECSTune(DataFlash_Class &_dataflash, AP_Baro &_baro, AP_GPS &_gps) :
+    dataflash(_dataflash),
+    baro(_baro),
+    gps(_gps),
+    rows(NULL),
+    num_rows(0),
+    rows_space(0),
+    num_log_params(0),
+    num_search(0),
+    airspeed(aparm),
+    use_airspeed(false),
+    candidates(NULL),
+    num_candidates(0),
+    cur_row(NULL),
+    cur_step(0),
+    step_dt(TECSTUNE_STEP_USEC * 1.0e-6f),
+    pool(&TECSTune::update_candidate_job, this)
+{
+    memset(&model, 0, sizeof(model));
+}
+
+/*
+  parse NAME=V1,V2,... lines. Names may be given with or without the
+  TECS_ prefix
+ */
+bool TECSTune::load_search(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        ::printf("Failed to open %s - %s\n", filename, strerror(errno));
+        return false;
+    }
+    char line[512];
+    uint16_t line_num = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        line_num++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) {
+            continue;
+        }
+        char *eq = strchr(p, '=');
+        if (eq == NULL) {
+            ::printf("Line %u: expected NAME=V1,V2,...\n", (unsigned)line_num);
+            ok = false;
+            break;
+        }
+        *eq++ = 0;
+        char *end = eq - 2;
+        while (end > p && (*end == ' ' || *end == '\t')) {
+            *end-- = 0;
+        }
+        const char *name = p;
+        if (strncmp(name, "TECS_", 5) == 0) {
+            name += 5;
+        }
+        bool found = false;
+        uint8_t type;
+        for (uint8_t i=0;
+             (type=pgm_read_byte(&AP_TECS::var_info[i].type)) != AP_PARAM_NONE;
+             i++) {
+            if (type <= AP_PARAM_FLOAT && strcmp(name, AP_TECS::var_info[i].name) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            ::printf("Line %u: unknown TECS parameter %s\n", (unsigned)line_num, p);
+            ok = false;
+            break;
+        }
+        if (num_search >= TECSTUNE_MAX_PARAMS) {
+            ::printf("Line %u: more than %u parameters\n", (unsigned)line_num, TECSTUNE_MAX_PARAMS);
+            ok = false;
+            break;
+        }
+        struct search_param &sp = search[num_search];
+        strncpy(sp.name, name, AP_MAX_NAME_SIZE);
+        sp.name[AP_MAX_NAME_SIZE] = 0;
+        sp.num_values = 0;
+        char *saveptr = NULL;
+        for (char *tok = strtok_r(eq, ", \t\r\n", &saveptr);
+             tok != NULL;
+             tok = strtok_r(NULL, ", \t\r\n", &saveptr)) {
+            if (sp.num_values >= TECSTUNE_MAX_VALUES) {
+                ::printf("Line %u: more than %u values\n", (unsigned)line_num, TECSTUNE_MAX_VALUES);
+                ok = false;
+                break;
+            }
+            sp.values[sp.num_values++] = atof(tok);
+        }
+        if (ok && sp.num_values == 0) {
+            ::printf("Line %u: no values for %s\n", (unsigned)line_num, p);
+            ok = false;
+        }
+        num_search++;
+    }
+    fclose(f);
+    if (ok && num_search == 0) {
+        ::printf("%s: nothing to search\n", filename);
+        ok = false;
+    }
+    return ok;
+}
+
+bool TECSTune::add_row(const struct row &r)
+{
+    if (num_rows >= rows_space) {
+        uint32_t new_space = rows_space ? rows_space * 2 : 4096;
+        struct row *new_rows = (struct row *)realloc(rows, new_space * sizeof(rows[0]));
+        if (new_rows == NULL) {
+            ::printf("Out of memory for TECS messages\n");
+            return false;
+        }
+        rows = new_rows;
+        rows_space = new_space;
+    }
+    rows[num_rows++] = r;
+    return true;
+}
+
+void TECSTune::set_log_param(const char *name, float value)
+{
+    for (uint8_t i=0; i<num_log_params; i++) {
+        if (streq(log_params[i].name, name)) {
+            log_params[i].value = value;
+            return;
+        }
+    }
+    if (num_log_params < TECSTUNE_MAX_LOG_PARAMS) {
+        strncpy(log_params[num_log_params].name, name, sizeof(log_params[0].name)-1);
+        log_params[num_log_params].name[sizeof(log_params[0].name)-1] = 0;
+        log_params[num_log_params].value = value;
+        num_log_params++;
+    }
+}
+
+float TECSTune::get_log_param(const char *name, float default_value) const
+{
+    for (uint8_t i=0; i<num_log_params; i++) {
+        if (streq(log_params[i].name, name)) {
+            return log_params[i].value;
+        }
+    }
+    return default_value;
+}
+
+// value of a numeric log field
+static float field_value(const uint8_t *msg, uint8_t offset, char type)
+{
+    const uint8_t *p = &msg[offset];
+    switch (type) {
+    case 'h':
+    case 'c': {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        return type == 'c' ? v*0.01f : v;
+    }
+    case 'H':
+    case 'C': {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return type == 'C' ? v*0.01f : v;
+    }
+    case 'i':
+    case 'e': {
+        int32_t v;
+        memcpy(&v, p, sizeof(v));
+        return type == 'e' ? v*0.01f : v;
+    }
+    case 'I':
+    case 'E': {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return type == 'E' ? v*0.01f : v;
+    }
+    case 'f': {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    }
+    return 0;
+}
+
+/*
+  read the TECS messages of a log into rows, with the attitude from the
+  CTUN messages, and the parameters the model and AP_TECS need
+ */
+bool TECSTune::read_log(const char *logfile, uint64_t time_offset_us)
+{
+    LogStream stream;
+    if (!stream.open(logfile)) {
+        return false;
+    }
+
+    enum tune_msg { MSG_NONE=0, MSG_PARM, MSG_CTUN, MSG_TECS };
+    static const struct {
+        const char *name;
+        const char *labels[10];
+    } tune_messages[] = {
+        { "",     { NULL } },
+        { "PARM", { "Name", "Value", NULL } },
+        { "CTUN", { "Roll", "Pitch", NULL } },
+        { "TECS", { "TimeMS", "h", "dh", "h_dem", "sp_dem", "sp", "dsp", "th", "ph", NULL } },
+    };
+    struct {
+        enum tune_msg msg;
+        uint8_t length;
+        uint8_t offsets[10];
+        char types[10];
+    } formats[256];
+    memset(formats, 0, sizeof(formats));
+
+    bool have_attitude = false;
+    float roll = 0, pitch = 0;
+    uint64_t last_time_us = 0;
+    uint32_t first_row = num_rows;
+
+    uint8_t msg[256];
+    uint8_t length;
+    while (stream.next(msg, length)) {
+        if (msg[2] == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            memcpy(&f, msg, sizeof(f));
+            char name[5];
+            memset(name, 0, sizeof(name));
+            strncpy(name, f.name, 4);
+            for (uint8_t m=1; m<sizeof(tune_messages)/sizeof(tune_messages[0]); m++) {
+                if (!streq(name, tune_messages[m].name)) {
+                    continue;
+                }
+                uint64_t last_timestamp_usec = 0;
+                MsgHandler_Check handler(f, dataflash, last_timestamp_usec);
+                bool complete = true;
+                for (uint8_t i=0; tune_messages[m].labels[i] != NULL; i++) {
+                    formats[f.type].offsets[i] = handler.find_offset(tune_messages[m].labels[i],
+                                                                     formats[f.type].types[i]);
+                    if (formats[f.type].offsets[i] == 0) {
+                        complete = false;
+                    }
+                }
+                if (complete) {
+                    formats[f.type].msg = (enum tune_msg)m;
+                    formats[f.type].length = f.length;
+                }
+            }
+            continue;
+        }
+        if (formats[msg[2]].msg == MSG_NONE || formats[msg[2]].length != length) {
+            continue;
+        }
+        const uint8_t *ofs = formats[msg[2]].offsets;
+        const char *types = formats[msg[2]].types;
+        switch (formats[msg[2]].msg) {
+        case MSG_NONE:
+            break;
+
+        case MSG_PARM: {
+            char name[17];
+            memset(name, 0, sizeof(name));
+            memcpy(name, &msg[ofs[0]], 16);
+            set_log_param(name, field_value(msg, ofs[1], types[1]));
+            break;
+        }
+
+        case MSG_CTUN:
+            roll = radians(field_value(msg, ofs[0], types[0]));
+            pitch = radians(field_value(msg, ofs[1], types[1]));
+            have_attitude = true;
+            break;
+
+        case MSG_TECS: {
+            struct row r;
+            r.time_us = time_offset_us + (uint64_t)field_value(msg, ofs[0], types[0]) * 1000ULL;
+            r.new_segment = (num_rows == first_row ||
+                             r.time_us < last_time_us ||
+                             r.time_us - last_time_us > TECSTUNE_SEGMENT_GAP_USEC);
+            r.hgt        = field_value(msg, ofs[1], types[1]);
+            r.climb_rate = field_value(msg, ofs[2], types[2]);
+            r.hgt_dem    = field_value(msg, ofs[3], types[3]);
+            r.spd_dem    = field_value(msg, ofs[4], types[4]);
+            r.spd        = field_value(msg, ofs[5], types[5]);
+            r.spd_rate   = field_value(msg, ofs[6], types[6]);
+            r.thr_dem    = field_value(msg, ofs[7], types[7]);
+            r.pitch_dem  = field_value(msg, ofs[8], types[8]);
+            r.have_attitude = have_attitude;
+            r.pitch      = have_attitude ? pitch : r.pitch_dem;
+            r.roll       = have_attitude ? roll : 0;
+            last_time_us = r.time_us;
+            if (!add_row(r)) {
+                return false;
+            }
+            break;
+        }
+        }
+    }
+    stream.close();
+
+    ::printf("%s: %u TECS updates\n", logfile, (unsigned)(num_rows - first_row));
+    return true;
+}
+
+void TECSTune::setup_aparm(void)
+{
+    // Plane parameters AP_TECS uses, with the Plane defaults for any
+    // not in the logs
+    aparm.throttle_min.set(get_log_param("THR_MIN", 0));
+    aparm.throttle_max.set(get_log_param("THR_MAX", 75));
+    aparm.throttle_slewrate.set(get_log_param("THR_SLEWRATE", 100));
+    aparm.throttle_cruise.set(get_log_param("TRIM_THROTTLE", 45));
+    aparm.takeoff_throttle_max.set(get_log_param("TKOFF_THR_MAX", 0));
+    aparm.airspeed_min.set(get_log_param("ARSPD_FBW_MIN", 9));
+    aparm.airspeed_max.set(get_log_param("ARSPD_FBW_MAX", 22));
+    aparm.pitch_limit_max_cd.set(get_log_param("LIM_PITCH_MAX", 2000));
+    aparm.pitch_limit_min_cd.set(get_log_param("LIM_PITCH_MIN", -2500));
+    aparm.land_pitch_cd.set(get_log_param("LAND_PITCH_CD", 0));
+    aparm.land_flare_sec.set(get_log_param("LAND_FLARE_SEC", 2));
+    aparm.stall_prevention.set(get_log_param("STALL_PREVENTION", 1));
+
+    // the candidates see a healthy airspeed sensor if the aircraft used
+    // one. Their airspeed comes from the model either way
+    use_airspeed = get_log_param("ARSPD_USE", 0) != 0 && get_log_param("ARSPD_ENABLE", 1) != 0;
+    if (use_airspeed) {
+        AP_Param::set_object_value(&airspeed, AP_Airspeed::var_info, "ENABLE", 1);
+        AP_Param::set_object_value(&airspeed, AP_Airspeed::var_info, "USE", 1);
+        AP_Param::set_object_value(&airspeed, AP_Airspeed::var_info, "OFFSET", 1);
+        airspeed.setHIL(0);
+    }
+}
+
+/*
+  solve the n by n normal equations ata.x = atb by Gaussian
+  elimination. Returns false if they are singular
+ */
+static bool solve_normal(double ata[4][4], double atb[4], uint8_t n, double x[4])
+{
+    for (uint8_t c=0; c<n; c++) {
+        uint8_t pivot = c;
+        for (uint8_t r=c+1; r<n; r++) {
+            if (fabs(ata[r][c]) > fabs(ata[pivot][c])) {
+                pivot = r;
+            }
+        }
+        if (fabs(ata[pivot][c]) < 1.0e-12) {
+            return false;
+        }
+        if (pivot != c) {
+            for (uint8_t k=0; k<n; k++) {
+                double tmp = ata[c][k];
+                ata[c][k] = ata[pivot][k];
+                ata[pivot][k] = tmp;
+            }
+            double tmp = atb[c];
+            atb[c] = atb[pivot];
+            atb[pivot] = tmp;
+        }
+        for (uint8_t r=c+1; r<n; r++) {
+            double f = ata[r][c] / ata[c][c];
+            for (uint8_t k=c; k<n; k++) {
+                ata[r][k] -= f * ata[c][k];
+            }
+            atb[r] -= f * atb[c];
+        }
+    }
+    for (int8_t r=n-1; r>=0; r--) {
+        double sum = atb[r];
+        for (uint8_t k=r+1; k<n; k++) {
+            sum -= ata[r][k] * x[k];
+        }
+        x[r] = sum / ata[r][r];
+    }
+    return true;
+}
+
+// flight path angle from the climb rate and airspeed
+static float flight_path_angle(float climb_rate, float spd)
+{
+    return asinf(constrain_float(climb_rate / spd, -1, 1));
+}
+
+/*
+  fit the longitudinal model to the logged updates
+ */
+bool TECSTune::fit_model(void)
+{
+    // the pitch lag, by trying time constants from 0.05 to 2 seconds
+    uint32_t num_attitude = 0;
+    for (uint32_t i=0; i<num_rows; i++) {
+        if (rows[i].have_attitude) {
+            num_attitude++;
+        }
+    }
+    model.pitch_tau = 0.3f;
+    if (num_attitude > 0) {
+        double best_sum = -1;
+        for (uint8_t t=1; t<=40; t++) {
+            float tau = t * 0.05f;
+            double sum = 0;
+            float pitch = 0;
+            for (uint32_t i=0; i<num_rows; i++) {
+                const struct row &r = rows[i];
+                if (r.new_segment) {
+                    pitch = r.pitch;
+                } else {
+                    const struct row &prev = rows[i-1];
+                    float dt = (r.time_us - prev.time_us) * 1.0e-6f;
+                    pitch += (prev.pitch_dem - pitch) * (1 - expf(-dt / tau));
+                }
+                if (r.have_attitude) {
+                    sum += sq(pitch - r.pitch);
+                }
+            }
+            if (best_sum < 0 || sum < best_sum) {
+                best_sum = sum;
+                model.pitch_tau = tau;
+            }
+        }
+        model.pitch_rms = sqrt(best_sum / num_attitude);
+    }
+
+    // angle of attack = pitch - gamma = alpha0 + alpha1/V^2
+    double ata[4][4], atb[4], x[4];
+    memset(ata, 0, sizeof(ata));
+    memset(atb, 0, sizeof(atb));
+    uint32_t n = 0;
+    for (uint32_t i=0; i<num_rows; i++) {
+        const struct row &r = rows[i];
+        if (!r.have_attitude || r.spd < 3) {
+            continue;
+        }
+        double a[2] = { 1, 1.0 / sq(r.spd) };
+        double y = r.pitch - flight_path_angle(r.climb_rate, r.spd);
+        for (uint8_t j=0; j<2; j++) {
+            for (uint8_t k=0; k<2; k++) {
+                ata[j][k] += a[j] * a[k];
+            }
+            atb[j] += a[j] * y;
+        }
+        n++;
+    }
+    if (n < 50 || !solve_normal(ata, atb, 2, x)) {
+        // no attitude to fit to, assume the aircraft flies along its
+        // pitch
+        model.alpha0 = 0;
+        model.alpha1 = 0;
+    } else {
+        model.alpha0 = x[0];
+        model.alpha1 = x[1];
+        double sum = 0;
+        for (uint32_t i=0; i<num_rows; i++) {
+            const struct row &r = rows[i];
+            if (r.have_attitude && r.spd >= 3) {
+                float alpha = model.alpha0 + model.alpha1 / sq(r.spd);
+                sum += sq(r.pitch - flight_path_angle(r.climb_rate, r.spd) - alpha);
+            }
+        }
+        model.alpha_rms = sqrt(sum / n);
+    }
+
+    // acceleration along the flight path, from the rate of change of
+    // airspeed TECS logs
+    memset(ata, 0, sizeof(ata));
+    memset(atb, 0, sizeof(atb));
+    n = 0;
+    for (uint32_t i=0; i<num_rows; i++) {
+        const struct row &r = rows[i];
+        if (r.spd < 3) {
+            continue;
+        }
+        float load_factor = 1.0f / constrain_float(cosf(r.roll), 0.1f, 1);
+        double a[4] = { 1, r.thr_dem, sq(r.spd), sq(load_factor) / sq(r.spd) };
+        double y = r.spd_rate + GRAVITY_MSS * sinf(flight_path_angle(r.climb_rate, r.spd));
+        for (uint8_t j=0; j<4; j++) {
+            for (uint8_t k=0; k<4; k++) {
+                ata[j][k] += a[j] * a[k];
+            }
+            atb[j] += a[j] * y;
+        }
+        n++;
+    }
+    if (n < 50 || !solve_normal(ata, atb, 4, x)) {
+        ::printf("Not enough variation in the logs to fit the speed response\n");
+        return false;
+    }
+    model.accel0 = x[0];
+    model.accel_thr = x[1];
+    model.drag0 = x[2];
+    model.drag_induced = x[3];
+    if (model.accel_thr <= 0) {
+        ::printf("Throttle has no visible effect on airspeed in the logs\n");
+        return false;
+    }
+    double sum = 0;
+    for (uint32_t i=0; i<num_rows; i++) {
+        const struct row &r = rows[i];
+        if (r.spd >= 3) {
+            float load_factor = 1.0f / constrain_float(cosf(r.roll), 0.1f, 1);
+            float accel = model.accel0 + model.accel_thr * r.thr_dem + model.drag0 * sq(r.spd) +
+                model.drag_induced * sq(load_factor) / sq(r.spd);
+            sum += sq(r.spd_rate + GRAVITY_MSS * sinf(flight_path_angle(r.climb_rate, r.spd)) - accel);
+        }
+    }
+    model.accel_rms = sqrt(sum / n);
+
+    ::printf("Model: pitch lag %.2fs (RMS %.2f deg), alpha %.2f deg + %.1f/V^2 (RMS %.2f deg)\n",
+             model.pitch_tau, degrees(model.pitch_rms),
+             degrees(model.alpha0), degrees(model.alpha1), degrees(model.alpha_rms));
+    ::printf("       accel %.3f + %.3f*thr + %.6f*V^2 + %.2f*n^2/V^2 m/s/s (RMS %.3f)\n",
+             model.accel0, model.accel_thr, model.drag0, model.drag_induced, model.accel_rms);
+    return true;
+}
+
+void TECSTune::set_candidate_value(struct candidate &c, const char *name, float value)
+{
+    AP_Param::set_object_value(c.tecs, AP_TECS::var_info, name, value);
+}
+
+bool TECSTune::setup_candidates(void)
+{
+    // the logged values, then every combination of the search values
+    uint32_t total = 1;
+    for (uint8_t p=0; p<num_search; p++) {
+        total *= search[p].num_values;
+        if (total + 1 > TECSTUNE_MAX_CANDIDATES) {
+            ::printf("The search has more than %u combinations\n", TECSTUNE_MAX_CANDIDATES);
+            return false;
+        }
+    }
+    num_candidates = total + 1;
+    candidates = (struct candidate *)calloc(num_candidates, sizeof(candidates[0]));
+    if (candidates == NULL) {
+        ::printf("Out of memory for %u combinations\n", (unsigned)num_candidates);
+        return false;
+    }
+
+    for (uint16_t i=0; i<num_candidates; i++) {
+        struct candidate &c = candidates[i];
+        c.ins = new AP_InertialSensor(accelcal);
+        c.ahrs = new TECSTuneAHRS(*c.ins, baro, gps);
+        if (c.ins == NULL || c.ahrs == NULL) {
+            ::printf("Out of memory for combination %u\n", (unsigned)i);
+            return false;
+        }
+        if (use_airspeed) {
+            c.ahrs->set_airspeed(&airspeed);
+        }
+        c.tecs = new AP_TECS(*c.ahrs, aparm);
+        if (c.tecs == NULL) {
+            ::printf("Out of memory for combination %u\n", (unsigned)i);
+            return false;
+        }
+        for (uint8_t p=0; p<num_log_params; p++) {
+            if (strncmp(log_params[p].name, "TECS_", 5) == 0) {
+                set_candidate_value(c, &log_params[p].name[5], log_params[p].value);
+            }
+        }
+        uint32_t index = i - 1;
+        for (uint8_t p=0; p<num_search; p++) {
+            if (i == 0) {
+                c.value_index[p] = 0xFF;
+                continue;
+            }
+            c.value_index[p] = index % search[p].num_values;
+            index /= search[p].num_values;
+            set_candidate_value(c, search[p].name, search[p].values[c.value_index[p]]);
+        }
+    }
+    return true;
+}
+
+/*
+  put a candidate's aircraft where the log says the real one was
+ */
+void TECSTune::reset_candidate(struct candidate &c, const struct row &r)
+{
+    c.hgt = r.hgt;
+    c.climb_rate = r.climb_rate;
+    c.spd = max(r.spd, 3.0f);
+    c.spd_rate = 0;
+    c.hgt_accel = 0;
+    c.pitch = r.pitch;
+    c.thr_dem = r.thr_dem;
+    c.pitch_dem = r.pitch_dem;
+}
+
+/*
+  one 50Hz step of a candidate. On the first step of each logged
+  update its TECS also updates the pitch and throttle demands from the
+  logged height and speed demands
+ */
+void TECSTune::update_candidate(struct candidate &c)
+{
+    const struct row &r = *cur_row;
+    float load_factor = 1.0f / constrain_float(cosf(r.roll), 0.1f, 1);
+
+    if (cur_step == 0) {
+        c.hgt_err.add(r.hgt_dem - c.hgt);
+        c.spd_err.add(r.spd_dem - c.spd);
+    }
+
+    c.ahrs->set_state(r.roll, c.pitch, c.hgt, c.climb_rate, c.hgt_accel, c.spd, c.spd_rate);
+    c.tecs->update_50hz(c.hgt);
+
+    if (cur_step == 0) {
+        c.tecs->update_pitch_throttle(r.hgt_dem * 100, r.spd_dem * 100,
+                                      AP_SpdHgtControl::FLIGHT_NORMAL, 0, 0,
+                                      c.hgt, load_factor);
+        float thr_dem = c.tecs->get_throttle_demand() * 0.01f;
+        float pitch_dem = radians(c.tecs->get_pitch_demand() * 0.01f);
+        if (!r.new_segment) {
+            float dt = (r.time_us - (cur_row-1)->time_us) * 1.0e-6f;
+            if (dt > 0) {
+                c.thr_rate.add((thr_dem - c.thr_dem) / dt);
+                c.pitch_rate.add(degrees(pitch_dem - c.pitch_dem) / dt);
+            }
+        }
+        c.thr_dem = thr_dem;
+        c.pitch_dem = pitch_dem;
+    }
+
+    // move the model on one step
+    c.pitch += (c.pitch_dem - c.pitch) * model.pitch_k;
+    float gamma = c.pitch - (model.alpha0 + model.alpha1 / sq(c.spd));
+    float climb_rate = c.spd * sinf(gamma);
+    c.spd_rate = model.accel0 + model.accel_thr * c.thr_dem + model.drag0 * sq(c.spd) +
+        model.drag_induced * sq(load_factor) / sq(c.spd) - GRAVITY_MSS * sinf(gamma);
+    c.hgt_accel = (climb_rate - c.climb_rate) / step_dt;
+    c.climb_rate = climb_rate;
+    c.hgt += climb_rate * step_dt;
+    c.spd = max(c.spd + c.spd_rate * step_dt, 3.0f);
+}
+
+void TECSTune::update_candidate_job(void *obj, uint16_t i)
+{
+    TECSTune *tune = (TECSTune *)obj;
+    tune->update_candidate(tune->candidates[i]);
+}
+
+bool TECSTune::run(char * const *logfiles, uint16_t num_logs,
+                   uint8_t _num_threads, const char *report_path)
+{
+    // logs follow each other in time, with a gap that restarts TECS
+    uint64_t time_offset_us = 0;
+    for (uint16_t i=0; i<num_logs; i++) {
+        if (!read_log(logfiles[i], time_offset_us)) {
+            return false;
+        }
+        if (num_rows > 0) {
+            time_offset_us = rows[num_rows-1].time_us + 10*TECSTUNE_SEGMENT_GAP_USEC;
+        }
+    }
+    if (num_rows == 0) {
+        ::printf("No TECS messages in the logs\n");
+        return false;
+    }
+
+    setup_aparm();
+    if (!fit_model()) {
+        return false;
+    }
+    model.pitch_k = 1 - expf(-step_dt / model.pitch_tau);
+
+    if (!setup_candidates()) {
+        return false;
+    }
+
+    uint8_t threads_used = pool.start(_num_threads, num_candidates);
+    ::printf("TECS search: %u combinations over %u updates on %u threads\n",
+             (unsigned)num_candidates, (unsigned)num_rows, (unsigned)threads_used);
+
+    // the errors actually flown, to compare with the model
+    struct log_stats flown_hgt_err, flown_spd_err;
+    memset(&flown_hgt_err, 0, sizeof(flown_hgt_err));
+    memset(&flown_spd_err, 0, sizeof(flown_spd_err));
+
+    for (uint32_t i=0; i<num_rows; i++) {
+        const struct row &r = rows[i];
+        flown_hgt_err.add(r.hgt_dem - r.hgt);
+        flown_spd_err.add(r.spd_dem - r.spd);
+
+        if (r.new_segment) {
+            for (uint16_t c=0; c<num_candidates; c++) {
+                reset_candidate(candidates[c], r);
+            }
+        }
+
+        // step at 50Hz up to the next update
+        uint8_t num_steps = 5;
+        if (i+1 < num_rows && !rows[i+1].new_segment) {
+            uint64_t dt_us = rows[i+1].time_us - r.time_us;
+            num_steps = constrain_int16((dt_us + TECSTUNE_STEP_USEC/2) / TECSTUNE_STEP_USEC, 1, 50);
+        }
+        cur_row = &r;
+        for (cur_step=0; cur_step<num_steps; cur_step++) {
+            hal.scheduler->stop_clock(r.time_us + cur_step*(uint64_t)TECSTUNE_STEP_USEC);
+            pool.run();
+        }
+    }
+
+    for (uint16_t c=0; c<num_candidates; c++) {
+        candidates[c].score = candidates[c].hgt_err.rms() + candidates[c].spd_err.rms();
+    }
+    return write_report(report_path, flown_hgt_err, flown_spd_err);
+}
+
+/*
+  write every combination to report_path, best first, and the best of
+  them to stdout. Errors are RMS over the logged updates against the
+  logged demands. ThrRate is the RMS rate of change of the throttle
+  demand in 1/s and PtchRate that of the pitch demand in deg/s, to show
+  how hard each combination works the aircraft. Score is HgtErr in
+  meters plus SpdErr in m/s
+ */
+bool TECSTune::write_report(const char *report_path, const struct log_stats &hgt_err, const struct log_stats &spd_err) const
+{
+    uint16_t *order = (uint16_t *)calloc(num_candidates, sizeof(order[0]));
+    if (order == NULL) {
+        return false;
+    }
+    for (uint16_t i=0; i<num_candidates; i++) {
+        order[i] = i;
+    }
+    // insertion sort, the number of candidates is small next to the
+    // time taken to fly them
+    for (uint16_t i=1; i<num_candidates; i++) {
+        uint16_t v = order[i];
+        int32_t j = i - 1;
+        while (j >= 0 && candidates[order[j]].score > candidates[v].score) {
+            order[j+1] = order[j];
+            j--;
+        }
+        order[j+1] = v;
+    }
+
+    FILE *f = fopen(report_path, "w");
+    if (f == NULL) {
+        ::printf("Failed to create %s - %s\n", report_path, strerror(errno));
+        free(order);
+        return false;
+    }
+    fprintf(f, "Rank Set HgtErr HgtErrMax SpdErr SpdErrMax ThrRate PtchRate Score Params\n");
+    ::printf("Flown:  HgtErr %.2f m  SpdErr %.2f m/s  Score %.2f\n",
+             hgt_err.rms(), spd_err.rms(), hgt_err.rms() + spd_err.rms());
+    ::printf("%4s %4s %7s %9s %7s %9s %7s %8s %6s  %s\n",
+             "Rank", "Set", "HgtErr", "HgtErrMax", "SpdErr", "SpdErrMax",
+             "ThrRate", "PtchRate", "Score", "Params");
+    for (uint16_t rank=0; rank<num_candidates; rank++) {
+        uint16_t i = order[rank];
+        const struct candidate &c = candidates[i];
+        char params[TECSTUNE_MAX_PARAMS*(AP_MAX_NAME_SIZE+20)] = "";
+        for (uint8_t p=0; p<num_search; p++) {
+            size_t len = strlen(params);
+            if (c.value_index[p] == 0xFF) {
+                snprintf(&params[len], sizeof(params)-len, "%slogged", p==0?"":",");
+                break;
+            }
+            snprintf(&params[len], sizeof(params)-len, "%sTECS_%s=%g",
+                     p==0?"":",", search[p].name, (double)search[p].values[c.value_index[p]]);
+        }
+        fprintf(f, "%u %u %f %f %f %f %f %f %f %s\n",
+                (unsigned)rank, (unsigned)i,
+                c.hgt_err.rms(), c.hgt_err.max, c.spd_err.rms(), c.spd_err.max,
+                c.thr_rate.rms(), c.pitch_rate.rms(), c.score, params);
+        if (rank < 10 || i == 0) {
+            ::printf("%4u %4u %7.2f %9.2f %7.2f %9.2f %7.3f %8.2f %6.2f  %s\n",
+                     (unsigned)rank, (unsigned)i,
+                     c.hgt_err.rms(), c.hgt_err.max, c.spd_err.rms(), c.spd_err.max,
+                     c.thr_rate.rms(), c.pitch_rate.rms(), c.score, params);
+        }
+    }
+    fclose(f);
+    free(order);
+    return true;
+}
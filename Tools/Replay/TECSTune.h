@@ -0,0 +1,206 @@
+#include <AP_AHRS.h>
+#include <AP_TECS.h>
+#include <AP_Airspeed.h>
+#include <AP_InertialSensor.h>
+#include <AP_AccelCal.h>
+#include <DataFlash.h>
+
+#include "LogBatch.h"
+
+/*
+  offline search for TECS gains
+
+  Reads the TECS and CTUN messages of Plane logs, fits a simple
+  longitudinal model of the aircraft to them, then flies every
+  combination of a list of TECS parameter values against the model
+  with the logged height and speed demands, using AP_TECS itself. Each
+  combination is scored on the RMS height and speed error it would
+  have flown with. The search is read from a file with one parameter
+  per line and the values to try for it, for example
+
+    TECS_TIME_CONST=3,4,5,6,7
+    TECS_PTCH_DAMP=0,0.1,0.3
+    TECS_THR_DAMP=0.3,0.5,0.7
+
+  Parameters not in the search keep the values in the log. The first
+  combination is always the logged parameters, so its predicted errors
+  can be compared with the errors actually flown to see how far the
+  model can be trusted.
+
+  AP_TECS times itself with hal.scheduler->micros(), so every
+  combination steps together on the one stopped clock, shared out
+  between the threads of a LogBatchPool.
+ */
+
+/*
+  the AHRS a simulated aircraft presents to AP_TECS
+ */
+class TECSTuneAHRS : public AP_AHRS
+{
+public:
+    TECSTuneAHRS(AP_InertialSensor &ins, AP_Baro &baro, AP_GPS &gps) :
+        AP_AHRS(ins, baro, gps),
+        _airspeed_est(0) {}
+
+    // set the state of the simulated aircraft
+    void set_state(float _roll, float _pitch, float hgt, float climb_rate,
+                   float hgt_accel, float airspeed, float airspeed_rate);
+
+    void update(void) {}
+    const Vector3f &get_gyro(void) const { return _zero; }
+    const Vector3f &get_gyro_drift(void) const { return _zero; }
+    void reset_gyro_drift(void) {}
+    void reset(bool recover_eulers=false) {}
+    void reset_attitude(const float &_roll, const float &_pitch, const float &_yaw) {}
+    float get_error_rp(void) const { return 0; }
+    float get_error_yaw(void) const { return 0; }
+    const Matrix3f &get_dcm_matrix(void) const { return _dcm; }
+    bool get_position(struct Location &loc) const { return false; }
+    Vector3f wind_estimate(void) { return Vector3f(); }
+    void set_home(const Location &loc) {}
+    bool healthy(void) const { return true; }
+
+    const Vector3f &get_accel_ef(void) const { return _accel_ef; }
+    bool get_velocity_NED(Vector3f &vec) const { vec = _velocity; return true; }
+    bool get_relative_position_NED(Vector3f &vec) const { vec = _position; return true; }
+    bool airspeed_estimate(float *airspeed_ret) const {
+        *airspeed_ret = _airspeed_est;
+        return true;
+    }
+
+private:
+    Vector3f _zero;
+    Matrix3f _dcm;
+    Vector3f _accel_ef;
+    Vector3f _velocity;
+    Vector3f _position;
+    float _airspeed_est;
+};
+
+class TECSTune
+{
+public:
+    TECSTune(DataFlash_Class &_dataflash, AP_Baro &_baro, AP_GPS &_gps);
+
+    // read the parameter values to search. Returns false if the file
+    // can't be read or names an unknown parameter
+    bool load_search(const char *filename);
+
+    // read the logs, fit the model, fly every combination on up to
+    // num_threads threads and write the results to report_path and
+    // the best of them to stdout
+    bool run(char * const *logfiles, uint16_t num_logs,
+             uint8_t num_threads, const char *report_path);
+
+private:
+    DataFlash_Class &dataflash;
+    AP_Baro &baro;
+    AP_GPS &gps;
+
+    // one logged TECS update, with the attitude from the CTUN before it
+    struct row {
+        uint64_t time_us;
+        bool new_segment;   // the first row after a gap in TECS updates
+        float hgt;
+        float climb_rate;
+        float hgt_dem;
+        float spd_dem;
+        float spd;
+        float spd_rate;
+        float thr_dem;      // 0 to 1
+        float pitch_dem;    // radians
+        bool have_attitude;
+        float pitch;        // radians
+        float roll;         // radians
+    } *rows;
+    uint32_t num_rows;
+    uint32_t rows_space;
+    bool add_row(const struct row &r);
+    bool read_log(const char *logfile, uint64_t time_offset_us);
+
+    // parameters from the logs, the last value of each is kept
+#define TECSTUNE_MAX_LOG_PARAMS 64
+    struct log_param {
+        char name[17];
+        float value;
+    } log_params[TECSTUNE_MAX_LOG_PARAMS];
+    uint8_t num_log_params;
+    void set_log_param(const char *name, float value);
+    float get_log_param(const char *name, float default_value) const;
+    void setup_aparm(void);
+
+    // the longitudinal model: pitch follows the demand with a lag,
+    // the angle of attack is alpha0 + alpha1/V^2 and the acceleration
+    // along the flight path is
+    //   accel0 + accel_thr*throttle + drag0*V^2 + drag_induced*n^2/V^2 - g*sin(gamma)
+    struct {
+        float pitch_tau;
+        float pitch_k;      // pitch_tau as a gain per 50Hz step
+        float alpha0;
+        float alpha1;
+        float accel0;
+        float accel_thr;
+        float drag0;
+        float drag_induced;
+        float pitch_rms;    // RMS residuals of the fits
+        float alpha_rms;
+        float accel_rms;
+    } model;
+    bool fit_model(void);
+
+    // the values to search
+#define TECSTUNE_MAX_PARAMS 8
+#define TECSTUNE_MAX_VALUES 16
+#define TECSTUNE_MAX_CANDIDATES 4096
+    struct search_param {
+        char name[AP_MAX_NAME_SIZE+1];  // without the TECS_ prefix
+        uint8_t num_values;
+        float values[TECSTUNE_MAX_VALUES];
+    } search[TECSTUNE_MAX_PARAMS];
+    uint8_t num_search;
+
+    // one combination of values flying against the model
+    AP_Vehicle::FixedWing aparm;
+    AP_Airspeed airspeed;
+    AP_AccelCal accelcal;
+    bool use_airspeed;
+    struct candidate {
+        uint8_t value_index[TECSTUNE_MAX_PARAMS];   // 0xFF for the logged values
+        AP_InertialSensor *ins;
+        TECSTuneAHRS *ahrs;
+        AP_TECS *tecs;
+
+        // simulated aircraft
+        float hgt;
+        float climb_rate;
+        float spd;
+        float spd_rate;
+        float hgt_accel;
+        float pitch;
+
+        // demands from the last TECS update
+        float thr_dem;
+        float pitch_dem;
+
+        struct log_stats hgt_err;
+        struct log_stats spd_err;
+        struct log_stats thr_rate;
+        struct log_stats pitch_rate;
+        float score;
+    } *candidates;
+    uint16_t num_candidates;
+    bool setup_candidates(void);
+    void set_candidate_value(struct candidate &c, const char *name, float value);
+    void reset_candidate(struct candidate &c, const struct row &r);
+    void update_candidate(struct candidate &c);
+    bool write_report(const char *report_path, const struct log_stats &hgt_err, const struct log_stats &spd_err) const;
+
+    // the row and step the candidates are working on
+    const struct row *cur_row;
+    uint8_t cur_step;
+    float step_dt;
+
+    // threads the candidates of each step are shared out between
+    LogBatchPool pool;
+    static void update_candidate_job(void *obj, uint16_t i);
+};
@@ -0,0 +1,148 @@
+#!/usr/bin/env python
+'''
+Compare the NavEKF output of a single precision and a double precision
+Replay build over the same log, to quantify the numerical drift of the
+single precision filter.
+
+Build the two Replay binaries:
+  make linux BUILDROOT=/tmp/Replay.float
+  make linux BUILDROOT=/tmp/Replay.double EKF_DOUBLE=1
+
+then either let this script run them:
+  ekf_precision.py --float /tmp/Replay.float/Replay.elf \
+                   --double /tmp/Replay.double/Replay.elf log.bin
+
+or compare the EKFprec.dat files from two existing Replay runs:
+  ekf_precision.py --compare float_dir double_dir
+'''
+
+import os
+import sys
+import math
+import shutil
+import tempfile
+import subprocess
+import argparse
+
+# columns compared, with the scale used to report them and their units
+columns = [
+    ('Roll',  math.degrees(1), 'deg'),
+    ('Pitch', math.degrees(1), 'deg'),
+    ('Yaw',   math.degrees(1), 'deg'),
+    ('VN',    1, 'm/s'),
+    ('VE',    1, 'm/s'),
+    ('VD',    1, 'm/s'),
+    ('PN',    1, 'm'),
+    ('PE',    1, 'm'),
+    ('PD',    1, 'm'),
+    ('GX',    60*math.degrees(1), 'deg/min'),
+    ('GY',    60*math.degrees(1), 'deg/min'),
+    ('GZ',    60*math.degrees(1), 'deg/min'),
+    ('WN',    1, 'm/s'),
+    ('WE',    1, 'm/s'),
+    ('MN',    1000, 'mGauss'),
+    ('ME',    1000, 'mGauss'),
+    ('MD',    1000, 'mGauss'),
+    ('MX',    1000, 'mGauss'),
+    ('MY',    1000, 'mGauss'),
+    ('MZ',    1000, 'mGauss'),
+    ('SV',    1, ''),
+    ('SP',    1, ''),
+    ('SH',    1, ''),
+]
+
+def load(path):
+    '''load an EKFprec.dat file as a dictionary of time to row'''
+    f = open(path, 'r')
+    header = f.readline().split()
+    rows = {}
+    for line in f:
+        v = line.split()
+        if len(v) != len(header):
+            continue
+        rows[v[0]] = dict(zip(header, [float(x) for x in v]))
+    f.close()
+    return rows
+
+def angle_diff(a, b):
+    '''difference between two angles in radians, wrapped to +-pi'''
+    d = a - b
+    while d > math.pi:
+        d -= 2*math.pi
+    while d < -math.pi:
+        d += 2*math.pi
+    return d
+
+def compare(float_file, double_file, threshold):
+    '''report the drift of the single precision filter from the double precision reference'''
+    single = load(float_file)
+    ref = load(double_file)
+    times = sorted([t for t in single.keys() if t in ref], key=float)
+    if len(times) == 0:
+        print("No common timestamps between %s and %s" % (float_file, double_file))
+        return False
+
+    print("Compared %u samples from %.1f to %.1f seconds" % (len(times), float(times[0]), float(times[-1])))
+    print("%-6s %12s %12s %12s %10s" % ("State", "MaxErr", "RMSErr", "FinalErr", "Units"))
+    ok = True
+    for (name, scale, units) in columns:
+        max_err = 0
+        sum_sq = 0
+        first_exceed = None
+        err = 0
+        for t in times:
+            if name in ['Roll', 'Pitch', 'Yaw']:
+                err = angle_diff(single[t][name], ref[t][name]) * scale
+            else:
+                err = (single[t][name] - ref[t][name]) * scale
+            sum_sq += err*err
+            if abs(err) > max_err:
+                max_err = abs(err)
+            if threshold is not None and abs(err) > threshold and first_exceed is None:
+                first_exceed = t
+        rms = math.sqrt(sum_sq / len(times))
+        print("%-6s %12.6g %12.6g %12.6g %10s" % (name, max_err, rms, err, units))
+        if first_exceed is not None:
+            print("       exceeded %g at %s seconds" % (threshold, first_exceed))
+            ok = False
+    return ok
+
+def run_replay(binary, logfile, extra_args):
+    '''run a Replay binary on a log in a temporary directory, returning the directory'''
+    d = tempfile.mkdtemp(prefix='ekf_precision_')
+    cmd = [os.path.abspath(binary)] + extra_args + [os.path.abspath(logfile)]
+    print("Running %s in %s" % (' '.join(cmd), d))
+    subprocess.check_call(cmd, cwd=d, stdout=open(os.path.join(d, 'replay.log'), 'w'))
+    return d
+
+parser = argparse.ArgumentParser(description='compare single and double precision NavEKF over a log')
+parser.add_argument('--float', dest='float_bin', default=None, help='single precision Replay binary')
+parser.add_argument('--double', dest='double_bin', default=None, help='double precision Replay binary')
+parser.add_argument('--compare', nargs=2, default=None, metavar=('FLOAT_DIR', 'DOUBLE_DIR'),
+                    help='compare EKFprec.dat from two existing Replay runs')
+parser.add_argument('--threshold', type=float, default=None, help='fail if any scaled error exceeds this')
+parser.add_argument('--keep', action='store_true', help='keep the Replay output directories')
+parser.add_argument('--replay-args', default='', help='extra arguments passed to both Replay runs')
+parser.add_argument('log', nargs='?', default=None)
+args = parser.parse_args()
+
+if args.compare is not None:
+    float_dir, double_dir = args.compare
+    dirs = []
+else:
+    if args.float_bin is None or args.double_bin is None or args.log is None:
+        parser.print_help()
+        sys.exit(1)
+    float_dir = run_replay(args.float_bin, args.log, args.replay_args.split())
+    double_dir = run_replay(args.double_bin, args.log, args.replay_args.split())
+    dirs = [float_dir, double_dir]
+
+ok = compare(os.path.join(float_dir, 'EKFprec.dat'),
+             os.path.join(double_dir, 'EKFprec.dat'),
+             args.threshold)
+
+if not args.keep:
+    for d in dirs:
+        shutil.rmtree(d)
+
+sys.exit(0 if ok else 1)
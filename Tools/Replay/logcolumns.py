@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+'''
+Load the columns written by Replay's log export:
+
+  Replay.elf -E columns -j 4 log1.bin log2.bin ...
+
+gives a directory per log under columns/, holding one file per message
+field and a columns.txt index. Each file is a little endian array of
+the field's DataFlash type, with a MSG.TimeUS column of timestamps in
+microseconds for each message type. Values are stored as logged, so
+scaled types (e.g. 'c' in centi-units, 'L' in 1e-7 degrees) still
+need scaling.
+
+  import logcolumns
+  log = logcolumns.load('columns/log1')
+  roll = log['ATT.Roll'] * 0.01
+  t = log['ATT.TimeUS'] * 1.0e-6
+
+With numpy the columns are memory mapped numpy arrays, otherwise they
+are read into python arrays.
+'''
+
+import os
+import sys
+
+# numpy dtype and python array type for each DataFlash field type
+types = {
+    'b' : ('<i1', 'b'),
+    'B' : ('<u1', 'B'),
+    'M' : ('<u1', 'B'),
+    'h' : ('<i2', 'h'),
+    'c' : ('<i2', 'h'),
+    'H' : ('<u2', 'H'),
+    'C' : ('<u2', 'H'),
+    'i' : ('<i4', 'i'),
+    'e' : ('<i4', 'i'),
+    'L' : ('<i4', 'i'),
+    'I' : ('<u4', 'I'),
+    'E' : ('<u4', 'I'),
+    'f' : ('<f4', 'f'),
+    'Q' : ('<u8', 'Q'),
+    'n' : ('S4', None),
+    'N' : ('S16', None),
+    'Z' : ('S64', None),
+}
+
+def index(logdir):
+    '''return a list of (column, type, size, count) from a log's columns.txt'''
+    ret = []
+    for line in open(os.path.join(logdir, 'columns.txt')):
+        if line.startswith('#'):
+            continue
+        v = line.split()
+        if len(v) == 4:
+            ret.append((v[0], v[1], int(v[2]), int(v[3])))
+    return ret
+
+def load_column(logdir, name, ftype, size, count):
+    '''load one column'''
+    path = os.path.join(logdir, name)
+    (dtype, atype) = types.get(ftype, ('S%u' % size, None))
+    try:
+        import numpy
+        if count == 0:
+            return numpy.zeros(0, dtype=dtype)
+        return numpy.memmap(path, dtype=dtype, mode='r', shape=(count,))
+    except ImportError:
+        data = open(path, 'rb').read()
+        if atype is None:
+            return [data[i*size:(i+1)*size].rstrip(b'\0') for i in range(count)]
+        import array
+        a = array.array(atype)
+        if sys.version_info[0] < 3:
+            a.fromstring(data)
+        else:
+            a.frombytes(data)
+        if sys.byteorder != 'little':
+            a.byteswap()
+        return a
+
+def load(logdir, prefix=None):
+    '''load all the columns of an exported log as a dictionary, optionally only those of one message type'''
+    ret = {}
+    for (name, ftype, size, count) in index(logdir):
+        if prefix is not None and not name.startswith(prefix + '.'):
+            continue
+        ret[name] = load_column(logdir, name, ftype, size, count)
+    return ret
+
+if __name__ == '__main__':
+    for logdir in sys.argv[1:]:
+        for (name, ftype, size, count) in index(logdir):
+            print("%-24s %s %2u %u" % (name, ftype, size, count))
@@ -451,11 +451,29 @@ void AC_AttitudeControl::rate_bf_roll_pitch_yaw(float roll_rate_bf, float pitch_
 void AC_AttitudeControl::rate_controller_run()
 {
     // call rate controllers and send output to motors object
+    // this does the same as rate_bf_to_motor_roll, pitch and yaw, with one gyro read and the three PIDs run together
     // To-Do: should the outputs from get_rate_roll, pitch, yaw be int16_t which is the input to the motors library?
     // To-Do: skip this step if the throttle out is zero?
-    _motors.set_roll(rate_bf_to_motor_roll(_rate_bf_target.x));
-    _motors.set_pitch(rate_bf_to_motor_pitch(_rate_bf_target.y));
-    _motors.set_yaw(rate_bf_to_motor_yaw(_rate_bf_target.z));
+    Vector3f rate_error = _rate_bf_target - _ahrs.get_gyro_for_control() * AC_ATTITUDE_CONTROL_DEGX100;
+
+    _roll_lead_filt.set_params(_roll_lead_w*2*M_PI, _roll_lead_r, 1.0f/_dt);
+    rate_error.x = _roll_lead_filt.apply(rate_error.x);
+    _pitch_lead_filt.set_params(_pitch_lead_w*2*M_PI, _pitch_lead_r, 1.0f/_dt);
+    rate_error.y = _pitch_lead_filt.apply(rate_error.y);
+
+    // roll and pitch filter only the D term, yaw filters its whole input
+    uint8_t limit_mask = 0;
+    if (_motors.limit.roll_pitch) {
+        limit_mask |= AC_PID_3D_AXIS_X | AC_PID_3D_AXIS_Y;
+    }
+    if (_motors.limit.yaw) {
+        limit_mask |= AC_PID_3D_AXIS_Z;
+    }
+    Vector3f out = _pid_rate.update(rate_error, AC_PID_3D_AXIS_Z, limit_mask);
+
+    _motors.set_roll(constrain_float(out.x, -AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX));
+    _motors.set_pitch(constrain_float(out.y, -AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_RP_CONTROLLER_OUT_MAX));
+    _motors.set_yaw(constrain_float(out.z, -AC_ATTITUDE_RATE_YAW_CONTROLLER_OUT_MAX, AC_ATTITUDE_RATE_YAW_CONTROLLER_OUT_MAX));
 }
 
 //
@@ -13,6 +13,7 @@
 #include <AP_AHRS.h>
 #include <AP_Motors.h>
 #include <AC_PID.h>
+#include <AC_PID_3D.h>
 #include <AC_P.h>
 #include <LeadFilter.h>
 
@@ -59,6 +60,7 @@ public:
         _pid_rate_roll(pid_rate_roll),
         _pid_rate_pitch(pid_rate_pitch),
         _pid_rate_yaw(pid_rate_yaw),
+        _pid_rate(pid_rate_roll, pid_rate_pitch, pid_rate_yaw),
         _dt(AC_ATTITUDE_100HZ_DT),
         _angle_boost(0),
         _acro_angle_switch(0)
@@ -88,6 +90,15 @@ public:
     // save_accel_yaw_max - sets and saves the yaw acceleration limit
     void save_accel_yaw_max(float accel_yaw_max) { _accel_yaw_max = accel_yaw_max; _accel_yaw_max.save(); }
 
+    // get_accel_roll_max - gets the roll acceleration limit
+    float get_accel_roll_max() const { return _accel_roll_max; }
+
+    // get_accel_pitch_max - gets the pitch acceleration limit
+    float get_accel_pitch_max() const { return _accel_pitch_max; }
+
+    // get_accel_yaw_max - gets the yaw acceleration limit
+    float get_accel_yaw_max() const { return _accel_yaw_max; }
+
     // relax_bf_rate_controller - ensure body-frame rate controller has zero errors to relax rate controller output
     void relax_bf_rate_controller();
 
@@ -258,6 +269,7 @@ protected:
     AC_PID&             _pid_rate_roll;
     AC_PID&             _pid_rate_pitch;
     AC_PID&             _pid_rate_yaw;
+    AC_PID_3D           _pid_rate;              // runs the three rate PIDs together in rate_controller_run
 
     // parameters
     AP_Float            _slew_yaw;              // maximum rate the yaw target can be updated in Loiter, RTL, Auto flight modes
@@ -44,7 +44,10 @@ AC_PID::AC_PID(float initial_p, float initial_i, float initial_d, float initial_
     _dt(dt),
     _integrator(0.0f),
     _input(0.0f),
-    _derivative(0.0f)
+    _derivative(0.0f),
+    _dt_inv(0.0f),
+    _filt_alpha(1.0f),
+    _filt_alpha_hz(0.0f)
 {
     // load parameter values from eeprom
     AP_Param::setup_object_defaults(this, var_info);
@@ -55,6 +58,9 @@ AC_PID::AC_PID(float initial_p, float initial_i, float initial_d, float initial_
     _imax = fabs(initial_imax);
     filt_hz(initial_filt_hz);
 
+    // calculate the input filter alpha and 1/dt
+    update_coefficients();
+
     // reset input filter to first value received
     _flags._reset_filter = true;
 }
@@ -64,6 +70,7 @@ void AC_PID::set_dt(float dt)
 {
     // set dt and calculate the input filter alpha
     _dt = dt;
+    update_coefficients();
 }
 
 // filt_hz - set input filter hz
@@ -73,6 +80,9 @@ void AC_PID::filt_hz(float hz)
 
     // sanity check _filt_hz
     _filt_hz = max(_filt_hz, AC_PID_FILT_HZ_MIN);
+
+    // calculate the input filter alpha
+    update_coefficients();
 }
 
 // set_input_filter_all - set input to PID controller
@@ -80,24 +90,7 @@ void AC_PID::filt_hz(float hz)
 //  this should be called before any other calls to get_p, get_i or get_d
 void AC_PID::set_input_filter_all(float input)
 {
-    // don't process inf or NaN
-    if (!isfinite(input)) {
-        return;
-    }
-
-    // reset input filter to value received
-    if (_flags._reset_filter) {
-        _flags._reset_filter = false;
-        _input = input;
-        _derivative = 0.0f;
-    }
-
-    // update filter and calculate derivative
-    float input_filt_change = get_filt_alpha() * (input - _input);
-    _input = _input + input_filt_change;
-    if (_dt > 0.0f) {
-        _derivative = input_filt_change / _dt;
-    }
+    filter_input(input, true);
 }
 
 // set_input_filter_d - set input to PID controller
@@ -105,24 +98,7 @@ void AC_PID::set_input_filter_all(float input)
 //  this should be called before any other calls to get_p, get_i or get_d
 void AC_PID::set_input_filter_d(float input)
 {
-    // don't process inf or NaN
-    if (!isfinite(input)) {
-        return;
-    }
-
-    // reset input filter to value received
-    if (_flags._reset_filter) {
-        _flags._reset_filter = false;
-        _derivative = 0.0f;
-    }
-
-    // update filter and calculate derivative
-    if (_dt > 0.0f) {
-        float derivative = (input - _input) / _dt;
-        _derivative = _derivative + get_filt_alpha() * (derivative-_derivative);
-    }
-
-    _input = input;
+    filter_input(input, false);
 }
 
 float AC_PID::get_p() const
@@ -132,16 +108,7 @@ float AC_PID::get_p() const
 
 float AC_PID::get_i()
 {
-    if(!is_zero(_ki) && !is_zero(_dt)) {
-        _integrator += ((float)_input * _ki) * _dt;
-        if (_integrator < -_imax) {
-            _integrator = -_imax;
-        } else if (_integrator > _imax) {
-            _integrator = _imax;
-        }
-        return _integrator;
-    }
-    return 0;
+    return update_i();
 }
 
 float AC_PID::get_d() const
@@ -173,6 +140,9 @@ void AC_PID::load_gains()
     _imax.load();
     _imax = fabs(_imax);
     _filt_hz.load();
+
+    // calculate the input filter alpha
+    update_coefficients();
 }
 
 // save_gains - save gains to eeprom
@@ -194,10 +164,20 @@ void AC_PID::operator() (float p, float i, float d, float imaxval, float input_f
     _imax = fabs(imaxval);
     _filt_hz = input_filt_hz;
     _dt = dt;
+    update_coefficients();
 }
 
-// calc_filt_alpha - recalculate the input filter alpha
+// get_filt_alpha - get the input filter alpha
 float AC_PID::get_filt_alpha() const
+{
+    if (_filt_hz == _filt_alpha_hz) {
+        return _filt_alpha;
+    }
+    return calc_filt_alpha();
+}
+
+// calc_filt_alpha - calculate the input filter alpha
+float AC_PID::calc_filt_alpha() const
 {
     if (is_zero(_filt_hz)) {
         return 1.0f;
@@ -207,3 +187,11 @@ float AC_PID::get_filt_alpha() const
     float rc = 1/(M_2PI_F*_filt_hz);
     return _dt / (_dt + rc);
 }
+
+// update_coefficients - recalculate the input filter alpha and 1/dt
+void AC_PID::update_coefficients()
+{
+    _filt_alpha = calc_filt_alpha();
+    _filt_alpha_hz = _filt_hz;
+    _dt_inv = is_zero(_dt) ? 0.0f : 1.0f/_dt;
+}
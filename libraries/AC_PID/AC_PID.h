@@ -42,6 +42,18 @@ public:
     float       get_i();
     float       get_d() const;
 
+    // update_all - set_input_filter_all() if filter_all is true, otherwise set_input_filter_d(), followed by get_pid()
+    //  when limit is true the integrator is only updated if the input will reduce it
+    //  inline so that AC_PID_3D can run the controllers of three axes in one pass
+    float       update_all(float input, bool filter_all, bool limit) {
+        filter_input(input, filter_all);
+        float integrator = _integrator;
+        if (!limit || (integrator > 0 && input < 0) || (integrator < 0 && input > 0)) {
+            integrator = update_i();
+        }
+        return _input * _kp + integrator + _kd * _derivative;
+    }
+
     // reset_I - reset the integrator
     void        reset_I();
 
@@ -80,6 +92,68 @@ public:
 
 protected:
 
+    // calc_filt_alpha - calculate the input filter alpha for the current filter frequency and time step
+    float       calc_filt_alpha() const;
+
+    // update_coefficients - recalculate the values derived from the filter frequency and time step
+    void        update_coefficients();
+
+    // filt_alpha - input filter alpha, only recalculated when the filter frequency or time step changes
+    float       filt_alpha() {
+        // _filt_hz can also be changed directly through its parameter
+        if (_filt_hz != _filt_alpha_hz) {
+            update_coefficients();
+        }
+        return _filt_alpha;
+    }
+
+    // filter_input - filter the input as set_input_filter_all() or set_input_filter_d()
+    void        filter_input(float input, bool filter_all) {
+        // don't process inf or NaN
+        if (!isfinite(input)) {
+            return;
+        }
+
+        // reset input filter to value received
+        if (_flags._reset_filter) {
+            _flags._reset_filter = false;
+            if (filter_all) {
+                _input = input;
+            }
+            _derivative = 0.0f;
+        }
+
+        // update filter and calculate derivative
+        const float alpha = filt_alpha();
+        if (filter_all) {
+            float input_filt_change = alpha * (input - _input);
+            _input += input_filt_change;
+            if (_dt > 0.0f) {
+                _derivative = input_filt_change * _dt_inv;
+            }
+        } else {
+            if (_dt > 0.0f) {
+                float derivative = (input - _input) * _dt_inv;
+                _derivative += alpha * (derivative - _derivative);
+            }
+            _input = input;
+        }
+    }
+
+    // update_i - update the integrator as get_i()
+    float       update_i() {
+        if (!is_zero(_ki) && !is_zero(_dt)) {
+            _integrator += (_input * _ki) * _dt;
+            if (_integrator < -_imax) {
+                _integrator = -_imax;
+            } else if (_integrator > _imax) {
+                _integrator = _imax;
+            }
+            return _integrator;
+        }
+        return 0;
+    }
+
     // parameters
     AP_Float        _kp;
     AP_Float        _ki;
@@ -97,6 +171,9 @@ protected:
     float           _integrator;                // integrator value
     float           _input;                // last input for derivative
     float           _derivative;           // last derivative for low-pass filter
+    float           _dt_inv;                    // 1/_dt, zero when _dt is zero
+    float           _filt_alpha;                // input filter alpha
+    float           _filt_alpha_hz;             // filter frequency _filt_alpha was calculated for
 };
 
 #endif // __AC_PID_H__
@@ -0,0 +1,25 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID_3D.cpp
+/// @brief	Runs three AC_PID controllers, one per axis, in a single pass
+
+#include <AP_Math.h>
+#include "AC_PID_3D.h"
+
+// Constructor
+AC_PID_3D::AC_PID_3D(AC_PID &pid_x, AC_PID &pid_y, AC_PID &pid_z)
+{
+    _pid[0] = &pid_x;
+    _pid[1] = &pid_y;
+    _pid[2] = &pid_z;
+}
+
+// update - set the input of each controller and return their outputs
+//  gives the same results as calling set_input_filter_all() or
+//  set_input_filter_d(), get_p(), get_i() and get_d() on each axis
+Vector3f AC_PID_3D::update(const Vector3f &input, uint8_t filter_all_mask, uint8_t limit_mask)
+{
+    return Vector3f(_pid[0]->update_all(input.x, (filter_all_mask & AC_PID_3D_AXIS_X) != 0, (limit_mask & AC_PID_3D_AXIS_X) != 0),
+                    _pid[1]->update_all(input.y, (filter_all_mask & AC_PID_3D_AXIS_Y) != 0, (limit_mask & AC_PID_3D_AXIS_Y) != 0),
+                    _pid[2]->update_all(input.z, (filter_all_mask & AC_PID_3D_AXIS_Z) != 0, (limit_mask & AC_PID_3D_AXIS_Z) != 0));
+}
@@ -0,0 +1,39 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_PID_3D.h
+/// @brief	Runs three AC_PID controllers, one per axis, in a single pass
+
+#ifndef __AC_PID_3D_H__
+#define __AC_PID_3D_H__
+
+#include <AP_Math.h>
+#include "AC_PID.h"
+
+#define AC_PID_3D_AXIS_X    (1<<0)
+#define AC_PID_3D_AXIS_Y    (1<<1)
+#define AC_PID_3D_AXIS_Z    (1<<2)
+
+/// @class	AC_PID_3D
+/// @brief	Evaluates an AC_PID per axis of a vector
+///
+/// The gains and state stay in the three AC_PID objects, so their
+/// parameters are unchanged, but each update runs the inline
+/// AC_PID::update_all() on the three axes together instead of making
+/// the five calls per axis of set_input_filter_d(), get_p(),
+/// get_integrator(), get_i() and get_d()
+class AC_PID_3D {
+public:
+
+    // Constructor
+    AC_PID_3D(AC_PID &pid_x, AC_PID &pid_y, AC_PID &pid_z);
+
+    // update - set the input of each controller and return their outputs
+    //  axes in filter_all_mask filter the input as set_input_filter_all(), the others as set_input_filter_d()
+    //  the integrators of axes in limit_mask are only updated when that will reduce them
+    Vector3f    update(const Vector3f &input, uint8_t filter_all_mask, uint8_t limit_mask);
+
+private:
+    AC_PID *_pid[3];
+};
+
+#endif // __AC_PID_3D_H__
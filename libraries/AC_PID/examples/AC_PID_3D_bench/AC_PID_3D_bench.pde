@@ -0,0 +1,164 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Cost of the copter body-frame rate PIDs per loop, run as three
+// separate AC_PID objects the way rate_bf_to_motor_roll, pitch and
+// yaw call them, and together through AC_PID_3D. The first case
+// changes the filter frequency every loop so that the input filter
+// alpha is recalculated on each update, as it was before AC_PID
+// cached it. The outputs of the separate and combined runs are
+// compared to check they match.
+//
+// Only the PIDs are timed. The rate errors are worked out beforehand,
+// so the gyro reads that rate_controller_run() saves by reading the
+// gyro once rather than once per axis are not included.
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_FLYMAPLE.h>
+#include <AP_HAL_PX4.h>
+#include <AP_HAL_Empty.h>
+#include <GCS_MAVLink.h>
+#include <StorageManager.h>
+#include <AC_PID.h>
+#include <AC_PID_3D.h>
+#include <AP_Scheduler.h>
+#include <DataFlash.h>
+#include <AP_GPS.h>
+#include <AP_Vehicle.h>
+#include <AP_InertialSensor.h>
+#include <Filter.h>
+#include <AP_Baro.h>
+#include <AP_AHRS.h>
+#include <AP_Compass.h>
+#include <AP_Declination.h>
+#include <AP_Airspeed.h>
+#include <AP_NavEKF.h>
+#include <AP_ADC.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_Notify.h>
+#include <AP_Mission.h>
+#include <AP_Terrain.h>
+#include <AP_Rally.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_LOOPS   2000
+#define DT          0.0025f     // 400Hz
+
+// copter default rate gains
+#define RATE_RP_P       0.15f
+#define RATE_RP_I       0.10f
+#define RATE_RP_D       0.004f
+#define RATE_RP_IMAX    1000
+#define RATE_YAW_P      0.20f
+#define RATE_YAW_I      0.02f
+#define RATE_YAW_D      0.0f
+#define RATE_YAW_IMAX   1000
+#define RATE_FILT_HZ    20.0f
+
+static Vector3f errors[NUM_LOOPS];
+static Vector3f outputs[NUM_LOOPS];
+
+// the rate errors of a copter wobbling about its target, in centi-degrees/sec
+static void make_errors(void)
+{
+    for (uint16_t i=0; i<NUM_LOOPS; i++) {
+        float t = i * DT;
+        errors[i] = Vector3f(3000 * sinf(t * 7.0f) + 500 * sinf(t * 53.0f),
+                             2500 * sinf(t * 5.0f + 1) + 400 * sinf(t * 61.0f),
+                             800 * sinf(t * 2.0f) + 100 * sinf(t * 37.0f));
+    }
+}
+
+// one axis as in rate_bf_to_motor_roll and pitch (filter_all false) or yaw
+static float run_axis(AC_PID &pid, float rate_error, bool filter_all, bool limit)
+{
+    if (filter_all) {
+        pid.set_input_filter_all(rate_error);
+    } else {
+        pid.set_input_filter_d(rate_error);
+    }
+    float p = pid.get_p();
+    float i = pid.get_integrator();
+    if (!limit || ((i>0&&rate_error<0)||(i<0&&rate_error>0))) {
+        i = pid.get_i();
+    }
+    float d = pid.get_d();
+    return p + i + d;
+}
+
+static uint32_t run_separate(bool change_filter)
+{
+    AC_PID roll(RATE_RP_P, RATE_RP_I, RATE_RP_D, RATE_RP_IMAX, RATE_FILT_HZ, DT);
+    AC_PID pitch(RATE_RP_P, RATE_RP_I, RATE_RP_D, RATE_RP_IMAX, RATE_FILT_HZ, DT);
+    AC_PID yaw(RATE_YAW_P, RATE_YAW_I, RATE_YAW_D, RATE_YAW_IMAX, RATE_FILT_HZ, DT);
+
+    uint32_t start_time = hal.scheduler->micros();
+    for (uint16_t i=0; i<NUM_LOOPS; i++) {
+        if (change_filter) {
+            float filt_hz = (i & 1) ? RATE_FILT_HZ : RATE_FILT_HZ + 0.001f;
+            roll.filt_hz(filt_hz);
+            pitch.filt_hz(filt_hz);
+            yaw.filt_hz(filt_hz);
+        }
+        bool limit = (i / 100) & 1;
+        outputs[i].x = run_axis(roll, errors[i].x, false, limit);
+        outputs[i].y = run_axis(pitch, errors[i].y, false, limit);
+        outputs[i].z = run_axis(yaw, errors[i].z, true, limit);
+    }
+    return hal.scheduler->micros() - start_time;
+}
+
+static uint32_t run_3d(bool *match)
+{
+    AC_PID roll(RATE_RP_P, RATE_RP_I, RATE_RP_D, RATE_RP_IMAX, RATE_FILT_HZ, DT);
+    AC_PID pitch(RATE_RP_P, RATE_RP_I, RATE_RP_D, RATE_RP_IMAX, RATE_FILT_HZ, DT);
+    AC_PID yaw(RATE_YAW_P, RATE_YAW_I, RATE_YAW_D, RATE_YAW_IMAX, RATE_FILT_HZ, DT);
+    AC_PID_3D pid(roll, pitch, yaw);
+    static Vector3f out[NUM_LOOPS];
+
+    uint32_t start_time = hal.scheduler->micros();
+    for (uint16_t i=0; i<NUM_LOOPS; i++) {
+        uint8_t limit_mask = ((i / 100) & 1) ? (AC_PID_3D_AXIS_X | AC_PID_3D_AXIS_Y | AC_PID_3D_AXIS_Z) : 0;
+        out[i] = pid.update(errors[i], AC_PID_3D_AXIS_Z, limit_mask);
+    }
+    uint32_t time = hal.scheduler->micros() - start_time;
+
+    *match = true;
+    for (uint16_t i=0; i<NUM_LOOPS; i++) {
+        if ((out[i] - outputs[i]).length() > 0.001f) {
+            *match = false;
+        }
+    }
+    return time;
+}
+
+void setup(void)
+{
+    hal.console->println("AC_PID rate controller benchmark");
+    make_errors();
+}
+
+void loop(void)
+{
+    bool match;
+    uint32_t uncached_time = run_separate(true);
+    uint32_t separate_time = run_separate(false);
+    uint32_t combined_time = run_3d(&match);
+
+    hal.console->printf_P(PSTR("alpha recalculated %7.3f usec per loop\n"), uncached_time / (float)NUM_LOOPS);
+    hal.console->printf_P(PSTR("separate AC_PID    %7.3f usec per loop\n"), separate_time / (float)NUM_LOOPS);
+    hal.console->printf_P(PSTR("AC_PID_3D          %7.3f usec per loop, outputs %s\n\n"),
+                          combined_time / (float)NUM_LOOPS,
+                          match ? "match" : "DIFFER");
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
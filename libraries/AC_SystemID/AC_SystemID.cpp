@@ -0,0 +1,461 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <AP_HAL.h>
+#include <AC_SystemID.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern const AP_HAL::HAL& hal;
+
+const AP_Param::GroupInfo AC_SystemID::var_info[] PROGMEM = {
+
+    // @Param: AXIS
+    // @DisplayName: System identification axis
+    // @Description: The axis the system identification flight mode sweeps
+    // @Values: 0:None,1:Roll,2:Pitch,3:Yaw
+    // @User: Advanced
+    AP_GROUPINFO("AXIS", 0, AC_SystemID, _axis, AC_SYSTEMID_AXIS_DEFAULT),
+
+    // @Param: MAGNITUDE
+    // @DisplayName: System identification chirp magnitude
+    // @Description: Amplitude of the chirp added to the axis' motor output, where 4500 is full scale
+    // @Range: 50 1500
+    // @Increment: 10
+    // @User: Advanced
+    AP_GROUPINFO("MAGNITUDE", 1, AC_SystemID, _magnitude, AC_SYSTEMID_MAGNITUDE_DEFAULT),
+
+    // @Param: F_START_HZ
+    // @DisplayName: System identification start frequency
+    // @Description: Frequency the chirp starts at
+    // @Units: Hz
+    // @Range: 0.1 5
+    // @User: Advanced
+    AP_GROUPINFO("F_START_HZ", 2, AC_SystemID, _f_start_hz, AC_SYSTEMID_F_START_DEFAULT),
+
+    // @Param: F_STOP_HZ
+    // @DisplayName: System identification stop frequency
+    // @Description: Frequency the chirp ends at. It is limited to a quarter of the loop rate
+    // @Units: Hz
+    // @Range: 5 100
+    // @User: Advanced
+    AP_GROUPINFO("F_STOP_HZ", 3, AC_SystemID, _f_stop_hz, AC_SYSTEMID_F_STOP_DEFAULT),
+
+    AP_GROUPEND
+};
+
+/// Constructor
+AC_SystemID::AC_SystemID() :
+    _state(STATE_IDLE),
+    _sample_rate_hz(0),
+    _sweep_rate(0),
+    _chirp_scale(0),
+    _num_samples(0),
+    _buffer(NULL),
+    _sine(NULL),
+    _step_index(0),
+    _fft_half(0),
+    _num_bands(0),
+    _model_K(0),
+    _model_tau(0),
+    _model_delay(0),
+    _model_fit_error(0)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+}
+
+/// start - start recording a sweep of samples taken at sample_rate_hz
+bool AC_SystemID::start(float sample_rate_hz)
+{
+    if (_axis < AXIS_ROLL || _axis > AXIS_YAW || sample_rate_hz <= 0 ||
+        _f_start_hz <= 0 || _f_stop_hz <= _f_start_hz || _f_start_hz >= sample_rate_hz * 0.25f) {
+        return false;
+    }
+
+    // the buffer is only allocated by vehicles that use system identification, and then kept
+    if (_buffer == NULL) {
+        _buffer = (float *)calloc(AC_SYSTEMID_NUM_SAMPLES * 2, sizeof(float));
+        _sine = (float *)calloc(AC_SYSTEMID_NUM_SAMPLES / 4 + 1, sizeof(float));
+        if (_buffer == NULL || _sine == NULL) {
+            free(_buffer);
+            free(_sine);
+            _buffer = NULL;
+            _sine = NULL;
+            return false;
+        }
+    }
+
+    float f_stop = min(_f_stop_hz, sample_rate_hz * 0.25f);
+    _sample_rate_hz = sample_rate_hz;
+    _sweep_rate = logf(f_stop / _f_start_hz) / AC_SYSTEMID_NUM_SAMPLES;
+    _chirp_scale = 2.0f * PI * _f_start_hz / (sample_rate_hz * _sweep_rate);
+    _num_samples = 0;
+    _num_bands = 0;
+    _model_K = 0;
+    _state = STATE_RECORDING;
+    return true;
+}
+
+/// stop - abandon the sweep or analysis
+void AC_SystemID::stop()
+{
+    _state = STATE_IDLE;
+}
+
+/// chirp - the chirp to add to the input for the next sample
+float AC_SystemID::chirp() const
+{
+    if (_state != STATE_RECORDING) {
+        return 0;
+    }
+
+    // exponential sweep, the frequency at sample n is f_start*exp(n*_sweep_rate)
+    float n = _num_samples;
+    float phase = _chirp_scale * (expf(n * _sweep_rate) - 1.0f);
+
+    // fade in and out so the sweep starts and ends smoothly
+    float fade_samples = AC_SYSTEMID_FADE * AC_SYSTEMID_NUM_SAMPLES;
+    float edge = min(n, AC_SYSTEMID_NUM_SAMPLES - 1 - n);
+    float scale = 1.0f;
+    if (edge < fade_samples) {
+        scale = 0.5f - 0.5f * cosf(PI * edge / fade_samples);
+    }
+
+    return _magnitude * scale * sinf(fmodf(phase, 2.0f * PI));
+}
+
+/// add_sample - record the input reaching the motors and the resulting rate
+void AC_SystemID::add_sample(float input, float output)
+{
+    if (_state != STATE_RECORDING) {
+        return;
+    }
+    _buffer[_num_samples*2]   = input;
+    _buffer[_num_samples*2+1] = output;
+    _num_samples++;
+    if (_num_samples >= AC_SYSTEMID_NUM_SAMPLES) {
+        _step_index = 0;
+        _state = STATE_SINE_TABLE;
+    }
+}
+
+/// update - run the analysis for up to time_budget_us microseconds
+void AC_SystemID::update(uint32_t time_budget_us)
+{
+    uint32_t start_us = hal.scheduler->micros();
+
+    while (analysing() && hal.scheduler->micros() - start_us < time_budget_us) {
+        switch (_state) {
+        case STATE_SINE_TABLE:
+            if (run_sine_table(start_us, time_budget_us)) {
+                _step_index = 0;
+                _state = STATE_BIT_REVERSE;
+            }
+            break;
+        case STATE_BIT_REVERSE:
+            if (run_bit_reverse(start_us, time_budget_us)) {
+                _step_index = 0;
+                _fft_half = 1;
+                _state = STATE_FFT;
+            }
+            break;
+        case STATE_FFT:
+            if (run_fft(start_us, time_budget_us)) {
+                _step_index = 0;
+                _state = STATE_BANDS;
+            }
+            break;
+        case STATE_BANDS:
+            if (run_bands(start_us, time_budget_us)) {
+                _state = STATE_FIT;
+            }
+            break;
+        case STATE_FIT:
+            _state = run_fit() ? STATE_COMPLETE : STATE_FAILED;
+            break;
+        }
+    }
+}
+
+/*
+  the twiddle factors exp(-2*pi*j*k/N) for k from 0 to N/2, from a
+  table of a quarter wave of sin()
+ */
+float AC_SystemID::twiddle_sin(uint16_t k) const
+{
+    return k <= AC_SYSTEMID_NUM_SAMPLES/4 ? _sine[k] : _sine[AC_SYSTEMID_NUM_SAMPLES/2 - k];
+}
+
+float AC_SystemID::twiddle_cos(uint16_t k) const
+{
+    return k <= AC_SYSTEMID_NUM_SAMPLES/4 ? _sine[AC_SYSTEMID_NUM_SAMPLES/4 - k] : -_sine[k - AC_SYSTEMID_NUM_SAMPLES/4];
+}
+
+bool AC_SystemID::run_sine_table(uint32_t start_us, uint32_t time_budget_us)
+{
+    while (_step_index <= AC_SYSTEMID_NUM_SAMPLES/4) {
+        _sine[_step_index] = sinf(2.0f * PI * _step_index / AC_SYSTEMID_NUM_SAMPLES);
+        _step_index++;
+        if ((_step_index & 63) == 0 && hal.scheduler->micros() - start_us >= time_budget_us) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AC_SystemID::run_bit_reverse(uint32_t start_us, uint32_t time_budget_us)
+{
+    while (_step_index < AC_SYSTEMID_NUM_SAMPLES) {
+        uint16_t i = _step_index;
+        uint16_t j = 0;
+        for (uint16_t bit=1; bit<AC_SYSTEMID_NUM_SAMPLES; bit<<=1) {
+            j = (j << 1) | ((i & bit) ? 1 : 0);
+        }
+        if (i < j) {
+            float tr = _buffer[i*2];
+            float ti = _buffer[i*2+1];
+            _buffer[i*2]   = _buffer[j*2];
+            _buffer[i*2+1] = _buffer[j*2+1];
+            _buffer[j*2]   = tr;
+            _buffer[j*2+1] = ti;
+        }
+        _step_index++;
+        if ((_step_index & 63) == 0 && hal.scheduler->micros() - start_us >= time_budget_us) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  radix 2 decimation in time FFT, run as N/2 butterflies per stage so
+  it can stop between any two of them
+ */
+bool AC_SystemID::run_fft(uint32_t start_us, uint32_t time_budget_us)
+{
+    while (_fft_half < AC_SYSTEMID_NUM_SAMPLES) {
+        const uint16_t twiddle_step = AC_SYSTEMID_NUM_SAMPLES / (2 * _fft_half);
+        while (_step_index < AC_SYSTEMID_NUM_SAMPLES/2) {
+            uint16_t j = _step_index & (_fft_half - 1);
+            uint16_t i0 = (_step_index - j) * 2 + j;
+            uint16_t i1 = i0 + _fft_half;
+            float wr = twiddle_cos(j * twiddle_step);
+            float wi = -twiddle_sin(j * twiddle_step);
+            float tr = wr * _buffer[i1*2] - wi * _buffer[i1*2+1];
+            float ti = wr * _buffer[i1*2+1] + wi * _buffer[i1*2];
+            _buffer[i1*2]   = _buffer[i0*2] - tr;
+            _buffer[i1*2+1] = _buffer[i0*2+1] - ti;
+            _buffer[i0*2]   += tr;
+            _buffer[i0*2+1] += ti;
+            _step_index++;
+            if ((_step_index & 63) == 0 && hal.scheduler->micros() - start_us >= time_budget_us) {
+                return false;
+            }
+        }
+        _step_index = 0;
+        _fft_half <<= 1;
+    }
+    return true;
+}
+
+// the spectrum of the input (x) and output (y) at bin k, unpacked from the FFT of x + jy
+void AC_SystemID::spectrum(uint16_t k, float &xr, float &xi, float &yr, float &yi) const
+{
+    const float *z = &_buffer[k*2];
+    const float *zn = &_buffer[(AC_SYSTEMID_NUM_SAMPLES - k)*2];
+    xr = 0.5f * (z[0] + zn[0]);
+    xi = 0.5f * (z[1] - zn[1]);
+    yr = 0.5f * (z[1] + zn[1]);
+    yi = -0.5f * (z[0] - zn[0]);
+}
+
+/*
+  average the auto and cross spectra over bands spaced evenly in log
+  frequency across the sweep, with at least AC_SYSTEMID_MIN_BAND_BINS
+  bins in each
+ */
+bool AC_SystemID::run_bands(uint32_t start_us, uint32_t time_budget_us)
+{
+    const float bin_hz = _sample_rate_hz / AC_SYSTEMID_NUM_SAMPLES;
+    const float f_stop = min(_f_stop_hz, _sample_rate_hz * 0.25f);
+    const float edge_ratio = powf(f_stop / _f_start_hz, 1.0f / AC_SYSTEMID_MAX_BANDS);
+    const uint16_t k_stop = min(floorf(f_stop / bin_hz), AC_SYSTEMID_NUM_SAMPLES/2 - 1.0f);
+
+    if (_step_index == 0) {
+        _step_index = max(ceilf(_f_start_hz / bin_hz), 1.0f);
+        memset(&_band_sums, 0, sizeof(_band_sums));
+        _band_sums.edge_hz = _f_start_hz * edge_ratio;
+        _num_bands = 0;
+    }
+
+    while (_step_index <= k_stop && _num_bands < AC_SYSTEMID_MAX_BANDS) {
+        uint16_t k = _step_index++;
+        float xr, xi, yr, yi;
+        spectrum(k, xr, xi, yr, yi);
+        _band_sums.sxx += xr*xr + xi*xi;
+        _band_sums.syy += yr*yr + yi*yi;
+        _band_sums.sxy_re += xr*yr + xi*yi;
+        _band_sums.sxy_im += xr*yi - xi*yr;
+        _band_sums.freq_sum += k * bin_hz;
+        _band_sums.bins++;
+
+        float f = (k + 1) * bin_hz;
+        if (_band_sums.bins >= AC_SYSTEMID_MIN_BAND_BINS && (f >= _band_sums.edge_hz || k == k_stop)) {
+            while (_band_sums.edge_hz <= f) {
+                _band_sums.edge_hz *= edge_ratio;
+            }
+
+            struct band &b = _bands[_num_bands];
+            float sxx = _band_sums.sxx;
+            float syy = _band_sums.syy;
+            float sxy_sq = sq(_band_sums.sxy_re) + sq(_band_sums.sxy_im);
+            b.freq_hz = _band_sums.freq_sum / _band_sums.bins;
+            b.gain = sxx > 0 ? safe_sqrt(sxy_sq) / sxx : 0;
+            b.phase = degrees(atan2f(_band_sums.sxy_im, _band_sums.sxy_re));
+            b.coherence = (sxx > 0 && syy > 0) ? sxy_sq / (sxx * syy) : 0;
+            if (_num_bands > 0) {
+                // unwrap the phase from the band below
+                float prev = _bands[_num_bands-1].phase;
+                while (b.phase - prev > 180) {
+                    b.phase -= 360;
+                }
+                while (b.phase - prev < -180) {
+                    b.phase += 360;
+                }
+            }
+            _num_bands++;
+            float edge_hz = _band_sums.edge_hz;
+            memset(&_band_sums, 0, sizeof(_band_sums));
+            _band_sums.edge_hz = edge_hz;
+        }
+
+        if ((_step_index & 31) == 0 && hal.scheduler->micros() - start_us >= time_budget_us) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  fit K and tau to the magnitude of the bands with a good coherence,
+  from |H|^-2 = (w^2 + tau^2 w^4) / K^2, then the delay to the phase
+  left over by the integrator and lag
+ */
+bool AC_SystemID::run_fit()
+{
+    // normalise the frequencies by the middle of the sweep to keep the sums well conditioned
+    const float w_ref = 2.0f * PI * safe_sqrt(_f_start_hz * min(_f_stop_hz, _sample_rate_hz * 0.25f));
+    float suu = 0, suv = 0, svv = 0, su = 0, sv = 0;
+    uint8_t used = 0;
+    for (uint8_t i=0; i<_num_bands; i++) {
+        const struct band &b = _bands[i];
+        if (b.coherence < AC_SYSTEMID_COHERENCE_MIN || b.gain <= 0) {
+            continue;
+        }
+        float wn = 2.0f * PI * b.freq_hz / w_ref;
+        float g2 = b.gain * b.gain;
+        float u = wn * wn * g2;
+        float v = wn * wn * wn * wn * g2;
+        float w = b.coherence;
+        suu += w * u * u;
+        suv += w * u * v;
+        svv += w * v * v;
+        su += w * u;
+        sv += w * v;
+        used++;
+    }
+    if (used < 3) {
+        return false;
+    }
+
+    // minimise sum(w * (a*u + b*v - 1)^2)
+    float a, b;
+    float det = suu * svv - suv * suv;
+    if (fabsf(det) > 1.0e-12f * suu * svv) {
+        a = (su * svv - sv * suv) / det;
+        b = (sv * suu - su * suv) / det;
+    } else {
+        b = 0;
+    }
+    if (b <= 0) {
+        // no measurable lag, fit the integrator alone
+        a = su / suu;
+        b = 0;
+    }
+    if (a <= 0) {
+        return false;
+    }
+    _model_K = w_ref / safe_sqrt(a);
+    _model_tau = safe_sqrt(b / a) / w_ref;
+
+    // the delay is the phase beyond -90 degrees and the lag
+    float swr = 0, sww = 0, serr = 0, sw = 0;
+    for (uint8_t i=0; i<_num_bands; i++) {
+        const struct band &bd = _bands[i];
+        if (bd.coherence < AC_SYSTEMID_COHERENCE_MIN || bd.gain <= 0) {
+            continue;
+        }
+        float w = 2.0f * PI * bd.freq_hz;
+        float r = -radians(bd.phase) - PI/2 - atanf(w * _model_tau);
+        swr += bd.coherence * w * r;
+        sww += bd.coherence * w * w;
+    }
+    _model_delay = max(swr / sww, 0.0f);
+
+    // coherence weighted RMS magnitude error in dB
+    for (uint8_t i=0; i<_num_bands; i++) {
+        const struct band &bd = _bands[i];
+        if (bd.coherence < AC_SYSTEMID_COHERENCE_MIN || bd.gain <= 0) {
+            continue;
+        }
+        float w = 2.0f * PI * bd.freq_hz;
+        float model_gain = _model_K / (w * safe_sqrt(1.0f + sq(w * _model_tau)));
+        float err = 20.0f * log10f(model_gain / bd.gain);
+        serr += bd.coherence * err * err;
+        sw += bd.coherence;
+    }
+    _model_fit_error = safe_sqrt(serr / sw);
+    return true;
+}
+
+/// design_rate_gains - P and D gains for the fitted model
+bool AC_SystemID::design_rate_gains(float phase_margin_deg, float max_lead_deg, float max_crossover_hz,
+                                    float &kp, float &kd, float &crossover_hz) const
+{
+    if (_state != STATE_COMPLETE || _model_K <= 0) {
+        return false;
+    }
+
+    // the lead needed from the D term for the phase margin at w
+    const float pm = radians(phase_margin_deg);
+    const float max_lead = radians(max_lead_deg);
+#define SYSTEMID_LEAD(w) (pm - PI/2 + atanf((w) * _model_tau) + (w) * _model_delay)
+
+    // the lead grows with frequency, so take the highest crossover that needs no more than max_lead
+    float w_hi = 2.0f * PI * max_crossover_hz;
+    float w = w_hi;
+    if (SYSTEMID_LEAD(w_hi) > max_lead) {
+        float w_lo = 0;
+        for (uint8_t i=0; i<40; i++) {
+            w = 0.5f * (w_lo + w_hi);
+            if (SYSTEMID_LEAD(w) > max_lead) {
+                w_hi = w;
+            } else {
+                w_lo = w;
+            }
+        }
+        w = w_lo;
+    }
+    if (w <= 0) {
+        return false;
+    }
+    float lead = max(SYSTEMID_LEAD(w), 0.0f);
+#undef SYSTEMID_LEAD
+
+    // unity loop gain at the crossover
+    float plant_gain = _model_K / (w * safe_sqrt(1.0f + sq(w * _model_tau)));
+    float controller_gain = 1.0f / plant_gain;
+    kp = controller_gain * cosf(lead);
+    kd = controller_gain * sinf(lead) / w;
+    crossover_hz = w / (2.0f * PI);
+    return true;
+}
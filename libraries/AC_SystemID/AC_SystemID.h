@@ -0,0 +1,187 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+/// @file	AC_SystemID.h
+/// @brief	Frequency sweep system identification of one control axis
+
+#ifndef AC_SYSTEMID_H
+#define AC_SYSTEMID_H
+
+#include <AP_Common.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+
+#define AC_SYSTEMID_NUM_SAMPLES         4096    // samples recorded in one sweep, a power of two for the FFT
+#define AC_SYSTEMID_MAX_BANDS           24      // frequency bands the response is averaged over
+#define AC_SYSTEMID_MIN_BAND_BINS       4       // FFT bins averaged in each band, so that its coherence means something
+#define AC_SYSTEMID_FADE                0.05f   // fraction of the sweep the chirp fades in and out over
+#define AC_SYSTEMID_COHERENCE_MIN       0.6f    // bands with a lower coherence are not used to fit the model
+
+#define AC_SYSTEMID_AXIS_DEFAULT        1       // roll
+#define AC_SYSTEMID_MAGNITUDE_DEFAULT   400.0f  // chirp amplitude in motor output units (4500 is full scale)
+#define AC_SYSTEMID_F_START_DEFAULT     0.5f    // chirp start frequency in Hz
+#define AC_SYSTEMID_F_STOP_DEFAULT      30.0f   // chirp stop frequency in Hz
+
+/// @class	AC_SystemID
+/// @brief	Identifies the response of a vehicle axis to a frequency sweep
+///
+/// A chirp sweeping exponentially from SID_F_START_HZ to SID_F_STOP_HZ
+/// is added to the controller output on one axis. The input reaching the
+/// motors and the body rate are recorded at the full loop rate into a
+/// RAM buffer. Once the buffer is full update() works through an FFT of
+/// both in slices of a given time budget, averages the cross spectrum
+/// over frequency bands to give the frequency response and its coherence,
+/// and fits the model
+///
+///   rate/input = K * exp(-s*delay) / (s * (tau*s + 1))
+///
+/// to the bands with a good coherence, from which rate controller gains
+/// can be worked out by design_rate_gains()
+class AC_SystemID {
+public:
+
+    // axes that can be identified
+    enum axis_type {
+        AXIS_NONE  = 0,
+        AXIS_ROLL  = 1,
+        AXIS_PITCH = 2,
+        AXIS_YAW   = 3
+    };
+
+    // the frequency response over one band
+    struct band {
+        float freq_hz;      // centre frequency
+        float gain;         // output per unit input
+        float phase;        // degrees, unwrapped from the lowest band
+        float coherence;    // 0 to 1
+    };
+
+    /// Constructor
+    AC_SystemID();
+
+    /// axis - the axis to identify, see axis_type
+    uint8_t axis() const { return _axis; }
+
+    /// start - start recording a sweep of samples taken at sample_rate_hz
+    ///  returns false if the parameters are invalid or the buffer can't be allocated
+    bool start(float sample_rate_hz);
+
+    /// stop - abandon the sweep or analysis
+    void stop();
+
+    /// recording - true while samples are wanted
+    bool recording() const { return _state == STATE_RECORDING; }
+
+    /// analysing - true while update() has work to do
+    bool analysing() const { return _state > STATE_RECORDING && _state < STATE_COMPLETE; }
+
+    /// complete - true once the model has been fitted
+    bool complete() const { return _state == STATE_COMPLETE; }
+
+    /// failed - true if the analysis finished without a usable model
+    bool failed() const { return _state == STATE_FAILED; }
+
+    /// chirp - the chirp to add to the input for the next sample, in motor output units
+    float chirp() const;
+
+    /// add_sample - record the input reaching the motors (including the chirp) and the resulting rate
+    ///  recording stops when the buffer is full
+    void add_sample(float input, float output);
+
+    /// sample_index - number of samples recorded so far
+    uint16_t sample_index() const { return _num_samples; }
+
+    /// update - run the analysis for up to time_budget_us microseconds
+    void update(uint32_t time_budget_us);
+
+    /// num_bands - number of bands in the frequency response
+    uint8_t num_bands() const { return _num_bands; }
+
+    /// get_band - frequency response over one band
+    const struct band &get_band(uint8_t i) const { return _bands[i]; }
+
+    /// model - the fitted model, valid once complete
+    float model_gain() const { return _model_K; }
+    float model_tau() const { return _model_tau; }
+    float model_delay() const { return _model_delay; }
+
+    /// model_fit_error - coherence weighted RMS error of the fitted model's magnitude in dB
+    float model_fit_error() const { return _model_fit_error; }
+
+    /// design_rate_gains - P and D gains giving the fitted model the requested phase margin at the highest
+    ///  crossover frequency that needs no more than max_lead_deg of phase lead from the D term and is no
+    ///  higher than max_crossover_hz. With max_lead_deg zero the design is P only
+    ///  returns false if no model has been fitted
+    bool design_rate_gains(float phase_margin_deg, float max_lead_deg, float max_crossover_hz,
+                           float &kp, float &kd, float &crossover_hz) const;
+
+    static const struct AP_Param::GroupInfo        var_info[];
+
+private:
+
+    enum state_type {
+        STATE_IDLE = 0,
+        STATE_RECORDING,
+        STATE_SINE_TABLE,
+        STATE_BIT_REVERSE,
+        STATE_FFT,
+        STATE_BANDS,
+        STATE_FIT,
+        STATE_COMPLETE,
+        STATE_FAILED
+    };
+
+    // parameters
+    AP_Int8         _axis;              // axis to identify
+    AP_Float        _magnitude;         // chirp amplitude
+    AP_Float        _f_start_hz;        // chirp start frequency
+    AP_Float        _f_stop_hz;         // chirp stop frequency
+
+    // sin() of a quarter wave at the FFT's angle step, the twiddle factors come from this
+    float           twiddle_sin(uint16_t k) const;
+    float           twiddle_cos(uint16_t k) const;
+
+    // analysis steps, each returns when done or out of time
+    bool            run_sine_table(uint32_t start_us, uint32_t time_budget_us);
+    bool            run_bit_reverse(uint32_t start_us, uint32_t time_budget_us);
+    bool            run_fft(uint32_t start_us, uint32_t time_budget_us);
+    bool            run_bands(uint32_t start_us, uint32_t time_budget_us);
+    bool            run_fit();
+
+    // the spectrum of the input (x) and output (y) at bin k, unpacked from the FFT of x + jy
+    void            spectrum(uint16_t k, float &xr, float &xi, float &yr, float &yi) const;
+
+    volatile uint8_t _state;
+    float           _sample_rate_hz;
+    float           _sweep_rate;        // ln(f_stop/f_start) per sample
+    float           _chirp_scale;       // 2*pi*f_start/(sample_rate*_sweep_rate)
+    uint16_t        _num_samples;
+
+    // x + jy for each sample, as interleaved real and imaginary parts. Allocated by the first start()
+    float           *_buffer;
+    float           *_sine;             // AC_SYSTEMID_NUM_SAMPLES/4+1 entries
+
+    // progress through the analysis
+    uint16_t        _step_index;
+    uint16_t        _fft_half;          // half size of the butterflies in the current FFT stage
+
+    // sums over the band being averaged
+    struct {
+        float       sxx;
+        float       syy;
+        float       sxy_re;
+        float       sxy_im;
+        float       freq_sum;
+        float       edge_hz;            // frequency the band ends at
+        uint8_t     bins;
+    } _band_sums;
+
+    struct band     _bands[AC_SYSTEMID_MAX_BANDS];
+    uint8_t         _num_bands;
+
+    float           _model_K;
+    float           _model_tau;
+    float           _model_delay;
+    float           _model_fit_error;
+};
+
+#endif // AC_SYSTEMID_H
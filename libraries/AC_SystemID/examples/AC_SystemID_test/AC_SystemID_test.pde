@@ -0,0 +1,148 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Runs AC_SystemID on a simulated axis with a known response, the way
+// the copter SystemID flight mode does: the chirp is added to the output
+// of a rate P controller at 400Hz and the motor input and noisy gyro
+// rate are recorded. The analysis is then run in 1ms slices and the
+// fitted model is compared with the simulated one.
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_FLYMAPLE.h>
+#include <AP_HAL_PX4.h>
+#include <AP_HAL_Empty.h>
+#include <GCS_MAVLink.h>
+#include <StorageManager.h>
+#include <AC_SystemID.h>
+#include <AP_Scheduler.h>
+#include <DataFlash.h>
+#include <AP_GPS.h>
+#include <AP_Vehicle.h>
+#include <AP_InertialSensor.h>
+#include <Filter.h>
+#include <AP_Baro.h>
+#include <AP_AHRS.h>
+#include <AP_Compass.h>
+#include <AP_Declination.h>
+#include <AP_Airspeed.h>
+#include <AP_NavEKF.h>
+#include <AP_ADC.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_Notify.h>
+#include <AP_Mission.h>
+#include <AP_Terrain.h>
+#include <AP_Rally.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define LOOP_RATE       400
+#define DT              (1.0f / LOOP_RATE)
+
+// simulated axis, rate in centi-degrees/sec for a motor output in +-4500
+#define PLANT_K         200.0f      // angular acceleration per unit output
+#define PLANT_TAU       0.025f      // motor lag in seconds
+#define PLANT_DELAY     4           // samples of delay between output and gyro
+#define GYRO_NOISE      150.0f      // peak gyro noise in centi-degrees/sec
+#define RATE_P          0.15f
+
+static AC_SystemID sysid;
+
+// uniform noise between -1 and 1
+static float noise(void)
+{
+    static uint32_t seed = 1;
+    seed = seed * 1664525UL + 1013904223UL;
+    return (seed >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// fly the sweep, returns the number of samples recorded
+static uint16_t record(void)
+{
+    float delay_line[PLANT_DELAY] = {};
+    uint8_t delay_index = 0;
+    float motor = 0;
+    float rate = 0;
+    float gyro = 0;
+
+    while (sysid.recording()) {
+        // the rate controller's output plus the chirp, as sent to the motors
+        float input = RATE_P * -gyro + sysid.chirp();
+        sysid.add_sample(input, gyro);
+
+        // delayed motor lag and the body integrating it
+        float delayed = delay_line[delay_index];
+        delay_line[delay_index] = input;
+        delay_index = (delay_index + 1) % PLANT_DELAY;
+        motor += (delayed - motor) * DT / PLANT_TAU;
+        rate += PLANT_K * motor * DT;
+        gyro = rate + GYRO_NOISE * noise();
+    }
+    return sysid.sample_index();
+}
+
+static bool check(const char *name, float value, float expected, float tolerance)
+{
+    bool ok = fabsf(value - expected) <= tolerance;
+    hal.console->printf_P(PSTR("%-6s %9.4f expected %9.4f %s\n"), name, value, expected, ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+void setup(void)
+{
+    hal.console->println("AC_SystemID test");
+}
+
+void loop(void)
+{
+    if (!sysid.start(LOOP_RATE)) {
+        hal.console->println("start failed");
+        hal.scheduler->delay(1000);
+        return;
+    }
+    uint16_t samples = record();
+
+    uint16_t slices = 0;
+    uint32_t start_time = hal.scheduler->micros();
+    while (sysid.analysing()) {
+        sysid.update(1000);
+        slices++;
+    }
+    uint32_t analysis_time = hal.scheduler->micros() - start_time;
+
+    hal.console->printf_P(PSTR("%u samples, analysed in %lu usec over %u slices\n"),
+                          (unsigned)samples, (unsigned long)analysis_time, (unsigned)slices);
+    if (!sysid.complete()) {
+        hal.console->println("analysis FAILED\n");
+        hal.scheduler->delay(1000);
+        return;
+    }
+
+    hal.console->println("  freq     gain    phase  coherence");
+    for (uint8_t i=0; i<sysid.num_bands(); i++) {
+        const AC_SystemID::band &b = sysid.get_band(i);
+        hal.console->printf_P(PSTR("%6.2f %8.4f %8.1f %6.3f\n"), b.freq_hz, b.gain, b.phase, b.coherence);
+    }
+
+    // the gyro is read a loop after the output and the Euler integration takes some of that back, so allow a sample either way
+    check("K", sysid.model_gain(), PLANT_K, PLANT_K * 0.02f);
+    // the Euler step makes the simulated lag that of a slightly shorter time constant
+    float tau = -DT / logf(1 - DT / PLANT_TAU);
+    check("tau", sysid.model_tau(), tau, tau * 0.1f);
+    check("delay", sysid.model_delay(), PLANT_DELAY * DT, DT);
+    hal.console->printf_P(PSTR("fit error %.2f dB\n"), sysid.model_fit_error());
+
+    float kp, kd, crossover_hz;
+    if (sysid.design_rate_gains(50, 45, 15, kp, kd, crossover_hz)) {
+        hal.console->printf_P(PSTR("rate P %.4f D %.5f crossover %.2f Hz\n\n"), kp, kd, crossover_hz);
+    }
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
@@ -97,6 +97,23 @@ const AP_Param::GroupInfo AC_WPNav::var_info[] PROGMEM = {
     // @User: Advanced
     AP_GROUPINFO("LOIT_MINA",   9, AC_WPNav, _loiter_accel_min_cmss, WPNAV_LOITER_ACCEL_MIN),
 
+    // @Param: LOOKAHEAD
+    // @DisplayName: Waypoint look-ahead
+    // @Description: Number of upcoming waypoints the look-ahead planner uses to work out how fast the vehicle can fly through each waypoint instead of stopping at it.  Set to 0 to disable the planner
+    // @Range: 0 6
+    // @Increment: 1
+    // @User: Advanced
+    AP_GROUPINFO("LOOKAHEAD",  10, AC_WPNav, _wp_lookahead, 0),
+
+    // @Param: JERK
+    // @DisplayName: Waypoint jerk
+    // @Description: Jerk in cm/s/s/s used by the look-ahead planner when speeding up and slowing down between waypoints.  Set to 0 for constant acceleration
+    // @Units: cm/s/s/s
+    // @Range: 0 5000
+    // @Increment: 10
+    // @User: Advanced
+    AP_GROUPINFO("JERK",       11, AC_WPNav, _wp_jerk_cmsss, WPNAV_WP_JERK_DEFAULT),
+
     AP_GROUPEND
 };
 
@@ -121,8 +138,14 @@ AC_WPNav::AC_WPNav(const AP_InertialNav& inav, const AP_AHRS& ahrs, AC_PosContro
     _track_speed(0.0f),
     _track_leash_length(0.0f),
     _slow_down_dist(0.0f),
+    _track_accel_ramp(0.0f),
+    _lookahead_num(0),
+    _lookahead_active(false),
+    _lookahead_exit_speed(0.0f),
     _spline_time(0.0f),
-    _spline_time_scale(0.0f),
+    _spline_dist(0.0f),
+    _spline_length(0.0f),
+    _spline_table_index(0),
     _spline_vel_scaler(0.0f),
     _yaw(0.0f)
 {
@@ -420,6 +443,9 @@ void AC_WPNav::set_wp_destination(const Vector3f& destination)
 /// set_origin_and_destination - set origin and destination waypoints using position vectors (distance from home in cm)
 void AC_WPNav::set_wp_origin_and_destination(const Vector3f& origin, const Vector3f& destination)
 {
+    // a leg the look-ahead planner passed through hands its target's speed on to the next leg
+    bool carry_speed = _flags.reached_destination && lookahead_passing() && ((hal.scheduler->millis() - _wp_last_update) < 1000);
+
     // store origin and destination locations
     _origin = origin;
     _destination = destination;
@@ -456,12 +482,21 @@ void AC_WPNav::set_wp_origin_and_destination(const Vector3f& origin, const Vecto
     _flags.slowing_down = false;    // target is not slowing down yet
     _flags.segment_type = SEGMENT_STRAIGHT;
     _flags.new_wp_destination = true;   // flag new waypoint so we can freeze the pos controller's feed forward and smooth the transition
+    _track_accel_ramp = 0.0f;
 
-    // initialise the limited speed to current speed along the track
-    const Vector3f &curr_vel = _inav.get_velocity();
-    // get speed along track (note: we convert vertical speed into horizontal speed equivalent)
-    float speed_along_track = curr_vel.x * _pos_delta_unit.x + curr_vel.y * _pos_delta_unit.y + curr_vel.z * _pos_delta_unit.z;
-    _limited_speed_xy_cms = constrain_float(speed_along_track,0,_wp_speed_cms);
+    // move the look-ahead plan on to this leg
+    lookahead_advance(destination);
+
+    if (carry_speed) {
+        // the planner limited the target to a speed the corner can be taken at
+        _limited_speed_xy_cms = constrain_float(_limited_speed_xy_cms,0,_wp_speed_cms);
+    } else {
+        // initialise the limited speed to current speed along the track
+        const Vector3f &curr_vel = _inav.get_velocity();
+        // get speed along track (note: we convert vertical speed into horizontal speed equivalent)
+        float speed_along_track = curr_vel.x * _pos_delta_unit.x + curr_vel.y * _pos_delta_unit.y + curr_vel.z * _pos_delta_unit.z;
+        _limited_speed_xy_cms = constrain_float(speed_along_track,0,_wp_speed_cms);
+    }
 }
 
 /// shift_wp_origin_to_current_pos - shifts the origin and destination so the origin starts at the current position
@@ -562,14 +597,29 @@ void AC_WPNav::advance_wp_target_along_track(float dt)
         _limited_speed_xy_cms = 0;
     }else{
         // increase intermediate target point's velocity if not yet at the leash limit
+        float prev_speed = _limited_speed_xy_cms;
         if(dt > 0 && !reached_leash_limit) {
-            _limited_speed_xy_cms += 2.0f * _track_accel * dt;
+            if (_lookahead_active && _wp_jerk_cmsss > 0.0f) {
+                // ramp up the acceleration at the look-ahead planner's jerk limit
+                _track_accel_ramp = min(_track_accel_ramp + _wp_jerk_cmsss * dt, 2.0f * _track_accel);
+                _limited_speed_xy_cms += _track_accel_ramp * dt;
+            }else{
+                _limited_speed_xy_cms += 2.0f * _track_accel * dt;
+            }
         }
         // do not allow speed to be below zero or over top speed
         _limited_speed_xy_cms = constrain_float(_limited_speed_xy_cms, 0.0f, _track_speed);
 
         // check if we should begin slowing down
-        if (!_flags.fast_waypoint) {
+        if (_lookahead_active) {
+            // slow to the speed the look-ahead planner has calculated for the end of the leg
+            float dist_to_dest = _track_length - _track_desired;
+            float max_speed = max(get_max_entry_speed(_lookahead_exit_speed, dist_to_dest, _track_accel, _wp_jerk_cmsss), WPNAV_WP_TRACK_SPEED_MIN);
+            if (_limited_speed_xy_cms > max_speed) {
+                _limited_speed_xy_cms = max_speed;
+                _flags.slowing_down = true;
+            }
+        }else if (!_flags.fast_waypoint) {
             float dist_to_dest = _track_length - _track_desired;
             if (!_flags.slowing_down && dist_to_dest <= _slow_down_dist) {
                 _flags.slowing_down = true;
@@ -584,6 +634,11 @@ void AC_WPNav::advance_wp_target_along_track(float dt)
         if (fabsf(speed_along_track) < linear_velocity) {
             _limited_speed_xy_cms = constrain_float(_limited_speed_xy_cms,speed_along_track-linear_velocity,speed_along_track+linear_velocity);
         }
+
+        // restart the acceleration ramp whenever the target stops speeding up
+        if (_limited_speed_xy_cms <= prev_speed) {
+            _track_accel_ramp = 0.0f;
+        }
     }
     // advance the current target
     if (!reached_leash_limit) {
@@ -599,8 +654,9 @@ void AC_WPNav::advance_wp_target_along_track(float dt)
     	}
     }
 
-    // do not let desired point go past the end of the track unless it's a fast waypoint
-    if (!_flags.fast_waypoint) {
+    // do not let desired point go past the end of the track unless it's a fast waypoint or the planner passes through it
+    bool pass_through = _flags.fast_waypoint || lookahead_passing();
+    if (!pass_through) {
         _track_desired = constrain_float(_track_desired, 0, _track_length);
     } else {
         _track_desired = constrain_float(_track_desired, 0, _track_length + WPNAV_WP_FAST_OVERSHOOT_MAX);
@@ -612,8 +668,8 @@ void AC_WPNav::advance_wp_target_along_track(float dt)
     // check if we've reached the waypoint
     if( !_flags.reached_destination ) {
         if( _track_desired >= _track_length ) {
-            // "fast" waypoints are complete once the intermediate point reaches the destination
-            if (_flags.fast_waypoint) {
+            // "fast" waypoints and those the planner passes through are complete once the intermediate point reaches the destination
+            if (pass_through) {
                 _flags.reached_destination = true;
             }else{
                 // regular waypoints also require the copter to be within the waypoint radius
@@ -726,6 +782,158 @@ void AC_WPNav::calculate_wp_leash_length()
     _flags.recalc_wp_leash = false;
 }
 
+///
+/// look-ahead planner
+///
+
+/// get_lookahead - returns the number of waypoints the planner should be given, zero if look-ahead is disabled
+uint8_t AC_WPNav::get_lookahead() const
+{
+    return constrain_int16(_wp_lookahead, 0, WPNAV_LOOKAHEAD_MAX);
+}
+
+/// lookahead_reset - discards all waypoints held by the planner
+void AC_WPNav::lookahead_reset()
+{
+    _lookahead_num = 0;
+    _lookahead_active = false;
+    _lookahead_exit_speed = 0.0f;
+}
+
+/// lookahead_push - adds a waypoint (distance from home in cm) to the end of the plan
+///     stop should be true if the vehicle must stop at the waypoint.  returns false if the plan is full
+bool AC_WPNav::lookahead_push(uint16_t id, const Vector3f& position, bool stop)
+{
+    if (_lookahead_num >= WPNAV_LOOKAHEAD_MAX) {
+        return false;
+    }
+    lookahead_wp &wp = _lookahead[_lookahead_num++];
+    wp.pos = position;
+    wp.speed = 0.0f;
+    wp.id = id;
+    wp.stop = stop;
+    return true;
+}
+
+/// lookahead_update - recalculates the speed at each waypoint held by the planner
+///     should be called at 10hz or less, after adding waypoints
+void AC_WPNav::lookahead_update()
+{
+    // the plan is only used if it begins with the current leg's destination
+    if (_lookahead_num == 0 || get_lookahead() == 0 || (_lookahead[0].pos - _destination).length() > 1.0f) {
+        _lookahead_active = false;
+        _lookahead_exit_speed = 0.0f;
+        return;
+    }
+
+    // speed limit at each waypoint from the change of direction.  the last waypoint is treated as a stop
+    // because nothing is known of the path beyond it
+    for (uint8_t i=0; i<_lookahead_num; i++) {
+        lookahead_wp &wp = _lookahead[i];
+        wp.speed = 0.0f;
+        if (wp.stop || i == _lookahead_num-1) {
+            continue;
+        }
+        Vector3f leg_in = wp.pos - (i == 0 ? _origin : _lookahead[i-1].pos);
+        Vector3f leg_out = _lookahead[i+1].pos - wp.pos;
+        float length_in = leg_in.length();
+        float length_out = leg_out.length();
+        if (length_in <= 0.0f || length_out <= 0.0f) {
+            continue;
+        }
+        leg_in /= length_in;
+        leg_out /= length_out;
+        float speed_in = get_track_limit(leg_in, _wp_speed_cms, _wp_speed_up_cms, _wp_speed_down_cms);
+        float speed_out = get_track_limit(leg_out, _wp_speed_cms, _wp_speed_up_cms, _wp_speed_down_cms);
+        wp.speed = min(min(speed_in, speed_out), _wp_speed_cms);
+
+        // sine of half the angle between the legs, 1 when they are in line and 0 when the path reverses.  the speed is
+        // that of an arc tangent to both legs which passes no further than the waypoint radius from the waypoint
+        float sin_half = safe_sqrt(0.5f * (1.0f + leg_in * leg_out));
+        if (sin_half < 0.999f) {
+            wp.speed = min(wp.speed, safe_sqrt(_wp_accel_cms * _wp_radius_cm * sin_half / (1.0f - sin_half)));
+        }
+    }
+
+    // working back from the end, limit each waypoint's speed to one the target can slow down from before the next waypoint
+    for (int8_t i=_lookahead_num-2; i>=0; i--) {
+        Vector3f leg = _lookahead[i+1].pos - _lookahead[i].pos;
+        float length = leg.length();
+        if (length <= 0.0f) {
+            _lookahead[i].speed = min(_lookahead[i].speed, _lookahead[i+1].speed);
+            continue;
+        }
+        float accel = get_track_limit(leg/length, _wp_accel_cms, _wp_accel_z_cms, _wp_accel_z_cms);
+        _lookahead[i].speed = min(_lookahead[i].speed, get_max_entry_speed(_lookahead[i+1].speed, length, accel, _wp_jerk_cmsss));
+    }
+
+    _lookahead_exit_speed = _lookahead[0].speed;
+    _lookahead_active = true;
+}
+
+/// lookahead_advance - moves the plan on to a new leg ending at destination.  called when the leg changes
+void AC_WPNav::lookahead_advance(const Vector3f& destination)
+{
+    // drop the waypoint just reached if the plan continues to this leg's destination
+    if (_lookahead_num > 1 && (_lookahead[1].pos - destination).length() <= 1.0f) {
+        for (uint8_t i=1; i<_lookahead_num; i++) {
+            _lookahead[i-1] = _lookahead[i];
+        }
+        _lookahead_num--;
+    }
+
+    // recalculate with the new origin so the first leg's speeds are right before the vehicle's next update
+    lookahead_update();
+}
+
+/// get_track_limit - returns the speed or acceleration limit along a unit direction given its horizontal, up and down limits
+float AC_WPNav::get_track_limit(const Vector3f& unit, float limit_xy, float limit_up, float limit_down) const
+{
+    float unit_xy = pythagorous2(unit.x, unit.y);
+    float unit_z = fabsf(unit.z);
+    float limit_z = (unit.z >= 0.0f) ? limit_up : limit_down;
+
+    if (unit_xy <= 0.0f && unit_z <= 0.0f) {
+        return 0.0f;
+    }else if (unit_z <= 0.0f) {
+        return limit_xy/unit_xy;
+    }else if (unit_xy <= 0.0f) {
+        return limit_z/unit_z;
+    }
+    return min(limit_xy/unit_xy, limit_z/unit_z);
+}
+
+/// get_max_entry_speed - returns the highest speed from which a jerk limited deceleration over dist_cm ends at exit_speed_cms
+///     a jerk of zero gives a constant deceleration
+float AC_WPNav::get_max_entry_speed(float exit_speed_cms, float dist_cm, float accel_cmss, float jerk_cmsss)
+{
+    if (dist_cm <= 0.0f || accel_cmss <= 0.0f) {
+        return exit_speed_cms;
+    }
+
+    // constant deceleration
+    if (jerk_cmsss <= 0.0f) {
+        return safe_sqrt(exit_speed_cms*exit_speed_cms + 2.0f*accel_cmss*dist_cm);
+    }
+
+    // speed lost while the deceleration ramps up to accel and straight back down again
+    float ramp_speed = accel_cmss*accel_cmss/jerk_cmsss;
+
+    if (dist_cm >= (2.0f*exit_speed_cms + ramp_speed)*accel_cmss/jerk_cmsss) {
+        // the deceleration reaches accel, covering dist = (v1+v0)/2 * ((v1-v0)/accel + accel/jerk)
+        float c = exit_speed_cms*ramp_speed - exit_speed_cms*exit_speed_cms - 2.0f*accel_cmss*dist_cm;
+        return 0.5f*(-ramp_speed + safe_sqrt(ramp_speed*ramp_speed - 4.0f*c));
+    }
+
+    // the deceleration ramps up and down again over 2t without reaching accel, covering dist = (2*v0 + jerk*t^2)*t
+    // t is the single real root of t^3 + p*t + q = 0
+    float p = 2.0f*exit_speed_cms/jerk_cmsss;
+    float q = -dist_cm/jerk_cmsss;
+    float r = safe_sqrt(0.25f*q*q + p*p*p/27.0f);
+    float t = cbrtf(r - 0.5f*q) - cbrtf(r + 0.5f*q);
+    return exit_speed_cms + jerk_cmsss*t*t;
+}
+
 ///
 /// spline methods
 ///
@@ -773,7 +981,7 @@ void AC_WPNav::set_spline_origin_and_destination(const Vector3f& origin, const V
     if (stopped_at_start || !prev_segment_exists) {
     	// if vehicle is stopped at the origin, set origin velocity to 0.1 * distance vector from origin to destination
     	_spline_origin_vel = (destination - origin) * 0.1f;
-    	_spline_time = 0.0f;
+    	_spline_dist = 0.0f;
     	_spline_vel_scaler = 0.0f;
     }else{
     	// look at previous segment to determine velocity at origin
@@ -781,7 +989,7 @@ void AC_WPNav::set_spline_origin_and_destination(const Vector3f& origin, const V
             // previous segment is straight, vehicle is moving so vehicle should fly straight through the origin
             // before beginning it's spline path to the next waypoint. Note: we are using the previous segment's origin and destination
             _spline_origin_vel = (_destination - _origin);
-            _spline_time = 0.0f;	// To-Do: this should be set based on how much overrun there was from straight segment?
+            _spline_dist = 0.0f;	// To-Do: this should be set based on how much overrun there was from straight segment?
             _spline_vel_scaler = _pos_control.get_vel_target().length();    // start velocity target from current target velocity
         }else{
             // previous segment is splined, vehicle will fly through origin
@@ -789,10 +997,12 @@ void AC_WPNav::set_spline_origin_and_destination(const Vector3f& origin, const V
             // Note: previous segment will leave destination velocity parallel to position difference vector
             //       from previous segment's origin to this segment's destination)
             _spline_origin_vel = _spline_destination_vel;
-            if (_spline_time > 1.0f && _spline_time < 1.1f) {    // To-Do: remove hard coded 1.1f
-                _spline_time -= 1.0f;
+            // carry over how far the target went past the end of the previous segment
+            float overrun = _spline_dist - _spline_length;
+            if (overrun > 0.0f && overrun < _spline_length * 0.1f) {    // To-Do: remove hard coded 0.1f
+                _spline_dist = overrun;
             }else{
-                _spline_time = 0.0f;
+                _spline_dist = 0.0f;
             }
             // Note: we leave _spline_vel_scaler as it was from end of previous segment
         }
@@ -858,7 +1068,7 @@ void AC_WPNav::set_spline_dest_and_vel(const Vector3f& dest_pos, const Vector3f&
         _wp_accel_cms.set_and_save(WPNAV_ACCELERATION);
     }
 
-    _spline_time = 0.0f;
+    _spline_dist = 0.0f;
 
     _origin = _inav.get_position();
     _destination = dest_pos;
@@ -943,7 +1153,25 @@ void AC_WPNav::update_spline_solution(const Vector3f& origin, const Vector3f& de
     _hermite_spline_solution[1] = origin_vel;
     _hermite_spline_solution[2] = -origin*3.0f -origin_vel*2.0f + dest*3.0f - dest_vel;
     _hermite_spline_solution[3] = origin*2.0f + origin_vel -dest*2.0f + dest_vel;
- }
+
+    // build the table of distance along the segment against spline
+    // time, integrating the speed over each interval with Simpson's rule
+    Vector3f pos, vel;
+    float dt = 1.0f / WPNAV_SPLINE_TABLE_SIZE;
+    calc_spline_pos_vel(0.0f, pos, vel);
+    float speed_start = vel.length();
+    _spline_table[0] = 0.0f;
+    for (uint8_t i=1; i<=WPNAV_SPLINE_TABLE_SIZE; i++) {
+        calc_spline_pos_vel((i-0.5f)*dt, pos, vel);
+        float speed_mid = vel.length();
+        calc_spline_pos_vel(i*dt, pos, vel);
+        float speed_end = vel.length();
+        _spline_table[i] = _spline_table[i-1] + (speed_start + 4.0f*speed_mid + speed_end) * dt / 6.0f;
+        speed_start = speed_end;
+    }
+    _spline_length = _spline_table[WPNAV_SPLINE_TABLE_SIZE];
+    _spline_table_index = 0;
+}
 
 /// advance_spline_target_along_track - move target location along track from origin to destination
 void AC_WPNav::advance_spline_target_along_track(float dt)
@@ -952,18 +1180,18 @@ void AC_WPNav::advance_spline_target_along_track(float dt)
         Vector3f target_pos, target_vel;
 
         // update target position and velocity from spline calculator
+        _spline_time = calc_spline_time(_spline_dist);
         calc_spline_pos_vel(_spline_time, target_pos, target_vel);
 
         // update velocity
-        float spline_dist_to_wp = (_destination - target_pos).length();
+        float spline_dist_to_wp = _spline_length - _spline_dist;
 
         // if within the stopping distance from destination, set target velocity to sqrt of distance * 2 * acceleration
         if (!_flags.fast_waypoint && spline_dist_to_wp < _slow_down_dist) {
             _spline_vel_scaler = safe_sqrt(spline_dist_to_wp * 2.0f * _wp_accel_cms);
         }else if(_spline_vel_scaler < _wp_speed_cms) {
             // increase velocity using acceleration
-        	// To-Do: replace 0.1f below with update frequency passed in from main program
-            _spline_vel_scaler += _wp_accel_cms* 0.1f;
+            _spline_vel_scaler += _wp_accel_cms * dt;
         }
 
         // constrain target velocity
@@ -971,24 +1199,18 @@ void AC_WPNav::advance_spline_target_along_track(float dt)
             _spline_vel_scaler = _wp_speed_cms;
         }
 
-        // scale the spline_time by the velocity we've calculated vs the velocity that came out of the spline calculator
-        float target_vel_length = target_vel.length();
-        if (target_vel_length != 0.0f) {
-            _spline_time_scale = _spline_vel_scaler/target_vel_length;
-        }
-
         // update target position
         _pos_control.set_pos_target(target_pos);
 
         // update the yaw
         _yaw = RadiansToCentiDegrees(fast_atan2(target_vel.y,target_vel.x));
 
-        // advance spline time to next step
-        _spline_time += _spline_time_scale*dt;
+        // advance the target along the spline
+        _spline_dist += _spline_vel_scaler*dt;
 
         // we will reach the next waypoint in the next step so set reached_destination flag
         // To-Do: is this one step too early?
-        if (_spline_time >= 1.0f) {
+        if (_spline_dist >= _spline_length) {
             _flags.reached_destination = true;
         }
     }
@@ -1012,6 +1234,36 @@ void AC_WPNav::calc_spline_pos_vel(float spline_time, Vector3f& position, Vector
 }
 
 
+// calc_spline_time - returns the spline time at the given distance along the segment
+///     looks up the distance in the arc length table built by update_spline_solution and
+///     interpolates within the interval, so the target moves at an even speed along the path
+float AC_WPNav::calc_spline_time(float dist)
+{
+    if (dist <= 0.0f) {
+        return 0.0f;
+    }
+    if (dist >= _spline_length) {
+        return 1.0f;
+    }
+
+    // the target normally stays in or moves forward from the last interval
+    uint8_t i = _spline_table_index;
+    while (i > 0 && dist < _spline_table[i]) {
+        i--;
+    }
+    while (i < WPNAV_SPLINE_TABLE_SIZE-1 && dist >= _spline_table[i+1]) {
+        i++;
+    }
+    _spline_table_index = i;
+
+    float interval = _spline_table[i+1] - _spline_table[i];
+    float frac = 0.0f;
+    if (interval > 0.0f) {
+        frac = (dist - _spline_table[i]) / interval;
+    }
+    return (i + frac) / WPNAV_SPLINE_TABLE_SIZE;
+}
+
 ///
 /// shared methods
 ///
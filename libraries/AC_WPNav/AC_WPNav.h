@@ -43,6 +43,11 @@
 
 #define WPNAV_LOITER_ACTIVE_TIMEOUT_MS     200      // loiter controller is considered active if it has been called within the past 200ms (0.2 seconds)
 
+#define WPNAV_SPLINE_TABLE_SIZE             16      // number of intervals in the arc length table of each spline segment
+
+#define WPNAV_LOOKAHEAD_MAX                  6      // maximum number of waypoints the look-ahead planner plans across
+#define WPNAV_WP_JERK_DEFAULT           1000.0f      // default jerk in cm/s/s/s used by the look-ahead planner
+
 #define WPNAV_YAW_DIST_MIN                 200      // minimum track length which will lead to target yaw being updated to point at next waypoint.  Under this distance the yaw target will be frozen at the current heading
 
 class AC_WPNav
@@ -174,6 +179,39 @@ public:
     /// calculate_wp_leash_length - calculates track speed, acceleration and leash lengths for waypoint controller
     void calculate_wp_leash_length();
 
+    ///
+    /// look-ahead planner
+    ///     the vehicle passes the destination of the current leg and the waypoints after it to the planner, which calculates
+    ///     the speed the target can pass through each of them at.  the waypoint controller then slows to that speed at the
+    ///     end of the leg instead of stopping or flying through at full speed
+    ///
+
+    /// get_lookahead - returns the number of waypoints the planner should be given, zero if look-ahead is disabled
+    uint8_t get_lookahead() const;
+
+    /// lookahead_reset - discards all waypoints held by the planner
+    void lookahead_reset();
+
+    /// lookahead_num - returns the number of waypoints held by the planner
+    uint8_t lookahead_num() const { return _lookahead_num; }
+
+    /// lookahead_id - returns the caller's identifier (i.e. mission command index) of a waypoint held by the planner
+    uint16_t lookahead_id(uint8_t i) const { return _lookahead[i].id; }
+
+    /// lookahead_pos - returns the position (distance from home in cm) of a waypoint held by the planner
+    const Vector3f& lookahead_pos(uint8_t i) const { return _lookahead[i].pos; }
+
+    /// lookahead_ends_in_stop - true if the last waypoint held by the planner is one the vehicle must stop at
+    bool lookahead_ends_in_stop() const { return _lookahead_num > 0 && _lookahead[_lookahead_num-1].stop; }
+
+    /// lookahead_push - adds a waypoint (distance from home in cm) to the end of the plan
+    ///     stop should be true if the vehicle must stop at the waypoint.  returns false if the plan is full
+    bool lookahead_push(uint16_t id, const Vector3f& position, bool stop);
+
+    /// lookahead_update - recalculates the speed at each waypoint held by the planner
+    ///     should be called at 10hz or less, after adding waypoints
+    void lookahead_update();
+
     ///
     /// spline methods
     ///
@@ -263,6 +301,21 @@ protected:
     /// get_slow_down_speed - returns target speed of target point based on distance from the destination (in cm)
     float get_slow_down_speed(float dist_from_dest_cm, float accel_cmss);
 
+    /// look-ahead planner protected functions
+
+    /// lookahead_advance - moves the plan on to a new leg ending at destination.  called when the leg changes
+    void lookahead_advance(const Vector3f& destination);
+
+    /// lookahead_passing - true if the planner passes through the current leg's destination without stopping
+    bool lookahead_passing() const { return _lookahead_active && _lookahead_exit_speed > 0.0f; }
+
+    /// get_track_limit - returns the speed or acceleration limit along a unit direction given its horizontal, up and down limits
+    float get_track_limit(const Vector3f& unit, float limit_xy, float limit_up, float limit_down) const;
+
+    /// get_max_entry_speed - returns the highest speed from which a jerk limited deceleration over dist_cm ends at exit_speed_cms
+    ///     a jerk of zero gives a constant deceleration
+    static float get_max_entry_speed(float exit_speed_cms, float dist_cm, float accel_cmss, float jerk_cmsss);
+
     /// spline protected functions
 
     /// update_spline_solution - recalculates hermite_spline_solution grid
@@ -275,6 +328,10 @@ protected:
     /// 	relies on update_spline_solution being called since the previous
     void calc_spline_pos_vel(float spline_time, Vector3f& position, Vector3f& velocity);
 
+    /// calc_spline_time - returns the spline time at the given distance along the spline segment
+    ///     relies on update_spline_solution being called since the previous
+    float calc_spline_time(float dist);
+
     // references to inertial nav and ahrs libraries
     const AP_InertialNav&   _inav;
     const AP_AHRS&          _ahrs;
@@ -292,6 +349,8 @@ protected:
     AP_Float    _wp_radius_cm;          // distance from a waypoint in cm that, when crossed, indicates the wp has been reached
     AP_Float    _wp_accel_cms;          // horizontal acceleration in cm/s/s during missions
     AP_Float    _wp_accel_z_cms;        // vertical acceleration in cm/s/s during missions
+    AP_Int8     _wp_lookahead;          // number of waypoints the look-ahead planner plans across, zero to disable
+    AP_Float    _wp_jerk_cmsss;         // jerk in cm/s/s/s used by the look-ahead planner
 
     // loiter controller internal variables
     uint8_t     _loiter_step;           // used to decide which portion of loiter controller to run during this iteration
@@ -312,10 +371,25 @@ protected:
     float       _track_speed;           // speed in cm/s along track
     float       _track_leash_length;    // leash length along track
     float       _slow_down_dist;        // vehicle should begin to slow down once it is within this distance from the destination
+    float       _track_accel_ramp;      // jerk limited acceleration of the target along track in cm/s/s, used while the look-ahead plan is active
+
+    // look-ahead planner variables
+    struct lookahead_wp {
+        Vector3f    pos;                // distance from home in cm
+        float       speed;              // planned speed in cm/s through the waypoint
+        uint16_t    id;                 // caller's identifier
+        bool        stop;               // true if the vehicle must stop at this waypoint
+    } _lookahead[WPNAV_LOOKAHEAD_MAX];
+    uint8_t     _lookahead_num;         // number of waypoints held by the planner
+    bool        _lookahead_active;      // true if the plan covers the current leg
+    float       _lookahead_exit_speed;  // planned speed in cm/s at the end of the current leg
 
     // spline variables
     float       _spline_time;           // current spline time between origin and destination
-    float       _spline_time_scale;     // current spline time between origin and destination
+    float       _spline_dist;           // distance in cm the target has travelled along the spline segment
+    float       _spline_length;         // length in cm of the spline segment
+    float       _spline_table[WPNAV_SPLINE_TABLE_SIZE+1];   // distance along the segment at evenly spaced spline times
+    uint8_t     _spline_table_index;    // table interval the target was last in
     Vector3f    _spline_origin_vel;     // the target velocity vector at the origin of the spline segment
     Vector3f    _spline_destination_vel;// the target velocity vector at the destination point of the spline segment
     Vector3f    _hermite_spline_solution[4]; // array describing spline path between origin and destination
@@ -85,9 +85,9 @@ const AP_Param::GroupInfo AP_SteerController::var_info[] PROGMEM = {
 */
 int32_t AP_SteerController::get_steering_out_rate(float desired_rate)
 {
-	uint32_t tnow = hal.scheduler->millis();
+	uint32_t tnow = hal.scheduler->micros();
 	uint32_t dt = tnow - _last_t;
-	if (_last_t == 0 || dt > 1000) {
+	if (_last_t == 0 || dt > 1000000UL) {
 		dt = 0;
 	}
 	_last_t = tnow;
@@ -109,7 +109,7 @@ int32_t AP_SteerController::get_steering_out_rate(float desired_rate)
     // No conversion is required for K_D
 	float ki_rate = _K_I * _tau * 45.0f;
 	float kp_ff = max((_K_P - _K_I * _tau) * _tau  - _K_D , 0) * 45.0f;
-	float delta_time    = (float)dt * 0.001f;
+	float delta_time    = (float)dt * 1.0e-6f;
 	
 	// Multiply roll rate error by _ki_rate and integrate
 	// Don't integrate if in stabilise mode as the integrator will wind up against the pilots inputs
@@ -124,6 +124,30 @@ const AP_Param::GroupInfo AP_AHRS::var_info[] PROGMEM = {
     AP_GROUPINFO("EKF_USE",  13, AP_AHRS, _ekf_use, AHRS_EKF_USE_DEFAULT),
 #endif
 
+#if AP_AHRS_NAVEKF_AVAILABLE
+    // @Param: EKF_LANES
+    // @DisplayName: NavEKF lane mode
+    // @Description: This controls whether a single NavEKF blends the first two IMUs, or an independent NavEKF lane is run for each IMU with the lane that has the best innovation consistency used for attitude and position estimation. On Linux boards the extra lanes are run in parallel threads, otherwise they are updated on alternate loops. Takes effect when the EKF is started.
+    // @Values: 0:Single blended filter,1:One lane per IMU
+    // @User: Advanced
+    AP_GROUPINFO("EKF_LANES",  14, AP_AHRS, _ekf_lanes, 0),
+
+    // @Param: DCM_SHADOW
+    // @DisplayName: DCM shadow update interval
+    // @Description: While the EKF is in use the DCM attitude estimate is only needed as a fallback. This sets the number of loops between DCM updates while the EKF is in use. The gyro data for the skipped loops is buffered, and the DCM estimate is brought up to date immediately if the EKF stops being used. A value of 0 or 1 updates DCM every loop.
+    // @Range: 0 10
+    // @Increment: 1
+    // @User: Advanced
+    AP_GROUPINFO("DCM_SHADOW", 15, AP_AHRS, _dcm_shadow, 0),
+
+    // @Param: EKF_OUTPUT
+    // @DisplayName: Use EKF output predictor
+    // @Description: When enabled the attitude, velocity and position used by the flight controllers come from the EKF output predictor. This is propagated with the IMU data every EKF update and is corrected smoothly towards the filter states, so the controllers do not see steps when measurements are fused.
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("EKF_OUTPUT", 16, AP_AHRS, _ekf_output, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -343,6 +343,19 @@ public:
     // current barometer and GPS altitudes correspond to this altitude
     virtual void set_home(const Location &loc) = 0;
 
+    // return a North/East frame for converting between locations and
+    // offsets from a nearby origin. This is anchored at the EKF origin
+    // while the EKF is in use and at home otherwise, so a caller should
+    // convert all the locations of one calculation with the same copy.
+    // Returns false if there is no origin yet
+    virtual bool get_local_frame(LocalFrame &frame) const {
+        if (!_home_frame.valid()) {
+            return false;
+        }
+        frame = _home_frame;
+        return true;
+    }
+
     // return true if the AHRS object supports inertial navigation,
     // with very accurate position and velocity
     virtual bool have_inertial_nav(void) const { return false; }
@@ -377,6 +390,9 @@ protected:
 #else
     AP_Int8 _ekf_use;
 #endif
+    AP_Int8 _ekf_lanes;
+    AP_Int8 _dcm_shadow;
+    AP_Int8 _ekf_output;
 
     // flags structure
     struct ahrs_flags {
@@ -430,6 +446,7 @@ protected:
 
     // reference position for NED positions
     struct Location _home;
+    LocalFrame _home_frame;
 
     // helper trig variables
     float _cos_roll, _cos_pitch, _cos_yaw;
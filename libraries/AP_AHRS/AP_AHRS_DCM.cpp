@@ -71,6 +71,9 @@ AP_AHRS_DCM::update(void)
         return;
     }
 
+    // catch up with any gyro data buffered while running as a shadow
+    flush_shadow();
+
     // Integrate the DCM matrix using gyro inputs
     matrix_update(delta_t);
 
@@ -90,30 +93,99 @@ AP_AHRS_DCM::update(void)
     update_trig();
 }
 
-// update the DCM matrix using only the gyros
+/*
+  run the DCM as a reduced rate shadow estimator. The IMU is still
+  updated every loop, but the gyro data is only buffered. Every
+  decimation loops the matrix is rotated through the buffered gyro
+  data and a single normalisation and drift correction step is run
+  over the whole interval
+ */
 void
-AP_AHRS_DCM::matrix_update(float _G_Dt)
+AP_AHRS_DCM::update_shadow(uint8_t decimation)
 {
-    // note that we do not include the P terms in _omega. This is
-    // because the spin_rate is calculated from _omega.length(),
-    // and including the P terms would give positive feedback into
-    // the _P_gain() calculation, which can lead to a very large P
-    // value
-    _omega.zero();
+    if (_last_startup_ms == 0) {
+        _last_startup_ms = hal.scheduler->millis();
+    }
 
-    // average across all healthy gyros. This reduces noise on systems
-    // with more than one gyro    
+    // tell the IMU to grab some data
+    _ins.update();
+
+    float delta_t = _ins.get_delta_time();
+
+    // discard long updates, as in update()
+    if (delta_t > 0.2f) {
+        memset(&_ra_sum[0], 0, sizeof(_ra_sum));
+        _ra_deltat = 0;
+        _shadow_count = 0;
+        return;
+    }
+
+    _shadow_gyro[_shadow_count] = gyro_average();
+    _shadow_delta_t[_shadow_count] = delta_t;
+    _shadow_count++;
+
+    if (_shadow_count >= constrain_int16(decimation, 1, AP_AHRS_DCM_SHADOW_MAX)) {
+        shadow_update();
+    }
+}
+
+// bring the DCM solution up to date with any buffered gyro data
+void
+AP_AHRS_DCM::flush_shadow(void)
+{
+    if (_shadow_count > 0) {
+        shadow_update();
+    }
+}
+
+// rotate through the buffered gyro data then correct over the whole interval
+void
+AP_AHRS_DCM::shadow_update(void)
+{
+    float delta_t = 0;
+    for (uint8_t i=0; i<_shadow_count; i++) {
+        _omega = _shadow_gyro[i] + _omega_I;
+        _dcm_matrix.rotate((_omega + _omega_P + _omega_yaw_P) * _shadow_delta_t[i]);
+        delta_t += _shadow_delta_t[i];
+    }
+    _shadow_count = 0;
+
+    normalize();
+    drift_correction(delta_t);
+    check_matrix();
+    euler_angles();
+    update_trig();
+}
+
+// average across all healthy gyros. This reduces noise on systems
+// with more than one gyro    
+Vector3f
+AP_AHRS_DCM::gyro_average(void) const
+{
+    Vector3f gyro;
     uint8_t healthy_count = 0;    
     for (uint8_t i=0; i<_ins.get_gyro_count(); i++) {
         if (_ins.get_gyro_health(i)) {
-            _omega += _ins.get_gyro(i);
+            gyro += _ins.get_gyro(i);
             healthy_count++;
         }
     }
     if (healthy_count > 1) {
-        _omega /= healthy_count;
+        gyro /= healthy_count;
     }
-    _omega += _omega_I;
+    return gyro;
+}
+
+// update the DCM matrix using only the gyros
+void
+AP_AHRS_DCM::matrix_update(float _G_Dt)
+{
+    // note that we do not include the P terms in _omega. This is
+    // because the spin_rate is calculated from _omega.length(),
+    // and including the P terms would give positive feedback into
+    // the _P_gain() calculation, which can lead to a very large P
+    // value
+    _omega = gyro_average() + _omega_I;
     _dcm_matrix.rotate((_omega + _omega_P + _omega_yaw_P) * _G_Dt);
 }
 
@@ -131,6 +203,9 @@ AP_AHRS_DCM::reset(bool recover_eulers)
     _omega_yaw_P.zero();
     _omega.zero();
 
+    // discard any gyro data buffered in shadow mode
+    _shadow_count = 0;
+
     // if the caller wants us to try to recover to the current
     // attitude then calculate the dcm matrix from the current
     // roll/pitch/yaw values
@@ -971,6 +1046,7 @@ void AP_AHRS_DCM::set_home(const Location &loc)
 {
     _home = loc;
     _home.options = 0;
+    _home_frame.set_origin(_home);
 }
 
 /*
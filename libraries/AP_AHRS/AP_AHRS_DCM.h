@@ -21,6 +21,8 @@
  *
  */
 
+#define AP_AHRS_DCM_SHADOW_MAX 10       // maximum number of loops of gyro data buffered in shadow mode
+
 class AP_AHRS_DCM : public AP_AHRS
 {
 public:
@@ -50,7 +52,8 @@ public:
         _imu1_weight(0.5f),
 #endif
         _last_failure_ms(0),
-        _last_startup_ms(0)
+        _last_startup_ms(0),
+        _shadow_count(0)
     {
         _dcm_matrix.identity();
 
@@ -110,12 +113,23 @@ public:
     // is the AHRS subsystem healthy?
     bool healthy(void) const;
 
+protected:
+    // reduced rate shadow operation, used while another estimator is
+    // in use. The gyro data for each loop is buffered and the DCM
+    // solution is only brought up to date every decimation loops
+    void            update_shadow(uint8_t decimation);
+
+    // bring the DCM solution up to date with any buffered gyro data
+    void            flush_shadow(void);
+
 private:
     float _ki;
     float _ki_yaw;
 
     // Methods
+    Vector3f        gyro_average(void) const;
     void            matrix_update(float _G_Dt);
+    void            shadow_update(void);
     void            normalize(void);
     void            check_matrix(void);
     bool            renorm(Vector3f const &a, Vector3f &result);
@@ -201,6 +215,11 @@ private:
 
     // time when DCM was last reset
     uint32_t _last_startup_ms;
+
+    // gyro data buffered in shadow mode
+    Vector3f _shadow_gyro[AP_AHRS_DCM_SHADOW_MAX];
+    float _shadow_delta_t[AP_AHRS_DCM_SHADOW_MAX];
+    uint8_t _shadow_count;
 };
 
 #endif // __AP_AHRS_DCM_H__
@@ -21,11 +21,22 @@
 #include <AP_HAL.h>
 #include <AP_AHRS.h>
 #include <AP_Vehicle.h>
+#include <GCS.h>
 
 #if AP_AHRS_NAVEKF_AVAILABLE
 
 extern const AP_HAL::HAL& hal;
 
+AP_AHRS_NavEKF::~AP_AHRS_NavEKF()
+{
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    stop_lane_threads();
+#endif
+    for (uint8_t i=1; i<_num_lanes; i++) {
+        delete _lane[i];
+    }
+}
+
 // return the smoothed gyro vector corrected for drift
 const Vector3f &AP_AHRS_NavEKF::get_gyro(void) const
 {
@@ -59,7 +70,9 @@ void AP_AHRS_NavEKF::reset_gyro_drift(void)
     AP_AHRS_DCM::reset_gyro_drift();
 
     // reset the EKF gyro bias states
-    EKF.resetGyroBias();
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->resetGyroBias();
+    }
 
     // zero gyro3 bias
     _gyro3_bias.zero();
@@ -78,7 +91,13 @@ void AP_AHRS_NavEKF::update(void)
     yaw = _dcm_attitude.z;
     update_cd_values();
 
-    AP_AHRS_DCM::update();
+    // while the EKF is in use DCM is only a fallback, so it can run as
+    // a reduced rate shadow
+    if (_dcm_shadow > 1 && using_EKF()) {
+        AP_AHRS_DCM::update_shadow(_dcm_shadow);
+    } else {
+        AP_AHRS_DCM::update();
+    }
 
     // keep DCM attitude available for get_secondary_attitude()
     _dcm_attitude(roll, pitch, yaw);
@@ -89,7 +108,13 @@ void AP_AHRS_NavEKF::update(void)
             start_time_ms = hal.scheduler->millis();
         }
         if (hal.scheduler->millis() - start_time_ms > startup_delay_ms) {
-            ekf_started = EKF.InitialiseFilterDynamic();
+            start_lanes();
+            for (uint8_t i=0; i<_num_lanes; i++) {
+                if (i != _active_lane) {
+                    _lane[i]->InitialiseFilterDynamic();
+                }
+            }
+            ekf_started = active_EKF().InitialiseFilterDynamic();
 
             if (ekf_started) {
                 lastEkfHealthyTime_ms = hal.scheduler->millis();
@@ -98,13 +123,16 @@ void AP_AHRS_NavEKF::update(void)
         }
     }
     if (ekf_started) {
-        EKF.UpdateFilter();
+        update_lanes();
+        select_lane();
+        NavEKF &ekf = active_EKF();
+
         // If EKF is started we switch away if it reports unhealthy. This could be due to bad
         // sensor data. If EKF reversion is inhibited, we only switch across if the EKF encounters
         // an internal processing error, but not for bad sensor data.
         uint8_t ekf_faults;
-        EKF.getFilterFaults(ekf_faults);
-        bool ekfHealthy = ekf_started && ((_ekf_use == EKF_USE_WITH_FALLBACK && EKF.healthy()) || (_ekf_use == EKF_USE_WITHOUT_FALLBACK && ekf_faults == 0));
+        ekf.getFilterFaults(ekf_faults);
+        bool ekfHealthy = ekf_started && ((_ekf_use == EKF_USE_WITH_FALLBACK && ekf.healthy()) || (_ekf_use == EKF_USE_WITHOUT_FALLBACK && ekf_faults == 0));
         // Check if the EKF is healthy and reinitialise if unhealthy for 200 msec
         // Don't repeat until 1500 msec has lapsed to allow EKF time to restart
         // Don't do on the ground because the health criteria are tightened before the vehicle arms and we could end up with repeating resets
@@ -113,7 +141,10 @@ void AP_AHRS_NavEKF::update(void)
             lastEkfHealthyTime_ms = hal.scheduler->millis();
         }
         if ((hal.scheduler->millis() - lastEkfHealthyTime_ms > 200) && (hal.scheduler->millis() - lastEkfResetTime_ms > 1500) && hal.util->get_soft_armed()) {
-            bool restartSuccessful = EKF.InitialiseFilterDynamic();
+            // the restart uses the DCM attitude
+            AP_AHRS_DCM::flush_shadow();
+            _dcm_attitude(roll, pitch, yaw);
+            bool restartSuccessful = ekf.InitialiseFilterDynamic();
             if (restartSuccessful) {
                 hal.console->printf("EKF restarted\n");
                 lastEkfHealthyTime_ms = hal.scheduler->millis();
@@ -121,14 +152,25 @@ void AP_AHRS_NavEKF::update(void)
              } else {
                 // If the restart is unsuccessful, then indicate that the ekf has not started and bypass the update steps
                 ekf_started = false;
+                AP_AHRS_DCM::flush_shadow();
+                _dcm_attitude(roll, pitch, yaw);
                 return;
              }
         }
 
-        EKF.getRotationBodyToNED(_dcm_matrix);
+        ekf.getRotationBodyToNED(_dcm_matrix);
+        _output_valid = false;
         if (using_EKF()) {
             Vector3f eulers;
-            EKF.getEulerAngles(eulers);
+            ekf.getEulerAngles(eulers);
+
+            // optionally give the controllers the output predictor solution
+            Quaternion output_quat;
+            if (_ekf_output && ekf.getOutputStates(output_quat, _output_vel, _output_pos)) {
+                output_quat.rotation_matrix(_dcm_matrix);
+                output_quat.to_euler(eulers.x, eulers.y, eulers.z);
+                _output_valid = true;
+            }
             roll  = eulers.x;
             pitch = eulers.y;
             yaw   = eulers.z;
@@ -139,31 +181,41 @@ void AP_AHRS_NavEKF::update(void)
             // keep _gyro_bias for get_gyro_drift()
             // filter with 5s time constant
             Vector3f ekf_gyro_bias;
-            EKF.getGyroBias(ekf_gyro_bias);
+            ekf.getGyroBias(ekf_gyro_bias);
             ekf_gyro_bias = -ekf_gyro_bias;
             _gyro_bias += (ekf_gyro_bias-_gyro_bias)*(0.0025f / (0.0025f + 5.0f));
 
             // calculate corrected gryo estimate for get_gyro()
+            // a single IMU lane only estimates the bias of its own gyro
+            int8_t lane_imu = ekf.getIMULane();
             _gyro_estimate.zero();
-            uint8_t healthy_count = 0;    
-            for (uint8_t i=0; i<_ins.get_gyro_count(); i++) {
-                if (_ins.get_gyro_health(i)) {
-                    _gyro_estimate += _ins.get_gyro(i);
-                    healthy_count++;
+            if (lane_imu >= 0) {
+                _gyro_estimate = _ins.get_gyro(lane_imu);
+            } else {
+                uint8_t healthy_count = 0;    
+                for (uint8_t i=0; i<_ins.get_gyro_count(); i++) {
+                    if (_ins.get_gyro_health(i)) {
+                        _gyro_estimate += _ins.get_gyro(i);
+                        healthy_count++;
+                    }
+                }
+                if (healthy_count > 1) {
+                    _gyro_estimate /= healthy_count;
                 }
-            }
-            if (healthy_count > 1) {
-                _gyro_estimate /= healthy_count;
             }
             _gyro_estimate += _gyro_bias;
 
             float abias1, abias2;
-            EKF.getAccelZBias(abias1, abias2);
+            ekf.getAccelZBias(abias1, abias2);
 
             // update _accel_ef_ekf
             for (uint8_t i=0; i<_ins.get_accel_count(); i++) {
                 Vector3f accel = _ins.get_accel(i);
-                if (i==0) {
+                if (lane_imu >= 0) {
+                    if (i == lane_imu) {
+                        accel.z -= abias1;
+                    }
+                } else if (i==0) {
                     accel.z -= abias1;
                 } else if (i==1) {
                     accel.z -= abias2;
@@ -173,13 +225,20 @@ void AP_AHRS_NavEKF::update(void)
                 }
             }
 
-            if(_ins.get_accel_health(0) && _ins.get_accel_health(1)) {
+            if (lane_imu >= 0) {
+                _accel_ef_ekf_blended = _accel_ef_ekf[lane_imu];
+            } else if(_ins.get_accel_health(0) && _ins.get_accel_health(1)) {
                 float IMU1_weighting;
-                EKF.getIMU1Weighting(IMU1_weighting);
+                ekf.getIMU1Weighting(IMU1_weighting);
                 _accel_ef_ekf_blended = _accel_ef_ekf[0] * IMU1_weighting + _accel_ef_ekf[1] * (1.0f-IMU1_weighting);
             } else {
                 _accel_ef_ekf_blended = _accel_ef_ekf[0];
             }
+        } else {
+            // the EKF has stopped being used, so bring the shadow DCM
+            // solution up to date before it is used this loop
+            AP_AHRS_DCM::flush_shadow();
+            _dcm_attitude(roll, pitch, yaw);
         }
     }
 }
@@ -233,7 +292,12 @@ void AP_AHRS_NavEKF::reset(bool recover_eulers)
 {
     AP_AHRS_DCM::reset(recover_eulers);
     if (ekf_started) {
-        ekf_started = EKF.InitialiseFilterBootstrap();        
+        for (uint8_t i=0; i<_num_lanes; i++) {
+            if (i != _active_lane) {
+                _lane[i]->InitialiseFilterBootstrap();
+            }
+        }
+        ekf_started = active_EKF().InitialiseFilterBootstrap();        
     }
 }
 
@@ -242,7 +306,12 @@ void AP_AHRS_NavEKF::reset_attitude(const float &_roll, const float &_pitch, con
 {
     AP_AHRS_DCM::reset_attitude(_roll, _pitch, _yaw);
     if (ekf_started) {
-        ekf_started = EKF.InitialiseFilterBootstrap();        
+        for (uint8_t i=0; i<_num_lanes; i++) {
+            if (i != _active_lane) {
+                _lane[i]->InitialiseFilterBootstrap();
+            }
+        }
+        ekf_started = active_EKF().InitialiseFilterBootstrap();        
     }
 }
 
@@ -250,7 +319,13 @@ void AP_AHRS_NavEKF::reset_attitude(const float &_roll, const float &_pitch, con
 bool AP_AHRS_NavEKF::get_position(struct Location &loc) const
 {
     Vector3f ned_pos;
-    if (using_EKF() && EKF.getLLH(loc) && EKF.getPosNED(ned_pos)) {
+    if (using_EKF() && active_EKF().getLLH(loc) && active_EKF().getPosNED(ned_pos)) {
+        // move the position forward to the output predictor solution,
+        // matching get_relative_position_NED()
+        if (_output_valid) {
+            active_EKF().getOriginFrame().offset(loc, _output_pos.x - ned_pos.x, _output_pos.y - ned_pos.y);
+            ned_pos.z = _output_pos.z;
+        }
         // fixup altitude using relative position from AHRS home, not
         // EKF origin
         loc.alt = get_home().alt - ned_pos.z*100;
@@ -279,7 +354,7 @@ Vector3f AP_AHRS_NavEKF::wind_estimate(void)
         return AP_AHRS_DCM::wind_estimate();
     }
     Vector3f wind;
-    EKF.getWind(wind);
+    active_EKF().getWind(wind);
     return wind;
 }
 
@@ -294,7 +369,7 @@ bool AP_AHRS_NavEKF::airspeed_estimate(float *airspeed_ret) const
 bool AP_AHRS_NavEKF::use_compass(void)
 {
     if (using_EKF()) {
-        return EKF.use_compass();
+        return active_EKF().use_compass();
     }
     return AP_AHRS_DCM::use_compass();
 }
@@ -310,7 +385,7 @@ bool AP_AHRS_NavEKF::get_secondary_attitude(Vector3f &eulers)
     }
     if (ekf_started) {
         // EKF is secondary
-        EKF.getEulerAngles(eulers);
+        active_EKF().getEulerAngles(eulers);
         return true;
     }
     // no secondary available
@@ -327,7 +402,7 @@ bool AP_AHRS_NavEKF::get_secondary_position(struct Location &loc)
     }    
     if (ekf_started) {
         // EKF is secondary
-        EKF.getLLH(loc);
+        active_EKF().getLLH(loc);
         return true;
     }
     // no secondary available
@@ -341,7 +416,7 @@ Vector2f AP_AHRS_NavEKF::groundspeed_vector(void)
         return AP_AHRS_DCM::groundspeed_vector();
     }
     Vector3f vec;
-    EKF.getVelNED(vec);
+    active_EKF().getVelNED(vec);
     return Vector2f(vec.x, vec.y);
 }
 
@@ -361,7 +436,11 @@ bool AP_AHRS_NavEKF::have_inertial_nav(void) const
 bool AP_AHRS_NavEKF::get_velocity_NED(Vector3f &vec) const
 {
     if (using_EKF()) {
-        EKF.getVelNED(vec);
+        if (_output_valid) {
+            vec = _output_vel;
+        } else {
+            active_EKF().getVelNED(vec);
+        }
         return true;
     }
     return false;
@@ -372,26 +451,52 @@ bool AP_AHRS_NavEKF::get_velocity_NED(Vector3f &vec) const
 bool AP_AHRS_NavEKF::get_relative_position_NED(Vector3f &vec) const
 {
     if (using_EKF()) {
-        return EKF.getPosNED(vec);
+        bool ret = active_EKF().getPosNED(vec);
+        if (_output_valid) {
+            vec = _output_pos;
+        }
+        return ret;
     }
     return false;
 }
 
+// return the frame of the EKF origin when using the EKF, so offsets
+// line up with the EKF positions
+bool AP_AHRS_NavEKF::get_local_frame(LocalFrame &frame) const
+{
+    if (using_EKF() && active_EKF().getOriginFrame().valid()) {
+        frame = active_EKF().getOriginFrame();
+        return true;
+    }
+    return AP_AHRS_DCM::get_local_frame(frame);
+}
+
+// return the EKF output predictor NED position and velocity
+bool AP_AHRS_NavEKF::get_output_NED(Vector3f &pos, Vector3f &vel) const
+{
+    if (!_output_valid || !using_EKF()) {
+        return false;
+    }
+    pos = _output_pos;
+    vel = _output_vel;
+    return true;
+}
+
 bool AP_AHRS_NavEKF::using_EKF(void) const
 {
     uint8_t ekf_faults;
-    EKF.getFilterFaults(ekf_faults);
+    active_EKF().getFilterFaults(ekf_faults);
     // If EKF is started we switch away if it reports unhealthy. This could be due to bad
     // sensor data. If EKF reversion is inhibited, we only switch across if the EKF encounters
     // an internal processing error, but not for bad sensor data.
     // if EKF is unhealthy for longer than 200msec, we re-initiliase the filter
-    bool ret = ekf_started && ((_ekf_use == EKF_USE_WITH_FALLBACK && EKF.healthy()) || (_ekf_use == EKF_USE_WITHOUT_FALLBACK && ekf_faults == 0));
+    bool ret = ekf_started && ((_ekf_use == EKF_USE_WITH_FALLBACK && active_EKF().healthy()) || (_ekf_use == EKF_USE_WITHOUT_FALLBACK && ekf_faults == 0));
     if (!ret) {
         return false;
     }
 #if APM_BUILD_TYPE(APM_BUILD_ArduPlane) || APM_BUILD_TYPE(APM_BUILD_APMrover2)
     nav_filter_status filt_state;
-    EKF.getFilterStatus(filt_state);
+    active_EKF().getFilterStatus(filt_state);
     if (hal.util->get_soft_armed() && filt_state.flags.const_pos_mode) {
         return false;
     }
@@ -415,7 +520,7 @@ bool AP_AHRS_NavEKF::healthy(void) const
     // sensor data. If EKF reversion is inhibited, we only switch across if the EKF encounters
     // an internal processing error, but not for bad sensor data.
     if (_ekf_use != EKF_DO_NOT_USE) {
-        return ekf_started && EKF.healthy();
+        return ekf_started && active_EKF().healthy();
     }
     return AP_AHRS_DCM::healthy();    
 }
@@ -437,37 +542,345 @@ bool AP_AHRS_NavEKF::initialised(void) const
 // write optical flow data to EKF
 void  AP_AHRS_NavEKF::writeOptFlowMeas(uint8_t &rawFlowQuality, Vector2f &rawFlowRates, Vector2f &rawGyroRates, uint32_t &msecFlowMeas)
 {
-    EKF.writeOptFlowMeas(rawFlowQuality, rawFlowRates, rawGyroRates, msecFlowMeas);
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->writeOptFlowMeas(rawFlowQuality, rawFlowRates, rawGyroRates, msecFlowMeas);
+    }
 }
 
 // inhibit GPS useage
 uint8_t AP_AHRS_NavEKF::setInhibitGPS(void)
 {
-    return EKF.setInhibitGPS();
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        if (i != _active_lane) {
+            _lane[i]->setInhibitGPS();
+        }
+    }
+    return active_EKF().setInhibitGPS();
 }
 
 // get speed limit
 void AP_AHRS_NavEKF::getEkfControlLimits(float &ekfGndSpdLimit, float &ekfNavVelGainScaler)
 {
-    EKF.getEkfControlLimits(ekfGndSpdLimit,ekfNavVelGainScaler);
+    active_EKF().getEkfControlLimits(ekfGndSpdLimit,ekfNavVelGainScaler);
 }
 
 // get compass offset estimates
 // true if offsets are valid
 bool AP_AHRS_NavEKF::getMagOffsets(Vector3f &magOffsets)
 {
-    bool status = EKF.getMagOffsets(magOffsets);
+    bool status = active_EKF().getMagOffsets(magOffsets);
     return status;
 }
 
 void AP_AHRS_NavEKF::setTakeoffExpected(bool val)
 {
-    EKF.setTakeoffExpected(val);
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->setTakeoffExpected(val);
+    }
 }
 
 void AP_AHRS_NavEKF::setTouchdownExpected(bool val)
 {
-    EKF.setTouchdownExpected(val);
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->setTouchdownExpected(val);
+    }
+}
+
+/*
+  allocate an independent single IMU filter lane for each IMU after the
+  first. Lane 0 is the filter registered with AP_Param and the other
+  lanes copy its parameters
+ */
+void AP_AHRS_NavEKF::start_lanes(void)
+{
+    if (_ekf_lanes <= 0 || _num_lanes > 1) {
+        return;
+    }
+    uint8_t imu_count = min(_ins.get_gyro_count(), _ins.get_accel_count());
+    if (imu_count < 2) {
+        return;
+    }
+    EKF.setIMULane(0);
+    for (uint8_t i=1; i<imu_count && i<AP_AHRS_NAVEKF_MAX_LANES; i++) {
+        NavEKF *lane = new NavEKF(this, _baro, _rng);
+        if (lane == NULL) {
+            break;
+        }
+        lane->copyParameters(EKF);
+        lane->setIMULane(i);
+        _lane[i] = lane;
+        _num_lanes++;
+    }
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // the lane threads inherit the scheduling policy and priority of the main thread
+    for (uint8_t i=1; i<_num_lanes; i++) {
+        struct lane_thread &t = _lane_thread[i];
+        t.ahrs = this;
+        t.lane = i;
+        t.run = false;
+        t.stop = false;
+        pthread_mutex_init(&t.mutex, NULL);
+        pthread_cond_init(&t.cond, NULL);
+        t.started = (pthread_create(&t.thread, NULL, &AP_AHRS_NavEKF::lane_thread_main, &t) == 0);
+    }
+#endif
+}
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+void *AP_AHRS_NavEKF::lane_thread_main(void *arg)
+{
+    struct lane_thread *t = (struct lane_thread *)arg;
+    while (true) {
+        pthread_mutex_lock(&t->mutex);
+        while (!t->run && !t->stop) {
+            pthread_cond_wait(&t->cond, &t->mutex);
+        }
+        bool stop = t->stop;
+        pthread_mutex_unlock(&t->mutex);
+        if (stop) {
+            break;
+        }
+
+        t->ahrs->update_lane(t->lane);
+
+        pthread_mutex_lock(&t->mutex);
+        t->run = false;
+        pthread_cond_broadcast(&t->cond);
+        pthread_mutex_unlock(&t->mutex);
+    }
+    return NULL;
+}
+
+// stop the lane threads and wait for them to exit
+void AP_AHRS_NavEKF::stop_lane_threads(void)
+{
+    for (uint8_t i=1; i<_num_lanes; i++) {
+        struct lane_thread &t = _lane_thread[i];
+        if (!t.started) {
+            continue;
+        }
+        pthread_mutex_lock(&t.mutex);
+        t.stop = true;
+        pthread_cond_broadcast(&t.cond);
+        pthread_mutex_unlock(&t.mutex);
+        pthread_join(t.thread, NULL);
+        pthread_mutex_destroy(&t.mutex);
+        pthread_cond_destroy(&t.cond);
+        t.started = false;
+    }
+}
+#endif
+
+/*
+  update the filter lanes. On Linux the lanes run in parallel and we
+  wait for all of them to finish, so the sensor data they read can't
+  change underneath them. On other boards the active lane runs every
+  loop and the standby lanes take turns, accumulating IMU data while
+  they wait
+ */
+void AP_AHRS_NavEKF::update_lanes(void)
+{
+    if (_num_lanes <= 1) {
+        update_lane(0);
+        return;
+    }
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    for (uint8_t i=1; i<_num_lanes; i++) {
+        struct lane_thread &t = _lane_thread[i];
+        if (t.started) {
+            pthread_mutex_lock(&t.mutex);
+            t.run = true;
+            pthread_cond_broadcast(&t.cond);
+            pthread_mutex_unlock(&t.mutex);
+        } else {
+            update_lane(i);
+        }
+    }
+    update_lane(0);
+    for (uint8_t i=1; i<_num_lanes; i++) {
+        struct lane_thread &t = _lane_thread[i];
+        if (t.started) {
+            pthread_mutex_lock(&t.mutex);
+            while (t.run) {
+                pthread_cond_wait(&t.cond, &t.mutex);
+            }
+            pthread_mutex_unlock(&t.mutex);
+        }
+    }
+#else
+    if (_next_standby_lane == _active_lane) {
+        _next_standby_lane = (_next_standby_lane + 1) % _num_lanes;
+    }
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        if (i == _active_lane || i == _next_standby_lane) {
+            update_lane(i);
+        } else {
+            _lane[i]->accumulateIMUData();
+        }
+    }
+    _next_standby_lane = (_next_standby_lane + 1) % _num_lanes;
+#endif
+}
+
+// update a single lane and keep a filtered record of its processing time
+void AP_AHRS_NavEKF::update_lane(uint8_t lane)
+{
+    uint32_t start_us = hal.scheduler->micros();
+    _lane[lane]->UpdateFilter();
+    uint32_t elapsed_us = hal.scheduler->micros() - start_us;
+    _lane_state[lane].time_us += (elapsed_us - _lane_state[lane].time_us) * 0.05f;
+}
+
+/*
+  score each lane by the worst of its innovation consistency test
+  ratios and switch to the lane with the lowest score. We only switch
+  away from a usable lane if the new lane is clearly better and we
+  haven't switched recently
+ */
+void AP_AHRS_NavEKF::select_lane(void)
+{
+    if (_num_lanes <= 1) {
+        return;
+    }
+
+    uint32_t now = hal.scheduler->millis();
+
+    // keep the lanes using the same parameters as lane 0
+    if (now - _last_lane_param_copy_ms > 1000) {
+        for (uint8_t i=1; i<_num_lanes; i++) {
+            _lane[i]->copyParameters(EKF);
+        }
+        _last_lane_param_copy_ms = now;
+    }
+
+    static const float laneScoreFiltTC = 1.0f;
+    float dt = 1.0f/_ins.get_sample_rate();
+    float alpha = constrain_float(dt / (dt+laneScoreFiltTC),0.0f,1.0f);
+
+    int8_t best_lane = -1;
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        NavEKF &lane = *_lane[i];
+        int8_t imu = lane.getIMULane();
+        float velVar, posVar, hgtVar, tasVar;
+        Vector3f magVar;
+        Vector2f offset;
+        uint8_t faults;
+        lane.getVariances(velVar, posVar, hgtVar, magVar, tasVar, offset);
+        lane.getFilterFaults(faults);
+
+        float score = max(max(velVar, posVar), max(hgtVar, max(magVar.x, max(magVar.y, magVar.z))));
+        _lane_state[i].score += (score - _lane_state[i].score) * alpha;
+        _lane_state[i].usable = (faults == 0 && lane.healthy() &&
+                                 _ins.get_gyro_health(imu) && _ins.get_accel_health(imu));
+
+        if (!_lane_state[i].usable) {
+            // restart a standby lane with numerical errors so it can be used again
+            if (faults != 0 && i != _active_lane && now - _lane_state[i].last_reset_ms > 1500) {
+                lane.InitialiseFilterDynamic();
+                _lane_state[i].last_reset_ms = now;
+            }
+            continue;
+        }
+        if (best_lane < 0 || _lane_state[i].score < _lane_state[best_lane].score) {
+            best_lane = i;
+        }
+    }
+
+    if (best_lane < 0 || best_lane == _active_lane) {
+        return;
+    }
+    if (_lane_state[_active_lane].usable &&
+        (_lane_state[best_lane].score + AP_AHRS_NAVEKF_LANE_SWITCH_MARGIN > _lane_state[_active_lane].score ||
+         now - _last_lane_switch_ms < AP_AHRS_NAVEKF_LANE_SWITCH_MS)) {
+        return;
+    }
+
+    uint8_t old_lane = _active_lane;
+    _active_lane = best_lane;
+    _last_lane_switch_ms = now;
+
+    // the filtered gyro bias was learnt by the previous lane
+    Vector3f ekf_gyro_bias;
+    _lane[_active_lane]->getGyroBias(ekf_gyro_bias);
+    _gyro_bias = -ekf_gyro_bias;
+
+    GCS_MAVLINK::send_statustext_all(PSTR("EKF lane %u (IMU %d) to %u (IMU %d)"),
+                                     (unsigned)old_lane, (int)_lane[old_lane]->getIMULane(),
+                                     (unsigned)_active_lane, (int)_lane[_active_lane]->getIMULane());
+}
+
+// return the IMU, filtered score and update time of a lane
+bool AP_AHRS_NavEKF::get_ekf_lane_status(uint8_t lane, int8_t &imu, float &score, uint16_t &time_us) const
+{
+    if (lane >= _num_lanes) {
+        return false;
+    }
+    imu = _lane[lane]->getIMULane();
+    score = _lane_state[lane].score;
+    time_us = _lane_state[lane].time_us;
+    return true;
+}
+
+// AHRS part of an EKF checkpoint. It is followed by the state of each lane
+struct ahrs_ekf_checkpoint {
+    uint8_t num_lanes;
+    uint8_t active_lane;
+    uint8_t next_standby_lane;
+    uint32_t last_lane_switch_ms;
+    uint32_t last_healthy_ms;
+    uint32_t last_reset_ms;
+};
+
+uint32_t AP_AHRS_NavEKF::get_ekf_checkpoint_size(void) const
+{
+    return sizeof(struct ahrs_ekf_checkpoint) + sizeof(_lane_state) + _num_lanes * EKF.getCheckpointSize();
+}
+
+void AP_AHRS_NavEKF::save_ekf_checkpoint(uint8_t *buf) const
+{
+    struct ahrs_ekf_checkpoint hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.num_lanes = _num_lanes;
+    hdr.active_lane = _active_lane;
+    hdr.next_standby_lane = _next_standby_lane;
+    hdr.last_lane_switch_ms = _last_lane_switch_ms;
+    hdr.last_healthy_ms = lastEkfHealthyTime_ms;
+    hdr.last_reset_ms = lastEkfResetTime_ms;
+    memcpy(buf, &hdr, sizeof(hdr));
+    buf += sizeof(hdr);
+    memcpy(buf, _lane_state, sizeof(_lane_state));
+    buf += sizeof(_lane_state);
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->saveCheckpoint(buf);
+        buf += EKF.getCheckpointSize();
+    }
+}
+
+bool AP_AHRS_NavEKF::restore_ekf_checkpoint(const uint8_t *buf, uint32_t size)
+{
+    struct ahrs_ekf_checkpoint hdr;
+    if (!ekf_started || size != get_ekf_checkpoint_size()) {
+        return false;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.num_lanes != _num_lanes || hdr.active_lane >= _num_lanes) {
+        return false;
+    }
+    buf += sizeof(hdr);
+    _active_lane = hdr.active_lane;
+    _next_standby_lane = hdr.next_standby_lane;
+    _last_lane_switch_ms = hdr.last_lane_switch_ms;
+    lastEkfHealthyTime_ms = hdr.last_healthy_ms;
+    lastEkfResetTime_ms = hdr.last_reset_ms;
+    memcpy(_lane_state, buf, sizeof(_lane_state));
+    buf += sizeof(_lane_state);
+    for (uint8_t i=0; i<_num_lanes; i++) {
+        _lane[i]->restoreCheckpoint(buf, EKF.getCheckpointSize());
+        buf += EKF.getCheckpointSize();
+    }
+    return true;
 }
 
 #endif // AP_AHRS_NAVEKF_AVAILABLE
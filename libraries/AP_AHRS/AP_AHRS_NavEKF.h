@@ -27,8 +27,15 @@
 #if HAL_CPU_CLASS >= HAL_CPU_CLASS_150
 #include <AP_NavEKF.h>
 
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <pthread.h>
+#endif
+
 #define AP_AHRS_NAVEKF_AVAILABLE 1
 #define AP_AHRS_NAVEKF_SETTLE_TIME_MS 20000     // time in milliseconds the ekf needs to settle after being started
+#define AP_AHRS_NAVEKF_MAX_LANES INS_MAX_INSTANCES  // maximum number of single IMU EKF lanes
+#define AP_AHRS_NAVEKF_LANE_SWITCH_MARGIN 0.3f  // reduction in lane score required before switching away from a healthy lane
+#define AP_AHRS_NAVEKF_LANE_SWITCH_MS 5000      // minimum time in milliseconds between switches away from a healthy lane
 
 class AP_AHRS_NavEKF : public AP_AHRS_DCM
 {
@@ -37,6 +44,7 @@ public:
     AP_AHRS_NavEKF(AP_InertialSensor &ins, AP_Baro &baro, AP_GPS &gps, RangeFinder &rng) :
     AP_AHRS_DCM(ins, baro, gps),
         EKF(this, baro, rng),
+        _rng(rng),
         ekf_started(false),
         startup_delay_ms(1000),
         start_time_ms(0),
@@ -44,10 +52,22 @@ public:
         _last_gyro3_bias_update_ms(0),
         lastEkfHealthyTime_ms(0),
         lastEkfResetTime_ms(0),
-        ekfStarting(false)
+        ekfStarting(false),
+        _num_lanes(1),
+        _active_lane(0),
+        _next_standby_lane(0),
+        _last_lane_switch_ms(0),
+        _last_lane_param_copy_ms(0),
+        _output_valid(false)
         {
+            // lane 0 is the filter registered with AP_Param, the others are allocated when the EKF starts
+            memset(_lane, 0, sizeof(_lane));
+            memset(_lane_state, 0, sizeof(_lane_state));
+            _lane[0] = &EKF;
         }
 
+    ~AP_AHRS_NavEKF();
+
     // return the smoothed gyro vector corrected for drift
     const Vector3f &get_gyro(void) const;
     const Matrix3f &get_dcm_matrix(void) const;
@@ -82,8 +102,21 @@ public:
     // true if compass is being used
     bool use_compass(void);
 
-    NavEKF &get_NavEKF(void) { return EKF; }
-    const NavEKF &get_NavEKF_const(void) const { return EKF; }
+    // return the filter lane currently providing the solution
+    // before the EKF has started this is always the filter registered with AP_Param
+    NavEKF &get_NavEKF(void) { return active_EKF(); }
+    const NavEKF &get_NavEKF_const(void) const { return active_EKF(); }
+
+    // EKF lane reporting. When AHRS_EKF_LANES is enabled an independent filter is run for each IMU
+    uint8_t get_ekf_lane_count(void) const { return _num_lanes; }
+    uint8_t get_active_ekf_lane(void) const { return _active_lane; }
+    bool get_ekf_lane_status(uint8_t lane, int8_t &imu, float &score, uint16_t &time_us) const;
+
+    // save and restore the state of all filter lanes, so a log replay can resume part way
+    // through. Restoring needs the EKF to have started with the same number of lanes
+    uint32_t get_ekf_checkpoint_size(void) const;
+    void save_ekf_checkpoint(uint8_t *buf) const;
+    bool restore_ekf_checkpoint(const uint8_t *buf, uint32_t size);
 
     // return secondary attitude solution if available, as eulers in radians
     bool get_secondary_attitude(Vector3f &eulers);
@@ -108,6 +141,12 @@ public:
     bool get_velocity_NED(Vector3f &vec) const;
     bool get_relative_position_NED(Vector3f &vec) const;
 
+    bool get_local_frame(LocalFrame &frame) const;
+
+    // return the EKF output predictor NED position (m) and velocity (m/s)
+    // only modifies pos and vel if AHRS_EKF_OUTPUT is enabled and the output states are valid
+    bool get_output_NED(Vector3f &pos, Vector3f &vel) const;
+
     // write optical flow measurements to EKF
     void writeOptFlowMeas(uint8_t &rawFlowQuality, Vector2f &rawFlowRates, Vector2f &rawGyroRates, uint32_t &msecFlowMeas);
 
@@ -138,6 +177,21 @@ public:
 private:
     bool using_EKF(void) const;
 
+    NavEKF &active_EKF(void) { return *_lane[_active_lane]; }
+    const NavEKF &active_EKF(void) const { return *_lane[_active_lane]; }
+
+    // allocate one filter lane per IMU if enabled by AHRS_EKF_LANES
+    void start_lanes(void);
+
+    // update all filter lanes for this loop
+    void update_lanes(void);
+
+    // update a single filter lane and record its processing time
+    void update_lane(uint8_t lane);
+
+    // score the lanes by innovation consistency and switch to the best lane
+    void select_lane(void);
+
     // update _gyro3_bias by comparing ins.get_gyro(2) with get_gyro
     void update_gyro3_bias();
 
@@ -157,6 +211,42 @@ private:
 
     uint32_t _last_gyro3_bias_update_ms;
     Vector3f _gyro3_bias;
+
+    // EKF output predictor solution, used when AHRS_EKF_OUTPUT is enabled
+    bool _output_valid;
+    Vector3f _output_pos;
+    Vector3f _output_vel;
+
+    // single IMU filter lanes
+    const RangeFinder &_rng;
+    NavEKF *_lane[AP_AHRS_NAVEKF_MAX_LANES];
+    struct {
+        float score;                // filtered worst case innovation test ratio, lower is better
+        float time_us;              // filtered update time (usec)
+        bool usable;                // true if the lane is healthy and its IMU is healthy
+        uint32_t last_reset_ms;     // time the lane was last restarted after a filter fault
+    } _lane_state[AP_AHRS_NAVEKF_MAX_LANES];
+    uint8_t _num_lanes;
+    uint8_t _active_lane;
+    uint8_t _next_standby_lane;
+    uint32_t _last_lane_switch_ms;
+    uint32_t _last_lane_param_copy_ms;
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // threads used to update lanes 1 and above in parallel with lane 0
+    struct lane_thread {
+        AP_AHRS_NavEKF *ahrs;
+        uint8_t lane;
+        bool started;
+        bool run;
+        bool stop;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+    } _lane_thread[AP_AHRS_NAVEKF_MAX_LANES];
+    static void *lane_thread_main(void *arg);
+    void stop_lane_threads(void);
+#endif
 };
 #endif
 
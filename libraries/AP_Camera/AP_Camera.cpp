@@ -6,6 +6,8 @@
 #include <RC_Channel.h>
 #include <AP_HAL.h>
 
+extern const AP_HAL::HAL& hal;
+
 // ------------------------------
 #define CAM_DEBUG DISABLED
 
@@ -43,7 +45,7 @@ const AP_Param::GroupInfo AP_Camera::var_info[] PROGMEM = {
 
     // @Param: TRIGG_DIST
     // @DisplayName: Camera trigger distance
-    // @Description: Distance in meters between camera triggers. If this value is non-zero then the camera will trigger whenever the GPS position changes by this number of meters regardless of what mode the APM is in. Note that this parameter can also be set in an auto mission using the DO_SET_CAM_TRIGG_DIST command, allowing you to enable/disable the triggering of the camera during the flight.
+    // @Description: Distance in meters between camera triggers. If this value is non-zero then the camera will trigger whenever the position changes by this number of meters regardless of what mode the APM is in. The time the vehicle reaches the distance is predicted from its velocity, so the pictures are evenly spaced. Note that this parameter can also be set in an auto mission using the DO_SET_CAM_TRIGG_DIST command, allowing you to enable/disable the triggering of the camera during the flight.
     // @User: Standard
     // @Units: meters
     // @Range: 0 1000
@@ -60,7 +62,7 @@ AP_Camera::servo_pic()
 	RC_Channel_aux::set_radio(RC_Channel_aux::k_cam_trigger, _servo_on_pwm);
 
 	// leave a message that it should be active for this many loops (assumes 50hz loops)
-	_trigger_counter = constrain_int16(_trigger_duration*5,0,255);
+	_trigger_counter = constrain_int16(_trigger_duration*5,1,255);
 }
 
 /// basic relay activation
@@ -70,13 +72,13 @@ AP_Camera::relay_pic()
     _apm_relay->on(0);
 
     // leave a message that it should be active for this many loops (assumes 50hz loops)
-    _trigger_counter = constrain_int16(_trigger_duration*5,0,255);
+    _trigger_counter = constrain_int16(_trigger_duration*5,1,255);
 }
 
-/// single entry point to take pictures
-///  set send_mavlink_msg to true to send DO_DIGICAM_CONTROL message to all components
+/// take a picture. This drives the servo or relay, so it is only
+/// called from the main thread
 void
-AP_Camera::trigger_pic(bool send_mavlink_msg)
+AP_Camera::shutter()
 {
     _image_index++;
     switch (_trigger_type)
@@ -88,30 +90,50 @@ AP_Camera::trigger_pic(bool send_mavlink_msg)
         relay_pic();                    // basic relay activation
         break;
     }
+}
+
+/// send DO_DIGICAM_CONTROL message to all components
+void
+AP_Camera::send_digicam_control(void)
+{
+    // create command long mavlink message
+    mavlink_command_long_t cmd_msg;
+    memset(&cmd_msg, 0, sizeof(cmd_msg));
+    cmd_msg.command = MAV_CMD_DO_DIGICAM_CONTROL;
+    cmd_msg.param5 = 1;
+    // create message
+    mavlink_message_t msg;
+    mavlink_msg_command_long_encode(0, 0, &msg, &cmd_msg);
+
+    // forward to all components
+    GCS_MAVLINK::send_to_components(&msg);
+}
+
+/// single entry point to take pictures
+///  set send_mavlink_msg to true to send DO_DIGICAM_CONTROL message to all components
+void
+AP_Camera::trigger_pic(bool send_mavlink_msg)
+{
+    shutter();
+    _feedback.valid = false;
 
     if (send_mavlink_msg) {
-        // create command long mavlink message
-        mavlink_command_long_t cmd_msg;
-        memset(&cmd_msg, 0, sizeof(cmd_msg));
-        cmd_msg.command = MAV_CMD_DO_DIGICAM_CONTROL;
-        cmd_msg.param5 = 1;
-        // create message
-        mavlink_message_t msg;
-        mavlink_msg_command_long_encode(0, 0, &msg, &cmd_msg);
-
-        // forward to all components
-        GCS_MAVLINK::send_to_components(&msg);
+        send_digicam_control();
     }
 }
 
 /// de-activate the trigger after some delay, but without using a delay() function
 /// should be called at 50hz
+/// the shutter is only released at the end of a picture, so a distance
+/// triggered picture isn't cut short
 void
 AP_Camera::trigger_pic_cleanup()
 {
-    if (_trigger_counter) {
-        _trigger_counter--;
-    } else {
+    if (_trigger_counter == 0) {
+        return;
+    }
+    _trigger_counter--;
+    if (_trigger_counter == 0) {
         switch (_trigger_type) {
             case AP_CAMERA_TRIGGER_TYPE_SERVO:
                 RC_Channel_aux::set_radio(RC_Channel_aux::k_cam_trigger, _servo_off_pwm);
@@ -209,47 +231,188 @@ void AP_Camera::control_cmd(const AP_Mission::Mission_Command& cmd)
  */
 void AP_Camera::send_feedback(mavlink_channel_t chan, AP_GPS &gps, const AP_AHRS &ahrs, const Location &current_loc)
 {
+    // distance triggered pictures are reported where and when they
+    // were taken
+    const Location &loc = _feedback.valid ? _feedback.location : current_loc;
+    uint64_t time_usec = gps.time_epoch_usec();
+    float roll = ahrs.roll_sensor/100.0f;
+    float pitch = ahrs.pitch_sensor/100.0f;
+    float yaw = ahrs.yaw_sensor/100.0f;
+    if (_feedback.valid) {
+        if (time_usec != 0) {
+            time_usec -= hal.scheduler->micros64() - _feedback.time_us;
+        }
+        roll = _feedback.roll_cd/100.0f;
+        pitch = _feedback.pitch_cd/100.0f;
+        yaw = _feedback.yaw_cd/100.0f;
+    }
+
     float altitude, altitude_rel;
-    if (current_loc.flags.relative_alt) {
-        altitude = current_loc.alt+ahrs.get_home().alt;
-        altitude_rel = current_loc.alt;
+    if (loc.flags.relative_alt) {
+        altitude = loc.alt+ahrs.get_home().alt;
+        altitude_rel = loc.alt;
     } else {
-        altitude = current_loc.alt;
-        altitude_rel = current_loc.alt - ahrs.get_home().alt;
+        altitude = loc.alt;
+        altitude_rel = loc.alt - ahrs.get_home().alt;
     }
 
     mavlink_msg_camera_feedback_send(chan, 
-        gps.time_epoch_usec(),
+        time_usec,
         0, 0, _image_index,
-        current_loc.lat, current_loc.lng,
+        loc.lat, loc.lng,
         altitude/100.0f, altitude_rel/100.0f,
-        ahrs.roll_sensor/100.0f, ahrs.pitch_sensor/100.0f, ahrs.yaw_sensor/100.0f,
+        roll, pitch, yaw,
         0.0f,CAMERA_FEEDBACK_PHOTO);
 }
 
 
-/*  update location, for triggering by GPS distance moved
-    This function returns true if a picture should be taken
-    The caller is responsible for taking the picture based on the return value of this function.
-    The caller is also responsible for logging the details about the photo
-*/
-bool AP_Camera::update_location(const struct Location &loc)
+/*
+  fire the shutter once the scheduled time has passed. Called at the
+  main loop rate, so the picture is at most one loop late
+ */
+void AP_Camera::update_fast(void)
 {
-    if (_trigg_dist == 0.0f) {
-        return false;
+    if (!_trigger_armed) {
+        return;
     }
-    if (_last_location.lat == 0 && _last_location.lng == 0) {
-        _last_location = loc;
-        return false;
+    uint64_t now = hal.scheduler->micros64();
+    if (now < _trigger_time_us) {
+        return;
     }
-    if (_last_location.lat == loc.lat && _last_location.lng == loc.lng) {
-        // we haven't moved - this can happen as update_location() may
-        // be called without a new GPS fix
+    _trigger_armed = false;
+    shutter();
+    _fired_time_us = now;
+    _trigger_fired = true;
+}
+
+/*
+  set the feedback to the state at time_us, between _prev_state and
+  s1. The position follows a cubic through both positions and
+  velocities, and the attitude is interpolated linearly
+ */
+void AP_Camera::interpolate_state(const LocalFrame &frame, const struct state &s1, uint64_t time_us)
+{
+    const struct state &s0 = _prev_state;
+    float T = (s1.time_us - s0.time_us) * 1.0e-6f;
+    float s = 1;
+    if (T > 0) {
+        s = constrain_float((int64_t)(time_us - s0.time_us) * 1.0e-6f / T, 0, 1);
+    }
+    float s2 = s*s;
+    float s3 = s2*s;
+    float h00 = 2*s3 - 3*s2 + 1;
+    float h10 = s3 - 2*s2 + s;
+    float h01 = -2*s3 + 3*s2;
+    float h11 = s3 - s2;
+
+    Vector2f p0 = frame.to_NE(s0.location);
+    Vector2f p1 = frame.to_NE(s1.location);
+    Vector2f v0(s0.velocity.x, s0.velocity.y);
+    Vector2f v1(s1.velocity.x, s1.velocity.y);
+    Vector2f p = p0*h00 + v0*(h10*T) + p1*h01 + v1*(h11*T);
+
+    _feedback.location = s1.location;
+    frame.from_NE(p, _feedback.location);
+    // altitude is in cm, and velocity is down
+    _feedback.location.alt = h00*s0.location.alt + h01*s1.location.alt
+        - 100*T*(h10*s0.velocity.z + h11*s1.velocity.z);
+
+    _feedback.roll_cd  = degrees(s0.roll + s*(s1.roll - s0.roll)) * 100;
+    _feedback.pitch_cd = degrees(s0.pitch + s*(s1.pitch - s0.pitch)) * 100;
+    _feedback.yaw_cd   = wrap_360_cd(degrees(s0.yaw + s*wrap_PI(s1.yaw - s0.yaw)) * 100);
+    _feedback.time_us  = time_us;
+    _feedback.valid    = true;
+}
+
+/*
+  distance triggering. The trigger time is where the straight line
+  distance from the last picture reaches TRIGG_DIST, assuming the
+  velocity holds. Only times before the next call are scheduled, so
+  each schedule uses a velocity at most one call old
+ */
+bool AP_Camera::update_trigger(AP_AHRS &ahrs)
+{
+    if (_trigg_dist <= 0.0f) {
+        _trigger_armed = false;
+        _last_location.lat = 0;
+        _last_location.lng = 0;
         return false;
     }
-    if (get_distance(loc, _last_location) < _trigg_dist) {
+
+    struct state s1;
+    s1.time_us = hal.scheduler->micros64();
+    if (!ahrs.get_position(s1.location)) {
+        _trigger_armed = false;
         return false;
     }
-    _last_location = loc;
-    return true;
+    if (!ahrs.get_velocity_NED(s1.velocity)) {
+        Vector2f groundspeed = ahrs.groundspeed_vector();
+        s1.velocity = Vector3f(groundspeed.x, groundspeed.y, 0);
+    }
+    s1.roll  = ahrs.roll;
+    s1.pitch = ahrs.pitch;
+    s1.yaw   = ahrs.yaw;
+
+    LocalFrame frame;
+    if (!ahrs.get_local_frame(frame)) {
+        frame.set_origin(s1.location);
+    }
+
+    bool fired = false;
+    if (_trigger_fired) {
+        _trigger_fired = false;
+        // the picture is reported, and the next distance measured,
+        // from where the shutter fired
+        interpolate_state(frame, s1, _fired_time_us);
+        _last_location = _feedback.location;
+        send_digicam_control();
+        fired = true;
+    }
+
+    float dt = constrain_float((s1.time_us - _prev_state.time_us) * 1.0e-6f, 0.005f, 0.1f);
+    _prev_state = s1;
+
+    if (_last_location.lat == 0 && _last_location.lng == 0) {
+        _last_location = s1.location;
+        return fired;
+    }
+
+    // solve |ofs + vel*t| = TRIGG_DIST for t
+    Vector2f ofs = frame.diff(_last_location, s1.location);
+    Vector2f vel(s1.velocity.x, s1.velocity.y);
+    float a = vel * vel;
+    float b = 2 * (ofs * vel);
+    float c = ofs * ofs - sq(_trigg_dist);
+    float t;
+    if (c >= 0) {
+        t = 0;
+    } else if (a < 0.01f) {
+        _trigger_armed = false;
+        return fired;
+    } else {
+        t = (-b + sqrtf(b*b - 4*a*c)) / (2*a);
+    }
+
+    if (t > 1.5f * dt) {
+        _trigger_armed = false;
+        return fired;
+    }
+    _trigger_armed = false;
+    _trigger_time_us = s1.time_us + (uint32_t)(t * 1.0e6f);
+    _trigger_armed = true;
+    return fired;
+}
+
+/*
+  log the last picture
+ */
+void AP_Camera::log_picture(DataFlash_Class &dataflash, const AP_GPS &gps, const AP_AHRS &ahrs, const Location &current_loc)
+{
+    if (_feedback.valid) {
+        dataflash.Log_Write_Camera(ahrs, gps, _feedback.location, _feedback.time_us / 1000,
+                                   _feedback.roll_cd, _feedback.pitch_cd, _feedback.yaw_cd);
+    } else {
+        dataflash.Log_Write_Camera(ahrs, gps, current_loc, hal.scheduler->millis(),
+                                   ahrs.roll_sensor, ahrs.pitch_sensor, ahrs.yaw_sensor);
+    }
 }
@@ -34,7 +34,9 @@ public:
     ///
     AP_Camera(AP_Relay *obj_relay) :
         _trigger_counter(0),    // count of number of cycles shutter has been held open
-        _image_index(0)
+        _image_index(0),
+        _trigger_armed(false),
+        _trigger_fired(false)
     {
 		AP_Param::setup_object_defaults(this, var_info);
         _apm_relay = obj_relay;
@@ -59,8 +61,20 @@ public:
     // set camera trigger distance in a mission
     void            set_trigger_distance(uint32_t distance_m) { _trigg_dist.set(distance_m); }
 
-    // Update location of vehicle and return true if a picture should be taken
-    bool update_location(const struct Location &loc);
+    // predict when the vehicle will have moved the trigger distance
+    // and schedule the shutter for that time. Should be called at 50Hz.
+    // Returns true if the shutter has fired since the last call, after
+    // which the picture should be logged
+    bool update_trigger(AP_AHRS &ahrs);
+
+    // fire the shutter once the time scheduled by update_trigger()
+    // has passed. Should be called at the main loop rate
+    void update_fast(void);
+
+    // log the last picture, at the position and attitude it was
+    // taken at for distance triggered pictures and at the current
+    // ones otherwise
+    void log_picture(DataFlash_Class &dataflash, const AP_GPS &gps, const AP_AHRS &ahrs, const Location &current_loc);
 
     static const struct AP_Param::GroupInfo        var_info[];
 
@@ -74,11 +88,40 @@ private:
 
     void            servo_pic();        // Servo operated camera
     void            relay_pic();        // basic relay activation
+    void            shutter();          // take a picture without telling other components
+    void            send_digicam_control(void);
 
     AP_Float        _trigg_dist;        // distance between trigger points (meters)
     struct Location _last_location;
     uint16_t        _image_index;       // number of pictures taken since boot
 
+    // distance triggering. update_trigger() works out the time the
+    // vehicle will reach the trigger distance from the vehicle state,
+    // and update_fast() fires the shutter when that time passes. The
+    // next update_trigger() measures the next distance from the
+    // position at the firing time, interpolated between the states
+    // either side of it. Times are from micros64() so they don't wrap
+    struct state {
+        uint64_t time_us;
+        struct Location location;
+        Vector3f velocity;              // NED m/s
+        float roll, pitch, yaw;         // radians
+    } _prev_state;
+    uint64_t        _trigger_time_us;
+    bool            _trigger_armed;
+    bool            _trigger_fired;
+    uint64_t        _fired_time_us;
+    void            interpolate_state(const LocalFrame &frame, const struct state &s1, uint64_t time_us);
+
+    // position and attitude of the last distance triggered picture
+    struct {
+        bool valid;
+        uint64_t time_us;
+        struct Location location;
+        int16_t roll_cd, pitch_cd;
+        uint16_t yaw_cd;
+    } _feedback;
+
 };
 
 #endif /* AP_CAMERA_H */
@@ -79,6 +79,42 @@ public:
       will be used to convert channel writes into a percentage
      */
     virtual void     set_esc_scaling(uint16_t min_pwm, uint16_t max_pwm) {}
+
+    /*
+      output modes. In the oneshot modes a channel sends a single
+      pulse for each write, or for each push() when corked, instead of
+      free-running at the rate given to set_freq(), so a new value
+      reaches the ESC as soon as it is written. MODE_PWM_ONESHOT125
+      sends pulses an eighth of the length written, for ESCs that take
+      125 to 250 microsecond pulses
+     */
+    enum output_mode {
+        MODE_PWM_NORMAL,
+        MODE_PWM_ONESHOT,
+        MODE_PWM_ONESHOT125
+    };
+
+    /*
+      set the output mode of a set of channels. Boards that can't
+      trigger single pulses run MODE_PWM_ONESHOT channels as normal
+      PWM, and free-run MODE_PWM_ONESHOT125 channels at the fastest
+      rate their pulses allow
+     */
+    virtual void     set_output_mode(uint32_t chmask, enum output_mode mode) {}
+
+    /*
+      hold back writes until push() is called. Between cork() and
+      push() write() only records the new periods, and push() then
+      sends all of the channels written in one operation, so that a
+      set of motors changes together. Boards that don't implement
+      this write through immediately as before
+     */
+    virtual void     cork(void) {}
+
+    /*
+      send the writes held back since cork()
+     */
+    virtual void     push(void) {}
 };
 
 #endif // __AP_HAL_RC_OUTPUT_H__
@@ -10,6 +10,15 @@ public:
     virtual void init(void *) = 0;
     virtual void read_block(void *dst, uint16_t src, size_t n) = 0;
     virtual void write_block(uint16_t dst, const void* src, size_t n) = 0;
+
+    /*
+      group writes that have to reach storage together, such as a
+      parameter and the header after it. Boards that journal their
+      storage commit the writes made between begin_transaction() and
+      the matching end_transaction() in one go. Calls may nest
+     */
+    virtual void begin_transaction(void) {}
+    virtual void end_transaction(void) {}
 };
 
 #endif // __AP_HAL_STORAGE_H__
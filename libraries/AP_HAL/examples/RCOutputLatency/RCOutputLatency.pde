@@ -0,0 +1,169 @@
+/*
+  measure the time from writing a set of motor outputs to the new
+  values reaching the outputs, for normal PWM and the oneshot modes.
+
+  Each sample writes new values to the motor channels between cork()
+  and push(), as AP_Motors does after the mixer, then polls read()
+  until every channel has the new value. On SITL read() gives what the
+  simulated ESCs have received, on the PRU boards what the PRU is
+  sending. The latency is to the last channel updating, the skew is
+  the time between the first and last channel updating. Samples are
+  spread at random over the PWM period, so free-running outputs show
+  their average wait for the next period
+ */
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_PX4.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_Empty.h>
+#include <AP_Common.h>
+#include <AP_Baro.h>
+#include <AP_ADC.h>
+#include <AP_GPS.h>
+#include <AP_InertialSensor.h>
+#include <AP_Notify.h>
+#include <DataFlash.h>
+#include <GCS_MAVLink.h>
+#include <AP_Mission.h>
+#include <StorageManager.h>
+#include <AP_Terrain.h>
+#include <AP_Compass.h>
+#include <AP_Declination.h>
+#include <SITL.h>
+#include <Filter.h>
+#include <AP_Param.h>
+#include <AP_Progmem.h>
+#include <AP_Math.h>
+#include <AP_AHRS.h>
+#include <AP_Airspeed.h>
+#include <AP_Vehicle.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_NavEKF.h>
+#include <AP_Rally.h>
+#include <AP_Scheduler.h>
+#include <UARTDriver.h>
+#include <AP_BattMonitor.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_MOTORS      4
+#define LOOP_MICROS     2500    // a 400Hz control loop
+#define NUM_SAMPLES     400
+#define TIMEOUT_MICROS  50000
+
+static uint32_t seed = 1;
+
+// a random delay of up to max_us
+static uint32_t random_delay(uint32_t max_us)
+{
+    seed = seed * 1103515245UL + 12345;
+    return (seed >> 8) % max_us;
+}
+
+static const struct {
+    const char *name;
+    enum AP_HAL::RCOutput::output_mode mode;
+    uint16_t freq_hz;
+} tests[] = {
+    { "PWM 50Hz",   AP_HAL::RCOutput::MODE_PWM_NORMAL,     50 },
+    { "PWM 490Hz",  AP_HAL::RCOutput::MODE_PWM_NORMAL,     490 },
+    { "OneShot",    AP_HAL::RCOutput::MODE_PWM_ONESHOT,    490 },
+    { "OneShot125", AP_HAL::RCOutput::MODE_PWM_ONESHOT125, 490 },
+};
+
+void setup (void)
+{
+    hal.console->println("RCOutput latency test");
+    for (uint8_t i=0; i<NUM_MOTORS; i++) {
+        hal.rcout->enable_ch(i);
+    }
+}
+
+static void run_test(uint8_t t)
+{
+    const uint32_t mask = (1U<<NUM_MOTORS)-1;
+    hal.rcout->set_freq(mask, tests[t].freq_hz);
+    hal.rcout->set_output_mode(mask, tests[t].mode);
+
+    uint32_t latency_min = 0xFFFFFFFF;
+    uint32_t latency_max = 0;
+    uint32_t skew_max = 0;
+    uint64_t latency_sum = 0;
+    uint16_t count = 0;
+    uint16_t timeouts = 0;
+
+    const uint32_t period = 1000000UL / tests[t].freq_hz;
+    for (uint16_t i=0; i<NUM_SAMPLES; i++) {
+        // start each sample at a random point in a control loop and
+        // in the PWM period
+        uint32_t next_loop = hal.scheduler->micros() + random_delay(max(period, (uint32_t)LOOP_MICROS));
+        while ((int32_t)(hal.scheduler->micros() - next_loop) < 0) {
+            hal.scheduler->delay_microseconds(50);
+        }
+
+        // a value that differs from the last one on every channel
+        uint16_t pwm = 1100 + (i * 37) % 800;
+
+        uint32_t start = hal.scheduler->micros();
+        hal.rcout->cork();
+        for (uint8_t ch=0; ch<NUM_MOTORS; ch++) {
+            hal.rcout->write(ch, pwm + ch);
+        }
+        hal.rcout->push();
+
+        uint32_t done = 0;
+        uint32_t first = 0;
+        uint32_t elapsed = 0;
+        while (done != mask && elapsed < TIMEOUT_MICROS) {
+            uint32_t seen = 0;
+            for (uint8_t ch=0; ch<NUM_MOTORS; ch++) {
+                int16_t diff = hal.rcout->read(ch) - (pwm + ch);
+                if (!(done & (1U<<ch)) && diff >= -1 && diff <= 1) {
+                    seen |= 1U<<ch;
+                }
+            }
+            elapsed = hal.scheduler->micros() - start;
+            if (seen != 0 && done == 0) {
+                first = elapsed;
+            }
+            done |= seen;
+        }
+        if (done != mask) {
+            timeouts++;
+            continue;
+        }
+
+        count++;
+        latency_sum += elapsed;
+        latency_min = min(latency_min, elapsed);
+        latency_max = max(latency_max, elapsed);
+        skew_max = max(skew_max, elapsed - first);
+    }
+
+    if (count == 0) {
+        hal.console->printf("%-10s %3uHz  no outputs seen, %u timeouts\n",
+                            tests[t].name, (unsigned)tests[t].freq_hz, (unsigned)timeouts);
+        return;
+    }
+    hal.console->printf("%-10s %3uHz  latency min %5lu avg %5lu max %5lu us  skew max %4lu us  timeouts %u\n",
+                        tests[t].name,
+                        (unsigned)tests[t].freq_hz,
+                        (unsigned long)latency_min,
+                        (unsigned long)(latency_sum / count),
+                        (unsigned long)latency_max,
+                        (unsigned long)skew_max,
+                        (unsigned)timeouts);
+}
+
+void loop (void)
+{
+    for (uint8_t t=0; t<sizeof(tests)/sizeof(tests[0]); t++) {
+        run_test(t);
+    }
+    hal.rcout->set_output_mode((1U<<NUM_MOTORS)-1, AP_HAL::RCOutput::MODE_PWM_NORMAL);
+    hal.console->println();
+    hal.scheduler->delay(5000);
+}
+
+AP_HAL_MAIN();
@@ -5,14 +5,26 @@
 
 using namespace AVR_SITL;
 
+extern const AP_HAL::HAL& hal;
+
 void SITLRCOutput::init(void* machtnichts) {}
 
 void SITLRCOutput::set_freq(uint32_t chmask, uint16_t freq_hz) {
-    _freq_hz = freq_hz;
+    if (freq_hz == 0) {
+        return;
+    }
+    for (uint8_t i=0; i<11; i++) {
+        if (chmask & (1U << i)) {
+            _freq_hz[i] = freq_hz;
+        }
+    }
 }
 
 uint16_t SITLRCOutput::get_freq(uint8_t ch) {
-    return _freq_hz;
+    if (ch < 11) {
+        return _freq_hz[ch];
+    }
+    return 50;
 }
 
 void SITLRCOutput::enable_ch(uint8_t ch)
@@ -24,18 +36,29 @@ void SITLRCOutput::disable_ch(uint8_t ch)
 void SITLRCOutput::write(uint8_t ch, uint16_t period_us)
 {
     if (ch < 11) {
-	_sitlState->pwm_output[ch] = period_us;
+        if (_corked) {
+            _pending[ch] = period_us;
+            _pending_mask |= (1U << ch);
+        } else {
+            send_pulse(ch, period_us, hal.scheduler->micros());
+        }
     }
 }
 
 void SITLRCOutput::write(uint8_t ch, uint16_t* period_us, uint8_t len)
 {
-	memcpy(_sitlState->pwm_output+ch, period_us, len*sizeof(uint16_t));
+    for (uint8_t i=0; i<len; i++) {
+        write(ch+i, period_us[i]);
+    }
 }
 
 uint16_t SITLRCOutput::read(uint8_t ch) 
 {
     if (ch < 11) {
+        if (_pending_mask & (1U << ch)) {
+            return _pending[ch];
+        }
+        _sitlState->update_pwm_output();
 	return _sitlState->pwm_output[ch];
     }
     return 0;
@@ -43,7 +66,75 @@ uint16_t SITLRCOutput::read(uint8_t ch)
 
 void SITLRCOutput::read(uint16_t* period_us, uint8_t len)
 {
-	memcpy(period_us, _sitlState->pwm_output, len*sizeof(uint16_t));
+    for (uint8_t i=0; i<len; i++) {
+        period_us[i] = read(i);
+    }
+}
+
+void SITLRCOutput::cork(void)
+{
+    _corked = true;
+}
+
+/*
+  copy the held back writes to the simulator in one go, so the physics
+  never sees a frame with only some of the motors updated
+ */
+void SITLRCOutput::push(void)
+{
+    _corked = false;
+    if (_pending_mask == 0) {
+        return;
+    }
+    uint32_t now = hal.scheduler->micros();
+    for (uint8_t ch=0; ch<11; ch++) {
+        if (_pending_mask & (1U << ch)) {
+            send_pulse(ch, _pending[ch], now);
+        }
+    }
+    _pending_mask = 0;
+}
+
+void SITLRCOutput::set_output_mode(uint32_t chmask, enum output_mode mode)
+{
+    _oneshot_mask &= ~chmask;
+    _oneshot125_mask &= ~chmask;
+    switch (mode) {
+    case MODE_PWM_ONESHOT:
+        _oneshot_mask |= chmask;
+        break;
+    case MODE_PWM_ONESHOT125:
+        _oneshot125_mask |= chmask;
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+  work out when the pulse carrying a new value goes out and hand it to
+  the simulator. Free-running PWM only picks up the new value at the
+  start of its next period, which is up to 1/freq away, while a oneshot
+  pulse starts straight away unless the last one is still going
+ */
+void SITLRCOutput::send_pulse(uint8_t ch, uint16_t period_us, uint32_t now)
+{
+    uint32_t width = period_us;
+    uint32_t start;
+    if (_oneshot125_mask & (1U << ch)) {
+        width /= 8;
+    }
+    if ((_oneshot_mask | _oneshot125_mask) & (1U << ch)) {
+        start = now;
+        if ((int32_t)(_pulse_end[ch] - now) > 0) {
+            start = _pulse_end[ch];
+        }
+    } else {
+        uint32_t period = 1000000UL / _freq_hz[ch];
+        start = now + period - (now % period);
+    }
+    _pulse_end[ch] = start + width;
+    _sitlState->output_pulse(ch, period_us, start, _pulse_end[ch]);
 }
 
 #endif
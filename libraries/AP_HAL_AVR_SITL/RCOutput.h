@@ -10,7 +10,14 @@ class AVR_SITL::SITLRCOutput : public AP_HAL::RCOutput {
 public:
     SITLRCOutput(SITL_State *sitlState) {
 	    _sitlState = sitlState;
-	    _freq_hz = 50;
+	    for (uint8_t i=0; i<11; i++) {
+	        _freq_hz[i] = 50;
+	        _pulse_end[i] = 0;
+	    }
+	    _oneshot_mask = 0;
+	    _oneshot125_mask = 0;
+	    _corked = false;
+	    _pending_mask = 0;
     }
     void     init(void* machtnichts);
     void     set_freq(uint32_t chmask, uint16_t freq_hz);
@@ -21,10 +28,26 @@ public:
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     set_output_mode(uint32_t chmask, enum output_mode mode);
+    void     cork(void);
+    void     push(void);
 
 private:    
     SITL_State *_sitlState;
-    uint16_t _freq_hz;
+    uint16_t _freq_hz[11];
+
+    // channels in each of the oneshot modes
+    uint16_t _oneshot_mask;
+    uint16_t _oneshot125_mask;
+
+    // when the last pulse sent on each channel ends
+    uint32_t _pulse_end[11];
+    void send_pulse(uint8_t ch, uint16_t period_us, uint32_t now);
+
+    // writes held back between cork() and push()
+    bool _corked;
+    uint16_t _pending_mask;
+    uint16_t _pending[11];
 };
 
 #endif
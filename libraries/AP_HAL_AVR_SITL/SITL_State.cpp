@@ -475,6 +475,49 @@ void SITL_State::_apply_servo_filter(float deltat)
 }
 
 
+void SITL_State::output_pulse(uint8_t ch, uint16_t pwm, uint32_t start_us, uint32_t end_us)
+{
+    if (ch >= 11) {
+        return;
+    }
+    if (_sitl != NULL && !_sitl->pwm_timing) {
+        pwm_output[ch] = pwm;
+        return;
+    }
+
+    update_pwm_output();
+
+    pthread_mutex_lock(&_pwm_pulse_mutex);
+    uint32_t now = hal.scheduler->micros();
+    uint8_t &n = _num_pwm_pulses[ch];
+    if (n > 0 && (int32_t)(now - _pwm_pulses[ch][0].start_us) >= 0) {
+        // the first pulse is already under way and finishes first
+        n = 1;
+    } else {
+        n = 0;
+    }
+    _pwm_pulses[ch][n].pwm = pwm;
+    _pwm_pulses[ch][n].start_us = start_us;
+    _pwm_pulses[ch][n].end_us = end_us;
+    n++;
+    pthread_mutex_unlock(&_pwm_pulse_mutex);
+}
+
+void SITL_State::update_pwm_output(void)
+{
+    pthread_mutex_lock(&_pwm_pulse_mutex);
+    uint32_t now = hal.scheduler->micros();
+    for (uint8_t i=0; i<11; i++) {
+        while (_num_pwm_pulses[i] > 0 &&
+               (int32_t)(now - _pwm_pulses[i][0].end_us) >= 0) {
+            pwm_output[i] = _pwm_pulses[i][0].pwm;
+            _pwm_pulses[i][0] = _pwm_pulses[i][1];
+            _num_pwm_pulses[i]--;
+        }
+    }
+    pthread_mutex_unlock(&_pwm_pulse_mutex);
+}
+
 /*
   send RC outputs to simulator
  */
@@ -519,6 +562,7 @@ void SITL_State::_simulator_output(bool synthetic_clock_mode)
     float deltat = (now - last_update_usec) * 1.0e-6f;
 	last_update_usec = now;
 
+    update_pwm_output();
     _apply_servo_filter(deltat);
 
 	for (i=0; i<11; i++) {
@@ -621,6 +665,7 @@ void SITL_State::init(int argc, char * const argv[])
     pwm_input[2] = pwm_input[5] = pwm_input[6] = 1000;
 
     _scheduler = (SITLScheduler *)hal.scheduler;
+    pthread_mutex_init(&_pwm_pulse_mutex, NULL);
 	_parse_command_line(argc, argv);
 }
 
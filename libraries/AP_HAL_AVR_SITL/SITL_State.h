@@ -46,6 +46,14 @@ public:
     void loop_hook(void);
     uint16_t base_port(void) const { return _base_port; }
 
+    // send a pulse carrying pwm on output channel ch, starting at
+    // start_us. The simulated ESC or servo acts on it once it ends at
+    // end_us, unless SIM_PWM_TIMING is off
+    void output_pulse(uint8_t ch, uint16_t pwm, uint32_t start_us, uint32_t end_us);
+
+    // move the pulses that have ended into pwm_output
+    void update_pwm_output(void);
+
     // simulated airspeed, sonar and battery monitor
     uint16_t sonar_pin_value;    // pin 0
     uint16_t airspeed_pin_value; // pin 1
@@ -103,6 +111,16 @@ private:
     void _fdm_input(void);
     void _simulator_output(bool synthetic_clock_mode);
     void _apply_servo_filter(float deltat);
+
+    // pulses on their way to each output. Only the first can have
+    // started, a later write replaces the second
+    struct pwm_pulse {
+        uint16_t pwm;
+        uint32_t start_us;
+        uint32_t end_us;
+    } _pwm_pulses[11][2];
+    uint8_t _num_pwm_pulses[11];
+    pthread_mutex_t _pwm_pulse_mutex;
     uint16_t _airspeed_sensor(float airspeed);
     uint16_t _ground_sonar();
     float _gyro_drift(void);
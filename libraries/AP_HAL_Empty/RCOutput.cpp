@@ -30,3 +30,8 @@ uint16_t EmptyRCOutput::read(uint8_t ch) {
 void EmptyRCOutput::read(uint16_t* period_us, uint8_t len)
 {}
 
+void EmptyRCOutput::cork(void)
+{}
+
+void EmptyRCOutput::push(void)
+{}
@@ -14,6 +14,8 @@ class Empty::EmptyRCOutput : public AP_HAL::RCOutput {
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     cork(void);
+    void     push(void);
 };
 
 #endif // __AP_HAL_EMPTY_RCOUTPUT_H__
@@ -49,6 +49,9 @@ void LinuxRCOutput_AioPRU::init(void* machtnicht)
 
    close(mem_fd);
 
+   corked = false;
+   pending_mask = 0;
+
    // Reset PRU 1
    *ctrl = 0;
    hal.scheduler->delay(1);
@@ -106,7 +109,12 @@ void LinuxRCOutput_AioPRU::disable_ch(uint8_t ch)
 void LinuxRCOutput_AioPRU::write(uint8_t ch, uint16_t period_us)
 {
    if(ch < PWM_CHAN_COUNT) {
-      pwm->channel[ch].time_high = TICK_PER_US * period_us;
+      if(corked) {
+         pending[ch] = TICK_PER_US * period_us;
+         pending_mask |= 1U << ch;
+      } else {
+         pwm->channel[ch].time_high = TICK_PER_US * period_us;
+      }
    }
 }
 
@@ -147,5 +155,24 @@ void LinuxRCOutput_AioPRU::read(uint16_t* period_us, uint8_t len)
    }
 }
 
+void LinuxRCOutput_AioPRU::cork(void)
+{
+   corked = true;
+}
+
+void LinuxRCOutput_AioPRU::push(void)
+{
+   uint8_t i;
+
+   corked = false;
+
+   for(i = 0; i < PWM_CHAN_COUNT && pending_mask != 0; i++) {
+      if(pending_mask & (1U << i)) {
+         pwm->channel[i].time_high = pending[i];
+         pending_mask &= ~(1U << i);
+      }
+   }
+}
+
 #endif
 
@@ -29,6 +29,8 @@ class Linux::LinuxRCOutput_AioPRU : public AP_HAL::RCOutput {
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     cork(void);
+    void     push(void);
 
 private:
    static const uint32_t TICK_PER_US = 200;
@@ -43,6 +45,11 @@ private:
     };
 
     volatile struct pwm *pwm;
+
+    // high times written since cork() and not yet pushed
+    bool corked;
+    uint16_t pending_mask;
+    uint32_t pending[PWM_CHAN_COUNT];
 };
 
 #endif // __AP_HAL_LINUX_RCOUTPUT_AIOPRU_H__
@@ -47,6 +47,18 @@
 using namespace Linux;
 
 #define PWM_CHAN_COUNT 13
+
+/*
+  the PCA9685 can't send single pulses, so MODE_PWM_ONESHOT channels
+  free-run as normal PWM. With OneShot125 channels the whole chip
+  free-runs at 1500Hz, the fastest prescaler with the 24.576MHz
+  clock. A normal servo pulse doesn't fit in the 667us period, so
+  set_output_mode() only picks OneShot125 if no other channel is in
+  use yet, and other channels are then held low. The prescaler is only
+  changed from set_freq() and set_output_mode(), as reprogramming it
+  stops every output for a period
+ */
+#define PCA9685_ONESHOT125_FREQ    1500
 #define PCA9685_OUTPUT_ENABLE RPI_GPIO_27
 
 static const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
@@ -55,7 +67,12 @@ LinuxRCOutput_Navio::LinuxRCOutput_Navio():
     _i2c_sem(NULL),
     enable_pin(NULL),
     _frequency(50),
-    _pulses_buffer(new uint16_t[PWM_CHAN_COUNT])
+    _pwm_frequency(50),
+    _oneshot125_mask(0),
+    _active_mask(0),
+    _pulses_buffer(new uint16_t[PWM_CHAN_COUNT]()),
+    _corked(false),
+    _pending_write_mask(0)
 {
 }
 
@@ -107,6 +124,11 @@ void LinuxRCOutput_Navio::set_freq(uint32_t chmask, uint16_t freq_hz)
         write(i, _pulses_buffer[i]);
     }
 
+    _pwm_frequency = freq_hz;
+    if (_oneshot125_mask != 0) {
+        freq_hz = PCA9685_ONESHOT125_FREQ;
+    }
+
     if (!_i2c_sem->take(10)) {
         return;
     }
@@ -142,7 +164,9 @@ uint16_t LinuxRCOutput_Navio::get_freq(uint8_t ch)
 
 void LinuxRCOutput_Navio::enable_ch(uint8_t ch)
 {
-
+    if (ch < PWM_CHAN_COUNT) {
+        _active_mask |= (1U << ch);
+    }
 }
 
 void LinuxRCOutput_Navio::disable_ch(uint8_t ch)
@@ -150,22 +174,44 @@ void LinuxRCOutput_Navio::disable_ch(uint8_t ch)
     write(ch, 0);
 }
 
+uint16_t LinuxRCOutput_Navio::period_to_length(uint8_t ch, uint16_t period_us) const
+{
+    if (period_us == 0) {
+        return 0;
+    }
+    float width = period_us;
+    if (_oneshot125_mask & (1U << ch)) {
+        width *= 0.125f;
+    } else if (_oneshot125_mask != 0) {
+        // a normal pulse doesn't fit in the OneShot125 period
+        return 0;
+    }
+    return round((width * 4096) / (1000000.f / _frequency)) - 1;
+}
+
 void LinuxRCOutput_Navio::write(uint8_t ch, uint16_t period_us)
 {
     if(ch >= PWM_CHAN_COUNT){
         return;
     }
 
-    if (!_i2c_sem->take_nonblocking()) {
+    if (period_us == 0) {
+        _active_mask &= ~(1U << ch);
+    } else {
+        _active_mask |= (1U << ch);
+    }
+
+    if (_corked) {
+        _pulses_buffer[ch] = period_us;
+        _pending_write_mask |= (1U << ch);
         return;
     }
 
-    uint16_t length;
+    if (!_i2c_sem->take_nonblocking()) {
+        return;
+    }
 
-    if (period_us == 0)
-        length = 0;
-    else
-        length = round((period_us * 4096) / (1000000.f / _frequency)) - 1;
+    uint16_t length = period_to_length(ch, period_us);
 
     uint8_t data[2] = {length & 0xFF, length >> 8};
     uint8_t status = hal.i2c->writeRegisters(PCA9685_ADDRESS,
@@ -195,4 +241,76 @@ void LinuxRCOutput_Navio::read(uint16_t* period_us, uint8_t len)
         period_us[i] = read(0 + i);
 }
 
+void LinuxRCOutput_Navio::set_output_mode(uint32_t chmask, enum output_mode mode)
+{
+    chmask &= (1U << PWM_CHAN_COUNT) - 1;
+    _oneshot125_mask &= ~chmask;
+
+    // MODE_PWM_ONESHOT runs as normal PWM
+    if (mode == MODE_PWM_ONESHOT125) {
+        if (_active_mask & ~(_oneshot125_mask | chmask)) {
+            // other channels are already sending normal pulses, so
+            // stay at normal PWM rather than stopping them
+            hal.console->printf("RCOutput: OneShot125 not used, other outputs are in use\n");
+        } else {
+            _oneshot125_mask |= chmask;
+        }
+    }
+
+    // set the chip rate for the new mode
+    set_freq(chmask, _pwm_frequency);
+}
+
+void LinuxRCOutput_Navio::cork(void)
+{
+    _corked = true;
+}
+
+/*
+  send every channel from the lowest to the highest one written since
+  cork() in a single auto-incremented transfer. The PCA9685 latches
+  new outputs on the I2C stop condition, so all of them change
+  together. Channels in between that weren't written are sent again
+  with their current values
+ */
+void LinuxRCOutput_Navio::push(void)
+{
+    _corked = false;
+    if (_pending_write_mask == 0) {
+        return;
+    }
+
+    if (!_i2c_sem->take_nonblocking()) {
+        // leave the writes pending for the next push()
+        return;
+    }
+
+    uint8_t first = 0;
+    while (!(_pending_write_mask & (1U << first))) {
+        first++;
+    }
+    uint8_t last = PWM_CHAN_COUNT - 1;
+    while (!(_pending_write_mask & (1U << last))) {
+        last--;
+    }
+
+    uint8_t data[4 * PWM_CHAN_COUNT];
+    uint8_t len = 0;
+    for (uint8_t ch = first; ch <= last; ch++) {
+        uint16_t length = period_to_length(ch, _pulses_buffer[ch]);
+        data[len++] = 0;
+        data[len++] = 0;
+        data[len++] = length & 0xFF;
+        data[len++] = length >> 8;
+    }
+
+    hal.i2c->writeRegisters(PCA9685_ADDRESS,
+                            PCA9685_RA_LED0_ON_L + 4 * (first + 3),
+                            len,
+                            data);
+    _pending_write_mask = 0;
+
+    _i2c_sem->give();
+}
+
 #endif // CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NAVIO
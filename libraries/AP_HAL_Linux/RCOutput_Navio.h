@@ -18,15 +18,31 @@ class Linux::LinuxRCOutput_Navio : public AP_HAL::RCOutput {
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     set_output_mode(uint32_t chmask, enum output_mode mode);
+    void     cork(void);
+    void     push(void);
 
 private:
     void reset();
+    uint16_t period_to_length(uint8_t ch, uint16_t period_us) const;
 
     AP_HAL::Semaphore *_i2c_sem;
     AP_HAL::DigitalSource *enable_pin;
     uint16_t _frequency;
 
+    // the rate asked for by set_freq(), which OneShot125 overrides
+    uint16_t _pwm_frequency;
+    uint16_t _oneshot125_mask;
+
+    // channels enabled or sending pulses, which decide whether
+    // set_output_mode() can use OneShot125
+    uint16_t _active_mask;
+
     uint16_t *_pulses_buffer;
+
+    // channels written since cork() and not yet sent
+    bool _corked;
+    uint16_t _pending_write_mask;
 };
 
 #endif // __AP_HAL_LINUX_RCOUTPUT_NAVIO_H__
@@ -21,6 +21,14 @@ using namespace Linux;
 
 #define PWM_CHAN_COUNT 12
 
+/*
+  the PRU firmware free-runs every channel and can't send single
+  pulses, so MODE_PWM_ONESHOT channels run as normal PWM. OneShot125
+  channels run at 2kHz, leaving at least 250us between pulses for the
+  ESCs
+ */
+#define PWM_ONESHOT125_PERIOD_US 500
+
 static const uint8_t chan_pru_map[]= {10,8,11,9,7,6,5,4,3,2,1,0};                //chan_pru_map[CHANNEL_NUM] = PRU_REG_R30/31_NUM;
 static const uint8_t pru_chan_map[]= {11,10,9,8,7,6,5,4,1,3,0,2};                //pru_chan_map[PRU_REG_R30/31_NUM] = CHANNEL_NUM;
 
@@ -38,6 +46,10 @@ void LinuxRCOutput_PRU::init(void* machtnicht)
                                             MAP_SHARED, mem_fd, RCOUT_PRUSS_SHAREDRAM_BASE);
     close(mem_fd);
 
+    _corked = false;
+    _pending_mask = 0;
+    _oneshot125_mask = 0;
+
     // all outputs default to 50Hz, the top level vehicle code
     // overrides this when necessary
     set_freq(0xFFFFFFFF, 50);
@@ -50,7 +62,10 @@ void LinuxRCOutput_PRU::set_freq(uint32_t chmask, uint16_t freq_hz)            /
 
     for (i=0;i<PWM_CHAN_COUNT;i++) {
         if (chmask & (1U<<i)) {
-            sharedMem_cmd->periodhi[chan_pru_map[i]][0]=tick;
+            _pwm_freq[i] = freq_hz;
+            if (!(_oneshot125_mask & (1U<<i))) {
+                sharedMem_cmd->periodhi[chan_pru_map[i]][0]=tick;
+            }
         }
     }
 }
@@ -70,9 +85,25 @@ void LinuxRCOutput_PRU::disable_ch(uint8_t ch)
     sharedMem_cmd->enmask &= !(1U<<chan_pru_map[ch]);
 }
 
+uint32_t LinuxRCOutput_PRU::period_to_ticks(uint8_t ch, uint16_t period_us) const
+{
+    if (_oneshot125_mask & (1U<<ch)) {
+        return TICK_PER_US*period_us/8;
+    }
+    return TICK_PER_US*period_us;
+}
+
 void LinuxRCOutput_PRU::write(uint8_t ch, uint16_t period_us)
 {
-    sharedMem_cmd->periodhi[chan_pru_map[ch]][1] = TICK_PER_US*period_us;
+    if (ch >= PWM_CHAN_COUNT) {
+        return;
+    }
+    if (_corked) {
+        _pending[ch] = period_to_ticks(ch, period_us);
+        _pending_mask |= 1U<<ch;
+        return;
+    }
+    sharedMem_cmd->periodhi[chan_pru_map[ch]][1] = period_to_ticks(ch, period_us);
 }
 
 void LinuxRCOutput_PRU::write(uint8_t ch, uint16_t* period_us, uint8_t len)
@@ -88,7 +119,14 @@ void LinuxRCOutput_PRU::write(uint8_t ch, uint16_t* period_us, uint8_t len)
 
 uint16_t LinuxRCOutput_PRU::read(uint8_t ch)
 {
-    return (sharedMem_cmd->hilo_read[chan_pru_map[ch]][1]/TICK_PER_US);
+    if (ch >= PWM_CHAN_COUNT) {
+        return 0;
+    }
+    uint32_t ticks = sharedMem_cmd->hilo_read[chan_pru_map[ch]][1];
+    if (_oneshot125_mask & (1U<<ch)) {
+        ticks *= 8;
+    }
+    return ticks/TICK_PER_US;
 }
 
 void LinuxRCOutput_PRU::read(uint16_t* period_us, uint8_t len)
@@ -98,7 +136,44 @@ void LinuxRCOutput_PRU::read(uint16_t* period_us, uint8_t len)
         len = PWM_CHAN_COUNT;
     }
     for(i=0;i<len;i++){
-        period_us[i] = sharedMem_cmd->hilo_read[chan_pru_map[i]][1]/TICK_PER_US;
+        period_us[i] = read(i);
+    }
+}
+
+void LinuxRCOutput_PRU::set_output_mode(uint32_t chmask, enum output_mode mode)
+{
+    uint8_t i;
+    for (i=0;i<PWM_CHAN_COUNT;i++) {
+        if (!(chmask & (1U<<i))) {
+            continue;
+        }
+        if (mode == MODE_PWM_ONESHOT125) {
+            _oneshot125_mask |= 1U<<i;
+            sharedMem_cmd->periodhi[chan_pru_map[i]][0] = TICK_PER_US*PWM_ONESHOT125_PERIOD_US;
+        } else {
+            _oneshot125_mask &= ~(1U<<i);
+            sharedMem_cmd->periodhi[chan_pru_map[i]][0] = TICK_PER_S/_pwm_freq[i];
+        }
+    }
+}
+
+void LinuxRCOutput_PRU::cork(void)
+{
+    _corked = true;
+}
+
+/*
+  copy the held back high times to the PRU back to back. The PRU
+  firmware picks them up at the start of each channel's next period
+ */
+void LinuxRCOutput_PRU::push(void)
+{
+    _corked = false;
+    for (uint8_t i=0; i<PWM_CHAN_COUNT && _pending_mask != 0; i++) {
+        if (_pending_mask & (1U<<i)) {
+            sharedMem_cmd->periodhi[chan_pru_map[i]][1] = _pending[i];
+            _pending_mask &= ~(1U<<i);
+        }
     }
 }
 
@@ -25,6 +25,9 @@ class Linux::LinuxRCOutput_PRU : public AP_HAL::RCOutput {
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     set_output_mode(uint32_t chmask, enum output_mode mode);
+    void     cork(void);
+    void     push(void);
 
 private:
     static const int TICK_PER_US=200;
@@ -39,6 +42,16 @@ private:
     };
     volatile struct pwm_cmd *sharedMem_cmd;
 
+    // the rates asked for by set_freq() and the OneShot125 channels,
+    // which run faster
+    uint16_t _pwm_freq[MAX_PWMS];
+    uint16_t _oneshot125_mask;
+    uint32_t period_to_ticks(uint8_t ch, uint16_t period_us) const;
+
+    // high times written since cork() and not yet pushed
+    bool _corked;
+    uint16_t _pending_mask;
+    uint32_t _pending[MAX_PWMS];
 };
 
 #endif // __AP_HAL_LINUX_RCOUTPUT_PRU_H__
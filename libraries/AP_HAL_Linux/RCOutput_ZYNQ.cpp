@@ -34,6 +34,9 @@ void LinuxRCOutput_ZYNQ::init(void* machtnicht)
                                             MAP_SHARED, mem_fd, RCOUT_ZYNQ_PWM_BASE);
     close(mem_fd);
 
+    _corked = false;
+    _pending_mask = 0;
+
     // all outputs default to 50Hz, the top level vehicle code
     // overrides this when necessary
     set_freq(0xFFFFFFFF, 50);
@@ -68,6 +71,14 @@ void LinuxRCOutput_ZYNQ::disable_ch(uint8_t ch)
 
 void LinuxRCOutput_ZYNQ::write(uint8_t ch, uint16_t period_us)
 {
+    if (ch >= PWM_CHAN_COUNT) {
+        return;
+    }
+    if (_corked) {
+        _pending[ch] = TICK_PER_US*period_us;
+        _pending_mask |= 1U<<ch;
+        return;
+    }
     sharedMem_cmd->periodhi[ch].hi = TICK_PER_US*period_us;
 }
 
@@ -98,4 +109,20 @@ void LinuxRCOutput_ZYNQ::read(uint16_t* period_us, uint8_t len)
     }
 }
 
+void LinuxRCOutput_ZYNQ::cork(void)
+{
+    _corked = true;
+}
+
+void LinuxRCOutput_ZYNQ::push(void)
+{
+    _corked = false;
+    for (uint8_t i=0; i<PWM_CHAN_COUNT && _pending_mask != 0; i++) {
+        if (_pending_mask & (1U<<i)) {
+            sharedMem_cmd->periodhi[i].hi = _pending[i];
+            _pending_mask &= ~(1U<<i);
+        }
+    }
+}
+
 #endif
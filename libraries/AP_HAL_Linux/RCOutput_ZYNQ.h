@@ -24,6 +24,8 @@ class Linux::LinuxRCOutput_ZYNQ : public AP_HAL::RCOutput {
     void     write(uint8_t ch, uint16_t* period_us, uint8_t len);
     uint16_t read(uint8_t ch);
     void     read(uint16_t* period_us, uint8_t len);
+    void     cork(void);
+    void     push(void);
 
 private:
     static const int TICK_PER_US=100;
@@ -38,6 +40,11 @@ private:
         struct s_period_hi periodhi[MAX_ZYNQ_PWMS];
     };
     volatile struct pwm_cmd *sharedMem_cmd;
+
+    // high times written since cork() and not yet pushed
+    bool _corked;
+    uint16_t _pending_mask;
+    uint32_t _pending[MAX_ZYNQ_PWMS];
 };
 
 #endif // __AP_HAL_LINUX_RCOUTPUT_ZYNQ_H__
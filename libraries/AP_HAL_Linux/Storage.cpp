@@ -16,31 +16,151 @@ using namespace Linux;
 /*
   This stores 'eeprom' data on the SD card, with a 4k size, and a
   in-memory buffer. This keeps the latency down.
+
+  Changed lines are appended to a journal on the IO thread rather
+  than written in place. Each record in the journal holds one whole
+  line and a CRC. The lines that are dirty when the IO thread writes
+  them go in as one transaction, which is either all there after a
+  power loss or not there at all. Nothing is written while a
+  begin_transaction() is open, so the writes between it and
+  end_transaction() always land in the same transaction. Other writes
+  are committed once they pause, so a burst of them can be split. On startup
+  the complete transactions in the journal are replayed on top of the
+  storage file, and once the journal grows long enough it is folded
+  into a new storage file which replaces the old one with a rename().
  */
 
 // name the storage file after the sketch so you can use the same board
 // card for ArduCopter and ArduPlane
 #define STORAGE_DIR "/var/APM"
 #define STORAGE_FILE STORAGE_DIR "/" SKETCHNAME ".stg"
+#define STORAGE_TMP_FILE STORAGE_FILE ".tmp"
+#define STORAGE_JOURNAL STORAGE_DIR "/" SKETCHNAME ".jnl"
+
+#define JOURNAL_MAGIC 0x4A524E4C
+
+struct journal_record {
+    uint32_t magic;
+    uint32_t txn;
+    uint8_t line;
+    uint8_t index;      // index of this record in its transaction
+    uint8_t count;      // number of records in the transaction
+    uint8_t reserved;
+    uint32_t crc;       // of the whole record, taken with crc=0
+    uint8_t data[LINUX_STORAGE_LINE_SIZE];
+};
 
 extern const AP_HAL::HAL& hal;
 
+static uint32_t crc32(const uint8_t *buf, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *buf++;
+        for (uint8_t i=0; i<8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t record_crc(struct journal_record &rec)
+{
+    uint32_t saved_crc = rec.crc;
+    rec.crc = 0;
+    uint32_t ret = crc32((const uint8_t *)&rec, sizeof(rec));
+    rec.crc = saved_crc;
+    return ret;
+}
+
+/*
+  replace the storage file with image. The new contents go to a
+  temporary file which is renamed over the old one, so the storage
+  file is always either the old image or the new one
+ */
+bool LinuxStorage::_write_image(const uint8_t *image)
+{
+    int fd = open(STORAGE_TMP_FILE, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = (write(fd, image, LINUX_STORAGE_SIZE) == LINUX_STORAGE_SIZE &&
+               fsync(fd) == 0);
+    close(fd);
+    if (!ok || rename(STORAGE_TMP_FILE, STORAGE_FILE) != 0) {
+        unlink(STORAGE_TMP_FILE);
+        return false;
+    }
+    // ensure the directory is updated with the rename
+    fd = open(STORAGE_DIR, O_RDONLY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+}
+
 void LinuxStorage::_storage_create(void)
 {
     mkdir(STORAGE_DIR, 0777);
-    unlink(STORAGE_FILE);
-    int fd = open(STORAGE_FILE, O_RDWR|O_CREAT, 0666);
-    if (fd == -1) {
+    unlink(STORAGE_JOURNAL);
+    if (!_write_image(_buffer)) {
         hal.scheduler->panic("Failed to create " STORAGE_FILE);
     }
-    for (uint16_t loc=0; loc<sizeof(_buffer); loc += LINUX_STORAGE_MAX_WRITE) {
-        if (write(fd, &_buffer[loc], LINUX_STORAGE_MAX_WRITE) != LINUX_STORAGE_MAX_WRITE) {
-            hal.scheduler->panic("Error filling " STORAGE_FILE);            
+}
+
+/*
+  apply the complete transactions in the journal to _buffer, returning
+  the length of the journal up to the end of the last of them
+ */
+uint32_t LinuxStorage::_replay_journal(void)
+{
+    int fd = open(STORAGE_JOURNAL, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+
+    struct journal_record rec;
+    uint8_t lines[LINUX_STORAGE_SIZE];
+    uint32_t line_mask = 0;
+    uint32_t offset = 0;
+    uint32_t valid_size = 0;
+    uint8_t next_index = 0;
+
+    while (read(fd, &rec, sizeof(rec)) == sizeof(rec)) {
+        if (rec.magic != JOURNAL_MAGIC ||
+            rec.crc != record_crc(rec) ||
+            rec.line >= LINUX_STORAGE_NUM_LINES ||
+            rec.index != next_index ||
+            rec.count == 0 || rec.index >= rec.count ||
+            (rec.index != 0 && rec.txn != _txn)) {
+            // a torn or corrupt record, nothing after it can be trusted
+            break;
+        }
+        offset += sizeof(rec);
+        _txn = rec.txn;
+        if (rec.index == 0) {
+            line_mask = 0;
+        }
+        memcpy(&lines[rec.line<<LINUX_STORAGE_LINE_SHIFT], rec.data, LINUX_STORAGE_LINE_SIZE);
+        line_mask |= 1U << rec.line;
+        next_index = rec.index + 1;
+        if (next_index == rec.count) {
+            // the transaction is complete
+            for (uint8_t i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
+                if (line_mask & (1U<<i)) {
+                    memcpy(&_buffer[i<<LINUX_STORAGE_LINE_SHIFT],
+                           &lines[i<<LINUX_STORAGE_LINE_SHIFT],
+                           LINUX_STORAGE_LINE_SIZE);
+                }
+            }
+            next_index = 0;
+            valid_size = offset;
+            _txn++;
         }
     }
-    // ensure the directory is updated with the new size
-    fsync(fd);
     close(fd);
+    return valid_size;
 }
 
 void LinuxStorage::_storage_open(void)
@@ -70,19 +190,37 @@ void LinuxStorage::_storage_open(void)
         }
     }
     close(fd);
+
+    uint32_t journal_size = _replay_journal();
+    memcpy(_committed, _buffer, sizeof(_buffer));
+
+    // start with an empty journal if we can, otherwise drop anything
+    // after the last complete transaction so new records can follow it
+    _journal_fd = open(STORAGE_JOURNAL, O_WRONLY|O_CREAT, 0666);
+    if (_journal_fd != -1) {
+        if (journal_size != 0 && _write_image(_committed)) {
+            journal_size = 0;
+        }
+        if (ftruncate(_journal_fd, journal_size) != 0) {
+            close(_journal_fd);
+            _journal_fd = -1;
+        }
+    }
+    _journal_size = journal_size;
     _initialised = true;
 }
 
 /*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
+  mark some lines as dirty. Called with _lock held
  */
 void LinuxStorage::_mark_dirty(uint16_t loc, uint16_t length)
 {
-    uint16_t end = loc + length;
+    uint16_t end = loc + length - 1;
+    uint32_t now = hal.scheduler->millis();
+    if (_dirty_mask == 0) {
+        _first_dirty_ms = now;
+    }
+    _last_write_ms = now;
     for (uint8_t line=loc>>LINUX_STORAGE_LINE_SHIFT;
          line <= end>>LINUX_STORAGE_LINE_SHIFT;
          line++) {
@@ -106,68 +244,134 @@ void LinuxStorage::write_block(uint16_t loc, const void *src, size_t n)
     }
     if (memcmp(src, &_buffer[loc], n) != 0) {
         _storage_open();
+        pthread_mutex_lock(&_lock);
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+        pthread_mutex_unlock(&_lock);
     }
 }
 
-void LinuxStorage::_timer_tick(void)
+void LinuxStorage::begin_transaction(void)
 {
-    if (!_initialised || _dirty_mask == 0) {
-        return;
+    pthread_mutex_lock(&_lock);
+    _txn_depth++;
+    pthread_mutex_unlock(&_lock);
+}
+
+void LinuxStorage::end_transaction(void)
+{
+    pthread_mutex_lock(&_lock);
+    if (_txn_depth > 0) {
+        _txn_depth--;
     }
+    pthread_mutex_unlock(&_lock);
+}
 
-    if (_fd == -1) {
-        _fd = open(STORAGE_FILE, O_WRONLY);
-        if (_fd == -1) {
-            return;    
+/*
+  append the dirty lines to the journal as one transaction. The lines
+  are copied out under _lock, so they hold whole writes and no open
+  transaction, and the journal is written after it is released
+ */
+bool LinuxStorage::_append_transaction(void)
+{
+    struct journal_record recs[LINUX_STORAGE_NUM_LINES];
+    uint8_t count = 0;
+
+    pthread_mutex_lock(&_lock);
+    if (_txn_depth != 0) {
+        pthread_mutex_unlock(&_lock);
+        return true;
+    }
+    uint32_t mask = _dirty_mask & ((1U<<LINUX_STORAGE_NUM_LINES)-1);
+    _dirty_mask = 0;
+    for (uint8_t i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
+        if (mask & (1U<<i)) {
+            recs[count].line = i;
+            memcpy(recs[count].data, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], LINUX_STORAGE_LINE_SIZE);
+            count++;
         }
     }
+    pthread_mutex_unlock(&_lock);
 
-    // write out the first dirty set of lines. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint8_t i, n;
-    for (i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask & (1<<i)) {
-            break;
+    if (count == 0) {
+        return true;
+    }
+    for (uint8_t i=0; i<count; i++) {
+        recs[i].magic = JOURNAL_MAGIC;
+        recs[i].txn = _txn;
+        recs[i].index = i;
+        recs[i].count = count;
+        recs[i].reserved = 0;
+        recs[i].crc = record_crc(recs[i]);
+    }
+
+    ssize_t len = count * sizeof(recs[0]);
+    if (pwrite(_journal_fd, recs, len, _journal_size) != len ||
+        fdatasync(_journal_fd) != 0) {
+        // drop anything partly written so the journal still ends on
+        // a complete transaction, and try again later
+        if (ftruncate(_journal_fd, _journal_size) != 0) {
+            // the torn record is caught by its CRC on replay
         }
+        pthread_mutex_lock(&_lock);
+        _dirty_mask |= mask;
+        pthread_mutex_unlock(&_lock);
+        close(_journal_fd);
+        _journal_fd = -1;
+        return false;
+    }
+    _journal_size += len;
+    _txn++;
+
+    for (uint8_t i=0; i<count; i++) {
+        memcpy(&_committed[recs[i].line<<LINUX_STORAGE_LINE_SHIFT], recs[i].data, LINUX_STORAGE_LINE_SIZE);
+    }
+    return true;
+}
+
+/*
+  fold the journal into a new storage file. If we lose power after the
+  rename but before the truncate the journal is replayed on top of an
+  image that already holds it, which gives the same result
+ */
+void LinuxStorage::_compact_journal(void)
+{
+    if (!_write_image(_committed)) {
+        return;
+    }
+    if (ftruncate(_journal_fd, 0) == 0) {
+        _journal_size = 0;
     }
-    if (i == LINUX_STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+}
+
+/*
+  called from the IO thread, so a slow card never holds up the main
+  loop or the timer thread
+ */
+void LinuxStorage::_timer_tick(void)
+{
+    if (!_initialised || _dirty_mask == 0) {
         return;
     }
-    uint32_t write_mask = (1U<<i);
-    // see how many lines to write
-    for (n=1; (i+n) < LINUX_STORAGE_NUM_LINES && 
-             n < (LINUX_STORAGE_MAX_WRITE>>LINUX_STORAGE_LINE_SHIFT); n++) {
-        if (!(_dirty_mask & (1<<(n+i)))) {
-            break;
-        }        
-        // mark that line clean
-        write_mask |= (1<<(n+i));
-    }
-
-    /*
-      write the lines. This also updates _dirty_mask. Note that
-      because this is a SCHED_FIFO thread it will not be preempted
-      by the main task except during blocking calls. This means we
-      don't need a semaphore around the _dirty_mask updates.
-     */
-    if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
-        _dirty_mask &= ~write_mask;
-        if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
-            // write error - likely EINTR
-            _dirty_mask |= write_mask;
-            close(_fd);
-            _fd = -1;
-        }
-        if (_dirty_mask == 0) {
-            if (fsync(_fd) != 0) {
-                close(_fd);
-                _fd = -1;
-            }
+
+    // let a burst of writes such as a parameter save or a mission
+    // upload finish, so that it usually goes in as one transaction
+    uint32_t now = hal.scheduler->millis();
+    if (now - _last_write_ms < LINUX_STORAGE_COMMIT_DELAY_MS &&
+        now - _first_dirty_ms < LINUX_STORAGE_COMMIT_MAX_MS) {
+        return;
+    }
+
+    if (_journal_fd == -1) {
+        _journal_fd = open(STORAGE_JOURNAL, O_WRONLY|O_CREAT, 0666);
+        if (_journal_fd == -1) {
+            return;
         }
     }
+
+    if (_append_transaction() && _journal_size >= LINUX_STORAGE_JOURNAL_MAX) {
+        _compact_journal();
+    }
 }
 
 #endif // CONFIG_HAL_BOARD
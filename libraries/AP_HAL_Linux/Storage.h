@@ -9,6 +9,7 @@
 
 #include <AP_HAL.h>
 #include "AP_HAL_Linux_Namespace.h"
+#include <pthread.h>
 
 #define LINUX_STORAGE_SIZE 4096
 #define LINUX_STORAGE_MAX_WRITE 512
@@ -16,13 +17,28 @@
 #define LINUX_STORAGE_LINE_SIZE (1<<LINUX_STORAGE_LINE_SHIFT)
 #define LINUX_STORAGE_NUM_LINES (LINUX_STORAGE_SIZE/LINUX_STORAGE_LINE_SIZE)
 
+// dirty lines go into the journal once writes have stopped for
+// COMMIT_DELAY_MS, or COMMIT_MAX_MS after the first of them
+#define LINUX_STORAGE_COMMIT_DELAY_MS 100
+#define LINUX_STORAGE_COMMIT_MAX_MS 1000
+
+// fold the journal into the storage file once it is this long
+#define LINUX_STORAGE_JOURNAL_MAX (64*1024)
+
 class Linux::LinuxStorage : public AP_HAL::Storage 
 {
 public:
     LinuxStorage() :
-	_fd(-1),
-	_dirty_mask(0)
-	{}
+	_dirty_mask(0),
+	_journal_fd(-1),
+	_journal_size(0),
+	_txn(0),
+	_txn_depth(0),
+	_first_dirty_ms(0),
+	_last_write_ms(0)
+	{
+	    pthread_mutex_init(&_lock, NULL);
+	}
     void init(void* machtnichts) {}
     uint8_t  read_byte(uint16_t loc);
     uint16_t read_word(uint16_t loc);
@@ -34,15 +50,39 @@ public:
     void write_dword(uint16_t loc, uint32_t value);
     void write_block(uint16_t dst, const void* src, size_t n);
 
+    void begin_transaction(void);
+    void end_transaction(void);
+
     virtual void _timer_tick(void);
 protected:
     void _mark_dirty(uint16_t loc, uint16_t length);
     virtual void _storage_create(void);
     virtual void _storage_open(void);
-    int _fd;
     volatile bool _initialised;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
     volatile uint32_t _dirty_mask;
+
+private:
+    // the contents as of the last transaction in the journal
+    uint8_t _committed[LINUX_STORAGE_SIZE];
+    int _journal_fd;
+    uint32_t _journal_size;
+    uint32_t _txn;
+
+    // held while _buffer and _dirty_mask are changed, and while the
+    // IO thread copies the dirty lines out of _buffer
+    pthread_mutex_t _lock;
+    // number of begin_transaction() calls not yet ended. Nothing is
+    // committed while it is non-zero
+    uint8_t _txn_depth;
+
+    volatile uint32_t _first_dirty_ms;
+    volatile uint32_t _last_write_ms;
+
+    bool _write_image(const uint8_t *image);
+    uint32_t _replay_journal(void);
+    bool _append_transaction(void);
+    void _compact_journal(void);
 };
 
 #include "Storage_FRAM.h"
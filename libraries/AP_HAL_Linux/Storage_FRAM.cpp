@@ -22,6 +22,7 @@ using namespace Linux;
 
 extern const AP_HAL::HAL& hal;
 LinuxStorage_FRAM::LinuxStorage_FRAM():
+_fd(-1),
 _spi(NULL),
 _spi_sem(NULL)
 {}
@@ -20,6 +20,7 @@ public:
 
 private:
     uint32_t fptr;
+    int _fd;
    
     int32_t write(uint16_t fd, uint8_t *Buff, uint16_t NumBytes);
     int32_t read(uint16_t fd, uint8_t *Buff, uint16_t NumBytes);
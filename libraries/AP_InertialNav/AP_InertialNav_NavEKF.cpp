@@ -17,13 +17,16 @@
 void AP_InertialNav_NavEKF::update(float dt)
 {
     _ahrs_ekf.get_NavEKF().getPosNED(_relpos_cm);
-    _relpos_cm *= 100; // convert to cm
+    _ahrs_ekf.get_NavEKF().getVelNED(_velocity_cm);
 
-    _haveabspos = _ahrs_ekf.get_position(_abspos);
+    // use the EKF output predictor solution if AHRS_EKF_OUTPUT is enabled
+    _ahrs_ekf.get_output_NED(_relpos_cm, _velocity_cm);
 
-    _ahrs_ekf.get_NavEKF().getVelNED(_velocity_cm);
+    _relpos_cm *= 100; // convert to cm
     _velocity_cm *= 100; // convert to cm/s
 
+    _haveabspos = _ahrs_ekf.get_position(_abspos);
+
     // InertialNav is NEU
     _relpos_cm.z = - _relpos_cm.z;
     _velocity_cm.z = -_velocity_cm.z;
@@ -127,8 +127,32 @@ void AP_L1_Control::_prevent_indecision(float &Nu)
     }
 }
 
+/*
+  rebuild the leg geometry if the waypoints have changed
+ */
+void AP_L1_Control::_update_leg(const struct Location &prev_WP, const struct Location &next_WP)
+{
+    if (_leg.valid &&
+        _leg.prev_lat == prev_WP.lat && _leg.prev_lng == prev_WP.lng &&
+        _leg.next_lat == next_WP.lat && _leg.next_lng == next_WP.lng) {
+        return;
+    }
+    _leg.prev_lat = prev_WP.lat;
+    _leg.prev_lng = prev_WP.lng;
+    _leg.next_lat = next_WP.lat;
+    _leg.next_lng = next_WP.lng;
+    _leg.lng_scale = LOCATION_SCALING_FACTOR * longitude_scale(prev_WP);
+    _leg.next_NE = _leg_position(next_WP);
+    _leg.length = _leg.next_NE.length();
+    if (_leg.length >= 1.0e-6f) {
+        _leg.unit = _leg.next_NE / _leg.length;
+    } else {
+        _leg.unit.zero();
+    }
+    _leg.valid = true;
+}
+
 // update L1 control for waypoint navigation
-// this function costs about 3.5 milliseconds on a AVR2560
 void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct Location &next_WP)
 {
 
@@ -145,8 +169,14 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 
 	Vector2f _groundspeed_vector = _ahrs.groundspeed_vector();
 
+	// Calculate the NE position of the aircraft relative to WP A, and
+	// of WP B relative to the aircraft
+    _update_leg(prev_WP, next_WP);
+    Vector2f A_air = _leg_position(_current_loc);
+    Vector2f air_B = _leg.next_NE - A_air;
+
 	// update _target_bearing_cd
-	_target_bearing_cd = get_bearing_cd(_current_loc, next_WP);
+	_target_bearing_cd = wrap_360_cd(RadiansToCentiDegrees(atan2f(air_B.y, air_B.x)));
 	
 	//Calculate groundspeed
 	float groundSpeed = _groundspeed_vector.length();
@@ -162,21 +192,18 @@ void AP_L1_Control::update_waypoint(const struct Location &prev_WP, const struct
 	// 0.3183099 = 1/1/pipi
 	_L1_dist = 0.3183099f * _L1_damping * _L1_period * groundSpeed;
 	
-	// Calculate the NE position of WP B relative to WP A
-    Vector2f AB = location_diff(prev_WP, next_WP);
+	// Unit vector from WP A to WP B
+    Vector2f AB = _leg.unit;
 	
 	// Check for AB zero length and track directly to the destination
 	// if too small
-	if (AB.length() < 1.0e-6f) {
-		AB = location_diff(_current_loc, next_WP);
+	if (_leg.length < 1.0e-6f) {
+		AB = air_B;
         if (AB.length() < 1.0e-6f) {
             AB = Vector2f(cosf(_ahrs.yaw), sinf(_ahrs.yaw));
         }
+		AB.normalize();
 	}
-	AB.normalize();
-
-	// Calculate the NE position of the aircraft relative to WP A
-    Vector2f A_air = location_diff(prev_WP, _current_loc);
 
 	// calculate distance to target track, for reporting
 	_crosstrack_error = AB % A_air;
@@ -250,8 +277,12 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 	float groundSpeed = max(_groundspeed_vector.length() , 1.0f);
 
 
+	//Calculate the NE position of the aircraft relative to WP A
+    _update_leg(center_WP, center_WP);
+    Vector2f A_air = _leg_position(_current_loc);
+
 	// update _target_bearing_cd
-	_target_bearing_cd = get_bearing_cd(_current_loc, center_WP);
+	_target_bearing_cd = wrap_360_cd(RadiansToCentiDegrees(atan2f(-A_air.y, -A_air.x)));
 
 
 	// Calculate time varying control parameters
@@ -259,9 +290,6 @@ void AP_L1_Control::update_loiter(const struct Location &center_WP, float radius
 	// 0.3183099 = 1/pi
 	_L1_dist = 0.3183099f * _L1_damping * _L1_period * groundSpeed;
 
-	//Calculate the NE position of the aircraft relative to WP A
-    Vector2f A_air = location_diff(center_WP, _current_loc);
-
     // Calculate the unit vector from WP A to aircraft
     // protect against being on the waypoint and having zero velocity
     // if too close to the waypoint, use the velocity vector
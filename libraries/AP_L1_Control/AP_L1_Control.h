@@ -27,6 +27,7 @@ public:
 		_ahrs(ahrs)
 		{
 			AP_Param::setup_object_defaults(this, var_info);
+			_leg.valid = false;
 		}
 
 	/* see AP_Navigation.h for the definitions and units of these
@@ -98,6 +99,27 @@ private:
 
     // prevent indecision in waypoint tracking
     void _prevent_indecision(float &Nu);
+
+    // geometry of the leg being tracked, in a north-east plane in
+    // meters with its origin at the start of the leg (the loiter centre
+    // when loitering). It is only rebuilt when the waypoints change, so
+    // each update only has to place the vehicle in the plane
+    struct {
+        bool valid;
+        int32_t prev_lat, prev_lng;
+        int32_t next_lat, next_lng;
+        float lng_scale;        // meters per 1e-7 degrees of longitude at the start of the leg
+        Vector2f next_NE;       // end of the leg
+        Vector2f unit;          // unit vector along the leg, zero if the leg has no length
+        float length;           // meters
+    } _leg;
+    void _update_leg(const struct Location &prev_WP, const struct Location &next_WP);
+
+    // position of loc in the plane of the leg
+    Vector2f _leg_position(const struct Location &loc) const {
+        return Vector2f((loc.lat - _leg.prev_lat) * LOCATION_SCALING_FACTOR,
+                        (loc.lng - _leg.prev_lng) * _leg.lng_scale);
+    }
 };
 
 
@@ -0,0 +1,188 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Cost of the L1 navigation updates for plane and rover style
+// waypoint legs and for loitering. Each case first flies the
+// controller around a simple kinematic vehicle, recording the track,
+// then times the updates along the recorded track.
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <StorageManager.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_Empty.h>
+#include <AP_ADC.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_InertialSensor.h>
+#include <AP_Baro.h>
+#include <AP_GPS.h>
+#include <AP_Compass.h>
+#include <AP_Declination.h>
+#include <AP_Airspeed.h>
+#include <AP_AHRS.h>
+#include <AP_NavEKF.h>
+#include <AP_Navigation.h>
+#include <AP_L1_Control.h>
+#include <AP_Vehicle.h>
+#include <AP_Notify.h>
+#include <AP_Mission.h>
+#include <AP_Terrain.h>
+#include <AP_Rally.h>
+#include <AP_BattMonitor.h>
+#include <AP_SerialManager.h>
+#include <AP_RangeFinder.h>
+#include <GCS_MAVLink.h>
+#include <DataFlash.h>
+#include <Filter.h>
+#include <SITL.h>
+#include <AP_Buffer.h>
+#include <RC_Channel.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_STEPS 2000
+#define DT 0.02f
+
+/*
+  an AHRS that reports a position and ground speed set by the
+  benchmark
+ */
+class BenchAHRS : public AP_AHRS
+{
+public:
+    BenchAHRS(AP_InertialSensor &ins, AP_Baro &baro, AP_GPS &gps) :
+        AP_AHRS(ins, baro, gps) {}
+
+    void update(void) {}
+    const Vector3f &get_gyro(void) const { return _zero; }
+    const Vector3f &get_gyro_drift(void) const { return _zero; }
+    void reset_gyro_drift(void) {}
+    void reset(bool recover_eulers=false) {}
+    void reset_attitude(const float &_roll, const float &_pitch, const float &_yaw) {}
+    float get_error_rp(void) const { return 0; }
+    float get_error_yaw(void) const { return 0; }
+    const Matrix3f &get_dcm_matrix(void) const { return _dcm; }
+    bool get_position(struct Location &loc) const { loc = position; return true; }
+    Vector3f wind_estimate(void) { return Vector3f(); }
+    Vector2f groundspeed_vector(void) { return velocity; }
+    void set_home(const Location &loc) {}
+    bool healthy(void) const { return true; }
+
+    void set_state(const Location &loc, const Vector2f &vel) {
+        position = loc;
+        velocity = vel;
+        yaw = atan2f(vel.y, vel.x);
+        yaw_sensor = wrap_360_cd(degrees(yaw) * 100);
+    }
+
+    Location position;
+    Vector2f velocity;
+
+private:
+    Vector3f _zero;
+    Matrix3f _dcm;
+};
+
+AP_InertialSensor ins;
+AP_Baro baro;
+AP_GPS gps;
+BenchAHRS ahrs(ins, baro, gps);
+
+static Location track_loc[NUM_STEPS];
+static Vector2f track_vel[NUM_STEPS];
+
+struct bench_case {
+    const char *name;
+    float period;           // NAVL1_PERIOD
+    float speed;            // m/s
+    float leg_length;       // meters, zero to loiter
+    float offset;           // starting distance to the right of the leg or outside the loiter circle
+};
+
+static const struct bench_case cases[] = {
+    { "plane waypoint",  20, 20, 2000, 100 },
+    { "rover waypoint",   8,  3,  200,  10 },
+    { "plane loiter",    20, 20,    0, 100 },
+};
+
+#define LOITER_RADIUS 80
+
+static void update_nav(AP_L1_Control &L1, const struct bench_case &c,
+                       const Location &prev_WP, const Location &next_WP)
+{
+    if (c.leg_length > 0) {
+        L1.update_waypoint(prev_WP, next_WP);
+    } else {
+        L1.update_loiter(next_WP, LOITER_RADIUS, 1);
+    }
+}
+
+static void run_case(const struct bench_case &c)
+{
+    AP_L1_Control L1(ahrs);
+    L1.set_default_period(c.period);
+
+    Location prev_WP = {};
+    prev_WP.lat = -353632620;
+    prev_WP.lng = 1491652370;
+    Location next_WP = prev_WP;
+    location_offset(next_WP, c.leg_length, 0);
+
+    // fly the controller, heading north along the leg or around the
+    // loiter point, starting off to the east of it
+    Location loc = prev_WP;
+    location_offset(loc, 0, c.offset + (c.leg_length > 0 ? 0 : LOITER_RADIUS));
+    Vector2f vel(c.speed, 0);
+    for (uint16_t i=0; i<NUM_STEPS; i++) {
+        ahrs.set_state(loc, vel);
+        track_loc[i] = loc;
+        track_vel[i] = vel;
+        update_nav(L1, c, prev_WP, next_WP);
+        float turn_rate = L1.lateral_acceleration() / c.speed;
+        float heading = atan2f(vel.y, vel.x) + turn_rate * DT;
+        vel = Vector2f(cosf(heading), sinf(heading)) * c.speed;
+        location_offset(loc, vel.x * DT, vel.y * DT);
+    }
+    float crosstrack = L1.crosstrack_error();
+
+    // time the updates along the recorded track
+    uint32_t start_time = hal.scheduler->micros();
+    for (uint16_t i=0; i<NUM_STEPS; i++) {
+        ahrs.set_state(track_loc[i], track_vel[i]);
+        update_nav(L1, c, prev_WP, next_WP);
+    }
+    uint32_t nav_time = hal.scheduler->micros() - start_time;
+
+    // and the cost of setting the state alone
+    start_time = hal.scheduler->micros();
+    for (uint16_t i=0; i<NUM_STEPS; i++) {
+        ahrs.set_state(track_loc[i], track_vel[i]);
+    }
+    uint32_t state_time = hal.scheduler->micros() - start_time;
+
+    hal.console->printf_P(PSTR("%-15s %7.3f usec per update, final crosstrack %6.2f m %s\n"),
+                          c.name,
+                          (nav_time - state_time) / (float)NUM_STEPS,
+                          crosstrack,
+                          fabsf(crosstrack) < 0.1f * c.offset ? "PASS" : "FAIL");
+}
+
+void setup(void)
+{
+    hal.console->println("AP_L1_Control benchmark");
+    for (uint8_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++) {
+        run_case(cases[i]);
+    }
+}
+
+void loop(void)
+{
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
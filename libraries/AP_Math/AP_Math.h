@@ -139,6 +139,12 @@ void        location_update(struct Location &loc, float bearing, float distance)
 // extrapolate latitude/longitude given distances north and east
 void        location_offset(struct Location &loc, float ofs_north, float ofs_east);
 
+// scaling factor from 1e-7 degrees to meters at equater
+// == 1.0e-7 * DEG_TO_RAD * RADIUS_OF_EARTH
+#define LOCATION_SCALING_FACTOR 0.011131884502145034f
+// inverse of LOCATION_SCALING_FACTOR
+#define LOCATION_SCALING_FACTOR_INV 89.83204953368922f
+
 /*
   return the distance in meters in North/East plane as a N/E vector
   from loc1 to loc2
@@ -204,6 +210,8 @@ float pythagorous3(float a, float b, float c);
 #define max(a,b) ((a)>(b)?(a):(b))
 #define min(a,b) ((a)<(b)?(a):(b))
 
+#include "local_frame.h"
+
 
 #endif // AP_MATH_H
 
@@ -0,0 +1,206 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Accuracy and speed tests for LocalFrame. The offsets are checked
+// against exact spherical earth distances and bearings at a range of
+// latitudes, and the conversions are timed against location_diff()
+// and location_offset()
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <AP_HAL.h>
+#include <AP_Math.h>
+#include <Filter.h>
+#include <AP_ADC.h>
+#include <AP_Notify.h>
+#include <AP_InertialSensor.h>
+#include <AP_GPS.h>
+#include <DataFlash.h>
+#include <AP_Baro.h>
+#include <GCS_MAVLink.h>
+#include <AP_Mission.h>
+#include <StorageManager.h>
+#include <AP_Terrain.h>
+#include <AP_Declination.h>
+
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Empty.h>
+#include <AP_HAL_Linux.h>
+#include <AP_AHRS.h>
+#include <SITL.h>
+#include <AP_NavEKF.h>
+#include <AP_Airspeed.h>
+#include <AP_Vehicle.h>
+#include <AP_ADC_AnalogSource.h>
+#include <AP_Compass.h>
+#include <AP_BattMonitor.h>
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define ARRAY_LENGTH(x) (sizeof((x))/sizeof((x)[0]))
+
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_75
+/*
+  the largest allowed offset error in meters over 10km at each
+  latitude
+ */
+static const struct {
+    float lat;
+    float max_error;
+} test_lats[] = {
+    {  0, 0.01f },
+    { 45, 0.01f },
+    { 70, 0.05f },
+    { 80, 0.2f  },
+    { 85, 1.0f  },
+};
+
+/*
+  the point distance meters from loc on an initial bearing in radians,
+  on a sphere
+ */
+static struct Location exact_offset(const struct Location &loc, double bearing, double distance)
+{
+    double lat1 = loc.lat * 1.0e-7 * DEG_TO_RAD_DOUBLE;
+    double d = distance / RADIUS_OF_EARTH;
+    double lat2 = asin(sin(lat1)*cos(d) + cos(lat1)*sin(d)*cos(bearing));
+    double dlng = atan2(sin(bearing)*sin(d)*cos(lat1), cos(d) - sin(lat1)*sin(lat2));
+    struct Location ret = loc;
+    ret.lat = (int32_t)floor(lat2 * RAD_TO_DEG_DOUBLE * 1.0e7 + 0.5);
+    ret.lng = loc.lng + (int32_t)floor(dlng * RAD_TO_DEG_DOUBLE * 1.0e7 + 0.5);
+    return ret;
+}
+
+/*
+  the North/East offset of loc2 from loc1 in the tangent plane, from
+  the great circle distance and initial bearing
+ */
+static void exact_NE(const struct Location &loc1, const struct Location &loc2, double &north, double &east)
+{
+    double lat1 = loc1.lat * 1.0e-7 * DEG_TO_RAD_DOUBLE;
+    double lat2 = loc2.lat * 1.0e-7 * DEG_TO_RAD_DOUBLE;
+    double dlng = ((double)loc2.lng - loc1.lng) * 1.0e-7 * DEG_TO_RAD_DOUBLE;
+    double a = sin((lat2-lat1)/2)*sin((lat2-lat1)/2) + cos(lat1)*cos(lat2)*sin(dlng/2)*sin(dlng/2);
+    double d = 2 * asin(sqrt(a)) * RADIUS_OF_EARTH;
+    double bearing = atan2(sin(dlng)*cos(lat2), cos(lat1)*sin(lat2) - sin(lat1)*cos(lat2)*cos(dlng));
+    north = d * cos(bearing);
+    east = d * sin(bearing);
+}
+
+static void test_accuracy(void)
+{
+    hal.console->println("accuracy over 10km, max error in meters");
+    for (uint8_t i=0; i<ARRAY_LENGTH(test_lats); i++) {
+        struct Location origin = {};
+        origin.lat = test_lats[i].lat * 1.0e7f;
+        origin.lng = 1491652370;
+        LocalFrame frame;
+        frame.set_origin(origin);
+
+        double frame_error = 0, diff_error = 0;
+        int32_t round_trip_error = 0;
+        for (uint16_t bearing=0; bearing<360; bearing += 5) {
+            for (float distance=100; distance<=10000; distance *= 1.5f) {
+                struct Location loc = exact_offset(origin, bearing * DEG_TO_RAD_DOUBLE, distance);
+                double north, east;
+                exact_NE(origin, loc, north, east);
+                Vector2f ne = frame.to_NE(loc);
+                Vector2f ne2 = location_diff(origin, loc);
+                frame_error = max(frame_error, sqrt(sq(ne.x - north) + sq(ne.y - east)));
+                diff_error = max(diff_error, sqrt(sq(ne2.x - north) + sq(ne2.y - east)));
+
+                struct Location loc2 = origin;
+                frame.from_NE(ne, loc2);
+                round_trip_error = max(round_trip_error, labs(loc2.lat - loc.lat) + labs(loc2.lng - loc.lng));
+            }
+        }
+        bool ok = frame_error < test_lats[i].max_error && round_trip_error <= 2;
+        hal.console->printf("lat %2.0f LocalFrame %8.4f location_diff %8.4f round trip %d %s\n",
+                            test_lats[i].lat, frame_error, diff_error, (int)round_trip_error,
+                            ok ? "PASS" : "FAIL");
+    }
+
+    // a frame straddling the date line
+    struct Location origin = {};
+    origin.lat = -40 * 1.0e7f;
+    origin.lng = 1799990000;
+    LocalFrame frame;
+    frame.set_origin(origin);
+    struct Location loc = origin;
+    frame.offset(loc, 0, 2000);
+    Vector2f ne = frame.to_NE(loc);
+    hal.console->printf("date line lng %ld offset %.3f %.3f %s\n",
+                        (long)loc.lng, ne.x, ne.y,
+                        loc.lng < 0 && fabsf(ne.y - 2000) < 0.01f ? "PASS" : "FAIL");
+}
+#endif // HAL_CPU_CLASS
+
+#define NUM_POINTS 100
+#define NUM_REPEATS 20
+
+static struct Location points[NUM_POINTS];
+static Vector2f offsets[NUM_POINTS];
+
+static void test_speed(void)
+{
+    struct Location origin = {};
+    origin.lat = -353632620;
+    origin.lng = 1491652370;
+    LocalFrame frame;
+    frame.set_origin(origin);
+
+    // points scattered over 20km around the origin
+    for (uint16_t i=0; i<NUM_POINTS; i++) {
+        points[i] = origin;
+        points[i].lat += (int32_t)((i * 7919UL) % 2000000UL) - 1000000;
+        points[i].lng += (int32_t)((i * 104729UL) % 2000000UL) - 1000000;
+    }
+
+    uint32_t t0 = hal.scheduler->micros();
+    for (uint8_t r=0; r<NUM_REPEATS; r++) {
+        for (uint16_t i=0; i<NUM_POINTS; i++) {
+            offsets[i] = location_diff(origin, points[i]);
+        }
+    }
+    uint32_t t1 = hal.scheduler->micros();
+    for (uint8_t r=0; r<NUM_REPEATS; r++) {
+        frame.to_NE(points, offsets, NUM_POINTS);
+    }
+    uint32_t t2 = hal.scheduler->micros();
+    for (uint8_t r=0; r<NUM_REPEATS; r++) {
+        for (uint16_t i=0; i<NUM_POINTS; i++) {
+            points[i].lat = origin.lat;
+            points[i].lng = origin.lng;
+            location_offset(points[i], offsets[i].x, offsets[i].y);
+        }
+    }
+    uint32_t t3 = hal.scheduler->micros();
+    for (uint8_t r=0; r<NUM_REPEATS; r++) {
+        frame.from_NE(offsets, points, NUM_POINTS);
+    }
+    uint32_t t4 = hal.scheduler->micros();
+
+    float n = NUM_POINTS * NUM_REPEATS;
+    hal.console->printf("location_diff   %7.3f usec\n", (t1 - t0) / n);
+    hal.console->printf("to_NE           %7.3f usec\n", (t2 - t1) / n);
+    hal.console->printf("location_offset %7.3f usec\n", (t3 - t2) / n);
+    hal.console->printf("from_NE         %7.3f usec\n", (t4 - t3) / n);
+}
+
+void setup(void)
+{
+    hal.console->println("LocalFrame tests");
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_75
+    test_accuracy();
+#endif
+    test_speed();
+}
+
+void loop(void)
+{
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
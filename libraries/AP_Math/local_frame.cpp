@@ -0,0 +1,139 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+ * local_frame.cpp
+ *
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_Math.h"
+
+// latitude change in radians per 1e-7 degree
+#define LAT_TO_RAD (1.0e-7f * DEG_TO_RAD)
+
+// round to the nearest 1e-7 degree
+static int32_t round_latlon(float v)
+{
+    return (int32_t)(v >= 0 ? v + 0.5f : v - 0.5f);
+}
+
+// wrap a longitude or longitude difference to -180..180 degrees
+static int32_t wrap_longitude(int64_t lng)
+{
+    if (lng > 1800000000LL) {
+        lng -= 3600000000LL;
+    } else if (lng < -1800000000LL) {
+        lng += 3600000000LL;
+    }
+    return (int32_t)lng;
+}
+
+void LocalFrame::set_origin(const struct Location &loc)
+{
+    _origin = loc;
+    float lat = loc.lat * LAT_TO_RAD;
+    float cos_lat = cosf(lat);
+    float sin_lat = sinf(lat);
+
+    // cos(lat + dlat) ~= cos(lat) - sin(lat)*dlat - cos(lat)*dlat^2/2
+    _lng_scale    = LOCATION_SCALING_FACTOR * cos_lat;
+    _lng_scale_d1 = -LOCATION_SCALING_FACTOR * sin_lat * LAT_TO_RAD;
+    _lng_scale_d2 = -LOCATION_SCALING_FACTOR * cos_lat * 0.5f * LAT_TO_RAD * LAT_TO_RAD;
+
+    // the parallels curve away to the north of the tangent plane by
+    // sin(lat)*cos(lat)*dlng^2/2
+    _north_d2 = LOCATION_SCALING_FACTOR * sin_lat * cos_lat * 0.5f * LAT_TO_RAD;
+    _valid = true;
+}
+
+/*
+  meters per 1e-7 degree of longitude at a latitude dlat north of the
+  origin, limited like longitude_scale() near the poles
+ */
+float LocalFrame::lng_scale(float dlat) const
+{
+    float scale = _lng_scale + dlat * (_lng_scale_d1 + dlat * _lng_scale_d2);
+    if (scale < 0.01f * LOCATION_SCALING_FACTOR) {
+        scale = 0.01f * LOCATION_SCALING_FACTOR;
+    }
+    return scale;
+}
+
+Vector2f LocalFrame::to_NE(const struct Location &loc) const
+{
+    float dlat = loc.lat - _origin.lat;
+    float dlng = wrap_longitude((int64_t)loc.lng - _origin.lng);
+    return Vector2f(dlat * LOCATION_SCALING_FACTOR + dlng * dlng * _north_d2,
+                    dlng * lng_scale(dlat));
+}
+
+/*
+  the inverse of to_NE(). The latitude and longitude depend on each
+  other only through the curvature terms, which are small, so one
+  correction of the flat earth answer is enough
+ */
+void LocalFrame::from_NE(const Vector2f &ne, struct Location &loc) const
+{
+    float dlat = ne.x * LOCATION_SCALING_FACTOR_INV;
+    float dlng = ne.y / lng_scale(dlat);
+    dlat = (ne.x - dlng * dlng * _north_d2) * LOCATION_SCALING_FACTOR_INV;
+    dlng = ne.y / lng_scale(dlat);
+    loc.lat = _origin.lat + round_latlon(dlat);
+    loc.lng = wrap_longitude((int64_t)_origin.lng + round_latlon(dlng));
+}
+
+void LocalFrame::to_NE(const struct Location *locs, Vector2f *ne, uint16_t n) const
+{
+    for (uint16_t i=0; i<n; i++) {
+        ne[i] = to_NE(locs[i]);
+    }
+}
+
+void LocalFrame::from_NE(const Vector2f *ne, struct Location *locs, uint16_t n) const
+{
+    for (uint16_t i=0; i<n; i++) {
+        from_NE(ne[i], locs[i]);
+    }
+}
+
+Vector2f LocalFrame::diff(const struct Location &loc1, const struct Location &loc2) const
+{
+    return to_NE(loc2) - to_NE(loc1);
+}
+
+float LocalFrame::get_distance(const struct Location &loc1, const struct Location &loc2) const
+{
+    return diff(loc1, loc2).length();
+}
+
+int32_t LocalFrame::get_bearing_cd(const struct Location &loc1, const struct Location &loc2) const
+{
+    Vector2f ofs = diff(loc1, loc2);
+    int32_t bearing = atan2f(ofs.y, ofs.x) * 5729.57795f;
+    if (bearing < 0) {
+        bearing += 36000;
+    }
+    return bearing;
+}
+
+void LocalFrame::offset(struct Location &loc, float ofs_north, float ofs_east) const
+{
+    if (ofs_north != 0 || ofs_east != 0) {
+        from_NE(to_NE(loc) + Vector2f(ofs_north, ofs_east), loc);
+    }
+}
+
+void LocalFrame::update(struct Location &loc, float bearing, float distance) const
+{
+    offset(loc, cosf(radians(bearing))*distance, sinf(radians(bearing))*distance);
+}
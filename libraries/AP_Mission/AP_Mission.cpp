@@ -213,6 +213,9 @@ void AP_Mission::update()
 ///     cmd.index is updated with it's new position in the mission
 bool AP_Mission::add_cmd(Mission_Command& cmd)
 {
+    // the command and the new total reach storage together
+    hal.storage->begin_transaction();
+
     // attempt to write the command to storage
     bool ret = write_cmd_to_storage(_cmd_total, cmd);
 
@@ -223,6 +226,8 @@ bool AP_Mission::add_cmd(Mission_Command& cmd)
         _cmd_total.set_and_save(_cmd_total + 1);
     }
 
+    hal.storage->end_transaction();
+
     return ret;
 }
 
@@ -428,9 +433,11 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, Mission_Command& cmd)
     // calculate where in storage the command should be placed
     uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
 
+    hal.storage->begin_transaction();
     _storage.write_byte(pos_in_storage, cmd.id);
     _storage.write_uint16(pos_in_storage+1, cmd.p1);
     _storage.write_block(pos_in_storage+3, cmd.content.bytes, 12);
+    hal.storage->end_transaction();
 
     // remember when the mission last changed
     _last_change_time_ms = hal.scheduler->millis();
@@ -1343,6 +1350,12 @@ uint16_t AP_Mission::get_landing_sequence_start()
     uint16_t landing_start_index = 0;
     float min_distance = -1;
 
+    LocalFrame frame;
+    if (!_ahrs.get_local_frame(frame)) {
+        frame.set_origin(current_loc);
+    }
+    Vector2f current_ne = frame.to_NE(current_loc);
+
     // Go through mission looking for nearest landing start command
     for (uint16_t i = 0; i < num_commands(); i++) {
         Mission_Command tmp;
@@ -1350,7 +1363,7 @@ uint16_t AP_Mission::get_landing_sequence_start()
             continue;
         }
         if (tmp.id == MAV_CMD_DO_LAND_START) {
-            float tmp_distance = get_distance(tmp.content.location, current_loc);
+            float tmp_distance = (frame.to_NE(tmp.content.location) - current_ne).length();
             if (min_distance < 0 || tmp_distance < min_distance) {
                 min_distance = tmp_distance;
                 landing_start_index = i;
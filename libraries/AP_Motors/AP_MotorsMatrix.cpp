@@ -53,6 +53,7 @@ void AP_MotorsMatrix::set_update_rate( uint16_t speed_hz )
         }
     }
     hal.rcout->set_freq( mask, _speed_hz );
+    setup_output_mode(mask);
 }
 
 // set frame orientation (normally + or X)
@@ -55,6 +55,7 @@ void AP_MotorsTri::set_update_rate( uint16_t speed_hz )
 	    1U << pgm_read_byte(&_motor_to_channel_map[AP_MOTORS_MOT_2]) |
 	    1U << pgm_read_byte(&_motor_to_channel_map[AP_MOTORS_MOT_4]);
     hal.rcout->set_freq(mask, _speed_hz);
+    setup_output_mode(mask);
 }
 
 // enable - starts allowing signals to be sent to motors
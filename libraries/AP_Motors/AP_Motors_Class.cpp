@@ -114,6 +114,13 @@ const AP_Param::GroupInfo AP_Motors::var_info[] PROGMEM = {
     // @User: Advanced
     AP_GROUPINFO("THR_PTY_GAIN", 15, AP_Motors, _thr_pty_min_pwm_gain, AP_MOTORS_MIN_PWM_GAIN_DEFAULT),
 
+    // @Param: PWM_TYPE
+    // @DisplayName: Output PWM type
+    // @Description: This selects the output type to the ESCs. Normal is free-running PWM at the motor update rate. OneShot sends one pulse each loop as soon as the motor outputs are calculated. OneShot125 does the same with pulses of 125 to 250 microseconds for ESCs that support it. SITL sends single pulses for both. On the BeagleBone PRU OneShot is normal PWM and OneShot125 free-runs at 2kHz. On Navio OneShot is normal PWM and OneShot125 free-runs every output at 1500Hz, so it is only used if no other output is in use when the motors start, after which outputs that are not motors, such as servos, are held low. Other boards output normal PWM for both. Takes effect after a reboot
+    // @Values: 0:Normal,1:OneShot,2:OneShot125
+    // @User: Advanced
+    AP_GROUPINFO("PWM_TYPE", 16, AP_Motors, _pwm_type, AP_MOTORS_PWM_TYPE_NORMAL),
+
     AP_GROUPEND
 };
 
@@ -218,6 +225,9 @@ void AP_Motors::output(bool thrust_priority, bool reduce_max_pwm)
     // move throttle_low_comp towards desired throttle low comp
     update_throttle_thr_mix();
 
+    // hold the motor writes back so they all go out together
+    hal.rcout->cork();
+
     if (_flags.armed) {
         if (_flags.stabilizing) {
             output_armed_stabilizing(thrust_priority, reduce_max_pwm);
@@ -227,8 +237,26 @@ void AP_Motors::output(bool thrust_priority, bool reduce_max_pwm)
     } else {
         output_disarmed();
     }
+
+    hal.rcout->push();
 };
 
+// setup_output_mode - sets the output mode of the motor channels in mask from the PWM_TYPE parameter
+void AP_Motors::setup_output_mode(uint32_t mask)
+{
+    switch (_pwm_type) {
+    case AP_MOTORS_PWM_TYPE_ONESHOT:
+        hal.rcout->set_output_mode(mask, AP_HAL::RCOutput::MODE_PWM_ONESHOT);
+        break;
+    case AP_MOTORS_PWM_TYPE_ONESHOT125:
+        hal.rcout->set_output_mode(mask, AP_HAL::RCOutput::MODE_PWM_ONESHOT125);
+        break;
+    default:
+        hal.rcout->set_output_mode(mask, AP_HAL::RCOutput::MODE_PWM_NORMAL);
+        break;
+    }
+}
+
 // slow_start - set to true to slew motors from current speed to maximum
 // Note: this must be set immediately before a step up in throttle
 void AP_Motors::slow_start(bool true_false)
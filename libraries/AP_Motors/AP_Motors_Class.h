@@ -48,6 +48,11 @@
 // motor update rate
 #define AP_MOTORS_SPEED_DEFAULT     490 // default output rate to the motors
 
+// motor output types
+#define AP_MOTORS_PWM_TYPE_NORMAL       0   // free-running PWM at the update rate
+#define AP_MOTORS_PWM_TYPE_ONESHOT      1   // one pulse per output() call
+#define AP_MOTORS_PWM_TYPE_ONESHOT125   2   // as ONESHOT with pulses an eighth of the length
+
 #define THROTTLE_CURVE_ENABLED      1   // throttle curve disabled by default
 #define THROTTLE_CURVE_MID_THRUST   52  // throttle which produces 1/2 the maximum thrust.  expressed as a percentage of the full throttle range (i.e 0 ~ 100)
 #define THROTTLE_CURVE_MAX_THRUST   93  // throttle which produces the maximum thrust.  expressed as a percentage of the full throttle range (i.e 0 ~ 100)
@@ -256,6 +261,9 @@ protected:
     // update_throttle_thr_mix - updates thr_low_comp value towards the target
     void                update_throttle_thr_mix();
 
+    // setup_output_mode - sets the output mode of the motor channels in mask from the PWM_TYPE parameter
+    void                setup_output_mode(uint32_t mask);
+
     // return gain scheduling gain based on voltage and air density
     float               get_compensation_gain() const;
 
@@ -289,6 +297,7 @@ protected:
     AP_Float            _thr_mix_min;           // current over which maximum throttle is limited
     AP_Float            _thr_pty_slew_time;     // number of seconds required to remove or restore the thrust priority during a critical loss of thrust event
     AP_Float            _thr_pty_min_pwm_gain;  // sets the minimum pwm that will be sent to the ESC during a critical loss of thrust event as a fraction of the hover throttle
+    AP_Int8             _pwm_type;              // output type to the ESCs, normal PWM or oneshot
 
     // internal variables
     RC_Channel&         _rc_roll;               // roll input in from users is held in servo_out
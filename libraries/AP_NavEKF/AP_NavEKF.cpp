@@ -114,6 +114,12 @@ extern const AP_HAL::HAL& hal;
 #define INIT_GYRO_BIAS_UNCERTAINTY  0.1f
 #define INIT_ACCEL_BIAS_UNCERTAINTY 0.3f
 
+// time constant used to correct the output predictor states towards the filter states (sec)
+#define OUTPUT_PREDICTOR_TAU 0.25f
+
+// output predictor attitude error above which it is reset to the filter attitude (rad)
+#define OUTPUT_PREDICTOR_RESET_ANGLE 0.2f
+
 // Define tuning parameters
 const AP_Param::GroupInfo NavEKF::var_info[] PROGMEM = {
 
@@ -485,6 +491,9 @@ NavEKF::NavEKF(const AP_AHRS *ahrs, AP_Baro &baro, const RangeFinder &rng) :
 {
     AP_Param::setup_object_defaults(this, var_info);
 
+    // blend IMU1 and IMU2 unless AP_AHRS_NavEKF assigns this instance to a single IMU lane
+    imuLaneIndex = -1;
+    laneIMU = lane_imu();
 }
 
 // Check basic filter health metrics and return a consolidated health status
@@ -517,6 +526,8 @@ bool NavEKF::healthy(void) const
 // resets position states to last GPS measurement or to zero if in constant position mode
 void NavEKF::ResetPosition(void)
 {
+    // the output predictor restarts from the reset states
+    outputStatesValid = false;
     if (constPosMode || (PV_AidingMode != AID_ABSOLUTE)) {
         state.position.x = 0;
         state.position.y = 0;
@@ -539,6 +550,8 @@ void NavEKF::ResetPosition(void)
 // Do not reset vertical velocity using GPS as there is baro alt available to constrain drift
 void NavEKF::ResetVelocity(void)
 {
+    // the output predictor restarts from the reset states
+    outputStatesValid = false;
     if (constPosMode || PV_AidingMode != AID_ABSOLUTE) {
          state.velocity.zero();
          state.vel1.zero();
@@ -562,6 +575,8 @@ void NavEKF::ResetVelocity(void)
 // reset the vertical position state using the last height measurement
 void NavEKF::ResetHeight(void)
 {
+    // the output predictor restarts from the reset states
+    outputStatesValid = false;
     // read the altimeter
     readHgtData();
     // write to the state vector
@@ -749,6 +764,8 @@ void NavEKF::UpdateFilter()
 
     // don't run filter updates if states have not been initialised
     if (!statesInitialised) {
+        // discard any IMU data accumulated by a lane that is waiting to start
+        laneIMU = lane_imu();
         return;
     }
 
@@ -821,10 +838,53 @@ void NavEKF::UpdateFilter()
     SelectTasFusion();
     SelectBetaFusion();
 
+    // update the output predictor now the states have been corrected for this time step
+    calcOutputStates();
+
     // stop the timer used for load measurement
     perf_end(_perf_UpdateFilter);
 }
 
+/*
+  Output predictor. Propagates attitude, velocity and position with the
+  same corrected delta angles and nav frame delta velocities as the
+  strapdown equations, and applies a complementary correction towards the
+  filter states. Measurement corrections to the filter states then reach
+  the outputs smoothly over OUTPUT_PREDICTOR_TAU rather than as steps,
+  while the outputs stay current with the IMU.
+*/
+void NavEKF::calcOutputStates(void)
+{
+    // rotation from the output attitude to the filter attitude
+    Quaternion quatErr = outputState.quat.inverse() * state.quat;
+    Vector3f attErr;
+    quatErr.to_axis_angle(attErr);
+
+    // start from the filter states after initialisation or a large attitude reset
+    if (!outputStatesValid || attErr.length() > OUTPUT_PREDICTOR_RESET_ANGLE) {
+        outputState.quat = state.quat;
+        outputState.velocity = state.velocity;
+        outputState.position = state.position;
+        outputStatesValid = true;
+        return;
+    }
+
+    float gain = constrain_float(dtIMUactual / OUTPUT_PREDICTOR_TAU, 0.0f, 1.0f);
+
+    // rotate through the corrected delta angle plus a fraction of the attitude error
+    outputState.quat.rotate(correctedDelAng + attErr * gain);
+    outputState.quat.normalize();
+
+    // integrate the nav frame delta velocity from the strapdown equations
+    Vector3f lastVelocity = outputState.velocity;
+    outputState.velocity += velDotNED * dtIMUactual;
+    outputState.position += (outputState.velocity + lastVelocity) * (dtIMUactual*0.5f);
+
+    // correct towards the filter velocity and position
+    outputState.velocity += (state.velocity - outputState.velocity) * gain;
+    outputState.position += (state.position - outputState.position) * gain;
+}
+
 // select fusion of velocity, position and height measurements
 void NavEKF::SelectVelPosFusion()
 {
@@ -1286,37 +1346,37 @@ void NavEKF::UpdateStrapdownEquationsNED()
 void NavEKF::CovariancePrediction()
 {
     perf_begin(_perf_CovariancePrediction);
-    float windVelSigma; // wind velocity 1-sigma process noise - m/s
-    float dAngBiasSigma;// delta angle bias 1-sigma process noise - rad/s
-    float dVelBiasSigma;// delta velocity bias 1-sigma process noise - m/s
-    float magEarthSigma;// earth magnetic field 1-sigma process noise
-    float magBodySigma; // body magnetic field 1-sigma process noise
-    float daxCov;       // X axis delta angle variance rad^2
-    float dayCov;       // Y axis delta angle variance rad^2
-    float dazCov;       // Z axis delta angle variance rad^2
-    float dvxCov;       // X axis delta velocity variance (m/s)^2
-    float dvyCov;       // Y axis delta velocity variance (m/s)^2
-    float dvzCov;       // Z axis delta velocity variance (m/s)^2
-    float dvx;          // X axis delta velocity (m/s)
-    float dvy;          // Y axis delta velocity (m/s)
-    float dvz;          // Z axis delta velocity (m/s)
-    float dax;          // X axis delta angle (rad)
-    float day;          // Y axis delta angle (rad)
-    float daz;          // Z axis delta angle (rad)
-    float q0;           // attitude quaternion
-    float q1;           // attitude quaternion
-    float q2;           // attitude quaternion
-    float q3;           // attitude quaternion
-    float dax_b;        // X axis delta angle measurement bias (rad)
-    float day_b;        // Y axis delta angle measurement bias (rad)
-    float daz_b;        // Z axis delta angle measurement bias (rad)
-    float dvz_b;        // Z axis delta velocity measurement bias (rad)
+    ftype windVelSigma; // wind velocity 1-sigma process noise - m/s
+    ftype dAngBiasSigma;// delta angle bias 1-sigma process noise - rad/s
+    ftype dVelBiasSigma;// delta velocity bias 1-sigma process noise - m/s
+    ftype magEarthSigma;// earth magnetic field 1-sigma process noise
+    ftype magBodySigma; // body magnetic field 1-sigma process noise
+    ftype daxCov;       // X axis delta angle variance rad^2
+    ftype dayCov;       // Y axis delta angle variance rad^2
+    ftype dazCov;       // Z axis delta angle variance rad^2
+    ftype dvxCov;       // X axis delta velocity variance (m/s)^2
+    ftype dvyCov;       // Y axis delta velocity variance (m/s)^2
+    ftype dvzCov;       // Z axis delta velocity variance (m/s)^2
+    ftype dvx;          // X axis delta velocity (m/s)
+    ftype dvy;          // Y axis delta velocity (m/s)
+    ftype dvz;          // Z axis delta velocity (m/s)
+    ftype dax;          // X axis delta angle (rad)
+    ftype day;          // Y axis delta angle (rad)
+    ftype daz;          // Z axis delta angle (rad)
+    ftype q0;           // attitude quaternion
+    ftype q1;           // attitude quaternion
+    ftype q2;           // attitude quaternion
+    ftype q3;           // attitude quaternion
+    ftype dax_b;        // X axis delta angle measurement bias (rad)
+    ftype day_b;        // Y axis delta angle measurement bias (rad)
+    ftype daz_b;        // Z axis delta angle measurement bias (rad)
+    ftype dvz_b;        // Z axis delta velocity measurement bias (rad)
 
     // calculate covariance prediction process noise
     // use filtered height rate to increase wind process noise when climbing or descending
     // this allows for wind gradient effects.
     // filter height rate using a 10 second time constant filter
-    float alpha = 0.1f * dt;
+    ftype alpha = 0.1f * dt;
     hgtRate = hgtRate * (1.0f - alpha) - state.velocity.z * alpha;
 
     // use filtered height rate to increase wind process noise when climbing or descending
@@ -1979,11 +2039,11 @@ void NavEKF::FuseVelPosNED()
     uint8_t obsIndex;
 
     // declare variables used by state and covariance update calculations
-    float posErr;
+    ftype posErr;
     Vector6 R_OBS; // Measurement variances used for fusion
     Vector6 R_OBS_DATA_CHECKS; // Measurement variances used for data checks only
     Vector6 observation;
-    float SK;
+    ftype SK;
 
     // perform sequential fusion of GPS measurements. This assumes that the
     // errors in the different velocity and position components are
@@ -2354,17 +2414,7 @@ void NavEKF::FuseVelPosNED()
 
                 // update the covariance - take advantage of direct observation of a single state at index = stateIndex to reduce computations
                 // this is a numerically optimised implementation of standard equation P = (I - K*H)*P;
-                for (uint8_t i= 0; i<=21; i++) {
-                    for (uint8_t j= 0; j<=21; j++)
-                    {
-                        KHP[i][j] = Kfusion[i] * P[stateIndex][j];
-                    }
-                }
-                for (uint8_t i= 0; i<=21; i++) {
-                    for (uint8_t j= 0; j<=21; j++) {
-                        P[i][j] = P[i][j] - KHP[i][j];
-                    }
-                }
+                DirectCovarianceUpdate(stateIndex);
             }
         }
     }
@@ -2717,43 +2767,11 @@ void NavEKF::FuseMagnetometer()
         // normalise the quaternion states
         state.quat.normalize();
         // correct the covariance P = (I - K*H)*P
-        // take advantage of the empty columns in KH to reduce the
-        // number of operations
-        for (uint8_t i = 0; i<=21; i++) {
-            for (uint8_t j = 0; j<=3; j++) {
-                KH[i][j] = Kfusion[i] * H_MAG[j];
-            }
-            for (uint8_t j = 4; j<=15; j++) {
-                KH[i][j] = 0.0f;
-            }
-            if (!inhibitMagStates) {
-                for (uint8_t j = 16; j<=21; j++) {
-                    KH[i][j] = Kfusion[i] * H_MAG[j];
-                }
-            } else {
-                for (uint8_t j = 16; j<=21; j++) {
-                    KH[i][j] = 0.0f;
-                }
-            }
-        }
-        for (uint8_t i = 0; i<=21; i++) {
-            for (uint8_t j = 0; j<=21; j++) {
-                KHP[i][j] = 0;
-                for (uint8_t k = 0; k<=3; k++) {
-                    KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                }
-                if (!inhibitMagStates) {
-                    for (uint8_t k = 16; k<=21; k++) {
-                        KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                    }
-                }
-            }
-        }
-        for (uint8_t i = 0; i<=21; i++) {
-            for (uint8_t j = 0; j<=21; j++) {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
+        // take advantage of the empty columns in H to reduce the
+        // number of operations. The magnetic field states are
+        // listed last so they can be dropped when inhibited
+        static const uint8_t magIndex[10] = {0, 1, 2, 3, 16, 17, 18, 19, 20, 21};
+        SparseCovarianceUpdate(H_MAG, magIndex, inhibitMagStates ? 4 : 10);
     }
 
     // force the covariance matrix to be symmetrical and limit the variances to prevent
@@ -3177,43 +3195,10 @@ void NavEKF::FuseOptFlow()
         // normalise the quaternion states
         state.quat.normalize();
         // correct the covariance P = (I - K*H)*P
-        // take advantage of the empty columns in KH to reduce the
+        // take advantage of the empty columns in H to reduce the
         // number of operations
-        for (uint8_t i = 0; i <= 21; i++)
-        {
-            for (uint8_t j = 0; j <= 6; j++)
-            {
-                KH[i][j] = Kfusion[i] * H_LOS[j];
-            }
-            for (uint8_t j = 7; j <= 8; j++)
-            {
-                KH[i][j] = 0.0f;
-            }
-            KH[i][9] = Kfusion[i] * H_LOS[9];
-            for (uint8_t j = 10; j <= 21; j++)
-            {
-                KH[i][j] = 0.0f;
-            }
-        }
-        for (uint8_t i = 0; i <= 21; i++)
-        {
-            for (uint8_t j = 0; j <= 21; j++)
-            {
-                KHP[i][j] = 0.0f;
-                for (uint8_t k = 0; k <= 6; k++)
-                {
-                    KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                }
-                KHP[i][j] = KHP[i][j] + KH[i][9] * P[9][j];
-            }
-        }
-        for (uint8_t i = 0; i <=  21; i++)
-        {
-            for (uint8_t j = 0; j <=  21; j++)
-            {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
+        static const uint8_t losIndex[8] = {0, 1, 2, 3, 4, 5, 6, 9};
+        SparseCovarianceUpdate(H_LOS, losIndex, 8);
     } else if (obsIndex == 0) {
         // store the fact we have failed the X conponent so that a combined X and Y axis pass/fail can be calculated next time round
         flowXfailed = true;
@@ -3231,17 +3216,17 @@ void NavEKF::FuseAirspeed()
     perf_begin(_perf_FuseAirspeed);
 
     // declarations
-    float vn;
-    float ve;
-    float vd;
-    float vwn;
-    float vwe;
-    float EAS2TAS = _ahrs->get_EAS2TAS();
+    ftype vn;
+    ftype ve;
+    ftype vd;
+    ftype vwn;
+    ftype vwe;
+    ftype EAS2TAS = _ahrs->get_EAS2TAS();
     const float R_TAS = sq(constrain_float(_easNoise, 0.5f, 5.0f) * constrain_float(EAS2TAS, 0.9f, 10.0f));
     Vector3f SH_TAS;
-    float SK_TAS;
+    ftype SK_TAS;
     Vector22 H_TAS;
-    float VtasPred;
+    ftype VtasPred;
 
     // health is set bad until test passed
     tasHealth = false;
@@ -3343,42 +3328,8 @@ void NavEKF::FuseAirspeed()
 
             // correct the covariance P = (I - K*H)*P
             // take advantage of the empty columns in H to reduce the number of operations
-            for (uint8_t i = 0; i<=21; i++)
-            {
-                for (uint8_t j = 0; j<=3; j++) KH[i][j] = 0.0f;
-                for (uint8_t j = 4; j<=6; j++)
-                {
-                    KH[i][j] = Kfusion[i] * H_TAS[j];
-                }
-                for (uint8_t j = 7; j<=13; j++) KH[i][j] = 0.0f;
-                for (uint8_t j = 14; j<=15; j++)
-                {
-                    KH[i][j] = Kfusion[i] * H_TAS[j];
-                }
-                for (uint8_t j = 16; j<=21; j++) KH[i][j] = 0.0f;
-            }
-            for (uint8_t i = 0; i<=21; i++)
-            {
-                for (uint8_t j = 0; j<=21; j++)
-                {
-                    KHP[i][j] = 0;
-                    for (uint8_t k = 4; k<=6; k++)
-                    {
-                        KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                    }
-                    for (uint8_t k = 14; k<=15; k++)
-                    {
-                        KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                    }
-                }
-            }
-            for (uint8_t i = 0; i<=21; i++)
-            {
-                for (uint8_t j = 0; j<=21; j++)
-                {
-                    P[i][j] = P[i][j] - KHP[i][j];
-                }
-            }
+            static const uint8_t tasIndex[5] = {4, 5, 6, 14, 15};
+            SparseCovarianceUpdate(H_TAS, tasIndex, 5);
         }
     }
 
@@ -3397,21 +3348,21 @@ void NavEKF::FuseSideslip()
     perf_begin(_perf_FuseSideslip);
 
     // declarations
-    float q0;
-    float q1;
-    float q2;
-    float q3;
-    float vn;
-    float ve;
-    float vd;
-    float vwn;
-    float vwe;
+    ftype q0;
+    ftype q1;
+    ftype q2;
+    ftype q3;
+    ftype vn;
+    ftype ve;
+    ftype vd;
+    ftype vwn;
+    ftype vwe;
     const float R_BETA = 0.03f; // assume a sideslip angle RMS of ~10 deg
     Vector13 SH_BETA;
     Vector8 SK_BETA;
     Vector3f vel_rel_wind;
     Vector22 H_BETA;
-    float innovBeta;
+    ftype innovBeta;
 
     // copy required states to local variable names
     q0 = state.quat[0];
@@ -3535,41 +3486,8 @@ void NavEKF::FuseSideslip()
         // correct the covariance P = (I - K*H)*P
         // take advantage of the empty columns in H to reduce the
         // number of operations
-        for (uint8_t i = 0; i<=21; i++)
-        {
-            for (uint8_t j = 0; j<=6; j++)
-            {
-                KH[i][j] = Kfusion[i] * H_BETA[j];
-            }
-            for (uint8_t j = 7; j<=13; j++) KH[i][j] = 0.0f;
-            for (uint8_t j = 14; j<=15; j++)
-            {
-                KH[i][j] = Kfusion[i] * H_BETA[j];
-            }
-            for (uint8_t j = 16; j<=21; j++) KH[i][j] = 0.0f;
-        }
-        for (uint8_t i = 0; i<=21; i++)
-        {
-            for (uint8_t j = 0; j<=21; j++)
-            {
-                KHP[i][j] = 0;
-                for (uint8_t k = 0; k<=6; k++)
-                {
-                    KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                }
-                for (uint8_t k = 14; k<=15; k++)
-                {
-                    KHP[i][j] = KHP[i][j] + KH[i][k] * P[k][j];
-                }
-            }
-        }
-        for (uint8_t i = 0; i<=21; i++)
-        {
-            for (uint8_t j = 0; j<=21; j++)
-            {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
+        static const uint8_t betaIndex[9] = {0, 1, 2, 3, 4, 5, 6, 14, 15};
+        SparseCovarianceUpdate(H_BETA, betaIndex, 9);
     }
 
     // force the covariance matrix to me symmetrical and limit the variances to prevent ill-condiioning.
@@ -3725,7 +3643,7 @@ bool NavEKF::getPosNED(Vector3f &pos) const
             if ((_ahrs->get_gps().status() >= AP_GPS::GPS_OK_FIX_2D)) {
                 // If the origin has been set and we have GPS, then return the GPS position relative to the origin
                 const struct Location &gpsloc = _ahrs->get_gps().location();
-                Vector2f tempPosNE = location_diff(EKF_origin, gpsloc);
+                Vector2f tempPosNE = originFrame.to_NE(gpsloc);
                 pos.x = tempPosNE.x;
                 pos.y = tempPosNE.y;
                 return false;
@@ -3868,9 +3786,7 @@ bool NavEKF::getLLH(struct Location &loc) const
         nav_filter_status status;
         getFilterStatus(status);
         if (status.flags.horiz_pos_abs || status.flags.horiz_pos_rel) {
-            loc.lat = EKF_origin.lat;
-            loc.lng = EKF_origin.lng;
-            location_offset(loc, state.position.x, state.position.y);
+            originFrame.from_NE(Vector2f(state.position.x, state.position.y), loc);
             return true;
         } else {
             // we could be in constant position mode  becasue the vehicle has taken off without GPS, or has lost GPS
@@ -3883,7 +3799,7 @@ bool NavEKF::getLLH(struct Location &loc) const
                 return true;
             } else {
                 // if no GPS fix, provide last known position before entering the mode
-                location_offset(loc, lastKnownPositionNE.x, lastKnownPositionNE.y);
+                originFrame.offset(loc, lastKnownPositionNE.x, lastKnownPositionNE.y);
                 return false;
             }
         }
@@ -4063,6 +3979,48 @@ void NavEKF::CovarianceInit()
 
 }
 
+/*
+  correct the covariance P = P - K*(H*P) after fusing a scalar observation.
+  H is only non-zero at the nnz states listed in hIndex, so the H*P row is
+  formed in O(22*nnz) operations and applied to P in place, instead of
+  building the full KH and KHP matrices.
+*/
+void NavEKF::SparseCovarianceUpdate(const Vector22 &H, const uint8_t *hIndex, uint8_t nnz)
+{
+    for (uint8_t j = 0; j<=21; j++) {
+        ftype sum = 0.0f;
+        for (uint8_t k = 0; k<nnz; k++) {
+            sum += H[hIndex[k]] * P[hIndex[k]][j];
+        }
+        HP[j] = sum;
+    }
+    ApplyCovarianceCorrection();
+}
+
+// correct the covariance for a direct observation of the state at stateIndex
+// where H*P reduces to a copy of row stateIndex of P
+void NavEKF::DirectCovarianceUpdate(uint8_t stateIndex)
+{
+    for (uint8_t j = 0; j<=21; j++) {
+        HP[j] = P[stateIndex][j];
+    }
+    ApplyCovarianceCorrection();
+}
+
+// subtract K*HP from P. Rows with a zero gain (eg inhibited states) are unchanged
+void NavEKF::ApplyCovarianceCorrection()
+{
+    for (uint8_t i = 0; i<=21; i++) {
+        const ftype gain = Kfusion[i];
+        if (gain == 0.0f) {
+            continue;
+        }
+        for (uint8_t j = 0; j<=21; j++) {
+            P[i][j] -= gain * HP[j];
+        }
+    }
+}
+
 // force symmetry on the covariance matrix to prevent ill-conditioning
 void NavEKF::ForceSymmetry()
 {
@@ -4164,6 +4122,21 @@ void NavEKF::readIMUData()
 {
     const AP_InertialSensor &ins = _ahrs->get_ins();
 
+    if (imuLaneIndex >= 0) {
+        // single IMU lane - use the delta angles and velocities accumulated since the last update
+        accumulateIMUData();
+        dtIMUavg = 1.0f/ins.get_sample_rate();
+        dtIMUactual = max(laneIMU.dt,1.0e-4f);
+        imuSampleTime_ms = hal.scheduler->millis();
+        dAngIMU = laneIMU.delAng;
+        dVelIMU1 = laneIMU.delVel;
+        dtDelVel1 = max(laneIMU.delVelDt,1.0e-4f);
+        dVelIMU2 = dVelIMU1;
+        dtDelVel2 = dtDelVel1;
+        laneIMU = lane_imu();
+        return;
+    }
+
     dtIMUavg = 1.0f/ins.get_sample_rate();
     dtIMUactual = max(ins.get_delta_time(),1.0e-4f);
 
@@ -4199,6 +4172,72 @@ void NavEKF::readIMUData()
     }
 }
 
+// restrict the filter to a single IMU so it can be run as an independent lane
+void NavEKF::setIMULane(int8_t imu_index)
+{
+    imuLaneIndex = imu_index;
+    laneIMU = lane_imu();
+}
+
+// sum the lane IMU delta angles and velocities until the next filter update
+void NavEKF::accumulateIMUData(void)
+{
+    if (imuLaneIndex < 0) {
+        return;
+    }
+    const AP_InertialSensor &ins = _ahrs->get_ins();
+
+    // the delta angle and velocity helpers use dtIMUactual when the sensor can't provide deltas
+    dtIMUactual = max(ins.get_delta_time(),1.0e-4f);
+    laneIMU.dt += dtIMUactual;
+
+    Vector3f dAng;
+    if (readDeltaAngle(imuLaneIndex, dAng)) {
+        laneIMU.delAng += dAng;
+    }
+    Vector3f dVel;
+    float dVel_dt;
+    if (readDeltaVelocity(imuLaneIndex, dVel, dVel_dt)) {
+        laneIMU.delVel += dVel;
+        laneIMU.delVelDt += dVel_dt;
+    }
+}
+
+// copy the EKF_ parameter values from another instance
+void NavEKF::copyParameters(const NavEKF &src)
+{
+    if (&src != this) {
+        AP_Param::copy_object_values(this, &src, var_info);
+    }
+}
+
+// the filter state is the state vector followed by the variables from statesInitialised to
+// gpsCheckStatusLastChange, which are declared together
+uint32_t NavEKF::getCheckpointSize(void) const
+{
+    const uint8_t *vars_start = (const uint8_t *)&statesInitialised;
+    const uint8_t *vars_end = (const uint8_t *)(&gpsCheckStatusLastChange + 1);
+    return sizeof(states) + (vars_end - vars_start);
+}
+
+void NavEKF::saveCheckpoint(uint8_t *buf) const
+{
+    const uint8_t *vars_start = (const uint8_t *)&statesInitialised;
+    memcpy(buf, &states, sizeof(states));
+    memcpy(&buf[sizeof(states)], vars_start, getCheckpointSize() - sizeof(states));
+}
+
+bool NavEKF::restoreCheckpoint(const uint8_t *buf, uint32_t size)
+{
+    if (size != getCheckpointSize()) {
+        return false;
+    }
+    uint8_t *vars_start = (uint8_t *)&statesInitialised;
+    memcpy(&states, buf, sizeof(states));
+    memcpy(vars_start, &buf[sizeof(states)], size - sizeof(states));
+    return true;
+}
+
 // check for new valid GPS data and update stored measurement if available
 void NavEKF::readGpsData()
 {
@@ -4280,7 +4319,7 @@ void NavEKF::readGpsData()
 
         // Convert to local coordinates if we have an origin.
         if (validOrigin) {
-            gpsPosNE = location_diff(EKF_origin, gpsloc);
+            gpsPosNE = originFrame.to_NE(gpsloc);
         }
 
         // calculate a position offset which is applied to NE position and velocity wherever it is used throughout code to allow GPS position jumps to be accommodated gradually
@@ -4660,6 +4699,8 @@ void  NavEKF::getVariances(float &velVar, float &posVar, float &hgtVar, Vector3f
 // Use a function call rather than a constructor to initialise variables because it enables the filter to be re-started in flight if necessary.
 void NavEKF::InitialiseVariables()
 {
+    outputStatesValid = false;
+
     // initialise time stamps
     imuSampleTime_ms = hal.scheduler->millis();
     lastHealthyMagTime_ms = imuSampleTime_ms;
@@ -4761,6 +4802,7 @@ void NavEKF::InitialiseVariables()
     gndOffsetValid =  false;
     flowXfailed = false;
     validOrigin = false;
+    originFrame.clear();
     takeoffExpectedSet_ms = 0;
     expectGndEffectTakeoff = false;
     touchdownExpectedSet_ms = 0;
@@ -5164,6 +5206,7 @@ void NavEKF::performArmingChecks()
 void NavEKF::setOrigin()
 {
     EKF_origin = _ahrs->get_gps().location();
+    originFrame.set_origin(EKF_origin);
     validOrigin = true;
 }
 
@@ -5183,6 +5226,7 @@ bool NavEKF::setOriginLLH(struct Location &loc)
         return false;
     }
     EKF_origin = loc;
+    originFrame.set_origin(EKF_origin);
     validOrigin = true;
     return true;
 }
@@ -5487,6 +5531,18 @@ void NavEKF::getQuaternion(Quaternion& ret) const
     ret = state.quat;
 }
 
+// return the output predictor attitude, NED velocity and NED position
+bool NavEKF::getOutputStates(Quaternion &quat, Vector3f &vel, Vector3f &pos) const
+{
+    if (!outputStatesValid) {
+        return false;
+    }
+    quat = outputState.quat;
+    vel = outputState.velocity;
+    pos = outputState.position;
+    return true;
+}
+
 // update inflight calculaton that determines if GPS data is good enough for reliable navigation
 void NavEKF::calcGpsGoodForFlight(void)
 {
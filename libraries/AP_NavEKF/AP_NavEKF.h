@@ -33,6 +33,15 @@
 
 // #define MATH_CHECK_INDEXES 1
 
+// build the covariance, Kalman gain and fusion arithmetic in double
+// precision. This gives a reference filter for checking the numerical
+// behaviour of the normal single precision build, for example with
+// Tools/Replay. The state vector stays single precision as it is
+// accessed through the Vector3f and Quaternion based state_elements
+#ifndef NAVEKF_DOUBLE_PRECISION
+#define NAVEKF_DOUBLE_PRECISION 0
+#endif
+
 #include <vectorN.h>
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_PX4 || CONFIG_HAL_BOARD == HAL_BOARD_VRBRAIN
@@ -54,7 +63,11 @@ class AP_AHRS;
 class NavEKF
 {
 public:
+#if NAVEKF_DOUBLE_PRECISION
+    typedef double ftype;
+#else
     typedef float ftype;
+#endif
 #if defined(MATH_CHECK_INDEXES) && (MATH_CHECK_INDEXES == 1)
     typedef VectorN<ftype,2> Vector2;
     typedef VectorN<ftype,3> Vector3;
@@ -70,7 +83,7 @@ public:
     typedef VectorN<ftype,15> Vector15;
     typedef VectorN<ftype,22> Vector22;
     typedef VectorN<ftype,31> Vector31;
-    typedef VectorN<ftype,34> Vector34;
+    typedef VectorN<float,34> Vector34;      // state vector, aliased by state_elements
     typedef VectorN<VectorN<ftype,3>,3> Matrix3;
     typedef VectorN<VectorN<ftype,22>,22> Matrix22;
     typedef VectorN<VectorN<ftype,34>,22> Matrix34_50;
@@ -90,7 +103,7 @@ public:
     typedef ftype Vector15[15];
     typedef ftype Vector22[22];
     typedef ftype Vector31[31];
-    typedef ftype Vector34[34];
+    typedef float Vector34[34];              // state vector, aliased by state_elements
     typedef ftype Matrix3[3][3];
     typedef ftype Matrix22[22][22];
     typedef ftype Matrix34_50[34][50];
@@ -179,6 +192,11 @@ public:
     // Returns false if the filter has rejected the attempt to set the origin
     bool setOriginLLH(struct Location &loc);
 
+    // return the North/East frame of the NED origin, for converting
+    // between locations and filter positions. Only valid once the
+    // origin has been set
+    const LocalFrame &getOriginFrame(void) const { return originFrame; }
+
     // return estimated height above ground level
     // return false if ground height is not being estimated.
     bool getHAGL(float &HAGL) const;
@@ -192,6 +210,12 @@ public:
     // return the quaternions defining the rotation from NED to XYZ (body) axes
     void getQuaternion(Quaternion &quat) const;
 
+    // return the output predictor attitude, NED velocity (m/s) and NED position (m)
+    // these are propagated every filter update using the corrected IMU data and
+    // pulled towards the filter states, so they do not step when fusion corrections are applied
+    // returns false if the output states are not yet initialised
+    bool getOutputStates(Quaternion &quat, Vector3f &vel, Vector3f &pos) const;
+
     // return the innovations for the NED Pos, NED Vel, XYZ Mag and Vtas measurements
     void  getInnovations(Vector3f &velInnov, Vector3f &posInnov, Vector3f &magInnov, float &tasInnov) const;
 
@@ -278,6 +302,30 @@ public:
     // returns the system time at which the yaw angle was reset
     uint32_t getLastYawResetAngle(float &yawAng);
 
+    // restrict the filter to the delta angles and velocities from a single IMU so it can be run as
+    // an independent lane alongside other instances. A negative index restores blending of IMU1 and IMU2
+    void setIMULane(int8_t imu_index);
+
+    // return the IMU index used by this filter lane, or -1 if the first two IMUs are blended
+    int8_t getIMULane(void) const { return imuLaneIndex; }
+
+    // accumulate the lane IMU delta angles and velocities without running the filter
+    // this allows lanes to be updated on alternate frames without losing IMU data
+    void accumulateIMUData(void);
+
+    // copy the EKF_ parameter values from the instance that is registered with AP_Param
+    void copyParameters(const NavEKF &src);
+
+    // save the filter state (states, covariances, stored state history, timers and flags) so the
+    // filter can later be restored to the same point, for example by Tools/Replay to resume a log
+    // part way through. The parameters are not included
+    uint32_t getCheckpointSize(void) const;
+    void saveCheckpoint(uint8_t *buf) const;
+
+    // restore a state saved by saveCheckpoint. Returns false if it is the wrong size,
+    // for example from a build with a different NAVEKF_DOUBLE_PRECISION setting
+    bool restoreCheckpoint(const uint8_t *buf, uint32_t size);
+
     static const struct AP_Param::GroupInfo var_info[];
 
 private:
@@ -321,6 +369,16 @@ private:
     // constrain variances (diagonal terms) in the state covariance matrix
     void ConstrainVariances();
 
+    // correct the covariance P = P - K*(H*P) for a scalar observation whose Jacobian H
+    // is non-zero only at the nnz state indices listed in hIndex
+    void SparseCovarianceUpdate(const Vector22 &H, const uint8_t *hIndex, uint8_t nnz);
+
+    // correct the covariance P = P - K*(H*P) for a direct observation of a single state
+    void DirectCovarianceUpdate(uint8_t stateIndex);
+
+    // subtract the outer product of the Kalman gain and the H*P row workspace from P
+    void ApplyCovarianceCorrection();
+
     // constrain states
     void ConstrainStates();
 
@@ -479,6 +537,9 @@ private:
     // update inflight calculaton that determines if GPS data is good enough for reliable navigation
     void calcGpsGoodForFlight(void);
 
+    // propagate the output predictor states and correct them towards the filter states
+    void calcOutputStates(void);
+
     // align the NE earth magnetic field states with the published declination
     void alignMagStateDeclination();
 
@@ -564,6 +625,8 @@ private:
 
 
     // Variables
+    // everything from statesInitialised to gpsCheckStatusLastChange is saved in a checkpoint
+    // as one block of memory, so must be plain data with no pointers
     bool statesInitialised;         // boolean true when filter states have been initialised
     bool velHealth;                 // boolean true if velocity measurements have passed innovation consistency check
     bool posHealth;                 // boolean true if position measurements have passed innovation consistency check
@@ -580,8 +643,7 @@ private:
 
     float gpsNoiseScaler;           // Used to scale the  GPS measurement noise and consistency gates to compensate for operation with small satellite counts
     Vector31 Kfusion;               // Kalman gain vector
-    Matrix22 KH;                    // intermediate result used for covariance updates
-    Matrix22 KHP;                   // intermediate result used for covariance updates
+    Vector22 HP;                    // H*P row workspace used for sequential covariance updates
     Matrix22 P;                     // covariance matrix
     VectorN<state_elements,50> storedStates;       // state vectors stored for the last 50 time steps
     Vector_u32_50 statetimeStamp;    // time stamp for each state vector stored
@@ -693,6 +755,7 @@ private:
     bool prevVehicleArmed;          // vehicleArmed from previous frame
     struct Location EKF_origin;     // LLH origin of the NED axis system - do not change unless filter is reset
     bool validOrigin;               // true when the EKF origin is valid
+    LocalFrame originFrame;         // NE frame of the EKF origin, valid with it
     uint32_t lastGpsVelFail_ms;     // time of last GPS vertical velocity consistency check fail
     Vector3f lastMagOffsets;        // magnetometer offsets returned by compass object from previous update
     bool gpsAidingBad;              // true when GPS position measurements have been consistently rejected by the filter
@@ -815,6 +878,23 @@ private:
     float dtDelVel1;
     float dtDelVel2;
 
+    // single IMU lane processing
+    int8_t imuLaneIndex;            // index of the IMU used by this lane, -1 if IMU1 and IMU2 are blended
+    struct lane_imu {
+        Vector3f delAng;            // summed delta angles since the lane was last updated (rad)
+        Vector3f delVel;            // summed delta velocities since the lane was last updated (m/s)
+        float delVelDt;             // time interval of the summed delta velocities (sec)
+        float dt;                   // time lapsed since the lane was last updated (sec)
+    } laneIMU;
+
+    // output predictor
+    struct {
+        Quaternion quat;            // attitude quaternion
+        Vector3f velocity;          // NED velocity (m/s)
+        Vector3f position;          // NED position (m)
+    } outputState;
+    bool outputStatesValid;         // true when the output states have been initialised from the filter states
+
     // baro ground effect
     bool expectGndEffectTakeoff;      // external state from ArduCopter - takeoff expected
     uint32_t takeoffExpectedSet_ms;   // system time at which expectGndEffectTakeoff was set
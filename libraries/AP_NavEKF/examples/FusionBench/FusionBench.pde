@@ -0,0 +1,259 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Speed and consistency test for the NavEKF sequential covariance update.
+// Replays one GPS, magnetometer, airspeed, sideslip and optical flow
+// fusion cycle through the K*H*P update NavEKF used before, including
+// its skipping of the empty columns of H, and the H*P row update it uses
+// now, checking they produce the same covariance.
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <StorageManager.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_Empty.h>
+
+#define NUM_STATES 22
+#define MAX_NNZ 10
+#define NUM_CYCLES 200
+
+#define ARRAY_LENGTH(x) (sizeof((x))/sizeof((x)[0]))
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+/*
+ *  observation Jacobian sparsity for each fusion step of one cycle, in
+ *  the order NavEKF fuses them
+ */
+static const struct {
+    uint8_t nnz;
+    uint8_t index[MAX_NNZ];
+    float R;
+} fusion_sequence[] = {
+    { 1, {4},                               0.09f },  // VN
+    { 1, {5},                               0.09f },  // VE
+    { 1, {6},                               0.25f },  // VD
+    { 1, {7},                               4.0f  },  // PN
+    { 1, {8},                               4.0f  },  // PE
+    { 1, {9},                               1.0f  },  // HGT
+    { 10, {0,1,2,3,16,17,18,19,20,21},      0.0025f },  // MAGX
+    { 10, {0,1,2,3,16,17,18,19,20,21},      0.0025f },  // MAGY
+    { 10, {0,1,2,3,16,17,18,19,20,21},      0.0025f },  // MAGZ
+    { 5, {4,5,6,14,15},                     2.0f  },  // TAS
+    { 9, {0,1,2,3,4,5,6,14,15},             0.09f },  // BETA
+    { 8, {0,1,2,3,4,5,6,9},                 0.01f },  // LOSX
+    { 8, {0,1,2,3,4,5,6,9},                 0.01f },  // LOSY
+};
+
+static float P_dense[NUM_STATES][NUM_STATES];
+static float P_sparse[NUM_STATES][NUM_STATES];
+static float KH[NUM_STATES][NUM_STATES];
+static float KHP[NUM_STATES][NUM_STATES];
+
+/*
+ *  a well conditioned starting covariance with some cross correlation
+ */
+static void init_covariance(float P[NUM_STATES][NUM_STATES])
+{
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            P[i][j] = (i == j) ? 1.0f + 0.1f*i : 0.01f / (1 + abs((int)i - (int)j));
+        }
+    }
+}
+
+/*
+ *  deterministic Jacobian values for a step so both methods see the same data
+ */
+static float jacobian_value(uint8_t step, uint8_t k)
+{
+    return 0.5f + 0.25f * sinf(0.7f*step + 1.3f*k);
+}
+
+/*
+ *  Kalman gain for a scalar observation
+ */
+static void kalman_gain(float P[NUM_STATES][NUM_STATES], uint8_t step, float H[NUM_STATES], float K[NUM_STATES])
+{
+    const uint8_t nnz = fusion_sequence[step].nnz;
+    const uint8_t *idx = fusion_sequence[step].index;
+    float PHT[NUM_STATES];
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        PHT[i] = 0;
+        for (uint8_t k=0; k<nnz; k++) {
+            PHT[i] += P[i][idx[k]] * H[idx[k]];
+        }
+    }
+    float S = fusion_sequence[step].R;
+    for (uint8_t k=0; k<nnz; k++) {
+        S += H[idx[k]] * PHT[idx[k]];
+    }
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        K[i] = PHT[i] / S;
+    }
+}
+
+static void build_jacobian(uint8_t step, float H[NUM_STATES])
+{
+    memset(H, 0, sizeof(float)*NUM_STATES);
+    for (uint8_t k=0; k<fusion_sequence[step].nnz; k++) {
+        H[fusion_sequence[step].index[k]] = fusion_sequence[step].nnz == 1 ? 1.0f : jacobian_value(step, k);
+    }
+}
+
+/*
+ *  covariance update as previously done in NavEKF. Direct observations
+ *  formed KHP from a row of P, the others built KH in full and skipped the
+ *  empty columns of H when forming KHP
+ */
+static void dense_update(uint8_t step)
+{
+    float H[NUM_STATES], K[NUM_STATES];
+    const uint8_t nnz = fusion_sequence[step].nnz;
+    const uint8_t *idx = fusion_sequence[step].index;
+    build_jacobian(step, H);
+    kalman_gain(P_dense, step, H, K);
+    if (nnz == 1) {
+        for (uint8_t i=0; i<NUM_STATES; i++) {
+            for (uint8_t j=0; j<NUM_STATES; j++) {
+                KHP[i][j] = K[i] * P_dense[idx[0]][j];
+            }
+        }
+    } else {
+        for (uint8_t i=0; i<NUM_STATES; i++) {
+            for (uint8_t j=0; j<NUM_STATES; j++) {
+                KH[i][j] = K[i] * H[j];
+            }
+        }
+        for (uint8_t i=0; i<NUM_STATES; i++) {
+            for (uint8_t j=0; j<NUM_STATES; j++) {
+                KHP[i][j] = 0;
+                for (uint8_t k=0; k<nnz; k++) {
+                    KHP[i][j] += KH[i][idx[k]] * P_dense[idx[k]][j];
+                }
+            }
+        }
+    }
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            P_dense[i][j] -= KHP[i][j];
+        }
+    }
+}
+
+/*
+ *  covariance update as done by NavEKF::SparseCovarianceUpdate() and
+ *  NavEKF::DirectCovarianceUpdate()
+ */
+static void sparse_update(uint8_t step)
+{
+    float H[NUM_STATES], K[NUM_STATES], HP[NUM_STATES];
+    const uint8_t nnz = fusion_sequence[step].nnz;
+    const uint8_t *idx = fusion_sequence[step].index;
+    build_jacobian(step, H);
+    kalman_gain(P_sparse, step, H, K);
+    if (nnz == 1) {
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            HP[j] = P_sparse[idx[0]][j];
+        }
+    } else {
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            float sum = 0;
+            for (uint8_t k=0; k<nnz; k++) {
+                sum += H[idx[k]] * P_sparse[idx[k]][j];
+            }
+            HP[j] = sum;
+        }
+    }
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        if (K[i] == 0.0f) {
+            continue;
+        }
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            P_sparse[i][j] -= K[i] * HP[j];
+        }
+    }
+}
+
+/*
+ *  largest difference between the two covariance matrices, relative to
+ *  the standard deviations of the states each element correlates, so
+ *  rounding in elements near zero is not exaggerated
+ */
+static float max_difference(void)
+{
+    float ret = 0;
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        for (uint8_t j=0; j<NUM_STATES; j++) {
+            float scale = sqrtf(P_dense[i][i] * P_dense[j][j]);
+            ret = max(ret, fabsf(P_dense[i][j] - P_sparse[i][j]) / scale);
+        }
+    }
+    return ret;
+}
+
+/*
+ *  re-inflate the diagonal between cycles as the covariance prediction would
+ */
+static void predict(float P[NUM_STATES][NUM_STATES])
+{
+    for (uint8_t i=0; i<NUM_STATES; i++) {
+        P[i][i] += 0.01f;
+    }
+}
+
+void setup(void)
+{
+    uint32_t start_time, dense_time, sparse_time;
+    uint8_t step;
+    uint16_t cycle;
+
+    hal.console->println("NavEKF sequential fusion test\n");
+
+    // check both methods give the same answer over a single cycle
+    init_covariance(P_dense);
+    init_covariance(P_sparse);
+    for (step=0; step<ARRAY_LENGTH(fusion_sequence); step++) {
+        dense_update(step);
+        sparse_update(step);
+    }
+    float err = max_difference();
+    hal.console->printf_P(PSTR("max relative difference %.3e %s\n"),
+                          err, err < 1.0e-4f ? "PASS" : "FAIL");
+
+    hal.console->println("Speed test:");
+    init_covariance(P_dense);
+    start_time = hal.scheduler->micros();
+    for (cycle=0; cycle<NUM_CYCLES; cycle++) {
+        predict(P_dense);
+        for (step=0; step<ARRAY_LENGTH(fusion_sequence); step++) {
+            dense_update(step);
+        }
+    }
+    dense_time = hal.scheduler->micros() - start_time;
+
+    init_covariance(P_sparse);
+    start_time = hal.scheduler->micros();
+    for (cycle=0; cycle<NUM_CYCLES; cycle++) {
+        predict(P_sparse);
+        for (step=0; step<ARRAY_LENGTH(fusion_sequence); step++) {
+            sparse_update(step);
+        }
+    }
+    sparse_time = hal.scheduler->micros() - start_time;
+
+    hal.console->printf_P(PSTR("dense  %u usec/cycle\n"), (unsigned)(dense_time/NUM_CYCLES));
+    hal.console->printf_P(PSTR("sparse %u usec/cycle\n"), (unsigned)(sparse_time/NUM_CYCLES));
+}
+
+void loop(void)
+{
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
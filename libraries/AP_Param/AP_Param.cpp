@@ -110,10 +110,12 @@ void AP_Param::erase_all(void)
     hdr.magic[1] = k_EEPROM_magic1;
     hdr.revision = k_EEPROM_revision;
     hdr.spare    = 0;
+    hal.storage->begin_transaction();
     eeprom_write_check(&hdr, 0, sizeof(hdr));
 
     // add a sentinal directly after the header
     write_sentinal(sizeof(struct EEPROM_header));
+    hal.storage->end_transaction();
 }
 
 // validate a group info table
@@ -753,9 +755,11 @@ bool AP_Param::save(bool force_save)
     }
 
     // write a new sentinal, then the data, then the header
+    hal.storage->begin_transaction();
     write_sentinal(ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(ap, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(&phdr, ofs, sizeof(phdr));
+    hal.storage->end_transaction();
     return true;
 }
 
@@ -909,6 +913,23 @@ void AP_Param::setup_object_defaults(const void *object_pointer, const struct Gr
     }
 }
 
+// copy the values of scalars in a group from one object to another
+// object of the same class. This does not recurse into other objects
+void AP_Param::copy_object_values(void *dest_pointer, const void *src_pointer, const struct GroupInfo *group_info)
+{
+    uintptr_t dest = (uintptr_t)dest_pointer;
+    uintptr_t src = (uintptr_t)src_pointer;
+    uint8_t type;
+    for (uint8_t i=0;
+         (type=PGM_UINT8(&group_info[i].type)) != AP_PARAM_NONE;
+         i++) {
+        if (type <= AP_PARAM_FLOAT) {
+            uint16_t ofs = PGM_UINT16(&group_info[i].offset);
+            memcpy((void *)(dest + ofs), (const void *)(src + ofs), type_size((enum ap_var_type)type));
+        }
+    }
+}
+
 // set a value directly in an object. This should only be used by
 // example code, not by mainline vehicle code
 void AP_Param::set_object_value(const void *object_pointer, 
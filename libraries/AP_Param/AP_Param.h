@@ -207,6 +207,9 @@ public:
     // load default values for scalars in a group
     static void         setup_object_defaults(const void *object_pointer, const struct GroupInfo *group_info);
 
+    // copy the values of scalars in a group between two objects of the same class
+    static void         copy_object_values(void *dest_pointer, const void *src_pointer, const struct GroupInfo *group_info);
+
     // set a value directly in an object. This should only be used by
     // example code, not by mainline vehicle code
     static void set_object_value(const void *object_pointer, 
@@ -110,13 +110,21 @@ bool AP_Rally::find_nearest_rally_point(const Location &current_loc, RallyLocati
     float min_dis = -1;
     const struct Location &home_loc = _ahrs.get_home();
 
+    // measure all the distances in one frame, so the scale factors
+    // are only worked out once
+    LocalFrame frame;
+    if (!_ahrs.get_local_frame(frame)) {
+        frame.set_origin(current_loc);
+    }
+    Vector2f current_ne = frame.to_NE(current_loc);
+
     for (uint8_t i = 0; i < (uint8_t) _rally_point_total_count; i++) {
         RallyLocation next_rally;
         if (!get_rally_point_with_index(i, next_rally)) {
             continue;
         }
         Location rally_loc = rally_location_to_location(next_rally);
-        float dis = get_distance(current_loc, rally_loc);
+        float dis = (frame.to_NE(rally_loc) - current_ne).length();
 
         if (dis < min_dis || min_dis < 0) {
             min_dis = dis;
@@ -124,7 +132,7 @@ bool AP_Rally::find_nearest_rally_point(const Location &current_loc, RallyLocati
         }
     }
 
-    if ((_rally_limit_km > 0) && (min_dis > _rally_limit_km*1000.0f) && (get_distance(current_loc, home_loc) < min_dis)) {
+    if ((_rally_limit_km > 0) && (min_dis > _rally_limit_km*1000.0f) && ((frame.to_NE(home_loc) - current_ne).length() < min_dis)) {
         return false; // use home position
     }
 
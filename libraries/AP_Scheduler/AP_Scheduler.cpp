@@ -23,6 +23,12 @@
 #include <AP_HAL.h>
 #include <AP_Scheduler.h>
 #include <AP_Param.h>
+#include <AP_Math.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <unistd.h>
+#include <string.h>
+#endif
 
 extern const AP_HAL::HAL& hal;
 
@@ -35,6 +41,23 @@ const AP_Param::GroupInfo AP_Scheduler::var_info[] PROGMEM = {
     // @Values: 0:Disabled,2:ShowSlips,3:ShowOverruns
     // @User: Advanced
     AP_GROUPINFO("DEBUG",    0, AP_Scheduler, _debug, 0),
+
+    // @Param: ORDER
+    // @DisplayName: Scheduler task ordering
+    // @Description: Controls the order in which tasks that are due are run. In table order the tasks late in the table are the first to be skipped when there is not enough time. In deadline order the task closest to slipping a whole interval runs first, so the delay is shared between tasks.
+    // @Values: 0:Table order,1:Deadline order
+    // @User: Advanced
+    AP_GROUPINFO("ORDER",    1, AP_Scheduler, _order, 0),
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // @Param: WORKERS
+    // @DisplayName: Scheduler worker threads
+    // @Description: Number of worker threads used to run tasks that are marked as thread safe, so they don't use main loop time. 0 runs all tasks in the main thread. Workers are started the first time the scheduler runs with this set, and stay running until reboot.
+    // @Range: 0 4
+    // @User: Advanced
+    AP_GROUPINFO("WORKERS",  2, AP_Scheduler, _workers, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -45,7 +68,15 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks)
     _num_tasks = num_tasks;
     _last_run = new uint16_t[_num_tasks];
     memset(_last_run, 0, sizeof(_last_run[0]) * _num_tasks);
+    _run_order = new uint8_t[_num_tasks];
+    _run_slack = NULL;
+    _max_lateness = new uint16_t[_num_tasks];
+    memset(_max_lateness, 0, sizeof(_max_lateness[0]) * _num_tasks);
     _tick_counter = 0;
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    _num_workers = 0;
+    _task_busy = NULL;
+#endif
 }
 
 // one tick has passed
@@ -54,63 +85,135 @@ void AP_Scheduler::tick(void)
     _tick_counter++;
 }
 
+/*
+  fill _run_order with the tasks that are due to run this tick. With
+  SCHED_ORDER enabled they are sorted by the number of ticks left before
+  they slip a whole interval, keeping table order for equal slack
+ */
+uint8_t AP_Scheduler::due_tasks(void)
+{
+    if (_order && _run_slack == NULL) {
+        _run_slack = new int16_t[_num_tasks];
+    }
+    bool sort = _order && _run_slack != NULL;
+
+    uint8_t num_due = 0;
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        uint16_t dt = _tick_counter - _last_run[i];
+        uint16_t interval_ticks = pgm_read_word(&_tasks[i].interval_ticks);
+        if (dt < interval_ticks) {
+            continue;
+        }
+        uint8_t n = num_due;
+        if (sort) {
+            int16_t slack = constrain_int32(2*(int32_t)interval_ticks - dt, INT16_MIN, INT16_MAX);
+            while (n > 0 && _run_slack[n-1] > slack) {
+                _run_order[n] = _run_order[n-1];
+                _run_slack[n] = _run_slack[n-1];
+                n--;
+            }
+            _run_slack[n] = slack;
+        }
+        _run_order[n] = i;
+        num_due++;
+    }
+    return num_due;
+}
+
+/*
+  run a task in the main thread, returning the time it took
+ */
+uint32_t AP_Scheduler::run_task(uint8_t i)
+{
+    _task_time_started = hal.scheduler->micros();
+    task_fn_t func = (task_fn_t)pgm_read_pointer(&_tasks[i].function);
+    current_task = i;
+    func();
+    current_task = -1;
+
+    // record the tick counter when we ran. This drives
+    // when we next run the event
+    _last_run[i] = _tick_counter;
+
+    // work out how long the event actually took
+    uint32_t time_taken = hal.scheduler->micros() - _task_time_started;
+
+    if (time_taken > _task_time_allowed) {
+        // the event overran!
+        if (_debug > 2) {
+            hal.console->printf_P(PSTR("Scheduler overrun task[%u] (%u/%u)\n"), 
+                                  (unsigned)i, 
+                                  (unsigned)time_taken,
+                                  (unsigned)_task_time_allowed);
+        }
+    }
+    return time_taken;
+}
+
 /*
   run one tick
   this will run as many scheduler tasks as we can in the specified time
  */
 void AP_Scheduler::run(uint16_t time_available)
 {
-    uint32_t run_started_usec = hal.scheduler->micros();
-    uint32_t now = run_started_usec;
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    if (_task_busy == NULL && _workers > 0) {
+        start_workers();
+    }
+#endif
 
-    for (uint8_t i=0; i<_num_tasks; i++) {
+    uint8_t num_due = due_tasks();
+
+    for (uint8_t n=0; n<num_due; n++) {
+        uint8_t i = _run_order[n];
         uint16_t dt = _tick_counter - _last_run[i];
         uint16_t interval_ticks = pgm_read_word(&_tasks[i].interval_ticks);
-        if (dt >= interval_ticks) {
-            // this task is due to run. Do we have enough time to run it?
-            _task_time_allowed = pgm_read_word(&_tasks[i].max_time_micros);
-
-            if (dt >= interval_ticks*2) {
-                // we've slipped a whole run of this task!
-                if (_debug > 1) {
-                    hal.console->printf_P(PSTR("Scheduler slip task[%u] (%u/%u/%u)\n"), 
-                                          (unsigned)i, 
-                                          (unsigned)dt,
-                                          (unsigned)interval_ticks,
-                                          (unsigned)_task_time_allowed);
-                }
+
+        // this task is due to run. Do we have enough time to run it?
+        _task_time_allowed = pgm_read_word(&_tasks[i].max_time_micros);
+
+        // keep track of how late tasks are being run
+        if (dt - interval_ticks > _max_lateness[i]) {
+            _max_lateness[i] = dt - interval_ticks;
+        }
+
+        if (dt >= interval_ticks*2) {
+            // we've slipped a whole run of this task!
+            if (_debug > 1) {
+                // also report the worst lateness since the last slip
+                hal.console->printf_P(PSTR("Scheduler slip task[%u] (%u/%u/%u) late %u\n"), 
+                                      (unsigned)i, 
+                                      (unsigned)dt,
+                                      (unsigned)interval_ticks,
+                                      (unsigned)_task_time_allowed,
+                                      (unsigned)task_max_lateness(i));
+            }
+        }
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+        if (_num_workers > 0 && (pgm_read_byte(&_tasks[i].flags) & TASK_THREAD_SAFE)) {
+            if (_task_busy[i]) {
+                // still running from an earlier tick
+                continue;
             }
-            
-            if (_task_time_allowed <= time_available) {
-                // run it
-                _task_time_started = now;
-                task_fn_t func = (task_fn_t)pgm_read_pointer(&_tasks[i].function);
-                current_task = i;
-                func();
-                current_task = -1;
-                
-                // record the tick counter when we ran. This drives
-                // when we next run the event
+            if (dispatch_task(i)) {
                 _last_run[i] = _tick_counter;
-                
-                // work out how long the event actually took
-                now = hal.scheduler->micros();
-                uint32_t time_taken = now - _task_time_started;
-                
-                if (time_taken > _task_time_allowed) {
-                    // the event overran!
-                    if (_debug > 2) {
-                        hal.console->printf_P(PSTR("Scheduler overrun task[%u] (%u/%u)\n"), 
-                                              (unsigned)i, 
-                                              (unsigned)time_taken,
-                                              (unsigned)_task_time_allowed);
-                    }
-                }
-                if (time_taken >= time_available) {
-                    goto update_spare_ticks;
-                }
-                time_available -= time_taken;
+                continue;
+            }
+            if (pgm_read_byte(&_tasks[i].flags) & TASK_WORKER_ONLY) {
+                // wait for a worker on a later tick
+                continue;
             }
+            // all workers are busy, so run it here
+        }
+#endif
+
+        if (_task_time_allowed <= time_available) {
+            uint32_t time_taken = run_task(i);
+            if (time_taken >= time_available) {
+                goto update_spare_ticks;
+            }
+            time_available -= time_taken;
         }
     }
 
@@ -125,11 +228,173 @@ update_spare_ticks:
     }
 }
 
+/*
+  return the largest number of ticks a task has been late by since the
+  last call to max_lateness()
+ */
+uint16_t AP_Scheduler::task_max_lateness(uint8_t task) const
+{
+    if (task >= _num_tasks) {
+        return 0;
+    }
+    return _max_lateness[task];
+}
+
+/*
+  return the largest number of ticks any task has been late by since
+  the last call, and start counting again
+ */
+uint16_t AP_Scheduler::max_lateness(void)
+{
+    uint16_t ret = 0;
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        if (_max_lateness[i] > ret) {
+            ret = _max_lateness[i];
+        }
+        _max_lateness[i] = 0;
+    }
+    return ret;
+}
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+/*
+  start the worker threads used for thread safe tasks
+ */
+void AP_Scheduler::start_workers(void)
+{
+    uint8_t num_workers = constrain_int16(_workers, 0, AP_SCHEDULER_MAX_WORKERS);
+
+    // don't start threads that no task can use
+    bool thread_safe = false;
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        if (pgm_read_byte(&_tasks[i].flags) & TASK_THREAD_SAFE) {
+            thread_safe = true;
+        }
+    }
+    if (!thread_safe) {
+        num_workers = 0;
+    }
+
+    _task_busy = new bool[_num_tasks];
+    memset((void *)_task_busy, 0, sizeof(_task_busy[0]) * _num_tasks);
+
+    for (uint8_t i=0; i<num_workers; i++) {
+        struct worker &w = _worker[_num_workers];
+        w.scheduler = this;
+        w.task = -1;
+        pthread_mutex_init(&w.mutex, NULL);
+        pthread_cond_init(&w.cond, NULL);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (geteuid() == 0) {
+            struct sched_param param = { .sched_priority = AP_SCHEDULER_WORKER_PRIORITY };
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+            pthread_attr_setschedparam(&attr, &param);
+        }
+        int r = pthread_create(&w.thread, &attr, &AP_Scheduler::worker_main, &w);
+        pthread_attr_destroy(&attr);
+        if (r != 0) {
+            hal.console->printf("Scheduler: failed to create worker: %s\n", strerror(r));
+            break;
+        }
+        pthread_setname_np(w.thread, "sched-worker");
+        _num_workers++;
+    }
+}
+
+/*
+  hand a task to an idle worker
+ */
+bool AP_Scheduler::dispatch_task(uint8_t i)
+{
+    for (uint8_t k=0; k<_num_workers; k++) {
+        struct worker &w = _worker[k];
+        if (w.task >= 0) {
+            continue;
+        }
+        pthread_mutex_lock(&w.mutex);
+        _task_busy[i] = true;
+        w.task = i;
+        pthread_cond_signal(&w.cond);
+        pthread_mutex_unlock(&w.mutex);
+        return true;
+    }
+    return false;
+}
+
+/*
+  worker thread main loop. Runs one task at a time as they are handed
+  over by dispatch_task()
+ */
+void *AP_Scheduler::worker_main(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    AP_Scheduler *sched = w->scheduler;
+
+    while (true) {
+        pthread_mutex_lock(&w->mutex);
+        while (w->task < 0) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        uint8_t i = w->task;
+        pthread_mutex_unlock(&w->mutex);
+
+        w->task_time_started = hal.scheduler->micros();
+        task_fn_t func = (task_fn_t)pgm_read_pointer(&sched->_tasks[i].function);
+        func();
+        uint32_t time_taken = hal.scheduler->micros() - w->task_time_started;
+        uint16_t time_allowed = pgm_read_word(&sched->_tasks[i].max_time_micros);
+        if (time_taken > time_allowed && sched->_debug > 2) {
+            hal.console->printf_P(PSTR("Scheduler overrun worker task[%u] (%u/%u)\n"),
+                                  (unsigned)i,
+                                  (unsigned)time_taken,
+                                  (unsigned)time_allowed);
+        }
+
+        pthread_mutex_lock(&w->mutex);
+        sched->_task_busy[i] = false;
+        w->task = -1;
+        pthread_mutex_unlock(&w->mutex);
+    }
+    return NULL;
+}
+
+/*
+  return the worker running in the calling thread
+ */
+struct AP_Scheduler::worker *AP_Scheduler::current_worker(void)
+{
+    pthread_t self = pthread_self();
+    for (uint8_t k=0; k<_num_workers; k++) {
+        if (pthread_equal(_worker[k].thread, self)) {
+            return &_worker[k];
+        }
+    }
+    return NULL;
+}
+#endif // CONFIG_HAL_BOARD
+
 /*
   return number of micros until the current task reaches its deadline
  */
 uint16_t AP_Scheduler::time_available_usec(void)
 {
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    if (_num_workers > 0) {
+        // tasks on a worker are measured against their own budget
+        struct worker *w = current_worker();
+        if (w != NULL && w->task >= 0) {
+            uint32_t allowed = pgm_read_word(&_tasks[w->task].max_time_micros);
+            uint32_t dt = hal.scheduler->micros() - w->task_time_started;
+            if (dt > allowed) {
+                return 0;
+            }
+            return allowed - dt;
+        }
+    }
+#endif
     uint32_t dt = hal.scheduler->micros() - _task_time_started;
     if (dt > _task_time_allowed) {
         return 0;
@@ -25,6 +25,12 @@
 
 #include <AP_Param.h>
 
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <pthread.h>
+#define AP_SCHEDULER_MAX_WORKERS 4
+#define AP_SCHEDULER_WORKER_PRIORITY 11 // realtime priority of worker threads, below the main thread
+#endif
+
 /*
   A task scheduler for APM main loops
 
@@ -33,6 +39,13 @@
 
   To run tasks use scheduler.run(), passing the amount of time that
   the scheduler is allowed to use before it must return
+
+  With SCHED_ORDER set the tasks that are due are run in order of
+  how close they are to slipping a whole interval, rather than in
+  table order, so tasks late in the table are not starved under
+  load. On Linux, tasks flagged TASK_THREAD_SAFE can be run by a
+  pool of SCHED_WORKERS worker threads instead of the main thread.
+  The workers are only started if the task table has such a task
  */
 
 class AP_Scheduler
@@ -40,10 +53,21 @@ class AP_Scheduler
 public:
 	typedef void (*task_fn_t)(void);
 
+	// task flags
+	enum task_flags {
+		// the task does not touch state used by the main loop without
+		// its own locking, so may be run by a worker thread
+		TASK_THREAD_SAFE = (1<<0),
+		// once workers are running the task is never run by the main
+		// thread. If all workers are busy it waits for a later tick
+		TASK_WORKER_ONLY = (1<<1)
+	};
+
 	struct Task {
 		task_fn_t function;
 		uint16_t interval_ticks;
 		uint16_t max_time_micros;
+		uint8_t flags;
 	};
 
 	// initialise scheduler
@@ -73,9 +97,32 @@ public:
     // current running task, or -1 if none. Used to debug stuck tasks
     static int8_t current_task;
 
+    // return the largest number of ticks a task has been run late by
+    // since the last call to max_lateness()
+    uint16_t task_max_lateness(uint8_t task) const;
+
+    // return the largest number of ticks any task has been run late by
+    // since the last call, and reset them. Vehicles log this in PM
+    uint16_t max_lateness(void);
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // set the number of worker threads used when SCHED_WORKERS has
+    // not been set by the user
+    void set_default_workers(uint8_t n) { _workers.set_default(n); }
+#endif
+
 private:
 	// used to enable scheduler debugging
 	AP_Int8 _debug;
+
+    // run due tasks in order of deadline slack rather than table order
+    AP_Int8 _order;
+
+    // fill _run_order with the tasks that are due, returning how many there are
+    uint8_t due_tasks(void);
+
+    // run a task in the main thread, returning the time it took
+    uint32_t run_task(uint8_t i);
 	
 	// progmem list of tasks to run
 	const struct Task *_tasks;
@@ -90,6 +137,16 @@ private:
 	// tick counter at the time we last ran each task
 	uint16_t *_last_run;
 
+    // order in which the due tasks are run this tick
+    uint8_t *_run_order;
+
+    // slack in ticks before each entry in _run_order slips a whole
+    // interval. Only allocated when SCHED_ORDER is enabled
+    int16_t *_run_slack;
+
+    // largest number of ticks each task has been late by
+    uint16_t *_max_lateness;
+
 	// number of microseconds allowed for the current task
 	uint32_t _task_time_allowed;
 
@@ -101,6 +158,34 @@ private:
 
     // number of ticks that _spare_micros is counted over
     uint8_t _spare_ticks;
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    // number of worker threads for thread safe tasks
+    AP_Int8 _workers;
+
+    struct worker {
+        AP_Scheduler *scheduler;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        volatile int16_t task;      // task being run, or -1 if idle
+        uint32_t task_time_started;
+    } _worker[AP_SCHEDULER_MAX_WORKERS];
+    uint8_t _num_workers;
+
+    // true for each task while it is queued or running on a worker
+    volatile bool *_task_busy;
+
+    void start_workers(void);
+
+    // hand a task to an idle worker, returning false if none is idle
+    bool dispatch_task(uint8_t i);
+
+    // return the worker for the calling thread, or NULL for the main thread
+    struct worker *current_worker(void);
+
+    static void *worker_main(void *arg);
+#endif
 };
 
 #endif // AP_SCHEDULER_H
@@ -53,11 +53,12 @@ static uint32_t ins_counter;
 /*
   scheduler table - all regular tasks are listed here, along with how
   often they should be called (in 20ms units) and the maximum time
-  they are expected to take (in microseconds)
+  they are expected to take (in microseconds). Tasks flagged
+  TASK_THREAD_SAFE may be run by a worker thread on Linux
  */
 static const AP_Scheduler::Task scheduler_tasks[] PROGMEM = {
     { ins_update,             1,   1000 },
-    { one_hz_print,          50,   1000 },
+    { one_hz_print,          50,   1000, AP_Scheduler::TASK_THREAD_SAFE },
     { five_second_call,     250,   1800 },
 };
 
@@ -0,0 +1,118 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  vehicle state snapshot
+
+  The main loop publishes a VehicleState once per cycle. Code running
+  in other threads (telemetry, logging, mount, notify) reads a copy of
+  it instead of the AHRS, inertial nav and motors objects the main loop
+  is part way through updating.
+
+  Publishing and reading use a sequence lock, so neither side ever
+  blocks. The sequence number is odd while a publish is in progress,
+  and a reader that sees it odd or changed across its copy tries
+  again. There must be only one publishing thread, and a reader must
+  not have a higher priority than the publisher on the same CPU, or it
+  could spin while the publisher is preempted part way through.
+ */
+
+#ifndef AP_VEHICLESTATE_H
+#define AP_VEHICLESTATE_H
+
+#include <AP_Common.h>
+#include <AP_Math.h>
+
+#define AP_VEHICLESTATE_NUM_OUTPUTS 8
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_APM1 || CONFIG_HAL_BOARD == HAL_BOARD_APM2
+// single threaded, only stop the compiler reordering
+#define AP_VEHICLESTATE_BARRIER() asm volatile("" ::: "memory")
+#else
+#define AP_VEHICLESTATE_BARRIER() __sync_synchronize()
+#endif
+
+struct VehicleState {
+    uint32_t time_us;               // main loop time the state was captured
+
+    // attitude
+    float roll;                     // radians
+    float pitch;                    // radians
+    float yaw;                      // radians, -pi to pi
+    Vector3f gyro;                  // body rates, rad/s
+
+    // position and velocity
+    struct Location location;       // alt in cm above home
+    int32_t home_alt_cm;            // home altitude above sea level
+    Vector3f position_ned;          // relative to the navigation origin, m
+    Vector3f velocity_ned;          // m/s
+
+    // navigation controller
+    Vector3f target_attitude;       // roll, pitch and yaw demands, radians
+    float wp_bearing;               // degrees
+    float wp_distance;              // m
+    float alt_error;                // m
+    float throttle;                 // 0 to 1
+
+    // outputs
+    uint16_t servo_out[AP_VEHICLESTATE_NUM_OUTPUTS]; // PWM, microseconds
+
+    // mode and health
+    uint8_t mode;                   // vehicle specific flight mode number
+    uint8_t failsafe;               // vehicle specific bitmask of active failsafes
+    uint8_t gps_fix;                // AP_GPS::GPS_Status
+    bool armed;
+    bool landed;
+    bool ahrs_healthy;
+};
+
+class AP_VehicleState
+{
+public:
+    AP_VehicleState() : _seq(0) {}
+
+    // publish a new state. Must only be called from one thread
+    void publish(const VehicleState &state) {
+        _seq++;
+        AP_VEHICLESTATE_BARRIER();
+        _state = state;
+        AP_VEHICLESTATE_BARRIER();
+        _seq++;
+    }
+
+    // copy out the latest state. Returns false if nothing has been
+    // published yet
+    bool read(VehicleState &state) const {
+        uint32_t seq;
+        do {
+            seq = _seq;
+            AP_VEHICLESTATE_BARRIER();
+            state = _state;
+            AP_VEHICLESTATE_BARRIER();
+        } while ((seq & 1) || seq != _seq);
+        return seq != 0;
+    }
+
+    // number of states published. A reader can compare this with an
+    // earlier value to tell if there is a new state
+    uint32_t version(void) const { return _seq >> 1; }
+
+private:
+    volatile uint32_t _seq;
+    VehicleState _state;
+};
+
+#endif // AP_VEHICLESTATE_H
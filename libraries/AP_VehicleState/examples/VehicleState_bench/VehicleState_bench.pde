@@ -0,0 +1,169 @@
+/// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: nil -*-
+//
+// Cost of publishing and reading an AP_VehicleState snapshot. On
+// Linux a second thread also publishes continuously while the main
+// thread reads, to check that every copy read is consistent.
+//
+
+#include <AP_Common.h>
+#include <AP_Progmem.h>
+#include <AP_Param.h>
+#include <StorageManager.h>
+#include <AP_Math.h>
+#include <AP_HAL.h>
+#include <AP_HAL_AVR.h>
+#include <AP_HAL_AVR_SITL.h>
+#include <AP_HAL_Linux.h>
+#include <AP_HAL_Empty.h>
+#include <AP_VehicleState.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <pthread.h>
+#endif
+
+const AP_HAL::HAL& hal = AP_HAL_BOARD_DRIVER;
+
+#define NUM_ITERATIONS 10000
+
+static AP_VehicleState vehicle_state;
+
+/*
+  fill a state where every field is derived from one counter, so a
+  reader can tell if it got parts of two different states
+ */
+static void fill_state(VehicleState &s, uint32_t n)
+{
+    float f = n;
+    s.time_us = n;
+    s.roll = f;
+    s.pitch = f;
+    s.yaw = f;
+    s.gyro(f, f, f);
+    s.location.lat = n;
+    s.location.lng = n;
+    s.location.alt = n;
+    s.home_alt_cm = n;
+    s.position_ned(f, f, f);
+    s.velocity_ned(f, f, f);
+    s.target_attitude(f, f, f);
+    s.wp_bearing = f;
+    s.wp_distance = f;
+    s.alt_error = f;
+    s.throttle = f;
+    for (uint8_t i=0; i<AP_VEHICLESTATE_NUM_OUTPUTS; i++) {
+        s.servo_out[i] = n;
+    }
+    s.mode = n;
+    s.failsafe = n;
+    s.gps_fix = n;
+    s.armed = n & 1;
+    s.landed = n & 1;
+    s.ahrs_healthy = n & 1;
+}
+
+static bool check_state(const VehicleState &s)
+{
+    uint32_t n = s.time_us;
+    float f = n;
+    return s.roll == f && s.yaw == f && s.gyro.z == f &&
+        s.location.alt == (int32_t)n && s.velocity_ned.z == f &&
+        s.throttle == f && s.servo_out[AP_VEHICLESTATE_NUM_OUTPUTS-1] == (uint16_t)n &&
+        s.mode == (uint8_t)n && s.ahrs_healthy == (bool)(n & 1);
+}
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+static volatile bool publisher_running;
+
+static void *publisher_thread(void *arg)
+{
+    VehicleState s;
+    uint32_t n = 1;
+    while (publisher_running) {
+        // keep the counter within the 24 bit Location altitude
+        fill_state(s, n);
+        vehicle_state.publish(s);
+        n = (n + 1) & 0x7FFFFF;
+    }
+    return NULL;
+}
+
+static void contention_test(void)
+{
+    pthread_t thread;
+    publisher_running = true;
+    if (pthread_create(&thread, NULL, publisher_thread, NULL) != 0) {
+        hal.console->println("failed to create publisher thread");
+        return;
+    }
+
+    VehicleState s;
+    uint32_t errors = 0;
+    uint32_t last_version = vehicle_state.version();
+    uint32_t updates = 0;
+    uint32_t start_time = hal.scheduler->micros();
+    for (uint32_t i=0; i<NUM_ITERATIONS; i++) {
+        vehicle_state.read(s);
+        if (!check_state(s)) {
+            errors++;
+        }
+        uint32_t version = vehicle_state.version();
+        if (version != last_version) {
+            updates++;
+            last_version = version;
+        }
+    }
+    uint32_t read_time = hal.scheduler->micros() - start_time;
+
+    publisher_running = false;
+    pthread_join(thread, NULL);
+
+    hal.console->printf_P(PSTR("contended read %.3f usec, %u new states seen, %u inconsistent %s\n"),
+                          read_time / (float)NUM_ITERATIONS,
+                          (unsigned)updates,
+                          (unsigned)errors,
+                          errors == 0 ? "PASS" : "FAIL");
+}
+#endif
+
+void setup(void)
+{
+    VehicleState s;
+    uint32_t start_time, publish_time, read_time;
+
+    hal.console->printf_P(PSTR("AP_VehicleState benchmark, state is %u bytes\n"),
+                          (unsigned)sizeof(VehicleState));
+
+    if (vehicle_state.read(s)) {
+        hal.console->println("read before publish should fail: FAIL");
+    }
+
+    start_time = hal.scheduler->micros();
+    for (uint32_t i=0; i<NUM_ITERATIONS; i++) {
+        fill_state(s, i);
+        vehicle_state.publish(s);
+    }
+    publish_time = hal.scheduler->micros() - start_time;
+
+    start_time = hal.scheduler->micros();
+    for (uint32_t i=0; i<NUM_ITERATIONS; i++) {
+        vehicle_state.read(s);
+    }
+    read_time = hal.scheduler->micros() - start_time;
+
+    hal.console->printf_P(PSTR("fill+publish %.3f usec\n"), publish_time / (float)NUM_ITERATIONS);
+    hal.console->printf_P(PSTR("read         %.3f usec\n"), read_time / (float)NUM_ITERATIONS);
+    hal.console->printf_P(PSTR("version %u %s\n"),
+                          (unsigned)vehicle_state.version(),
+                          vehicle_state.version() == NUM_ITERATIONS && check_state(s) ? "PASS" : "FAIL");
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    contention_test();
+#endif
+}
+
+void loop(void)
+{
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
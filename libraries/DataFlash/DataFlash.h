@@ -41,7 +41,8 @@ class DataFlash_Class
 public:
     DataFlash_Class() :
         _startup_messagewriter_factory(NULL),
-        _next_backend(0)
+        _next_backend(0),
+        _ekf_active_lane(0)
         { }
 
     // initialisation
@@ -97,7 +98,8 @@ public:
     void Log_Write_Radio(const mavlink_radio_t &packet);
     void Log_Write_Message(const char *message);
     void Log_Write_Message_P(const prog_char_t *message);
-    void Log_Write_Camera(const AP_AHRS &ahrs, const AP_GPS &gps, const Location &current_loc);
+    void Log_Write_Camera(const AP_AHRS &ahrs, const AP_GPS &gps, const Location &loc, uint32_t time_ms,
+                          int16_t roll_cd, int16_t pitch_cd, uint16_t yaw_cd);
     void Log_Write_ESC(void);
     void Log_Write_Airspeed(AP_Airspeed &airspeed);
     void Log_Write_Attitude(AP_AHRS &ahrs, const Vector3f &targets);
@@ -150,6 +152,9 @@ private:
     #define DATAFLASH_MAX_BACKENDS 2
     uint8_t _next_backend;
     DataFlash_Backend *backends[DATAFLASH_MAX_BACKENDS];
+
+    // EKF lane last reported as active
+    uint8_t _ekf_active_lane;
 };
 
 #endif
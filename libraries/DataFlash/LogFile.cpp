@@ -1112,6 +1112,34 @@ void DataFlash_Class::Log_Write_EKF(AP_AHRS_NavEKF &ahrs, bool optFlowEnabled)
         horizVelFilt : (float)(horizVelFilt)
     };
     WriteBlock(&pkt6, sizeof(pkt6));
+
+    // Write lane packets when a filter lane is run for each IMU
+    if (ahrs.get_ekf_lane_count() > 1) {
+        if (ahrs.get_active_ekf_lane() != _ekf_active_lane) {
+            _ekf_active_lane = ahrs.get_active_ekf_lane();
+            char msg[24];
+            hal.util->snprintf(msg, sizeof(msg), "EKF lane %u active", (unsigned)_ekf_active_lane);
+            Log_Write_Message(msg);
+        }
+        for (uint8_t i=0; i<ahrs.get_ekf_lane_count(); i++) {
+            int8_t imu;
+            float score;
+            uint16_t time_us;
+            if (!ahrs.get_ekf_lane_status(i, imu, score, time_us)) {
+                continue;
+            }
+            struct log_EKFL pktl = {
+                LOG_PACKET_HEADER_INIT(LOG_EKFL_MSG),
+                time_ms : hal.scheduler->millis(),
+                lane    : i,
+                imu     : imu,
+                active  : (uint8_t)(i == ahrs.get_active_ekf_lane()),
+                score   : score,
+                time_us : time_us
+            };
+            WriteBlock(&pktl, sizeof(pktl));
+        }
+    }
 }
 #endif
 
@@ -1151,29 +1179,49 @@ void DataFlash_Class::Log_Write_Radio(const mavlink_radio_t &packet)
     WriteBlock(&pkt, sizeof(pkt)); 
 }
 
-// Write a Camera packet
-void DataFlash_Class::Log_Write_Camera(const AP_AHRS &ahrs, const AP_GPS &gps, const Location &current_loc)
+// Write a Camera packet for a picture taken at time_ms, at loc with
+// the given attitude. The GPS time is moved on from the last fix to
+// time_ms
+void DataFlash_Class::Log_Write_Camera(const AP_AHRS &ahrs, const AP_GPS &gps, const Location &loc, uint32_t time_ms,
+                                       int16_t roll_cd, int16_t pitch_cd, uint16_t yaw_cd)
 {
     int32_t altitude, altitude_rel;
-    if (current_loc.flags.relative_alt) {
-        altitude = current_loc.alt+ahrs.get_home().alt;
-        altitude_rel = current_loc.alt;
+    if (loc.flags.relative_alt) {
+        altitude = loc.alt+ahrs.get_home().alt;
+        altitude_rel = loc.alt;
     } else {
-        altitude = current_loc.alt;
-        altitude_rel = current_loc.alt - ahrs.get_home().alt;
+        altitude = loc.alt;
+        altitude_rel = loc.alt - ahrs.get_home().alt;
+    }
+
+    uint32_t gps_time = gps.time_week_ms();
+    uint16_t gps_week = gps.time_week();
+    if (gps.last_fix_time_ms() != 0) {
+        // the picture can be from before the last fix
+        int32_t ofs_ms = (int32_t)(time_ms - gps.last_fix_time_ms());
+        if (ofs_ms < 0 && (uint32_t)-ofs_ms > gps_time) {
+            gps_time += 7*86400*1000UL;
+            gps_week--;
+        }
+        gps_time += ofs_ms;
+        if (gps_time >= 7*86400*1000UL) {
+            gps_time -= 7*86400*1000UL;
+            gps_week++;
+        }
     }
 
     struct log_Camera pkt = {
         LOG_PACKET_HEADER_INIT(LOG_CAMERA_MSG),
-        gps_time    : gps.time_week_ms(),
-        gps_week    : gps.time_week(),
-        latitude    : current_loc.lat,
-        longitude   : current_loc.lng,
+        time_ms     : time_ms,
+        gps_time    : gps_time,
+        gps_week    : gps_week,
+        latitude    : loc.lat,
+        longitude   : loc.lng,
         altitude    : altitude,
         altitude_rel: altitude_rel,
-        roll        : (int16_t)ahrs.roll_sensor,
-        pitch       : (int16_t)ahrs.pitch_sensor,
-        yaw         : (uint16_t)ahrs.yaw_sensor
+        roll        : roll_cd,
+        pitch       : pitch_cd,
+        yaw         : yaw_cd
     };
     WriteBlock(&pkt, sizeof(pkt));
 }
@@ -283,6 +283,16 @@ struct PACKED log_EKF6 {
     float horizVelFilt;
 };
 
+struct PACKED log_EKFL {
+    LOG_PACKET_HEADER;
+    uint32_t time_ms;
+    uint8_t lane;
+    int8_t imu;
+    uint8_t active;
+    float score;
+    uint16_t time_us;
+};
+
 struct PACKED log_Cmd {
     LOG_PACKET_HEADER;
     uint32_t time_ms;
@@ -312,6 +322,7 @@ struct PACKED log_Radio {
 
 struct PACKED log_Camera {
     LOG_PACKET_HEADER;
+    uint32_t time_ms;
     uint32_t gps_time;
     uint16_t gps_week;
     int32_t  latitude;
@@ -535,7 +546,7 @@ Format characters in the format string for binary log messages
     { LOG_RADIO_MSG, sizeof(log_Radio), \
       "RAD", "IBBBBBHH", "TimeMS,RSSI,RemRSSI,TxBuf,Noise,RemNoise,RxErrors,Fixed" }, \
     { LOG_CAMERA_MSG, sizeof(log_Camera), \
-      "CAM", "IHLLeeccC","GPSTime,GPSWeek,Lat,Lng,Alt,RelAlt,Roll,Pitch,Yaw" }, \
+      "CAM", "IIHLLeeccC","TimeMS,GPSTime,GPSWeek,Lat,Lng,Alt,RelAlt,Roll,Pitch,Yaw" }, \
     { LOG_ARSP_MSG, sizeof(log_AIRSPEED), \
       "ARSP",  "Iffcff",   "TimeMS,Airspeed,DiffPress,Temp,RawPress,Offset" }, \
     { LOG_CURRENT_MSG, sizeof(log_Current), \
@@ -626,7 +637,9 @@ Format characters in the format string for binary log messages
     { LOG_GYR3_MSG, sizeof(log_GYRO), \
       "GYR3", "IIfff",        "TimeMS,TimeUS,GyrX,GyrY,GyrZ" }, \
     { LOG_EKF6_MSG, sizeof(log_EKF6), \
-      "EKF6","IHfffff","TimeMS,GCS,VVD,GSE,PDR,VVF,HVF" }
+      "EKF6","IHfffff","TimeMS,GCS,VVD,GSE,PDR,VVF,HVF" }, \
+    { LOG_EKFL_MSG, sizeof(log_EKFL), \
+      "EKFL","IBbBfH","TimeMS,Lane,IMU,Act,Score,TimeUS" }
 
 #if HAL_CPU_CLASS >= HAL_CPU_CLASS_75
 #define LOG_COMMON_STRUCTURES LOG_BASE_STRUCTURES, LOG_EXTRA_STRUCTURES
@@ -696,6 +709,7 @@ Format characters in the format string for binary log messages
 #define LOG_DF_MAV_STATS  184
 #define LOG_EKF6_MSG      185
 #define LOG_R10CGIMBAL_MSG 186
+#define LOG_EKFL_MSG      187
 
 // message types 200 to 210 reversed for GPS driver use
 // message types 211 to 220 reversed for autotune use
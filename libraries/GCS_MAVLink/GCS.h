@@ -150,9 +150,9 @@ public:
     /*
       send a statustext message to all active MAVLink
       connections. This function is static so it can be called from
-      any library
+      any library. The message is a printf style format
     */
-    static void send_statustext_all(const prog_char_t *msg);
+    static void send_statustext_all(const prog_char_t *fmt, ...);
 
     /*
       send a MAVLink message to all components with this vehicle's system id
@@ -165,8 +165,22 @@ public:
     */
     static void send_on_all_channels(const mavlink_message_t* msg) { routing.send_on_all_channels(msg); }
 
+    // send a message if there is room for it, without sending or
+    // adding to the deferred message queue. Returns true if sent
+    bool send_message_now(enum ap_message id);
+
+    /*
+      lock the links while a message is being built and sent. When
+      built with MAVLINK_SEND_LOCK a vehicle may send from a scheduler
+      worker thread as well as the main loop, so the lock is recursive
+      and is held for one message at a time. Otherwise these do nothing
+    */
+    static void send_lock(void) { comm_send_lock(MAVLINK_COMM_0); }
+    static void send_unlock(void) { comm_send_unlock(MAVLINK_COMM_0); }
+
 private:
     void        handleMessage(mavlink_message_t * msg);
+    void        queue_message(enum ap_message id);
 
     /// The stream we are communicating over
     AP_HAL::UARTDriver *_port;
@@ -286,6 +300,7 @@ private:
     void handle_log_message(mavlink_message_t *msg, DataFlash_Class &dataflash);
     void handle_log_send(DataFlash_Class &dataflash);
     void handle_log_send_listing(DataFlash_Class &dataflash);
+    void handle_log_send_blocks(DataFlash_Class &dataflash);
     bool handle_log_send_data(DataFlash_Class &dataflash);
 
     void handle_mission_request_list(AP_Mission &mission, mavlink_message_t *msg);
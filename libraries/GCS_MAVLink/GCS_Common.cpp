@@ -627,6 +627,7 @@ void GCS_MAVLINK::handle_param_set(mavlink_message_t *msg, DataFlash_Class *Data
 void
 GCS_MAVLINK::send_text(gcs_severity severity, const char *str)
 {
+    send_lock();
     if (severity != SEVERITY_LOW && 
         comm_get_txspace(chan) >= 
         MAVLINK_NUM_NON_PAYLOAD_BYTES+MAVLINK_MSG_ID_STATUSTEXT_LEN) {
@@ -639,6 +640,7 @@ GCS_MAVLINK::send_text(gcs_severity severity, const char *str)
         strncpy((char *)s->text, str, sizeof(s->text));
         send_message(MSG_STATUSTEXT);
     }
+    send_unlock();
 }
 
 void
@@ -815,6 +817,26 @@ GCS_MAVLINK::handle_gps_inject(const mavlink_message_t *msg, AP_GPS &gps)
 
 // send a message using mavlink, handling message queueing
 void GCS_MAVLINK::send_message(enum ap_message id)
+{
+    send_lock();
+    queue_message(id);
+    send_unlock();
+}
+
+// send a message if there is room for it, bypassing the deferred queue
+bool GCS_MAVLINK::send_message_now(enum ap_message id)
+{
+    send_lock();
+    bool ret = try_send_message(id);
+    send_unlock();
+    return ret;
+}
+
+/*
+  send a message, or add it to the deferred queue if there is no room
+  for it. Called with the send lock held
+ */
+void GCS_MAVLINK::queue_message(enum ap_message id)
 {
     uint8_t i, nextid;
 
@@ -903,9 +925,11 @@ GCS_MAVLINK::update(void (*run_cli)(AP_HAL::UARTDriver *))
             if (msg_snoop != NULL) {
                 msg_snoop(&msg);
             }
+            send_lock();
             if (routing.check_and_forward(chan, &msg)) {
                 handleMessage(&msg);
             }
+            send_unlock();
         }
     }
 
@@ -1188,20 +1212,26 @@ void GCS_MAVLINK::send_ahrs(AP_AHRS &ahrs)
 /*
   send a statustext message to all active MAVLink connections
  */
-void GCS_MAVLINK::send_statustext_all(const prog_char_t *msg)
+void GCS_MAVLINK::send_statustext_all(const prog_char_t *fmt, ...)
 {
+    char msg2[50];
+    va_list arg_list;
+    va_start(arg_list, fmt);
+    hal.util->vsnprintf_P(msg2, sizeof(msg2), fmt, arg_list);
+    va_end(arg_list);
+
+    send_lock();
     for (uint8_t i=0; i<MAVLINK_COMM_NUM_BUFFERS; i++) {
         if ((1U<<i) & mavlink_active) {
             mavlink_channel_t chan = (mavlink_channel_t)(MAVLINK_COMM_0+i);
             if (comm_get_txspace(chan) >= MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_STATUSTEXT_LEN) {
-                char msg2[50];
-                strncpy_P(msg2, msg, sizeof(msg2));
                 mavlink_msg_statustext_send(chan,
                                             SEVERITY_HIGH,
                                             msg2);
             }
         }
     }
+    send_unlock();
 }
 
 // report battery2 state
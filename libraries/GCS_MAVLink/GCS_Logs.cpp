@@ -145,12 +145,21 @@ void GCS_MAVLINK::handle_log_request_end(mavlink_message_t *msg, DataFlash_Class
  */
 void GCS_MAVLINK::handle_log_send(DataFlash_Class &dataflash)
 {
+    send_lock();
     if (_log_listing) {
         handle_log_send_listing(dataflash);
     }
-    if (!_log_sending) {
-        return;
+    if (_log_sending) {
+        handle_log_send_blocks(dataflash);
     }
+    send_unlock();
+}
+
+/**
+   send a batch of log data blocks. Called with the send lock held
+ */
+void GCS_MAVLINK::handle_log_send_blocks(DataFlash_Class &dataflash)
+{
     uint8_t num_sends = 1;
     if (chan == MAVLINK_COMM_0 && hal.gpio->usb_connected()) {
         // when on USB we can send a lot more data
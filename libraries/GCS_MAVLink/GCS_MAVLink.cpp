@@ -31,6 +31,10 @@ This provides some support code and variables for MAVLink enabled sketches
 #include "include/mavlink/v1.0/mavlink_helpers.h"
 #endif
 
+#if MAVLINK_SEND_LOCK
+#include <pthread.h>
+#endif
+
 AP_HAL::UARTDriver	*mavlink_comm_0_port;
 AP_HAL::UARTDriver	*mavlink_comm_1_port;
 #if MAVLINK_COMM_NUM_BUFFERS > 2
@@ -49,6 +53,45 @@ MAVLink_routing GCS_MAVLINK::routing;
 // other targets
 void (*GCS_MAVLINK::msg_snoop)(const mavlink_message_t* msg) = NULL;
 
+#if MAVLINK_SEND_LOCK
+// lock held while sending, see GCS_MAVLINK::send_lock()
+static pthread_mutex_t mavlink_send_mutex;
+static pthread_once_t mavlink_send_mutex_once = PTHREAD_ONCE_INIT;
+
+/*
+  the lock is recursive, and uses priority inheritance so the main
+  loop is never left waiting on a lower priority worker that has been
+  preempted while holding it
+ */
+static void comm_send_mutex_init(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&mavlink_send_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/*
+  take the send lock. A single lock is used for all channels, as
+  message routing and statustext send on several channels at once
+ */
+void comm_send_lock(mavlink_channel_t chan)
+{
+    pthread_once(&mavlink_send_mutex_once, comm_send_mutex_init);
+    pthread_mutex_lock(&mavlink_send_mutex);
+}
+
+/*
+  release the send lock
+ */
+void comm_send_unlock(mavlink_channel_t chan)
+{
+    pthread_mutex_unlock(&mavlink_send_mutex);
+}
+#endif // MAVLINK_SEND_LOCK
+
 /*
   lock a channel, preventing use by MAVLink
  */
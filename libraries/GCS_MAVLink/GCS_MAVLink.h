@@ -16,6 +16,22 @@
 
 #define MAVLINK_SEND_UART_BYTES(chan, buf, len) comm_send_buffer(chan, buf, len)
 
+// vehicles that send from a scheduler worker thread as well as the
+// main loop are built with MAVLINK_SEND_LOCK set to 1
+#ifndef MAVLINK_SEND_LOCK
+#define MAVLINK_SEND_LOCK 0
+#endif
+#if MAVLINK_SEND_LOCK && CONFIG_HAL_BOARD != HAL_BOARD_LINUX
+#error MAVLINK_SEND_LOCK is only supported on Linux
+#endif
+
+#if MAVLINK_SEND_LOCK
+// take the send lock around each packet, so packets sent by
+// different threads are never interleaved on a link
+#define MAVLINK_START_UART_SEND(chan, length) comm_send_lock(chan)
+#define MAVLINK_END_UART_SEND(chan, length) comm_send_unlock(chan)
+#endif
+
 // define our own MAVLINK_MESSAGE_CRC() macro to allow it to be put
 // into progmem
 #define MAVLINK_MESSAGE_CRC(msgid) mavlink_get_message_crc(msgid)
@@ -90,6 +106,20 @@ static inline void comm_send_ch(mavlink_channel_t chan, uint8_t ch)
 
 void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len);
 
+/// Take and release the lock used to send on a MAVLink channel. Only
+/// does anything when built with MAVLINK_SEND_LOCK, where telemetry
+/// may be sent from more than one thread
+///
+/// @param chan		Channel being sent on
+///
+#if MAVLINK_SEND_LOCK
+void comm_send_lock(mavlink_channel_t chan);
+void comm_send_unlock(mavlink_channel_t chan);
+#else
+static inline void comm_send_lock(mavlink_channel_t chan) {}
+static inline void comm_send_unlock(mavlink_channel_t chan) {}
+#endif
+
 /// Read a byte from the nominated MAVLink channel
 ///
 /// @param chan		Channel to receive on
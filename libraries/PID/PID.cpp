@@ -21,12 +21,12 @@ const AP_Param::GroupInfo PID::var_info[] PROGMEM = {
 
 float PID::get_pid(float error, float scaler)
 {
-    uint32_t tnow = hal.scheduler->millis();
+    uint32_t tnow = hal.scheduler->micros();
     uint32_t dt = tnow - _last_t;
     float output            = 0;
     float delta_time;
 
-    if (_last_t == 0 || dt > 1000) {
+    if (_last_t == 0 || dt > 1000000UL) {
         dt = 0;
 
 		// if this PID hasn't been used for a full second then zero
@@ -37,7 +37,7 @@ float PID::get_pid(float error, float scaler)
     }
     _last_t = tnow;
 
-    delta_time = (float)dt / 1000.0f;
+    delta_time = (float)dt * 1.0e-6f;
 
     // Compute proportional component
     output += error * _kp;
@@ -100,6 +100,8 @@ public:
 
     AP_Int16 gps_spd_err; // reported GPS speed accuracy in cm/s
 
+    AP_Int8  pwm_timing; // simulate the time taken for PWM pulses to reach the ESCs
+
 	void simstate_send(mavlink_channel_t chan);
 
     void Log_Write_SIMSTATE(DataFlash_Class &dataflash);